@@ -7,8 +7,45 @@
 #define EXPORT
 #endif
 
+#include <stddef.h>
+
 EXPORT void punktRun(const char *graph_source_cstr, const char *font_path_relative_to_project_root_cstr);
 
+// like punktRun, but reads the graph from a file and follows its changes until the window is closed
+EXPORT void punktRunWatched(const char *graph_path_cstr, const char *font_path_relative_to_project_root_cstr);
+
+// Lays out the graph file without opening a window and stores the result as a binary snapshot (see
+// punkt/snapshot.hpp). Returns 0 on success.
+EXPORT int punktConvertToSnapshot(const char *graph_path_cstr, const char *snapshot_path_cstr,
+                                  const char *font_path_relative_to_project_root_cstr);
+
+// Lays out the graph file without opening a window and writes the layout as "plain" (graphviz -Tplain), "json" or "svg"
+// (see punkt/layout_export.hpp) to output_path, or to stdout if it is null. Returns 0 on success.
+EXPORT int punktExportLayout(const char *graph_path_cstr, const char *output_path_cstr, const char *format_cstr,
+                             const char *font_path_relative_to_project_root_cstr);
+
+// Lays out many graph files concurrently on n_threads threads (0 = one per hardware thread) and writes each as a
+// snapshot into output_dir. Directories among the paths contribute their `.dot` files. Prints per file timings and
+// failures, a failing graph does not stop the others. Returns 0 if all graphs were laid out.
+EXPORT int punktRunBatch(const char *const *graph_paths_cstr, size_t n_graph_paths, const char *output_dir_cstr,
+                         const char *font_path_relative_to_project_root_cstr, size_t n_threads);
+
+// Runs a layout server on a Unix domain socket (see punkt/layout_server.hpp) until the process is killed, with
+// n_threads workers (0 = one per hardware thread) and a best effort per request timeout (0 = none, see
+// LayoutServerConfig::m_request_timeout). Returns 1 if the server cannot be started.
+EXPORT int punktServe(const char *socket_path_cstr, const char *font_path_relative_to_project_root_cstr,
+                      size_t n_threads, size_t request_timeout_ms);
+
+// shows a snapshot written by punktConvertToSnapshot, no parsing or layout involved
+EXPORT void punktRunSnapshot(const char *snapshot_path_cstr, const char *font_path_relative_to_project_root_cstr);
+
+// applies a layout tuning profile (see punkt/layout/x_opt_profile.hpp) to all graphs laid out afterwards. Returns 1
+// (and changes nothing) if the profile file cannot be read or parsed.
+EXPORT int punktLoadProfile(const char *profile_path_cstr);
+
+// reuses finished layouts from (and stores them in) the given directory, see punkt/layout/layout_cache.hpp
+EXPORT void punktSetLayoutCacheDirectory(const char *cache_dir_cstr);
+
 #undef EXPORT
 
 #endif
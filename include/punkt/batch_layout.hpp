@@ -0,0 +1,29 @@
+#pragma once
+
+#include "punkt/glyph_loader/glyph_loader.hpp"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace punkt {
+struct BatchLayoutResult {
+    std::filesystem::path m_graph_path, m_output_path;
+    bool m_is_ok{};
+    // why the graph failed, empty if it did not
+    std::string m_error;
+    double m_parse_ms{}, m_layout_ms{}, m_write_ms{};
+};
+
+// The graph files to lay out for the given paths: files are taken as they are, directories contribute their `.dot`
+// files (not recursively, sorted by name).
+std::vector<std::filesystem::path> collectBatchGraphPaths(const std::vector<std::filesystem::path> &paths);
+
+// Lays out the graph files concurrently on a pool of n_threads (0 = one per hardware thread) and writes each as a
+// snapshot `<output_dir>/<file stem>.punktsnap` (see punkt/snapshot.hpp). All graphs share the glyph loader, which
+// only serves glyph metrics during layout, so a headless one is enough. A graph that fails (or whose output name is
+// taken by an earlier graph) is reported in its result and does not affect the others. The results are in input order.
+std::vector<BatchLayoutResult> runBatchLayout(const std::vector<std::filesystem::path> &graph_paths,
+                                              const std::filesystem::path &output_dir,
+                                              render::glyph::GlyphLoader &glyph_loader, size_t n_threads = 0);
+}
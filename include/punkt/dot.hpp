@@ -9,6 +9,13 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <functional>
+#include <chrono>
+#include <optional>
+#include <utility>
+
+namespace punkt::render {
+struct RenderInstanceData;
+}
 
 namespace punkt {
 using Attrs = std::unordered_map<std::string_view, std::string_view>;
@@ -41,6 +48,8 @@ struct EdgeRenderAttrs {
 struct Edge {
     std::string_view m_source;
     std::string_view m_dest;
+    // dense index of the edge within its graph, assigned together with Digraph::m_edge_layout_weights
+    size_t m_id{};
     Attrs m_attrs;
     EdgeRenderAttrs m_render_attrs{};
 
@@ -64,6 +73,8 @@ struct RankDirConfig {
 
 struct Node {
     std::string_view m_name;
+    // dense index of the node within its graph, assigned once the node set is final (after ghost node insertion)
+    size_t m_id{};
     std::vector<std::reference_wrapper<Edge> > m_ingoing;
     std::vector<Edge> m_outgoing;
     Attrs m_attrs;
@@ -86,6 +97,38 @@ struct DigraphRenderAttrs {
     std::vector<GlyphQuad> m_label_quads;
 };
 
+// statistics of one iteration of the barycenter x optimization, see Digraph::m_x_opt_trajectory
+struct XOptIterationStats {
+    size_t m_stage{}, m_iteration{};
+    // sum of the absolute x movement of all nodes during the iteration
+    float m_displacement{};
+    // sum of layout weight * |dx| over all edges
+    float m_energy{};
+    // number of horizontally adjacent node pairs whose boxes overlap
+    size_t m_n_overlaps{};
+};
+
+// time usage of one layout stage in the anytime layout mode, see Digraph::m_time_budget_report
+struct LayoutStageTimeUsage {
+    std::string_view m_stage;
+    // the share of the `punkttimebudget` deadline the stage was allowed to use and the time it actually took
+    float m_budget_ms{}, m_used_ms{};
+    // whether the stage stopped early (keeping its best solution so far) because its budget ran out
+    bool m_was_cut_short{};
+};
+
+// what Digraph::update changed in a laid out graph since its last layout, see Digraph::relayout
+struct LayoutDirtyRegion {
+    std::unordered_set<std::string_view> m_added_nodes;
+    // (source node, index into its m_outgoing) of every added edge
+    std::vector<std::pair<std::string_view, size_t> > m_added_edges;
+    // set by changes the incremental relayout cannot handle (graph attributes, redeclared nodes, rank constraints and
+    // clusters)
+    bool m_requires_full_layout{};
+
+    [[nodiscard]] bool isEmpty() const;
+};
+
 struct Digraph;
 
 struct GraphRenderer {
@@ -97,6 +140,12 @@ struct GraphRenderer {
 
     void initialize(const Digraph &dg, render::glyph::GlyphLoader &glyph_loader);
 
+    // initializes the renderer from instance data that was built off the render thread
+    void initialize(render::RenderInstanceData instance_data, render::glyph::GlyphLoader &glyph_loader);
+
+    // replaces what is drawn (e.g. by a refined layout) without resetting the camera. Call between frames.
+    void uploadInstanceData(render::RenderInstanceData instance_data) const;
+
     void notifyFramebufferSize(int width, int height) const;
 
     void renderFrame() const;
@@ -118,12 +167,27 @@ struct Digraph {
     std::unordered_set<size_t> m_io_port_ranks;
     std::unordered_map<std::string_view, size_t> m_cluster_order;
     std::unordered_map<std::string_view, Digraph> m_clusters;
+    // name of every node owned by one of the clusters (or their clusters) -> name of that cluster. The parser creates
+    // @link nodes from it only for the names that are actually referenced outside the owning cluster.
+    std::unordered_map<std::string_view, std::string_view> m_cluster_node_owners;
     std::unordered_map<std::string_view, Node> m_nodes;
     std::vector<size_t> m_rank_counts;
     std::vector<std::vector<std::string_view> > m_per_rank_orderings;
-    std::vector<std::unordered_map<std::string_view, size_t> > m_per_rank_orderings_index;
+    // index of every node within its rank ordering, indexed by Node::m_id
+    std::vector<size_t> m_node_positions;
+    // layout weight of every edge (see layout::getEdgeLayoutWeight), indexed by Edge::m_id
+    std::vector<size_t> m_edge_layout_weights;
     std::vector<std::tuple<std::string_view, std::vector<std::string_view> > > m_rank_constraints;
     size_t m_n_ghost_nodes{};
+    // per-iteration statistics of the most recent x optimization run (instrumentation only), both engines only record
+    // them if BARYCENTER_X_OPTIMIZATION_RECORD_TRAJECTORY is set.
+    std::vector<XOptIterationStats> m_x_opt_trajectory;
+    // deadline of the anytime layout mode (graph attr `punkttimebudget`, inherited by clusters), unset = unbounded
+    std::optional<std::chrono::steady_clock::time_point> m_layout_deadline;
+    // one entry per time budgeted stage of the most recent preprocess run (only filled in the anytime layout mode)
+    std::vector<LayoutStageTimeUsage> m_time_budget_report;
+    // changes made by update() since the last layout (only tracked once the graph has been laid out)
+    LayoutDirtyRegion m_dirty_region;
     // graph attrs also exist. They store attributes like ranksep, nodesep, etc.
     Attrs m_attrs;
     DigraphRenderAttrs m_render_attrs;
@@ -141,6 +205,12 @@ struct Digraph {
 
     void preprocess(render::glyph::GlyphLoader &glyph_loader, std::string_view id_in_parent = "");
 
+    // Brings the layout up to date after update(). Added nodes and edges are laid out incrementally: existing nodes
+    // keep their ranks and order, the new ones are ranked next to their neighbours and only the affected ranks are
+    // re-legalized. Other changes fall back to a full layout. Throws UnsupportedRelayoutException for changed graphs
+    // with clusters.
+    void relayout(render::glyph::GlyphLoader &glyph_loader);
+
     void fuseClusterLinksIntoClusterSuperNodes();
 
     void convertParentLinksToIOPorts(std::string_view id_in_parent);
@@ -168,7 +238,10 @@ struct Digraph {
     void constructFromTokens(std::span<tokenizer::Token> &tokens);
 
 private:
-    void swapNodesOnRank(std::string_view a, std::string_view b);
+    void swapNodesOnRank(size_t rank, size_t a_idx, size_t b_idx);
+
+    // undoes preprocessing (removes the ghost nodes and resets all render attributes) so preprocess can run again
+    void resetLayout();
 };
 
 class UnexpectedTokenException final : std::exception {
@@ -190,6 +263,10 @@ public:
     explicit IllegalAttributeException(std::string attr, std::string value);
 };
 
+class UnsupportedRelayoutException final : std::exception {
+    [[nodiscard]] const char *what() const noexcept override;
+};
+
 class ReservedIdentifierException final : std::exception {
     const std::string m_name;
 
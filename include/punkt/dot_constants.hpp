@@ -2,6 +2,8 @@
 
 #include "punkt/utils/int_types.hpp"
 
+#include <cstdint>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -50,6 +52,26 @@ extern ssize_t BARYCENTER_ORDERING_MAX_ITERS_PER_DIRECTION;
 extern float BUBBLE_ORDERING_CROSSOVER_COUNT_WEIGHT;
 extern float BUBBLE_ORDERING_DX_WEIGHT;
 extern ssize_t BUBBLE_ORDERING_MAX_ITERS;
+// `punktparallelsweep=auto` (the default) runs the ordering barycenter sweeps in parallel for graphs with at least this
+// many ranks
+extern size_t PARALLEL_SWEEP_MIN_RANKS;
+// number of consecutive ranks swept sequentially by one task in parallel mode (1 = pure odd/even rank scheme). Fixed
+// rather than derived from the core count so results do not depend on the machine.
+extern size_t PARALLEL_SWEEP_BAND_SIZE;
+// Multi-start ordering runs this many independently seeded orderings on a thread pool and keeps the best scoring one
+// (0 disables it, 1 only refines the alphabetical ordering). Overridable per graph via `punktorderingruns`.
+extern size_t MULTI_START_ORDERING_RUNS;
+// overridable per graph via `punktorderingseed`
+extern uint64_t MULTI_START_ORDERING_SEED;
+extern ssize_t MULTI_START_ORDERING_MAX_SWEEPS_PER_RUN;
+// Multilevel ordering coarsens the graph, orders the coarsest level and refines back up. `punktmultilevel=auto` (the
+// default) enables it for graphs with at least MULTILEVEL_ORDERING_MIN_NODES nodes.
+extern size_t MULTILEVEL_ORDERING_MIN_NODES;
+extern size_t MULTILEVEL_ORDERING_COARSEST_NODES;
+extern ssize_t MULTILEVEL_ORDERING_REFINEMENT_SWEEPS;
+// Graphs with more nodes + edges than this get proportionally fewer iterations (see layout::scaleIterationBudget), so
+// huge graphs stay affordable with the same settings. 0 disables the scaling.
+extern size_t ITERATION_BUDGET_FULL_SIZE;
 constexpr size_t DEFAULT_DPI = 96;
 // X optimization is the process which optimizes the initial x positioning of the nodes while keeping ordering fixed
 extern float BARYCENTER_X_OPTIMIZATION_MIN_AVERAGE_CHANGE_REQUIRED;
@@ -57,6 +79,36 @@ extern ssize_t BARYCENTER_X_OPTIMIZATION_REGULARIZATION_RANK;
 extern bool BARYCENTER_X_OPTIMIZATION_REGULARIZATION_ONLY_ON_DOWNWARD;
 // weight of ghost nodes relative to normal nodes (all normal nodes have the same weight)
 extern float BARYCENTER_X_OPTIMIZATION_GHOST_NODE_RELATIVE_WEIGHT;
+// a pipeline stage stops early once an iteration changes the edge length energy by at most this fraction (and does
+// not add overlaps). Zero or negative values disable early termination. Overridable per graph via `punktxopttolerance`.
+extern float BARYCENTER_X_OPTIMIZATION_CONVERGENCE_TOLERANCE;
+// record per-iteration statistics of the x optimization (either engine) in Digraph::m_x_opt_trajectory. They are also
+// measured (but not recorded) whenever early termination or the anytime layout mode needs them.
+extern bool BARYCENTER_X_OPTIMIZATION_RECORD_TRAJECTORY;
+// iteration limit of the quadratic x optimization (`punktxoptengine=quadratic`), scaled down for large graphs like the
+// barycenter stages
+extern ssize_t QUADRATIC_X_OPTIMIZATION_MAX_ITERS;
+// weight factors of the quadratic x optimization for edges with one ghost end and for edges between two ghost nodes
+// (the inner segments of long edges, weighted highest so long edges are drawn straight)
+extern float QUADRATIC_X_OPTIMIZATION_GHOST_EDGE_WEIGHT_FACTOR;
+extern float QUADRATIC_X_OPTIMIZATION_GHOST_CHAIN_WEIGHT_FACTOR;
+// Anytime layout mode (`punkttimebudget`): fraction of the time left until the deadline that crossing minimization and
+// x optimization may use when they begin. Whatever a stage leaves unused goes to the stages after it.
+extern float TIME_BUDGET_ORDERING_SHARE;
+extern float TIME_BUDGET_X_OPTIMIZATION_SHARE;
+// time budgets of the preview passes the interactive viewer lays a graph out with before the full layout (see
+// render::ProgressiveLayout)
+extern std::vector<float> PROGRESSIVE_LAYOUT_PASS_TIME_BUDGETS_MS;
+// Directory of the on-disk layout cache (see punkt/layout/layout_cache.hpp), empty = disabled. Once the files in it
+// exceed LAYOUT_CACHE_MAX_BYTES, the least recently used layouts are evicted.
+extern std::string LAYOUT_CACHE_DIRECTORY;
+extern size_t LAYOUT_CACHE_MAX_BYTES;
+// must be bumped whenever the cache file format or the output of the layout algorithms changes, so stale cache entries
+// are never used
+constexpr uint32_t LAYOUT_CACHE_FORMAT_VERSION = 2;
+// must be bumped whenever the snapshot file format or one of the GL instance structs it stores changes (see
+// punkt/snapshot.hpp)
+constexpr uint32_t SNAPSHOT_FORMAT_VERSION = 1;
 
 enum class SweepMode {
     normal,
@@ -97,14 +149,23 @@ struct XOptPipelineStageSettings {
             static LegalizerSpecialInstruction getExplodeInterGroupNodeSep(float factor);
         };
 
+        enum class Algorithm {
+            // pushes nodes apart in two sweeps outward from the middle node
+            outward_sweeps,
+            // weighted pool adjacent violators: least squares closest non-overlapping positions in O(n) per rank
+            isotonic_regression,
+        };
+
         LegalizationTiming m_legalization_timing{LegalizationTiming::none};
         LegalizerSpecialInstruction m_legalizer_special_instruction{};
         bool m_try_cancel_mean_shift{};
+        Algorithm m_algorithm{Algorithm::outward_sweeps};
 
         LegalizerSettings();
 
         LegalizerSettings(LegalizationTiming legalization_timing,
-                          LegalizerSpecialInstruction legalizer_special_instruction, bool try_cancel_mean_shift);
+                          LegalizerSpecialInstruction legalizer_special_instruction, bool try_cancel_mean_shift,
+                          Algorithm algorithm = Algorithm::outward_sweeps);
     };
 
     LegalizerSettings m_legalizer_settings{};
@@ -33,7 +33,8 @@ struct Token {
     bool operator==(const Token &other) const;
 };
 
-std::vector<Token> tokenize(Digraph &dg, std::string_view s);
+// if out_offsets is given, the byte offset in s at which every token starts is appended to it
+std::vector<Token> tokenize(Digraph &dg, std::string_view s, std::vector<size_t> *out_offsets = nullptr);
 
 class UnexpectedCharException final : std::exception {
     char m_c;
@@ -2,11 +2,13 @@
 
 #include "dot_constants.hpp"
 #include "punkt/dot.hpp"
+#include "punkt/render_geometry.hpp"
 
 #include <glad/glad.h>
 
 #include <unordered_map>
 #include <span>
+#include <vector>
 
 namespace punkt::render {
 struct CharQuadPerInstanceData {
@@ -72,12 +74,20 @@ struct EdgeArrowTriangle {
 
 using VAO = GLuint;
 
-struct GLRenderer {
-    const Digraph &m_dg;
-    glyph::GlyphLoader &m_glyph_loader;
-    double m_zoom{};
-    size_t m_viewport_w{}, m_viewport_h{};
-    double m_camera_x{}, m_camera_y{};
+// the vertex buffer holding the per-instance data behind a VAO, with its allocated size in bytes
+struct InstanceBuffer {
+    GLuint m_vbo{};
+    size_t m_capacity{};
+};
+
+class Snapshot;
+
+// Everything the renderer draws, as CPU side per-instance data. Building it from a preprocessed Digraph does not touch
+// OpenGL, so it can happen on any thread and only the upload (GLRenderer::uploadInstanceData) is left to the render
+// thread.
+struct RenderInstanceData {
+    bool m_is_reversed{}, m_is_sideways{};
+    size_t m_graph_width{}, m_graph_height{};
     std::unordered_map<glyph::GlyphCharInfo, CharQuadInstanceTracker, glyph::GlyphCharInfoHasher> m_char_quads;
     ShapeQuadInfo m_digraph_quad;
     std::vector<ShapeQuadInfo> m_cluster_quads;
@@ -85,14 +95,41 @@ struct GLRenderer {
     std::vector<EdgeLinePoints> m_edge_line_points;
     std::vector<EdgeLinePoints> m_edge_spline_points;
     std::vector<EdgeArrowTriangle> m_edge_arrow_triangles;
+
+    explicit RenderInstanceData(const Digraph &dg);
+
+    // copies the instance arrays stored in the snapshot, see punkt/snapshot.hpp
+    explicit RenderInstanceData(const Snapshot &snapshot);
+
+private:
+    void buildArrows(const Digraph &dg, const Edge &edge, GLuint edge_color);
+};
+
+struct GLRenderer {
+    glyph::GlyphLoader &m_glyph_loader;
+    double m_zoom{};
+    size_t m_viewport_w{}, m_viewport_h{};
+    double m_camera_x{}, m_camera_y{};
+    RenderInstanceData m_data;
     // opengl buffers
     VAO m_node_quad_buffer{}, m_digraph_quad_buffer{}, m_cluster_quads_buffer{}, m_edge_lines_buffer{},
             m_edge_splines_buffer{}, m_arrow_triangles_buffer{};
     std::unordered_map<glyph::GlyphCharInfo, VAO, glyph::GlyphCharInfoHasher> m_char_buffers;
+    // the buffers uploadInstanceData updates in place
+    InstanceBuffer m_digraph_quad_instances, m_cluster_quad_instances, m_node_quad_instances, m_edge_line_instances,
+            m_edge_spline_instances, m_arrow_triangle_instances;
+    std::unordered_map<glyph::GlyphCharInfo, InstanceBuffer, glyph::GlyphCharInfoHasher> m_char_instances;
     GLuint m_nodes_shader{}, m_chars_shader{}, m_edges_shader{}, m_edge_splines_shader{}, m_arrows_shader{};
 
     explicit GLRenderer(const Digraph &dg, glyph::GlyphLoader &glyph_loader);
 
+    explicit GLRenderer(RenderInstanceData data, glyph::GlyphLoader &glyph_loader);
+
+    // replaces everything that is drawn (e.g. by a refined layout of the same graph) while keeping the camera. Only the
+    // instance ranges that differ from the current data are uploaded, buffers grow with some headroom. Must be called
+    // on the render thread, between frames.
+    void uploadInstanceData(RenderInstanceData data);
+
     void notifyFramebufferSize(int width, int height);
 
     void renderFrame();
@@ -104,6 +141,6 @@ struct GLRenderer {
     void notifyCursorMovement(double dx, double dy);
 
 private:
-    void buildArrows(const Edge &edge, GLuint edge_color);
+    void createInstanceBuffers();
 };
 }
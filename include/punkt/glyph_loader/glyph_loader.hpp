@@ -54,7 +54,7 @@ struct PSF1GlyphsT {
 using GlyphLoaderFontDataT = std::variant<PSF1GlyphsT>;
 
 class GlyphLoader {
-    bool m_is_real_loader{}, m_in_load_mode{};
+    bool m_is_real_loader{}, m_is_headless{}, m_in_load_mode{};
     FontType m_font_type{FontType::none};
     GLuint m_pre_load_mode_enter_framebuffer{}, m_render_framebuffer{}, m_quad_vao{};
     GLuint m_ttf_stencil_shader{}, m_ttf_cover_shader{};
@@ -84,7 +84,12 @@ public:
 
     const Glyph &getGlyph(char32_t c, size_t font_size);
 
-    explicit GlyphLoader(std::string font_path);
+    // identifies the font the glyph metrics come from (0 for the fake loader), e.g. for keying cached layouts
+    [[nodiscard]] size_t getFontFingerprint() const;
+
+    // A headless loader only parses the font for its glyph metrics, which is all layout needs. It makes no OpenGL calls,
+    // so it works without a window (e.g. to lay out graphs for export), but cannot load glyphs for rendering.
+    explicit GlyphLoader(std::string font_path, bool headless = false);
 
     // creates a fake glyph loader that returns all black patches (useful for testing)
     explicit GlyphLoader();
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "punkt/dot.hpp"
+#include "punkt/dot_tokenizer.hpp"
+#include "punkt/gl_renderer.hpp"
+#include "punkt/glyph_loader/glyph_loader.hpp"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace punkt::render {
+// Keeps a laid out graph in sync with its edited source (see punktRunWatched). Every new version of the source is
+// tokenized and compared to the token stream of the previous one:
+// - identical token streams (whitespace or comment edits) need no relayout
+// - if the only change is statements appended before the final `}`, those statements are applied to the existing
+//   Digraph (Digraph::update) and laid out incrementally (Digraph::relayout)
+// - anything else is parsed and laid out from scratch
+class GraphReloader {
+    glyph::GlyphLoader &m_glyph_loader;
+    // owns the current source and the strings its tokens reference (unescaped string literals)
+    Digraph m_token_storage;
+    std::vector<tokenizer::Token> m_tokens;
+    // null if an incremental update failed half way, the next reload is a full one then. Held by pointer because a
+    // laid out Digraph must not move (clusters point to their parent).
+    std::unique_ptr<Digraph> m_digraph;
+    size_t m_n_incremental_reloads{}, m_n_full_reloads{};
+
+    // the source to pass to Digraph::update if `tokens` only appends statements to m_tokens
+    [[nodiscard]] std::optional<std::string> getAppendedSource(std::string_view source,
+                                                               const std::vector<tokenizer::Token> &tokens,
+                                                               const std::vector<size_t> &token_offsets) const;
+
+public:
+    // parses and lays out the initial source
+    GraphReloader(std::string source, glyph::GlyphLoader &glyph_loader);
+
+    [[nodiscard]] RenderInstanceData getRenderInstanceData() const;
+
+    // Brings the layout up to date with the new source and returns what to draw now, or nothing if the graph did not
+    // change. If the new source is invalid, the error is thrown and the previous source stays current.
+    std::optional<RenderInstanceData> reload(std::string source);
+
+    [[nodiscard]] size_t getNumIncrementalReloads() const;
+
+    [[nodiscard]] size_t getNumFullReloads() const;
+};
+}
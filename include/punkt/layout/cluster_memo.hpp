@@ -0,0 +1,68 @@
+#pragma once
+
+#include "punkt/dot.hpp"
+#include "punkt/glyph_loader/glyph_loader.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace punkt::layout {
+// attrs of a node, edge or cluster without the render-only ones (see computeClusterCanonicalForm), sorted by key
+using CanonicalAttrs = std::vector<std::pair<std::string_view, std::string_view> >;
+
+// Name independent canonical form of a parsed, not yet laid out cluster. Two clusters with equal forms are isomorphic
+// including everything the layout depends on (node attrs, node sizes, edge attrs, graph attrs, label size), and
+// m_node_order lists their nodes in corresponding order. Labels and other render-only attrs are not part of the form,
+// a reused layout keeps the labels and colors of its cluster.
+//
+// The nodes are ordered by Weisfeiler-Lehman color refinement, individualizing one node of a tied color class whenever
+// the refinement gets stuck. Tie breaking is not isomorphism invariant in general, so isomorphic clusters can get
+// different forms (a memo miss), but equal forms are always a proper match: isIsomorphicTo compares the forms exactly.
+struct ClusterCanonicalForm {
+    // hash of the form, only used to look it up
+    uint64_t m_hash{};
+    CanonicalAttrs m_graph_attrs;
+    RankDirConfig m_rank_dir{};
+    // the label text only matters through its size and whether it has any glyphs
+    size_t m_label_width{}, m_label_height{};
+    bool m_has_label_glyphs{};
+    // per node (in canonical order) its attrs and size
+    std::vector<std::tuple<CanonicalAttrs, size_t, size_t> > m_nodes;
+    // (source index, destination index, edge attrs), sorted
+    std::vector<std::tuple<size_t, size_t, CanonicalAttrs> > m_edges;
+    std::vector<std::string_view> m_node_order;
+
+    [[nodiscard]] bool isIsomorphicTo(const ClusterCanonicalForm &other) const;
+};
+
+// nullopt for clusters the memo does not handle (nested clusters and rank constraints)
+std::optional<ClusterCanonicalForm> computeClusterCanonicalForm(const Digraph &cluster_dg,
+                                                                render::glyph::GlyphLoader &glyph_loader);
+
+// Memo table of cluster layouts within one graph. Generated graphs often contain many identical clusters (e.g. one per
+// service with the same internal pipeline), which then only need to be laid out once. Cluster layouts are relative to
+// the cluster, so a reused layout needs no offset, the parent positions the cluster as a whole.
+class ClusterLayoutMemo {
+    struct Entry {
+        ClusterCanonicalForm m_form;
+        const Digraph *m_laid_out_dg;
+    };
+
+    std::unordered_map<uint64_t, std::vector<Entry> > m_entries;
+
+public:
+    // Lays out cluster_dg like Digraph::preprocess, or copies the layout of an identical cluster that was laid out
+    // through this memo before. Returns whether the layout was reused. Memoized clusters must outlive the memo.
+    bool preprocess(Digraph &cluster_dg, render::glyph::GlyphLoader &glyph_loader, std::string_view id_in_parent);
+};
+
+// Copies the layout of the laid out `source` onto the parsed `target`, which is isomorphic to it as described by the
+// forms. `target` and its nodes keep their own attrs and label glyphs.
+void copyClusterLayout(const Digraph &source, const ClusterCanonicalForm &source_form, Digraph &target,
+                       const ClusterCanonicalForm &target_form, render::glyph::GlyphLoader &glyph_loader);
+}
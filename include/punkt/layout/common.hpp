@@ -2,9 +2,13 @@
 
 #include "punkt/dot.hpp"
 #include "punkt/utils/int_types.hpp"
+#include "punkt/utils/thread_pool.hpp"
 
 #include <vector>
+#include <span>
 #include <functional>
+#include <string_view>
+#include <utility>
 
 namespace punkt::layout {
 // stores the connection info between two ranks of nodes in a format fit for efficient intersection count computation
@@ -38,21 +42,65 @@ struct IntersectionMat {
     [[nodiscard]] size_t getTotalIntersections() const;
 };
 
+// Old and new barycenters of the nodes visited by a sweep, stored flat by global position: the nodes of rank r occupy
+// [m_rank_offsets[r], m_rank_offsets[r + 1]). Reused across sweeps, so the sweep inner loop does not allocate, and
+// sweeps of different ranks write disjoint slices. There is no swap between iterations, every sweep of a rank
+// overwrites both of its slices.
+struct SweepBarycenters {
+    std::vector<float> m_old, m_new;
+    std::vector<size_t> m_rank_offsets;
+
+    // recomputes the rank offsets if the rank sizes of `dg` differ from the current ones
+    void ensureLayout(const Digraph &dg);
+
+    [[nodiscard]] std::span<float> getOld(size_t rank);
+
+    [[nodiscard]] std::span<float> getNew(size_t rank);
+};
+
 void clearGlobalState();
 
-void populateOrderingIndexAtRank(Digraph &dg, size_t rank);
+// The pool the parallel layout stages (multi-start ordering, parallel sweeps) run on, one thread per hardware thread.
+// Created on first use and shared by all layouts, so laying out a graph does not start threads.
+ThreadPool &getLayoutThreadPool();
+
+// parses the `weight` attribute of an edge (defaults to 1, or to 0 for `constraint=false` edges)
+size_t getEdgeLayoutWeight(const Edge &edge);
+
+// assigns the edge ids (in node id order) and parses every edge weight once into dg.m_edge_layout_weights. Must be
+// called after the node ids have been assigned and no edges are added anymore (i.e. after ghost node insertion).
+void populateEdgeLayoutWeights(Digraph &dg);
+
+// like Digraph::insertGhostNodes, but only decomposes the given edges (source node, index into its m_outgoing)
+void insertGhostNodesForEdges(Digraph &dg, std::span<const std::pair<std::string_view, size_t> > edges);
+
+// heuristic for how far rank `rank + 1` will be right shifted compared to rank `rank` for centering purposes
+ssize_t getRowLayoutPaddingForRanks(size_t node_count_current_rank, size_t node_count_next_rank);
+
+void populateNodePositionsAtRank(Digraph &dg, size_t rank);
 
 void populateInitialOrderings(Digraph &dg);
 
 void reorderRankByBarycenterX(Digraph &dg, size_t rank, bool &out_improvement_found);
 
-using BarycenterSweepOperatorFunc = std::function<void(Digraph &, std::vector<float>, std::vector<float>, size_t,
-                                                       bool &)>;
+// called with the new and old barycenters of the rank (slices of g_sweep_barycenters) after it has been swept
+using BarycenterSweepOperatorFunc = std::function<void(Digraph &, std::span<const float>, std::span<const float>,
+                                                       size_t, bool &)>;
 
 void barycenterSweep(Digraph &dg, bool is_downward_sweep, bool &improvement_found, float &total_change,
                      const BarycenterSweepOperatorFunc &sweep_operator, bool use_median, float barycenter_dampening,
                      ssize_t start_rank = -1, ssize_t n_ranks = -1);
 
+// Parallel variant of barycenterSweep: the swept ranks are split into bands of `band_size` consecutive ranks. First, all
+// even bands are swept concurrently on `pool` (each band sequentially, against the fixed last rank of the preceding
+// band), then all odd bands. band_size = 1 is a plain odd/even rank scheme, larger bands get closer to the sequential
+// result. `sweep_operator` must be safe to call concurrently for different ranks (reordering is, the x optimization
+// operators are not).
+void barycenterSweepParallel(Digraph &dg, bool is_downward_sweep, bool &improvement_found, float &total_change,
+                             const BarycenterSweepOperatorFunc &sweep_operator, bool use_median,
+                             float barycenter_dampening, ThreadPool &pool, size_t band_size, ssize_t start_rank = -1,
+                             ssize_t n_ranks = -1);
+
 float getRankOrderingScore(const Digraph &dg, size_t rank);
 
 float updateRankOrderingScoreAfterSwap(size_t idx_a, size_t idx_b);
@@ -61,10 +109,12 @@ void revertToPreSwapState(const size_t pre_swap_n_intersections_pr[2], const siz
                           size_t idx_b);
 
 // we want to reuse the underlying allocated memory (these vars are cleared every time they are used, this is safe).
-// Also, we have 2 because one is for upward and one for downward connections
-extern ConnectionMat g_connection_mats[2];
-extern IntersectionMat g_intersection_mats[2];
+// Also, we have 2 because one is for upward and one for downward connections. They are per thread, so independent
+// graphs can be laid out concurrently (see runBatchLayout).
+extern thread_local ConnectionMat g_connection_mats[2];
+extern thread_local IntersectionMat g_intersection_mats[2];
 // TODO I should refactor this to use local variables and references instead of globals
-extern size_t g_n_intersections_pr[2];
-extern size_t g_sum_dx_pr[2];
+extern thread_local size_t g_n_intersections_pr[2];
+extern thread_local size_t g_sum_dx_pr[2];
+extern thread_local SweepBarycenters g_sweep_barycenters;
 }
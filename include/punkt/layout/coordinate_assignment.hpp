@@ -0,0 +1,30 @@
+#pragma once
+
+#include "punkt/dot.hpp"
+#include "punkt/utils/int_types.hpp"
+#include "punkt/layout/time_budget.hpp"
+
+#include <span>
+
+namespace punkt::layout {
+// Brandes-Koepf horizontal coordinate assignment ("Fast and Simple Horizontal Coordinate Assignment", 2001). Aligns
+// every node with a median neighbour into vertical blocks (preferring the inner segments of ghost node chains, so long
+// edges are drawn straight), compacts the blocks once for each of the four combinations of vertical and horizontal
+// direction while keeping node widths and nodesep apart, and balances the four results. Runs in O(V + E), keeps the
+// rank orderings untouched and writes the node centers into m_barycenter_x.
+void assignXCoordinatesBrandesKoepf(Digraph &dg);
+
+// Quadratic programming coordinate assignment: minimizes sum_e w_e (x_u - x_v)^2 over all edges, where edges touching
+// ghost nodes are weighted up by QUADRATIC_X_OPTIMIZATION_GHOST_EDGE_WEIGHT_FACTOR and
+// QUADRATIC_X_OPTIMIZATION_GHOST_CHAIN_WEIGHT_FACTOR, subject to horizontally adjacent nodes being node widths and
+// nodesep apart. Solved by accelerated gradient projection (the projection is one isotonic regression per rank),
+// warm started from the current m_barycenter_x. Stops once an iteration improves the objective by at most `tolerance`
+// relative to it (negative disables that), after `max_iters` iterations (negative means unlimited) or once `budget` is
+// exhausted (every iterate is feasible and no worse than the one before, so it can stop anywhere). Records one
+// XOptIterationStats per iteration in m_x_opt_trajectory and writes the node centers into m_barycenter_x.
+void assignXCoordinatesQuadratic(Digraph &dg, float tolerance, ssize_t max_iters, StageTimeBudget &budget);
+
+// in-place weighted isotonic regression (pool adjacent violators): replaces `values` with the non-decreasing sequence
+// closest to them in the `weights` weighted squared distance. O(n).
+void solveIsotonicRegression(std::span<float> values, std::span<const float> weights);
+}
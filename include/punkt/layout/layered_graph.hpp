@@ -0,0 +1,75 @@
+#pragma once
+
+#include "punkt/dot.hpp"
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+namespace punkt::layout {
+// Compact, index-based copy of the rank structure of a Digraph (after ghost node insertion). Node ids are assigned in
+// rank-major order of the orderings the graph was built from. Unlike the Digraph, a LayeredGraph is cheap to copy and
+// contains no string lookups, which is what the ordering engines that run on multiple threads or on coarsened copies
+// of the graph need.
+struct LayeredGraph {
+    struct Neighbour {
+        size_t m_node;
+        size_t m_weight;
+    };
+
+    // node ids of every rank in their current left-to-right order
+    std::vector<std::vector<size_t> > m_orderings;
+    // node id -> index of the node within its rank ordering
+    std::vector<size_t> m_positions;
+    std::vector<size_t> m_ranks;
+    std::vector<std::string_view> m_names;
+    // ranks that must not be reordered (IO port ranks)
+    std::vector<bool> m_is_fixed_rank;
+    // CSR adjacency: neighbours on rank + 1 (down) and rank - 1 (up) with the summed layout weight of the edges
+    std::vector<size_t> m_down_offsets, m_up_offsets;
+    std::vector<Neighbour> m_down_neighbours, m_up_neighbours;
+
+    static LayeredGraph fromDigraph(const Digraph &dg);
+
+    // (re)builds both CSR adjacencies from (node on rank r, node on rank r + 1, weight) triples. Parallel edges are
+    // merged by summing their weights. Expects m_names to already contain every node.
+    void buildAdjacency(std::vector<std::tuple<size_t, size_t, size_t> > down_edges);
+
+    void writeOrderingsTo(Digraph &dg) const;
+
+    [[nodiscard]] size_t getNumNodes() const;
+
+    [[nodiscard]] std::span<const Neighbour> getNeighbours(size_t node, bool is_downward) const;
+
+    // replaces the ordering of a rank and keeps m_positions in sync
+    void setOrdering(size_t rank, std::span<const size_t> ordering);
+
+    // sum of weighted crossings and weighted dx over all pairs of adjacent ranks (smaller is better). This mirrors
+    // getRankOrderingScore, but is computed for the whole graph at once in O(E log V).
+    [[nodiscard]] double getOrderingScore() const;
+
+    // weighted crossings between `rank` and `rank + 1` (Fenwick tree accumulation)
+    [[nodiscard]] size_t countCrossings(size_t rank) const;
+};
+
+// Reorders every non-fixed rank by the (weighted) median position of its neighbours on the previously swept rank.
+// Nodes without neighbours keep their position.
+void medianSweep(LayeredGraph &lg, bool is_downward_sweep);
+
+// Alternates downward and upward median sweeps until the score stops improving (or `max_sweeps` is reached, -1 means
+// unlimited). Leaves the best ordering encountered (possibly the initial one) in `lg` and returns its score.
+double refineByMedianSweeps(LayeredGraph &lg, ssize_t max_sweeps);
+
+// Runs `n_runs` independently seeded orderings (the current ordering, DFS-based orderings and random permutations)
+// on the layout thread pool, refines each one with median sweeps and writes the best scoring one back into the Digraph.
+// The result only depends on the seed, not on the number of threads. Returns the score of every run.
+std::vector<double> runMultiStartOrdering(Digraph &dg, size_t n_runs, uint64_t seed, ssize_t max_sweeps_per_run);
+
+// Multilevel ordering for very large graphs: repeatedly coarsens every rank by merging pairs of nodes which share
+// heavily weighted neighbours until at most `coarsest_n_nodes` nodes are left (or coarsening stalls), orders the
+// coarsest graph, then projects the ordering back level by level, refining it with up to `refinement_sweeps` median
+// sweeps on each level.
+void runMultilevelOrdering(Digraph &dg, size_t coarsest_n_nodes, ssize_t refinement_sweeps);
+}
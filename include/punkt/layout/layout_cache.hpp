@@ -0,0 +1,43 @@
+#pragma once
+
+#include "punkt/dot.hpp"
+#include "punkt/glyph_loader/glyph_loader.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace punkt::layout {
+// On-disk cache of finished layouts in LAYOUT_CACHE_DIRECTORY. An entry stores everything preprocessing produces (the
+// final node set including ghost nodes and IO ports, node positions and glyph quads, edge trajectories and label
+// quads, rank layout, recursively for all clusters), so a hit replaces Digraph::preprocess entirely.
+//
+// Entries are keyed by a hash of the parsed graph (so whitespace, comments and quoting do not matter), the layout
+// tuning globals, the font and LAYOUT_CACHE_FORMAT_VERSION. Every entry is one `<key>.punktlayout` file.
+
+// m_canonical_form serializes everything the layout depends on and m_hash is its hash, which names the entry. Entries
+// store the canonical form and loading compares it, so a hash collision is a miss rather than a wrong layout.
+struct LayoutCacheKey {
+    uint64_t m_hash{};
+    std::string m_canonical_form;
+
+    bool operator==(const LayoutCacheKey &) const = default;
+};
+
+// whether preprocessing `dg` may use the cache: a cache directory is configured, `dg` is not a cluster (clusters are
+// cached as part of their root graph) and not laid out in the anytime mode, whose results depend on timing
+bool isLayoutCacheEnabled(const Digraph &dg);
+
+// must be computed before preprocessing, which modifies the graph
+LayoutCacheKey getLayoutCacheKey(const Digraph &dg, const render::glyph::GlyphLoader &glyph_loader);
+
+// Restores the cached layout into the freshly parsed `dg` and returns true on a hit. Missing, outdated and corrupt
+// entries are misses (the latter two are deleted) and leave `dg` untouched.
+bool loadCachedLayout(Digraph &dg, const LayoutCacheKey &key);
+
+// Stores the layout of the preprocessed `dg`. Once the cache may exceed LAYOUT_CACHE_MAX_BYTES (tracked in memory,
+// re-scanned every few stores to account for other processes), evicts the least recently used entries until it fits.
+// I/O errors are ignored, the cache never fails a layout.
+void storeCachedLayout(const Digraph &dg, const LayoutCacheKey &key);
+
+void evictLayoutCache(size_t max_bytes);
+}
@@ -16,4 +16,10 @@ TextAlignment textAlignmentFromStr(const std::string_view &s);
 void populateGlyphQuadsWithText(const std::string_view &text, size_t font_size, TextAlignment ta,
                                 render::glyph::GlyphLoader &glyph_loader, std::vector<GlyphQuad> &out_quads,
                                 size_t &out_max_line_width, size_t &out_height, RankDirConfig rank_dir);
+
+// the quads of the graph label (attr `label`, relative to its top left corner) and its size, leaves everything
+// untouched if the graph has no label
+void populateGraphLabelText(const Attrs &attrs, render::glyph::GlyphLoader &glyph_loader,
+                            std::vector<GlyphQuad> &out_label_quads, size_t &out_graph_label_width,
+                            size_t &out_graph_label_height, RankDirConfig rank_dir);
 }
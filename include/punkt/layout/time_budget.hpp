@@ -0,0 +1,35 @@
+#pragma once
+
+#include "punkt/dot.hpp"
+
+#include <chrono>
+#include <optional>
+#include <string_view>
+
+namespace punkt::layout {
+// parses durations like "200ms", "1.5s" or "200" (milliseconds) into milliseconds. Throws IllegalAttributeException.
+float parseDurationMs(std::string_view sv, std::string_view attr_name);
+
+// Starts the anytime layout mode if the graph has a `punkttimebudget` attr (clusters without one inherit the deadline
+// of their parent) and clears the time budget report.
+void beginTimeBudgetedLayout(Digraph &dg);
+
+// The time budget of one layout stage in the anytime layout mode: `share` of the time left until the graph deadline
+// when the stage begins. Without a graph deadline, the budget never runs out and nothing is reported.
+struct StageTimeBudget {
+    std::optional<std::chrono::steady_clock::time_point> m_deadline;
+    std::chrono::steady_clock::time_point m_start;
+    bool m_was_cut_short{};
+
+    static StageTimeBudget begin(const Digraph &dg, float share);
+
+    [[nodiscard]] bool isEnabled() const;
+
+    // Whether the stage has to stop now. Only ask when the stage would otherwise go on, because a true result is
+    // remembered as the stage having been cut short.
+    bool isExhausted();
+
+    // appends the time usage of the stage to dg.m_time_budget_report (if the budget is enabled)
+    void finish(Digraph &dg, std::string_view stage) const;
+};
+}
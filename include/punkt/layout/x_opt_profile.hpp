@@ -0,0 +1,73 @@
+#pragma once
+
+#include "punkt/dot.hpp"
+#include "punkt/dot_constants.hpp"
+#include "punkt/utils/int_types.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace punkt::layout {
+// Runtime overrides for the compiled-in layout tuning knobs. Knobs a profile does not mention keep their current value.
+//
+// Profiles are line based (`;` also separates lines, so a profile fits into a single graph attribute). `#` starts a
+// comment. Keys before the first `[stage]` header are global knobs, every `[stage]` starts a new x optimization
+// pipeline stage and the stages of a profile replace the whole pipeline:
+//
+//     tolerance = 0.001
+//     barycenter_ordering_max_iters = 5
+//     bubble_ordering_max_iters = 100
+//     budget_full_size = 20000
+//
+//     [stage]
+//     repeats = 1
+//     max_iters = 3
+//     initial_dampening = 0.9
+//     dampening_fadeout = 0.96
+//     pull_towards_mean = 0
+//     regularization = 1
+//     sweep_mode = normal                 # normal | outer_loop | innermost_loop
+//     legalization = after_iteration      # none | after_stage | after_iteration | in_operator
+//     legalizer = sweeps                  # sweeps | isotonic
+//     explode_node_sep = 2                # optional
+//     cancel_mean_shift = false
+//     sweeps = up-group up down-group down  # optional @N suffix limits a sweep to N ranks, e.g. down@1
+struct XOptProfile {
+    std::optional<std::vector<XOptPipelineStageSettings> > m_pipeline;
+    std::optional<ssize_t> m_barycenter_ordering_max_iters;
+    std::optional<ssize_t> m_bubble_ordering_max_iters;
+    std::optional<float> m_convergence_tolerance;
+    std::optional<size_t> m_budget_full_size;
+};
+
+// throws IllegalAttributeException on unknown keys and malformed values
+XOptProfile parseXOptProfile(std::string_view source);
+
+// profile files are small, anything larger is rejected before it is read
+constexpr size_t MAX_X_OPT_PROFILE_FILE_BYTES = 64 * 1024;
+
+// Throws IllegalAttributeException if `path` is not a regular file of at most MAX_X_OPT_PROFILE_FILE_BYTES or cannot be
+// read. Parse errors only report the line number, never the file contents.
+XOptProfile loadXOptProfileFile(const std::string &path);
+
+// writes every knob the profile sets into the corresponding global
+void applyXOptProfile(const XOptProfile &profile);
+
+// Scales an iteration limit down for graphs with more than ITERATION_BUDGET_FULL_SIZE nodes + edges, proportionally to
+// the size, but never below one iteration. Unlimited (negative) and zero limits are returned unchanged.
+ssize_t scaleIterationBudget(ssize_t max_iters, size_t graph_size);
+
+// number of nodes + edges, the size measure the iteration budgets are scaled by
+size_t getIterationBudgetGraphSize(const Digraph &dg);
+
+// the inline profile given through the graph attribute `punktxoptpipeline`, an empty profile if it is not set. Only its
+// pipeline and tolerance apply, and only to that graph: global knobs are rejected with IllegalAttributeException.
+// Profile files are only loaded from the command line (punktLoadProfile), a graph cannot name a file to read.
+XOptProfile getGraphXOptProfile(const Digraph &dg);
+
+// the pipeline of `graph_profile` (the global BARYCENTER_X_OPTIMIZATION_PIPELINE if it has none) with the iteration
+// limits scaled to the size of `dg`
+std::vector<XOptPipelineStageSettings> getEffectiveXOptPipeline(const Digraph &dg, const XOptProfile &graph_profile);
+}
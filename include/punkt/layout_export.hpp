@@ -0,0 +1,49 @@
+#pragma once
+
+#include "punkt/dot.hpp"
+
+#include <ostream>
+
+namespace punkt::render {
+// Text exports of a preprocessed graph for tools that consume graphviz layouts, and an SVG drawing of it. All of them
+// are written straight from the render attrs through a BufferedWriter, so memory use does not grow with the output,
+// and none of them needs an OpenGL context.
+//
+// Plain and JSON coordinates follow graphviz: the origin is the bottom left corner of the graph, y points up and node
+// positions are box centers. Edges that the layout split at ghost nodes are written as one edge with the joined
+// trajectory (cubic Bezier control points for spline edges, polyline points otherwise). Clusters appear as the box of
+// their super node, their contents are not exported yet (the renderer does not draw them either).
+
+// Maps layout coordinates to displayed ones (origin top left, y down). The layout always stacks ranks top to bottom,
+// the renderer's shaders transpose sideways graphs (rankdir=LR/RL) and mirror reversed ones (rankdir=BT/RL), so
+// exports have to do the same.
+struct DisplayTransform {
+    RankDirConfig m_rank_dir;
+    double m_layout_width, m_layout_height;
+
+    explicit DisplayTransform(const Digraph &dg);
+
+    [[nodiscard]] Vector2<double> apply(double x, double y) const;
+
+    [[nodiscard]] double getWidth() const;
+
+    [[nodiscard]] double getHeight() const;
+};
+
+// graphviz `-Tplain`: `graph`, `node`, `edge` and `stop` lines, sizes and positions in inches
+void writeLayoutPlain(const Digraph &dg, std::ostream &out);
+
+// JSON with the same content as writeLayoutPlain, sizes and positions in points:
+// {"directed":true,"width":..,"height":..,
+//  "nodes":[{"name":..,"label":..,"x":..,"y":..,"width":..,"height":..,"shape":..,"style":..,"color":..,
+//            "fillcolor":..}, ...],
+//  "edges":[{"tail":..,"head":..,"points":[[x,y], ...],"spline":..,"style":..,"color":..
+//            [,"label":..,"label_x":..,"label_y":..]}, ...]}
+void writeLayoutJson(const Digraph &dg, std::ostream &out);
+
+// An SVG 1.1 drawing of what the renderer draws: the graph box, nodes (by getNodeShapeId), edges (cubic Bezier paths
+// where the renderer draws splines, see isEdgeDrawnAsSpline), arrowheads and labels. Coordinates are displayed layout
+// pixels with the origin in the top left corner. Text is drawn in a monospace font stretched to the glyph quads the
+// layout reserved for it.
+void writeLayoutSvg(const Digraph &dg, std::ostream &out);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "punkt/glyph_loader/glyph_loader.hpp"
+#include "punkt/utils/thread_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace punkt {
+// Long running layout server on a Unix domain socket (see punktServe). Clients send DOT sources and get layouts back
+// without paying for process startup and font loading on every request. The glyph loader is shared by all requests and
+// the layout scratch buffers are thread local, so they stay allocated in the worker threads between requests.
+//
+// Messages in both directions are frames: a little endian uint32 payload size followed by the payload.
+// - request payload: uint32 request id, uint8 LayoutServerFormat, then the DOT source
+// - response payload: uint32 request id, uint8 LayoutServerStatus, then the layout in the requested format (ok) or an
+//   error message (anything else)
+// Requests are pipelined: a client may send any number of requests without waiting. They are laid out concurrently, so
+// responses can arrive in a different order and are matched to their requests by id. Once m_max_pending_requests are
+// being processed, the server stops reading requests until one finishes.
+enum class LayoutServerFormat : uint8_t {
+    // the snapshot file contents, see punkt/snapshot.hpp
+    snapshot = 0,
+    // see render::writeLayoutJson
+    json = 1,
+};
+
+enum class LayoutServerStatus : uint8_t {
+    ok = 0,
+    // invalid graph or unknown format
+    error = 1,
+    // the request did not finish within the request timeout
+    timeout = 2,
+};
+
+struct LayoutServerConfig {
+    std::filesystem::path m_socket_path;
+    // 0 means one thread per hardware thread
+    size_t m_n_threads{};
+    size_t m_max_pending_requests{64};
+    // Measured from when a request is read. A request still queued at its deadline is answered with a timeout right
+    // away, otherwise the time left becomes the layout time budget (see punkt/layout/time_budget.hpp). 0 means none.
+    // The timeout is best effort: only crossing minimization and x optimization stop early, parsing, ranking, edge
+    // routing and serialization always run to completion. A request that finishes late is answered with a timeout.
+    // m_max_request_bytes bounds how long the stages that cannot stop early take.
+    std::chrono::milliseconds m_request_timeout{0};
+    // larger DOT sources are skipped and answered with an error without being parsed
+    size_t m_max_request_bytes{16 * 1024 * 1024};
+};
+
+class LayoutServer {
+    struct Connection;
+
+    LayoutServerConfig m_config;
+    render::glyph::GlyphLoader &m_glyph_loader;
+    int m_listen_fd{-1};
+    std::atomic<bool> m_is_stopping{};
+    std::atomic<size_t> m_n_served_requests{};
+    std::mutex m_mutex;
+    std::condition_variable m_request_finished;
+    size_t m_n_pending_requests{};
+    std::vector<std::shared_ptr<Connection> > m_connections;
+    // declared last so it is destroyed first, its remaining tasks still use the members above
+    ThreadPool m_pool;
+
+    void serveConnection(const std::shared_ptr<Connection> &connection);
+
+    void processRequest(const std::shared_ptr<Connection> &connection, uint32_t request_id, uint8_t format,
+                        std::string source, std::chrono::steady_clock::time_point deadline);
+
+    void joinFinishedConnections(bool join_all);
+
+public:
+    // binds and listens on the socket (replacing a stale socket file), throws LayoutServerException
+    LayoutServer(LayoutServerConfig config, render::glyph::GlyphLoader &glyph_loader);
+
+    ~LayoutServer();
+
+    LayoutServer(const LayoutServer &) = delete;
+
+    LayoutServer &operator=(const LayoutServer &) = delete;
+
+    // accepts connections until stop() is called
+    void run();
+
+    // makes run() return, can be called from any thread
+    void stop();
+
+    [[nodiscard]] size_t getNumServedRequests() const;
+};
+
+class LayoutServerException final : std::exception {
+    const std::string m_msg;
+
+public:
+    [[nodiscard]] const char *what() const noexcept override;
+
+    explicit LayoutServerException(std::string msg);
+};
+}
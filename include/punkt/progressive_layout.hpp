@@ -0,0 +1,65 @@
+#pragma once
+
+#include "punkt/dot.hpp"
+#include "punkt/gl_renderer.hpp"
+#include "punkt/glyph_loader/glyph_loader.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace punkt::render {
+// Lays a graph out on a worker thread in passes of increasing effort and publishes the render instance data of every
+// finished pass, so the render loop can show a rough layout within milliseconds and swap in the refined ones as they
+// become available. Every pass but the last runs in the anytime layout mode with the next budget of
+// PROGRESSIVE_LAYOUT_PASS_TIME_BUDGETS_MS, the last one lays the graph out exactly as punktRun always has.
+class ProgressiveLayout {
+    std::string m_source;
+    glyph::GlyphLoader &m_glyph_loader;
+    std::mutex m_mutex;
+    std::condition_variable m_published;
+    // the most recently published pass that has not been taken yet
+    std::optional<RenderInstanceData> m_pending;
+    size_t m_n_published{};
+    bool m_is_done{};
+    std::exception_ptr m_error;
+    // checked between passes, a running pass always finishes
+    std::atomic<bool> m_stop_requested{};
+    std::thread m_worker;
+
+    void run();
+
+    void publish(RenderInstanceData data, bool is_final);
+
+public:
+    // starts laying out right away. The glyph loader is only used for glyph metrics, which is safe while the render
+    // thread renders glyphs.
+    ProgressiveLayout(std::string source, glyph::GlyphLoader &glyph_loader);
+
+    ~ProgressiveLayout();
+
+    ProgressiveLayout(const ProgressiveLayout &) = delete;
+
+    ProgressiveLayout &operator=(const ProgressiveLayout &) = delete;
+
+    // blocks until a pass is published and takes the most recent one. Rethrows layout errors.
+    RenderInstanceData waitForLayout();
+
+    // takes the most recently published pass, if there is one the caller has not seen yet. Never waits for the worker,
+    // so it can be called every frame. Rethrows a layout error once, the passes published before it stay valid.
+    std::optional<RenderInstanceData> takeLatest();
+
+    // number of passes published so far
+    size_t getNumPublished();
+
+    // whether the final pass has been published (or the layout failed)
+    bool isDone();
+
+    // requests the worker to stop after its current pass and joins it
+    void stop();
+};
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "punkt/dot.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// Geometry decisions of the renderer that do not depend on OpenGL, shared by the GL renderer and the SVG export so
+// both draw the same picture.
+namespace punkt::render {
+constexpr uint32_t node_shape_none = 0;
+constexpr uint32_t node_shape_box = 1;
+constexpr uint32_t node_shape_ellipse = 2;
+constexpr uint32_t node_shape_circle = node_shape_ellipse; // from shader POV there is no difference
+constexpr uint32_t node_shape_pill = 3; // this one is punkt-specific
+
+// used in the fragment shader for identifying how to draw the border
+uint32_t getNodeShapeId(const Node &node);
+
+// the fill color of a node or graph: fillcolor, or its border color with style=filled, otherwise white
+std::string_view getFillColor(const Attrs &attrs);
+
+// the line thickness of an edge in pixels
+size_t getEdgeThickness(const Edge &edge);
+
+// Whether the edge is drawn as a cubic Bezier curve through its 4 trajectory points rather than as a polyline. Spline
+// edges are only drawn as curves where that makes a visible difference.
+bool isEdgeDrawnAsSpline(const Digraph &dg, const Edge &edge);
+
+// the arrowheads of a visible (i.e. not split at ghost nodes) edge in layout coordinates, at most one per end
+struct EdgeArrows {
+    std::array<std::array<Vector2<double>, 3>, 2> m_triangles{};
+    size_t m_n_triangles{};
+};
+
+EdgeArrows getEdgeArrows(const Digraph &dg, const Edge &edge);
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "punkt/dot.hpp"
+#include "punkt/gl_renderer.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace punkt::render {
+// Binary snapshot of a laid out graph (`*.punktsnap`), for viewing large graphs without parsing or layout. The file is
+// a header followed by sections of fixed size records in native byte order, among them the GL per-instance arrays of
+// RenderInstanceData. A snapshot is memory mapped and validated once, after which the instance arrays are copied
+// straight into the vectors that get uploaded to the GPU.
+//
+// For other consumers, a snapshot also holds the geometry of the laid out graph: node and edge endpoint names
+// (interned into one string table), node boxes with their label glyph quads and edge trajectories with their label
+// glyph quads, all in graph coordinates. Cluster contents are not stored, as the renderer does not draw them yet.
+//
+// Snapshots are only portable between builds with the same SNAPSHOT_FORMAT_VERSION, byte order and instance struct
+// layout, anything else is rejected on load.
+
+constexpr std::string_view snapshot_file_extension = ".punktsnap";
+
+// a string in the string table
+struct SnapshotString {
+    uint64_t m_offset, m_size;
+};
+
+// [m_begin, m_end) of the records of another section
+struct SnapshotRange {
+    uint64_t m_begin, m_end;
+};
+
+struct SnapshotGlyphQuad {
+    uint64_t m_left, m_top, m_right, m_bottom;
+    uint64_t m_c, m_font_size;
+};
+
+struct SnapshotNode {
+    SnapshotString m_name;
+    uint64_t m_x, m_y, m_width, m_height;
+    uint64_t m_is_ghost;
+    // label glyph quads, relative to the node
+    SnapshotRange m_quads;
+};
+
+struct SnapshotEdge {
+    SnapshotString m_source, m_dest;
+    SnapshotRange m_trajectory;
+    // label glyph quads, absolute
+    SnapshotRange m_label_quads;
+};
+
+// the instances of one glyph in RenderInstanceData::m_char_quads
+struct SnapshotCharGlyph {
+    uint64_t m_c, m_font_size;
+    GLQuad m_quad;
+    SnapshotRange m_instances;
+};
+
+// the snapshot file contents of the preprocessed `dg`, e.g. for sending it elsewhere
+std::string serializeSnapshot(const Digraph &dg, const glyph::GlyphLoader &glyph_loader);
+
+// writes the snapshot of the preprocessed `dg`, throws SnapshotIOException if the file cannot be written
+void writeSnapshot(const Digraph &dg, const glyph::GlyphLoader &glyph_loader, const std::filesystem::path &path);
+
+struct SnapshotFileHeader;
+
+class Snapshot {
+    struct MappedFile;
+
+    std::unique_ptr<MappedFile> m_file;
+
+    [[nodiscard]] SnapshotFileHeader getHeader() const;
+
+    template<typename T>
+    [[nodiscard]] std::span<const T> getSection(size_t section) const;
+
+    void validate() const;
+
+    friend struct RenderInstanceData;
+
+public:
+    // maps and validates the snapshot file, throws SnapshotIOException or InvalidSnapshotException
+    explicit Snapshot(const std::filesystem::path &path);
+
+    ~Snapshot();
+
+    Snapshot(Snapshot &&) noexcept;
+
+    Snapshot &operator=(Snapshot &&) noexcept;
+
+    // fingerprint of the font the snapshot was laid out with, see GlyphLoader::getFontFingerprint
+    [[nodiscard]] size_t getFontFingerprint() const;
+
+    [[nodiscard]] std::span<const SnapshotNode> getNodes() const;
+
+    [[nodiscard]] std::span<const SnapshotEdge> getEdges() const;
+
+    [[nodiscard]] std::string_view getString(SnapshotString s) const;
+
+    [[nodiscard]] std::span<const SnapshotGlyphQuad> getGlyphQuads(SnapshotRange range) const;
+
+    [[nodiscard]] std::span<const Vector2<uint64_t> > getTrajectory(SnapshotRange range) const;
+};
+
+class SnapshotIOException final : std::exception {
+    const std::string m_path;
+
+    [[nodiscard]] const char *what() const noexcept override;
+
+public:
+    explicit SnapshotIOException(std::string path);
+};
+
+class InvalidSnapshotException final : std::exception {
+    const std::string m_reason;
+
+    [[nodiscard]] const char *what() const noexcept override;
+
+public:
+    explicit InvalidSnapshotException(std::string reason);
+};
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <string_view>
+
+namespace punkt {
+// Formats text into a fixed buffer and hands it to the stream in large blocks, so exporters can write very large
+// outputs without going through the stream's per item formatting. Numbers are formatted with std::to_chars. The buffer
+// is flushed when full and on destruction.
+class BufferedWriter {
+    std::ostream &m_out;
+    std::array<char, 64 * 1024> m_buffer{};
+    size_t m_size{};
+
+    void reserve(size_t n);
+
+public:
+    explicit BufferedWriter(std::ostream &out);
+
+    ~BufferedWriter();
+
+    BufferedWriter(const BufferedWriter &) = delete;
+
+    BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+    BufferedWriter &operator<<(std::string_view s);
+
+    BufferedWriter &operator<<(char c);
+
+    BufferedWriter &operator<<(size_t n);
+
+    // fixed point with at most `max_decimals` decimals, trailing zeros removed
+    BufferedWriter &writeDecimal(double x, int max_decimals);
+
+    // a JSON string literal
+    BufferedWriter &writeJsonString(std::string_view s);
+
+    void flush();
+};
+}
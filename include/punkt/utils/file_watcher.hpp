@@ -0,0 +1,30 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+
+namespace punkt {
+// Reports when a file was written. On Linux this uses inotify on the parent directory, so editors that save by
+// writing a temporary file and renaming it over the original are noticed too. Elsewhere (or if inotify is unavailable)
+// it falls back to comparing the modification time a few times per second.
+class FileWatcher {
+    std::filesystem::path m_path;
+    std::filesystem::file_time_type m_last_write_time{};
+    std::chrono::steady_clock::time_point m_last_poll{};
+    int m_inotify_fd{-1};
+
+    bool pollModificationTime();
+
+public:
+    explicit FileWatcher(std::filesystem::path path);
+
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher &) = delete;
+
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    // whether the file was written since the last call. Never blocks, so it can be called every frame.
+    bool pollChanged();
+};
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace punkt {
+// Fixed-size pool of worker threads. Tasks are executed in submission order (but possibly concurrently). If a task
+// throws, the first exception is stored and rethrown by the next call to wait().
+class ThreadPool {
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()> > m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_task_available;
+    std::condition_variable m_all_done;
+    size_t m_n_running{};
+    bool m_is_stopping{};
+    std::exception_ptr m_first_exception;
+
+    void workerLoop();
+
+public:
+    // n_threads == 0 means one thread per hardware thread
+    explicit ThreadPool(size_t n_threads = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void submit(std::function<void()> task);
+
+    // blocks until all submitted tasks have finished
+    void wait();
+
+    // Runs fn(i) for every i in [0, n) on the pool and the calling thread and blocks until all of them have finished.
+    // Only waits for its own calls of fn, so several threads may use the same pool concurrently. The first exception
+    // thrown by fn is rethrown.
+    void parallelFor(size_t n, const std::function<void(size_t)> &fn);
+
+    [[nodiscard]] size_t getNumThreads() const;
+
+    static size_t getDefaultNumThreads();
+};
+}
@@ -0,0 +1,126 @@
+#include "punkt/batch_layout.hpp"
+#include "punkt/dot.hpp"
+#include "punkt/snapshot.hpp"
+#include "punkt/utils/thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <utility>
+
+using namespace punkt;
+
+namespace fs = std::filesystem;
+
+using Clock = std::chrono::steady_clock;
+
+static double getElapsedMs(const Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+static std::optional<std::string> readGraphFile(const fs::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return std::nullopt;
+    }
+    return std::string(std::istreambuf_iterator(file), std::istreambuf_iterator<char>());
+}
+
+// the repo's exceptions do not expose what() through std::exception, so those are described by the stage they
+// failed in
+static std::string describeCurrentException(const std::string_view stage) {
+    try {
+        throw;
+    } catch (const std::exception &e) {
+        return std::string(stage) + ": " + e.what();
+    } catch (...) {
+        return std::string(stage) + " failed";
+    }
+}
+
+static void layOutGraphFile(BatchLayoutResult &result, render::glyph::GlyphLoader &glyph_loader) {
+    Clock::time_point start = Clock::now();
+    const std::optional<std::string> source = readGraphFile(result.m_graph_path);
+    if (!source) {
+        result.m_error = "Cannot read the graph file";
+        return;
+    }
+    std::optional<Digraph> dg;
+    try {
+        dg.emplace(*source);
+    } catch (...) {
+        result.m_error = describeCurrentException("Parsing");
+        return;
+    }
+    result.m_parse_ms = getElapsedMs(start);
+
+    start = Clock::now();
+    try {
+        dg->preprocess(glyph_loader);
+    } catch (...) {
+        result.m_error = describeCurrentException("Layout");
+        return;
+    }
+    result.m_layout_ms = getElapsedMs(start);
+
+    start = Clock::now();
+    try {
+        render::writeSnapshot(*dg, glyph_loader, result.m_output_path);
+    } catch (...) {
+        result.m_error = "Cannot write \"" + result.m_output_path.string() + "\"";
+        return;
+    }
+    result.m_write_ms = getElapsedMs(start);
+    result.m_is_ok = true;
+}
+
+std::vector<fs::path> punkt::collectBatchGraphPaths(const std::vector<fs::path> &paths) {
+    std::vector<fs::path> graph_paths;
+    for (const fs::path &path: paths) {
+        if (!fs::is_directory(path)) {
+            graph_paths.push_back(path);
+            continue;
+        }
+        std::vector<fs::path> dir_graph_paths;
+        for (const fs::directory_entry &entry: fs::directory_iterator(path)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".dot") {
+                dir_graph_paths.push_back(entry.path());
+            }
+        }
+        std::ranges::sort(dir_graph_paths);
+        graph_paths.insert(graph_paths.end(), dir_graph_paths.begin(), dir_graph_paths.end());
+    }
+    return graph_paths;
+}
+
+std::vector<BatchLayoutResult> punkt::runBatchLayout(const std::vector<fs::path> &graph_paths,
+                                                     const fs::path &output_dir,
+                                                     render::glyph::GlyphLoader &glyph_loader, const size_t n_threads) {
+    std::vector<BatchLayoutResult> results(graph_paths.size());
+    std::vector<size_t> jobs;
+    std::unordered_set<std::string> output_paths;
+    for (size_t i = 0; i < graph_paths.size(); i++) {
+        BatchLayoutResult &result = results[i];
+        result.m_graph_path = graph_paths[i];
+        result.m_output_path = output_dir / graph_paths[i].stem();
+        result.m_output_path += render::snapshot_file_extension;
+        if (!output_paths.insert(result.m_output_path.string()).second) {
+            result.m_error = "Output \"" + result.m_output_path.string() + "\" is already written by another graph";
+        } else {
+            jobs.push_back(i);
+        }
+    }
+    fs::create_directories(output_dir);
+
+    // the layout stages keep their scratch state per thread, so every worker lays out its own graphs independently
+    ThreadPool pool{n_threads};
+    pool.parallelFor(jobs.size(), [&](const size_t job) {
+        layOutGraphFile(results[jobs[job]], glyph_loader);
+    });
+    return results;
+}
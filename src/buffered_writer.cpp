@@ -0,0 +1,92 @@
+#include "punkt/utils/buffered_writer.hpp"
+
+#include <charconv>
+#include <cmath>
+
+using namespace punkt;
+
+// enough for any number BufferedWriter formats
+constexpr size_t max_formatted_number_size = 64;
+
+BufferedWriter::BufferedWriter(std::ostream &out)
+    : m_out(out) {
+}
+
+BufferedWriter::~BufferedWriter() {
+    flush();
+}
+
+void BufferedWriter::flush() {
+    m_out.write(m_buffer.data(), static_cast<std::streamsize>(m_size));
+    m_size = 0;
+}
+
+void BufferedWriter::reserve(const size_t n) {
+    if (m_size + n > m_buffer.size()) {
+        flush();
+    }
+}
+
+BufferedWriter &BufferedWriter::operator<<(const std::string_view s) {
+    if (s.size() > m_buffer.size()) {
+        flush();
+        m_out.write(s.data(), static_cast<std::streamsize>(s.size()));
+        return *this;
+    }
+    reserve(s.size());
+    s.copy(m_buffer.data() + m_size, s.size());
+    m_size += s.size();
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::operator<<(const char c) {
+    reserve(1);
+    m_buffer[m_size++] = c;
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::operator<<(const size_t n) {
+    reserve(max_formatted_number_size);
+    m_size = std::to_chars(m_buffer.data() + m_size, m_buffer.data() + m_buffer.size(), n).ptr - m_buffer.data();
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::writeDecimal(double x, const int max_decimals) {
+    if (!std::isfinite(x) || std::abs(x) >= 1e15) {
+        x = 0.0;
+    }
+    reserve(max_formatted_number_size);
+    char *const begin = m_buffer.data() + m_size;
+    char *end = std::to_chars(begin, m_buffer.data() + m_buffer.size(), x, std::chars_format::fixed,
+                              max_decimals).ptr;
+    if (max_decimals > 0) {
+        while (end[-1] == '0') {
+            end--;
+        }
+        if (end[-1] == '.') {
+            end--;
+        }
+    }
+    // "-0" would be odd to read
+    if (end - begin == 2 && begin[0] == '-' && begin[1] == '0') {
+        begin[0] = '0';
+        end--;
+    }
+    m_size = end - m_buffer.data();
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::writeJsonString(const std::string_view s) {
+    *this << '"';
+    for (const char c: s) {
+        if (c == '"' || c == '\\') {
+            *this << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            constexpr std::string_view hex_digits = "0123456789abcdef";
+            *this << "\\u00" << hex_digits[c >> 4 & 0xf] << hex_digits[c & 0xf];
+        } else {
+            *this << c;
+        }
+    }
+    return *this << '"';
+}
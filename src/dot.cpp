@@ -1,6 +1,9 @@
 #include "punkt/dot.hpp"
 #include "punkt/utils/int_types.hpp"
 #include "punkt/dot_constants.hpp"
+#include "punkt/layout/time_budget.hpp"
+#include "punkt/layout/layout_cache.hpp"
+#include "punkt/layout/cluster_memo.hpp"
 
 #include <ranges>
 
@@ -18,12 +21,40 @@ float punkt::BUBBLE_ORDERING_DX_WEIGHT = 1.0f;
 // TODO re-enable to 100
 ssize_t punkt::BUBBLE_ORDERING_MAX_ITERS = 0;
 
+size_t punkt::PARALLEL_SWEEP_MIN_RANKS = 64;
+size_t punkt::PARALLEL_SWEEP_BAND_SIZE = 8;
+
+// 0 = disabled
+size_t punkt::MULTI_START_ORDERING_RUNS = 0;
+uint64_t punkt::MULTI_START_ORDERING_SEED = 0;
+ssize_t punkt::MULTI_START_ORDERING_MAX_SWEEPS_PER_RUN = 24;
+
+size_t punkt::MULTILEVEL_ORDERING_MIN_NODES = 50000;
+size_t punkt::MULTILEVEL_ORDERING_COARSEST_NODES = 1000;
+ssize_t punkt::MULTILEVEL_ORDERING_REFINEMENT_SWEEPS = 4;
+
+size_t punkt::ITERATION_BUDGET_FULL_SIZE = 20000;
+
 // when to stop because change is too insignificant
 float punkt::BARYCENTER_X_OPTIMIZATION_MIN_AVERAGE_CHANGE_REQUIRED = 0.0f;
 // lerps x with mean x
 bool punkt::BARYCENTER_X_OPTIMIZATION_REGULARIZATION_ONLY_ON_DOWNWARD = false;
 float punkt::BARYCENTER_X_OPTIMIZATION_GHOST_NODE_RELATIVE_WEIGHT = 0.1f;
 ssize_t punkt::BARYCENTER_X_OPTIMIZATION_REGULARIZATION_RANK = -1;
+float punkt::BARYCENTER_X_OPTIMIZATION_CONVERGENCE_TOLERANCE = 0.0f;
+bool punkt::BARYCENTER_X_OPTIMIZATION_RECORD_TRAJECTORY = false;
+
+ssize_t punkt::QUADRATIC_X_OPTIMIZATION_MAX_ITERS = 500;
+float punkt::QUADRATIC_X_OPTIMIZATION_GHOST_EDGE_WEIGHT_FACTOR = 2.0f;
+float punkt::QUADRATIC_X_OPTIMIZATION_GHOST_CHAIN_WEIGHT_FACTOR = 8.0f;
+
+float punkt::TIME_BUDGET_ORDERING_SHARE = 0.5f;
+float punkt::TIME_BUDGET_X_OPTIMIZATION_SHARE = 0.8f;
+
+std::vector<float> punkt::PROGRESSIVE_LAYOUT_PASS_TIME_BUDGETS_MS = {0.0f, 100.0f};
+
+std::string punkt::LAYOUT_CACHE_DIRECTORY;
+size_t punkt::LAYOUT_CACHE_MAX_BYTES = 256 * 1024 * 1024;
 
 // TODO fix the pipeline
 // constexpr float x_optimization_pipeline_center_reg_factor = 100.0f;
@@ -148,12 +179,28 @@ void Digraph::preprocess(render::glyph::GlyphLoader &glyph_loader, const std::st
     for (Digraph &cluster_dg: std::views::values(m_clusters)) {
         cluster_dg.m_parent = this;
     }
+    layout::beginTimeBudgetedLayout(*this);
+
+    std::optional<layout::LayoutCacheKey> layout_cache_key;
+    if (layout::isLayoutCacheEnabled(*this)) {
+        layout_cache_key = layout::getLayoutCacheKey(*this, glyph_loader);
+        if (layout::loadCachedLayout(*this, *layout_cache_key)) {
+            return;
+        }
+    }
 
     populateIngoingNodesVectors();
     fuseClusterLinksIntoClusterSuperNodes();
     // fusing cluster links invalidates the Node&'s
     deleteIngoingNodesVectors();
 
+    // Clusters are laid out bottom-up before this graph, so their super nodes enter rank and coordinate assignment with
+    // their final size and every graph runs a single x optimization pass. Identical clusters are only laid out once.
+    layout::ClusterLayoutMemo cluster_memo;
+    for (auto &[cluster_id, cluster_dg]: m_clusters) {
+        cluster_memo.preprocess(cluster_dg, glyph_loader, cluster_id);
+    }
+
     populateIngoingNodesVectors();
     computeRanks();
     convertParentLinksToIOPorts(id_in_parent);
@@ -173,20 +220,10 @@ void Digraph::preprocess(render::glyph::GlyphLoader &glyph_loader, const std::st
     computeGraphLayout(glyph_loader);
     optimizeGraphLayout();
 
-    // after first optimization run, preprocess the clusters to compute their sizes
-    for (auto &[cluster_id, cluster_dg]: m_clusters) {
-        cluster_dg.preprocess(glyph_loader, cluster_id);
-        // update the cluster node with the cluster dimensions
-        Node &node = m_nodes.at(cluster_id);
-        node.m_render_attrs.m_width = cluster_dg.m_render_attrs.m_graph_width;
-        node.m_render_attrs.m_height = cluster_dg.m_render_attrs.m_graph_height;
-    }
-
-    if (!m_clusters.empty()) {
-        // re-run x opt after
-        optimizeGraphLayout();
-    }
-
     computeEdgeLayout();
     computeEdgeLabelLayouts(glyph_loader);
+
+    if (layout_cache_key) {
+        layout::storeCachedLayout(*this, *layout_cache_key);
+    }
 }
@@ -0,0 +1,87 @@
+#include "punkt/utils/file_watcher.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <climits>
+#include <cstring>
+#endif
+
+using namespace punkt;
+
+constexpr auto file_watcher_poll_interval = std::chrono::milliseconds(250);
+
+static std::filesystem::file_time_type getLastWriteTime(const std::filesystem::path &path) {
+    std::error_code ec;
+    const std::filesystem::file_time_type t = std::filesystem::last_write_time(path, ec);
+    return ec ? std::filesystem::file_time_type{} : t;
+}
+
+FileWatcher::FileWatcher(std::filesystem::path path)
+    : m_path(std::move(path)), m_last_write_time(getLastWriteTime(m_path)) {
+#ifdef __linux__
+    m_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify_fd >= 0) {
+        std::filesystem::path dir = m_path.parent_path();
+        if (dir.empty()) {
+            dir = ".";
+        }
+        // a partially written file is only reported once the writer closes it
+        if (inotify_add_watch(m_inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+            close(m_inotify_fd);
+            m_inotify_fd = -1;
+        }
+    }
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+    if (m_inotify_fd >= 0) {
+        close(m_inotify_fd);
+    }
+#endif
+}
+
+bool FileWatcher::pollModificationTime() {
+    const auto now = std::chrono::steady_clock::now();
+    if (now - m_last_poll < file_watcher_poll_interval) {
+        return false;
+    }
+    m_last_poll = now;
+    const std::filesystem::file_time_type t = getLastWriteTime(m_path);
+    if (t == m_last_write_time) {
+        return false;
+    }
+    m_last_write_time = t;
+    return true;
+}
+
+bool FileWatcher::pollChanged() {
+#ifdef __linux__
+    if (m_inotify_fd >= 0) {
+        const std::string file_name = m_path.filename().string();
+        bool changed = false;
+        alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+        ssize_t n_read;
+        // drain all pending events, an editor save usually produces several
+        while ((n_read = read(m_inotify_fd, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t offset = 0; offset < n_read;) {
+                inotify_event event;
+                std::memcpy(&event, buffer + offset, sizeof(inotify_event));
+                if (event.len > 0 && file_name == buffer + offset + sizeof(inotify_event)) {
+                    changed = true;
+                }
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event.len);
+            }
+        }
+        return changed;
+    }
+#endif
+    return pollModificationTime();
+}
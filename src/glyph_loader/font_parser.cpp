@@ -29,9 +29,11 @@ static void setMaxFontSize(size_t &m_max_allowed_font_size) {
     m_max_allowed_font_size = std::min(value, 1024);
 }
 
-GlyphLoader::GlyphLoader(std::string font_path)
-    : m_is_real_loader(true), m_font_path(std::move(font_path)) {
-    setMaxFontSize(m_max_allowed_font_size);
+GlyphLoader::GlyphLoader(std::string font_path, const bool headless)
+    : m_is_real_loader(true), m_is_headless(headless), m_font_path(std::move(font_path)) {
+    if (!m_is_headless) {
+        setMaxFontSize(m_max_allowed_font_size);
+    }
     if (raw_font_data_map.contains(m_font_path)) {
         m_raw_font_data = raw_font_data_map[m_font_path];
     } else {
@@ -49,7 +51,13 @@ GlyphLoader::GlyphLoader(std::string font_path)
         font_file.read(m_raw_font_data.data(), file_size);
     }
     parseFontData();
-    loadAndCompileShaders();
+    if (!m_is_headless) {
+        loadAndCompileShaders();
+    }
+}
+
+size_t GlyphLoader::getFontFingerprint() const {
+    return m_is_real_loader ? std::hash<std::string>{}(m_raw_font_data) : 0;
 }
 
 void GlyphLoader::parseFontData() {
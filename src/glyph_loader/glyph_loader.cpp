@@ -62,6 +62,7 @@ GlyphMeta GlyphLoader::getGlyphMeta(const char32_t c, const size_t font_size) {
 }
 
 const Glyph &GlyphLoader::getGlyph(const char32_t c, const size_t font_size) {
+    assert(!m_is_headless && "headless glyph loaders cannot load glyphs");
     if (font_size == 0 || font_size > m_max_allowed_font_size) {
         throw IllegalFontSizeException(font_size);
     }
@@ -0,0 +1,313 @@
+#include "punkt/dot.hpp"
+#include "punkt/utils/int_types.hpp"
+#include "punkt/layout/layered_graph.hpp"
+#include "punkt/layout/coordinate_assignment.hpp"
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <ranges>
+#include <cassert>
+
+using namespace punkt;
+using namespace punkt::layout;
+
+constexpr size_t no_node = std::numeric_limits<size_t>::max();
+
+namespace {
+// The rank structure as seen from one of the four directions. Ranks are stored in the order they are visited and the
+// nodes of every rank in the order they are compacted in, so that all four directions can share the top-left code.
+struct BKFrame {
+    std::vector<std::vector<size_t> > m_layers;
+    // node id -> index of the node within its (possibly mirrored) layer
+    std::vector<size_t> m_positions;
+    // node id -> neighbours on the previously visited layer, sorted by position. Zero weight edges are left out.
+    std::vector<std::vector<size_t> > m_upper;
+    // node id -> for every entry of m_upper, whether the segment to that neighbour takes part in a type 1 conflict
+    std::vector<std::vector<bool> > m_is_marked;
+};
+}
+
+static BKFrame buildFrame(const LayeredGraph &lg, const bool is_bottom_to_top, const bool is_right_to_left) {
+    BKFrame frame;
+    frame.m_layers = lg.m_orderings;
+    if (is_bottom_to_top) {
+        std::ranges::reverse(frame.m_layers);
+    }
+    frame.m_positions.resize(lg.getNumNodes());
+    for (std::vector<size_t> &layer: frame.m_layers) {
+        if (is_right_to_left) {
+            std::ranges::reverse(layer);
+        }
+        for (size_t i = 0; i < layer.size(); i++) {
+            frame.m_positions[layer[i]] = i;
+        }
+    }
+
+    frame.m_upper.resize(lg.getNumNodes());
+    frame.m_is_marked.resize(lg.getNumNodes());
+    for (size_t node = 0; node < lg.getNumNodes(); node++) {
+        std::vector<size_t> &upper = frame.m_upper[node];
+        // the previously visited rank is rank + 1 when going bottom to top
+        for (const LayeredGraph::Neighbour &neighbour: lg.getNeighbours(node, is_bottom_to_top)) {
+            if (neighbour.m_weight > 0) {
+                upper.push_back(neighbour.m_node);
+            }
+        }
+        // the adjacency is sorted by original position, which is exactly the reverse of a mirrored layer
+        if (is_right_to_left) {
+            std::ranges::reverse(upper);
+        }
+        frame.m_is_marked[node].resize(upper.size());
+    }
+    return frame;
+}
+
+// returns the upper end of the inner segment (an edge between two ghost nodes) ending in `node`, if there is one
+static size_t getInnerSegmentUpperNode(const BKFrame &frame, const std::vector<bool> &is_ghost, const size_t node) {
+    if (!is_ghost[node]) {
+        return no_node;
+    }
+    for (const size_t upper: frame.m_upper[node]) {
+        if (is_ghost[upper]) {
+            return upper;
+        }
+    }
+    return no_node;
+}
+
+// Marks every non-inner segment that crosses an inner segment (type 1 conflict), so that the alignment never breaks
+// a chain of ghost nodes apart. Linear in the number of segments.
+static void markType1Conflicts(BKFrame &frame, const std::vector<bool> &is_ghost) {
+    for (size_t i = 1; i < frame.m_layers.size(); i++) {
+        const std::vector<size_t> &upper_layer = frame.m_layers[i - 1];
+        const std::vector<size_t> &layer = frame.m_layers[i];
+        size_t k0 = 0, l = 0;
+        for (size_t l1 = 0; l1 < layer.size(); l1++) {
+            const size_t inner_upper = getInnerSegmentUpperNode(frame, is_ghost, layer[l1]);
+            if (l1 + 1 != layer.size() && inner_upper == no_node) {
+                continue;
+            }
+            size_t k1 = upper_layer.empty() ? 0 : upper_layer.size() - 1;
+            if (inner_upper != no_node) {
+                k1 = frame.m_positions[inner_upper];
+            }
+            for (; l <= l1; l++) {
+                const size_t node = layer[l];
+                for (size_t j = 0; j < frame.m_upper[node].size(); j++) {
+                    if (const size_t k = frame.m_positions[frame.m_upper[node][j]]; k < k0 || k > k1) {
+                        frame.m_is_marked[node][j] = true;
+                    }
+                }
+            }
+            k0 = k1;
+        }
+    }
+}
+
+// groups the nodes into blocks by aligning each node with one of its median upper neighbours
+static void alignVertically(const BKFrame &frame, std::vector<size_t> &out_root, std::vector<size_t> &out_align) {
+    std::iota(out_root.begin(), out_root.end(), 0);
+    std::iota(out_align.begin(), out_align.end(), 0);
+    for (const std::vector<size_t> &layer: frame.m_layers) {
+        // position of the rightmost upper node aligned so far on this layer, alignments must not cross
+        ssize_t r = -1;
+        for (const size_t node: layer) {
+            const std::vector<size_t> &upper = frame.m_upper[node];
+            if (upper.empty()) {
+                continue;
+            }
+            const size_t d = upper.size();
+            for (const size_t m: {(d - 1) / 2, d / 2}) {
+                if (out_align[node] != node) {
+                    break;
+                }
+                const size_t u = upper[m];
+                if (const auto u_pos = static_cast<ssize_t>(frame.m_positions[u]);
+                    !frame.m_is_marked[node][m] && r < u_pos) {
+                    out_align[u] = node;
+                    out_root[node] = out_root[u];
+                    out_align[node] = out_root[node];
+                    r = u_pos;
+                }
+            }
+        }
+    }
+}
+
+// Horizontal compaction as in the paper: place_block assigns every block the smallest coordinate relative to the sink
+// (leftmost block) of its class, then the classes are shifted towards each other. The shifts are propagated through
+// the class graph in topological order, so that chains of classes stay separated (the erratum to the paper).
+static std::vector<float> compactHorizontally(const BKFrame &frame, const std::vector<size_t> &root,
+                                              const std::vector<size_t> &align, const std::vector<float> &widths,
+                                              const float node_sep) {
+    const size_t n_nodes = root.size();
+    // node id -> the node visited directly before it on its layer
+    std::vector<size_t> left_neighbour(n_nodes, no_node);
+    for (const std::vector<size_t> &layer: frame.m_layers) {
+        for (size_t i = 1; i < layer.size(); i++) {
+            left_neighbour[layer[i]] = layer[i - 1];
+        }
+    }
+    const auto getSep = [&](const size_t left, const size_t right) {
+        return (widths[left] + widths[right]) / 2.0f + node_sep;
+    };
+
+    // separation constraint between a node and its left neighbour, whose blocks ended up in different classes
+    struct ClassConstraint {
+        size_t m_left, m_right;
+    };
+    std::vector<ClassConstraint> class_constraints;
+
+    // place_block, with an explicit stack because blocks can nest as deep as the graph is wide
+    enum class PlaceState { unplaced, placing, placed };
+    struct PlaceFrame {
+        size_t m_block, m_node;
+    };
+    std::vector<float> x(n_nodes);
+    std::vector<size_t> sink(n_nodes);
+    std::iota(sink.begin(), sink.end(), 0);
+    std::vector<PlaceState> states(n_nodes, PlaceState::unplaced);
+    std::vector<PlaceFrame> stack;
+    for (const std::vector<size_t> &layer: frame.m_layers) {
+        for (const size_t node: layer) {
+            if (root[node] != node || states[node] != PlaceState::unplaced) {
+                continue;
+            }
+            states[node] = PlaceState::placing;
+            stack.push_back({node, node});
+            while (!stack.empty()) {
+                const auto [block, w] = stack.back();
+                if (const size_t u = left_neighbour[w]; u != no_node) {
+                    const size_t u_block = root[u];
+                    if (states[u_block] == PlaceState::unplaced) {
+                        states[u_block] = PlaceState::placing;
+                        stack.push_back({u_block, u_block});
+                        continue;
+                    }
+                    // the block graph is acyclic because the alignment never crosses itself
+                    assert(states[u_block] == PlaceState::placed);
+                    if (sink[block] == block) {
+                        sink[block] = sink[u_block];
+                    }
+                    if (sink[block] != sink[u_block]) {
+                        class_constraints.push_back({u, w});
+                    } else {
+                        x[block] = std::max(x[block], x[u_block] + getSep(u, w));
+                    }
+                }
+                if (const size_t next = align[w]; next != block) {
+                    stack.back().m_node = next;
+                } else {
+                    states[block] = PlaceState::placed;
+                    stack.pop_back();
+                }
+            }
+        }
+    }
+
+    // shift[c] <= shift[c'] + x[right] - x[left] - sep for every constraint from class c' (right) to class c (left)
+    std::ranges::sort(class_constraints, {}, [&](const ClassConstraint &c) { return sink[root[c.m_right]]; });
+    std::vector<size_t> in_degrees(n_nodes);
+    for (const ClassConstraint &c: class_constraints) {
+        in_degrees[sink[root[c.m_left]]]++;
+    }
+    std::vector<size_t> class_order;
+    for (size_t node = 0; node < n_nodes; node++) {
+        if (root[node] == node && sink[node] == node && in_degrees[node] == 0) {
+            class_order.push_back(node);
+        }
+    }
+    std::vector<float> shift(n_nodes, std::numeric_limits<float>::infinity());
+    for (size_t i = 0; i < class_order.size(); i++) {
+        const size_t right_class = class_order[i];
+        if (shift[right_class] == std::numeric_limits<float>::infinity()) {
+            shift[right_class] = 0.0f;
+        }
+        const auto [first, last] = std::ranges::equal_range(
+            class_constraints, right_class, {}, [&](const ClassConstraint &c) { return sink[root[c.m_right]]; });
+        for (const ClassConstraint &c: std::ranges::subrange(first, last)) {
+            const size_t left_class = sink[root[c.m_left]];
+            shift[left_class] = std::min(shift[left_class], shift[right_class] + x[root[c.m_right]] -
+                                                            x[root[c.m_left]] - getSep(c.m_left, c.m_right));
+            if (--in_degrees[left_class] == 0) {
+                class_order.push_back(left_class);
+            }
+        }
+    }
+    assert(std::ranges::all_of(std::views::iota(size_t{0}, n_nodes), [&](const size_t node) {
+        return root[node] != node || sink[node] != node || shift[node] != std::numeric_limits<float>::infinity();
+    }));
+
+    std::vector<float> xs(n_nodes);
+    for (size_t node = 0; node < n_nodes; node++) {
+        xs[node] = x[root[node]] + shift[sink[root[node]]];
+    }
+    return xs;
+}
+
+void layout::assignXCoordinatesBrandesKoepf(Digraph &dg) {
+    const LayeredGraph lg = LayeredGraph::fromDigraph(dg);
+    const size_t n_nodes = lg.getNumNodes();
+    if (n_nodes == 0) {
+        return;
+    }
+    std::vector<float> widths(n_nodes);
+    std::vector<bool> is_ghost(n_nodes);
+    for (size_t node = 0; node < n_nodes; node++) {
+        const NodeRenderAttrs &render_attrs = dg.m_nodes.at(lg.m_names[node]).m_render_attrs;
+        widths[node] = static_cast<float>(render_attrs.m_width);
+        is_ghost[node] = render_attrs.m_is_ghost;
+    }
+    const auto node_sep = static_cast<float>(dg.m_render_attrs.m_node_sep);
+
+    // one layout per direction: (top-to-bottom, left-to-right), (top-to-bottom, right-to-left), ...
+    std::array<std::vector<float>, 4> layouts;
+    std::vector<size_t> root(n_nodes), align(n_nodes);
+    for (size_t dir = 0; dir < layouts.size(); dir++) {
+        const bool is_bottom_to_top = dir >= 2, is_right_to_left = dir % 2 == 1;
+        BKFrame frame = buildFrame(lg, is_bottom_to_top, is_right_to_left);
+        markType1Conflicts(frame, is_ghost);
+        alignVertically(frame, root, align);
+        layouts[dir] = compactHorizontally(frame, root, align, widths, node_sep);
+        if (is_right_to_left) {
+            for (float &x: layouts[dir]) {
+                x = -x;
+            }
+        }
+    }
+
+    // align all layouts to the one with the smallest width: left-to-right layouts at its left border, right-to-left
+    // layouts at its right border
+    std::array<float, 4> mins{}, maxs{};
+    size_t narrowest = 0;
+    for (size_t dir = 0; dir < layouts.size(); dir++) {
+        mins[dir] = std::numeric_limits<float>::infinity();
+        maxs[dir] = -std::numeric_limits<float>::infinity();
+        for (size_t node = 0; node < n_nodes; node++) {
+            mins[dir] = std::min(mins[dir], layouts[dir][node] - widths[node] / 2.0f);
+            maxs[dir] = std::max(maxs[dir], layouts[dir][node] + widths[node] / 2.0f);
+        }
+        if (maxs[dir] - mins[dir] < maxs[narrowest] - mins[narrowest]) {
+            narrowest = dir;
+        }
+    }
+    for (size_t dir = 0; dir < layouts.size(); dir++) {
+        const float shift = dir % 2 == 1 ? maxs[narrowest] - maxs[dir] : mins[narrowest] - mins[dir];
+        for (float &x: layouts[dir]) {
+            x += shift;
+        }
+    }
+
+    // the balanced coordinate is the average of the two median candidates
+    for (size_t node = 0; node < n_nodes; node++) {
+        std::array<float, 4> candidates{};
+        for (size_t dir = 0; dir < layouts.size(); dir++) {
+            candidates[dir] = layouts[dir][node];
+        }
+        std::ranges::sort(candidates);
+        dg.m_nodes.at(lg.m_names[node]).m_render_attrs.m_barycenter_x = (candidates[1] + candidates[2]) / 2.0f;
+    }
+}
@@ -0,0 +1,347 @@
+#include "punkt/layout/cluster_memo.hpp"
+#include "punkt/dot.hpp"
+#include "punkt/layout/populate_glyph_quads_with_text.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <functional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <utility>
+
+using namespace punkt;
+using namespace punkt::layout;
+
+constexpr uint64_t out_edges_salt = 0x6f7574ull, individualized_salt = 0x696e6476ull;
+
+// order dependent, well mixing hash combination (splitmix64 finalizer)
+static uint64_t mixHash(const uint64_t h, uint64_t v) {
+    v += 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    v ^= v >> 30;
+    v *= 0xbf58476d1ce4e5b9ull;
+    v ^= v >> 27;
+    v *= 0x94d049bb133111ebull;
+    v ^= v >> 31;
+    return h ^ v;
+}
+
+static uint64_t hashString(const std::string_view s) {
+    return std::hash<std::string_view>{}(s);
+}
+
+// Attrs only the renderer reads. Clusters and nodes whose attrs differ only in these share a layout (the label through
+// its size), while edges keep all of theirs because a reused layout copies the edges of the laid out cluster.
+constexpr std::array<std::string_view, 7> render_only_attrs = {
+    "label", "color", "fontcolor", "fillcolor", "bgcolor", "pencolor", "style"
+};
+
+static CanonicalAttrs getCanonicalAttrs(const Attrs &attrs, const std::span<const std::string_view> ignored_keys = {}) {
+    CanonicalAttrs canonical_attrs;
+    canonical_attrs.reserve(attrs.size());
+    for (const auto &[key, value]: attrs) {
+        if (std::ranges::find(ignored_keys, key) == ignored_keys.end()) {
+            canonical_attrs.emplace_back(key, value);
+        }
+    }
+    std::ranges::sort(canonical_attrs);
+    return canonical_attrs;
+}
+
+static uint64_t hashCanonicalAttrs(const CanonicalAttrs &attrs) {
+    uint64_t h = attrs.size();
+    for (const auto &[key, value]: attrs) {
+        h = mixHash(h, mixHash(hashString(key), hashString(value)));
+    }
+    return h;
+}
+
+static size_t countDistinct(std::vector<uint64_t> values) {
+    std::ranges::sort(values);
+    return static_cast<size_t>(std::ranges::distance(values.begin(), std::ranges::unique(values).begin()));
+}
+
+namespace {
+struct LabeledEdge {
+    size_t m_node;
+    uint64_t m_hash;
+};
+
+// Weisfeiler-Lehman color refinement over a cluster whose nodes are indexed in name order
+struct ColorRefinement {
+    std::vector<std::vector<LabeledEdge> > m_outgoing, m_ingoing;
+    std::vector<uint64_t> m_colors;
+
+    [[nodiscard]] uint64_t hashNeighbourhood(const std::vector<LabeledEdge> &edges,
+                                             std::vector<uint64_t> &scratch) const {
+        scratch.clear();
+        for (const LabeledEdge &e: edges) {
+            scratch.push_back(mixHash(e.m_hash, m_colors[e.m_node]));
+        }
+        std::ranges::sort(scratch);
+        uint64_t h = scratch.size();
+        for (const uint64_t v: scratch) {
+            h = mixHash(h, v);
+        }
+        return h;
+    }
+
+    // refines the colors until the partition into color classes is stable, returns the number of classes
+    size_t refine() {
+        size_t n_classes = countDistinct(m_colors);
+        std::vector<uint64_t> new_colors(m_colors.size()), scratch;
+        while (true) {
+            for (size_t v = 0; v < m_colors.size(); v++) {
+                const uint64_t out_hash = mixHash(out_edges_salt, hashNeighbourhood(m_outgoing[v], scratch));
+                new_colors[v] = mixHash(mixHash(m_colors[v], out_hash), hashNeighbourhood(m_ingoing[v], scratch));
+            }
+            std::swap(m_colors, new_colors);
+            const size_t n_new_classes = countDistinct(m_colors);
+            if (n_new_classes == n_classes) {
+                return n_classes;
+            }
+            n_classes = n_new_classes;
+        }
+    }
+
+    // makes every color unique by individualizing the first node (in name order) of the smallest tied color class
+    // until the refinement separates all nodes
+    void individualize() {
+        while (refine() < m_colors.size()) {
+            std::vector<uint64_t> sorted = m_colors;
+            std::ranges::sort(sorted);
+            uint64_t tied_color{};
+            for (size_t i = 0; i + 1 < sorted.size(); i++) {
+                if (sorted[i] == sorted[i + 1]) {
+                    tied_color = sorted[i];
+                    break;
+                }
+            }
+            const auto it = std::ranges::find(m_colors, tied_color);
+            *it = mixHash(*it, individualized_salt);
+        }
+    }
+};
+}
+
+bool ClusterCanonicalForm::isIsomorphicTo(const ClusterCanonicalForm &other) const {
+    return m_hash == other.m_hash && m_graph_attrs == other.m_graph_attrs
+           && m_rank_dir.m_is_sideways == other.m_rank_dir.m_is_sideways
+           && m_rank_dir.m_is_reversed == other.m_rank_dir.m_is_reversed && m_label_width == other.m_label_width
+           && m_label_height == other.m_label_height && m_has_label_glyphs == other.m_has_label_glyphs
+           && m_nodes == other.m_nodes && m_edges == other.m_edges;
+}
+
+std::optional<ClusterCanonicalForm> layout::computeClusterCanonicalForm(const Digraph &cluster_dg,
+                                                                        render::glyph::GlyphLoader &glyph_loader) {
+    // rank constraints refer to nodes by name and nested clusters would need their own node correspondence
+    if (cluster_dg.m_nodes.empty() || !cluster_dg.m_clusters.empty() || !cluster_dg.m_rank_constraints.empty()) {
+        return std::nullopt;
+    }
+
+    // name order only serves as a deterministic tie breaker
+    std::vector<std::string_view> names;
+    names.reserve(cluster_dg.m_nodes.size());
+    for (const std::string_view name: std::views::keys(cluster_dg.m_nodes)) {
+        names.push_back(name);
+    }
+    std::ranges::sort(names);
+    std::unordered_map<std::string_view, size_t> indices;
+    indices.reserve(names.size());
+    for (size_t i = 0; i < names.size(); i++) {
+        indices.emplace(names[i], i);
+    }
+
+    const size_t n_nodes = names.size();
+    ColorRefinement cr;
+    cr.m_outgoing.resize(n_nodes);
+    cr.m_ingoing.resize(n_nodes);
+    cr.m_colors.resize(n_nodes);
+    std::vector<std::tuple<CanonicalAttrs, size_t, size_t> > nodes;
+    nodes.reserve(n_nodes);
+    std::vector<std::tuple<size_t, size_t, CanonicalAttrs> > edges;
+    std::vector<uint64_t> edge_hashes;
+    for (size_t i = 0; i < n_nodes; i++) {
+        const Node &node = cluster_dg.m_nodes.at(names[i]);
+        // the label text only matters through the node size it results in
+        Node probe{node.m_name, node.m_attrs};
+        probe.populateRenderInfo(glyph_loader, cluster_dg.m_render_attrs.m_rank_dir);
+        const auto &[attrs, width, height] = nodes.emplace_back(getCanonicalAttrs(node.m_attrs, render_only_attrs),
+                                                                probe.m_render_attrs.m_width,
+                                                                probe.m_render_attrs.m_height);
+        cr.m_colors[i] = mixHash(mixHash(hashCanonicalAttrs(attrs), width), height);
+        for (const Edge &edge: node.m_outgoing) {
+            const size_t dest = indices.at(edge.m_dest);
+            const auto &[u, v, edge_attrs] = edges.emplace_back(i, dest, getCanonicalAttrs(edge.m_attrs));
+            const uint64_t edge_hash = hashCanonicalAttrs(edge_attrs);
+            cr.m_outgoing[i].push_back({dest, edge_hash});
+            cr.m_ingoing[dest].push_back({i, edge_hash});
+            edge_hashes.push_back(edge_hash);
+        }
+    }
+    const std::vector<uint64_t> node_descriptors = cr.m_colors;
+    cr.individualize();
+
+    std::vector<size_t> order(n_nodes);
+    for (size_t i = 0; i < n_nodes; i++) {
+        order[i] = i;
+    }
+    std::ranges::sort(order, [&](const size_t a, const size_t b) { return cr.m_colors[a] < cr.m_colors[b]; });
+    std::vector<size_t> positions(n_nodes);
+    for (size_t pos = 0; pos < n_nodes; pos++) {
+        positions[order[pos]] = pos;
+    }
+
+    ClusterCanonicalForm form;
+    form.m_graph_attrs = getCanonicalAttrs(cluster_dg.m_attrs, render_only_attrs);
+    form.m_rank_dir = cluster_dg.m_render_attrs.m_rank_dir;
+    std::vector<GlyphQuad> label_quads;
+    populateGraphLabelText(cluster_dg.m_attrs, glyph_loader, label_quads, form.m_label_width, form.m_label_height,
+                           form.m_rank_dir);
+    form.m_has_label_glyphs = !label_quads.empty();
+    form.m_hash = mixHash(mixHash(mixHash(hashCanonicalAttrs(form.m_graph_attrs), form.m_label_width),
+                                  form.m_label_height),
+                          4 * static_cast<uint64_t>(form.m_has_label_glyphs)
+                          + 2 * static_cast<uint64_t>(form.m_rank_dir.m_is_sideways) + form.m_rank_dir.m_is_reversed);
+    form.m_hash = mixHash(form.m_hash, n_nodes);
+    form.m_nodes.reserve(n_nodes);
+    form.m_node_order.reserve(n_nodes);
+    for (const size_t i: order) {
+        form.m_hash = mixHash(form.m_hash, node_descriptors[i]);
+        form.m_nodes.push_back(std::move(nodes[i]));
+        form.m_node_order.push_back(names[i]);
+    }
+    std::vector<std::tuple<size_t, size_t, uint64_t> > hashed_edges;
+    hashed_edges.reserve(edges.size());
+    form.m_edges.reserve(edges.size());
+    for (size_t i = 0; i < edges.size(); i++) {
+        auto &[u, v, edge_attrs] = edges[i];
+        hashed_edges.emplace_back(positions[u], positions[v], edge_hashes[i]);
+        form.m_edges.emplace_back(positions[u], positions[v], std::move(edge_attrs));
+    }
+    std::ranges::sort(hashed_edges);
+    std::ranges::sort(form.m_edges);
+    for (const auto &[u, v, edge_hash]: hashed_edges) {
+        form.m_hash = mixHash(mixHash(mixHash(form.m_hash, u), v), edge_hash);
+    }
+    return form;
+}
+
+void layout::copyClusterLayout(const Digraph &source, const ClusterCanonicalForm &source_form, Digraph &target,
+                               const ClusterCanonicalForm &target_form, render::glyph::GlyphLoader &glyph_loader) {
+    assert(source_form.isIsomorphicTo(target_form));
+    std::unordered_map<std::string_view, std::string_view> renamed;
+    renamed.reserve(source_form.m_node_order.size());
+    for (size_t i = 0; i < source_form.m_node_order.size(); i++) {
+        renamed.emplace(source_form.m_node_order[i], target_form.m_node_order[i]);
+    }
+    // strings only the laid out source owns (ghost node names, attrs of ghost nodes and edges) are copied into target
+    std::unordered_map<std::string_view, std::string_view> interned;
+    const auto intern = [&](const std::string_view s) {
+        const auto [it, inserted] = interned.try_emplace(s);
+        if (inserted) {
+            it->second = target.m_referenced_sources.emplace_front(s);
+        }
+        return it->second;
+    };
+    const auto rename = [&](const std::string_view name) {
+        const auto it = renamed.find(name);
+        return it != renamed.end() ? it->second : intern(name);
+    };
+    const auto internAttrs = [&](const Attrs &attrs) {
+        Attrs out;
+        out.reserve(attrs.size());
+        for (const auto &[key, value]: attrs) {
+            out.emplace(intern(key), intern(value));
+        }
+        return out;
+    };
+
+    // the parse-time nodes the source layout dropped (link nodes) are dropped from target as well
+    std::unordered_map<std::string_view, Node> nodes;
+    nodes.reserve(source.m_nodes.size());
+    for (const Node &source_node: std::views::values(source.m_nodes)) {
+        const std::string_view name = rename(source_node.m_name);
+        const auto parsed = target.m_nodes.find(name);
+        Node node(name, parsed != target.m_nodes.end() ? parsed->second.m_attrs : internAttrs(source_node.m_attrs));
+        node.m_id = source_node.m_id;
+        node.m_render_attrs = source_node.m_render_attrs;
+        if (parsed != target.m_nodes.end()) {
+            // the sizes match by construction of the canonical form, but the label text may differ
+            Node probe{name, node.m_attrs};
+            probe.populateRenderInfo(glyph_loader, target.m_render_attrs.m_rank_dir);
+            assert(probe.m_render_attrs.m_width == node.m_render_attrs.m_width &&
+                probe.m_render_attrs.m_height == node.m_render_attrs.m_height);
+            node.m_render_attrs.m_quads = std::move(probe.m_render_attrs.m_quads);
+        }
+        node.m_outgoing.reserve(source_node.m_outgoing.size());
+        for (const Edge &source_edge: source_node.m_outgoing) {
+            Edge &edge = node.m_outgoing.emplace_back(rename(source_edge.m_source), rename(source_edge.m_dest),
+                                                      internAttrs(source_edge.m_attrs));
+            edge.m_id = source_edge.m_id;
+            edge.m_render_attrs = source_edge.m_render_attrs;
+        }
+        nodes.emplace(name, std::move(node));
+    }
+
+    // the label text of target may differ from that of source (only the size is part of the canonical form), so the
+    // label is laid out again and moved to where the layout placed the label of source
+    std::vector<GlyphQuad> source_label_quads, target_label_quads;
+    size_t label_width, label_height;
+    populateGraphLabelText(source.m_attrs, glyph_loader, source_label_quads, label_width, label_height,
+                           source.m_render_attrs.m_rank_dir);
+    populateGraphLabelText(target.m_attrs, glyph_loader, target_label_quads, label_width, label_height,
+                           target.m_render_attrs.m_rank_dir);
+    target.m_render_attrs = source.m_render_attrs;
+    if (!target_label_quads.empty()) {
+        const GlyphQuad &placed = source.m_render_attrs.m_label_quads.front(), &unplaced = source_label_quads.front();
+        const ssize_t dx = static_cast<ssize_t>(placed.m_left) - static_cast<ssize_t>(unplaced.m_left);
+        const ssize_t dy = static_cast<ssize_t>(placed.m_top) - static_cast<ssize_t>(unplaced.m_top);
+        for (GlyphQuad &gq: target_label_quads) {
+            gq.m_left += dx;
+            gq.m_right += dx;
+            gq.m_top += dy;
+            gq.m_bottom += dy;
+        }
+    }
+    target.m_render_attrs.m_label_quads = std::move(target_label_quads);
+    target.m_rank_counts = source.m_rank_counts;
+    target.m_per_rank_orderings.clear();
+    target.m_per_rank_orderings.reserve(source.m_per_rank_orderings.size());
+    for (const std::vector<std::string_view> &source_ordering: source.m_per_rank_orderings) {
+        std::vector<std::string_view> &ordering = target.m_per_rank_orderings.emplace_back();
+        ordering.reserve(source_ordering.size());
+        for (const std::string_view name: source_ordering) {
+            ordering.push_back(rename(name));
+        }
+    }
+    target.m_node_positions = source.m_node_positions;
+    target.m_edge_layout_weights = source.m_edge_layout_weights;
+    target.m_n_ghost_nodes = source.m_n_ghost_nodes;
+    target.m_io_port_ranks = source.m_io_port_ranks;
+    target.m_nodes = std::move(nodes);
+    target.m_x_opt_trajectory.clear();
+    target.populateIngoingNodesVectors();
+}
+
+bool ClusterLayoutMemo::preprocess(Digraph &cluster_dg, render::glyph::GlyphLoader &glyph_loader,
+                                   const std::string_view id_in_parent) {
+    std::optional<ClusterCanonicalForm> form = computeClusterCanonicalForm(cluster_dg, glyph_loader);
+    if (form) {
+        if (const auto it = m_entries.find(form->m_hash); it != m_entries.end()) {
+            for (const Entry &entry: it->second) {
+                if (entry.m_form.isIsomorphicTo(*form)) {
+                    copyClusterLayout(*entry.m_laid_out_dg, entry.m_form, cluster_dg, *form, glyph_loader);
+                    return true;
+                }
+            }
+        }
+    }
+    cluster_dg.preprocess(glyph_loader, id_in_parent);
+    if (form) {
+        const uint64_t hash = form->m_hash;
+        m_entries[hash].push_back({std::move(*form), &cluster_dg});
+    }
+    return false;
+}
@@ -1,6 +1,7 @@
 #include "punkt/dot.hpp"
 #include "punkt/dot_constants.hpp"
 #include "punkt/utils/int_types.hpp"
+#include "punkt/utils/thread_pool.hpp"
 #include "punkt/layout/common.hpp"
 
 #include <cassert>
@@ -11,18 +12,20 @@
 #include <cstring>
 #include <numeric>
 #include <string_view>
+#include <span>
 
 using namespace punkt;
 using namespace punkt::layout;
 
-void layout::populateOrderingIndexAtRank(Digraph &dg, const size_t rank) {
+void layout::populateNodePositionsAtRank(Digraph &dg, const size_t rank) {
     for (size_t x = 0; x < dg.m_per_rank_orderings[rank].size(); x++) {
-        dg.m_per_rank_orderings_index.at(rank).insert_or_assign(dg.m_per_rank_orderings[rank][x], x);
+        dg.m_node_positions.at(dg.m_nodes.at(dg.m_per_rank_orderings[rank][x]).m_id) = x;
     }
 }
 
 // populates the dg.m_per_rank_orderings by sorting nodes of each rank alphabetically. This is supposed to make similar
-// inputs more coherent in terms of output.
+// inputs more coherent in terms of output. Also assigns the node ids (in rank-major order of the initial orderings, so
+// they are deterministic) and initializes dg.m_node_positions.
 void layout::populateInitialOrderings(Digraph &dg) {
     for (const Node &node: std::views::values(dg.m_nodes)) {
         if (dg.m_io_port_ranks.contains(node.m_render_attrs.m_rank)) {
@@ -37,9 +40,28 @@ void layout::populateInitialOrderings(Digraph &dg) {
         auto &ordering = dg.m_per_rank_orderings.at(i);
         std::ranges::sort(ordering);
     }
-    // write to dg.m_per_rank_orderings_index maps
-    for (size_t rank = 0; rank < dg.m_per_rank_orderings.size(); rank++) {
-        populateOrderingIndexAtRank(dg, rank);
+
+    size_t next_id = 0;
+    dg.m_node_positions.assign(dg.m_nodes.size(), 0);
+    for (const auto &ordering: dg.m_per_rank_orderings) {
+        for (size_t x = 0; x < ordering.size(); x++) {
+            Node &node = dg.m_nodes.at(ordering[x]);
+            node.m_id = next_id++;
+            dg.m_node_positions[node.m_id] = x;
+        }
+    }
+    if (next_id != dg.m_nodes.size()) {
+        // nodes that are not part of any ordering (IO ports) get the remaining ids in alphabetical order
+        std::vector<std::string_view> unordered_nodes;
+        for (const Node &node: std::views::values(dg.m_nodes)) {
+            if (dg.m_io_port_ranks.contains(node.m_render_attrs.m_rank)) {
+                unordered_nodes.emplace_back(node.m_name);
+            }
+        }
+        std::ranges::sort(unordered_nodes);
+        for (const std::string_view &name: unordered_nodes) {
+            dg.m_nodes.at(name).m_id = next_id++;
+        }
     }
 }
 
@@ -50,13 +72,15 @@ void layout::reorderRankByBarycenterX(Digraph &dg, const size_t rank, bool &out_
     }
 
     auto &ordering = dg.m_per_rank_orderings.at(rank);
+    // look up every node once instead of once per comparison
+    std::vector<const Node *> nodes(ordering.size());
     std::vector<size_t> rearrangement_order(ordering.size());
     for (size_t i = 0; i < rearrangement_order.size(); i++) {
+        nodes[i] = &dg.m_nodes.at(ordering[i]);
         rearrangement_order[i] = i;
     }
     std::ranges::sort(rearrangement_order, [&](const size_t a, const size_t b) {
-        return dg.m_nodes.at(ordering.at(a)).m_render_attrs.m_barycenter_x <
-               dg.m_nodes.at(ordering.at(b)).m_render_attrs.m_barycenter_x;
+        return nodes[a]->m_render_attrs.m_barycenter_x < nodes[b]->m_render_attrs.m_barycenter_x;
     });
     bool rearrangement_order_has_effect = false;
     for (size_t i = 0; i < rearrangement_order.size(); i++) {
@@ -69,24 +93,42 @@ void layout::reorderRankByBarycenterX(Digraph &dg, const size_t rank, bool &out_
         return;
     }
 
-    // rearrange orderings vector according to rearrangement order
+    // rearrange orderings vector according to rearrangement order (and move the positions along in place)
     std::vector<std::string_view> rearranged_ordering;
     rearranged_ordering.reserve(ordering.size());
-    for (const size_t idx: rearrangement_order) {
+    for (size_t x = 0; x < rearrangement_order.size(); x++) {
+        const size_t idx = rearrangement_order[x];
         rearranged_ordering.emplace_back(ordering.at(idx));
+        dg.m_node_positions[nodes[idx]->m_id] = x;
     }
 
     std::swap(ordering, rearranged_ordering);
-    populateOrderingIndexAtRank(dg, rank);
     out_improvement_found = true;
 }
 
 
-std::unordered_map<uintptr_t, size_t> g_edge_weight_attribute_cache;
+size_t layout::getEdgeLayoutWeight(const Edge &edge) {
+    const bool constraint = getAttrOrDefault(edge.m_attrs, "constraint", "true") == "true";
+    return getAttrTransformedCheckedOrDefault(edge.m_attrs, "weight", constraint ? 1 : 0, stringViewToSizeT);
+}
+
+void layout::populateEdgeLayoutWeights(Digraph &dg) {
+    std::vector<Node *> nodes_by_id(dg.m_nodes.size());
+    for (Node &node: std::views::values(dg.m_nodes)) {
+        nodes_by_id.at(node.m_id) = &node;
+    }
+    dg.m_edge_layout_weights.clear();
+    for (Node *node: nodes_by_id) {
+        for (Edge &edge: node->m_outgoing) {
+            edge.m_id = dg.m_edge_layout_weights.size();
+            dg.m_edge_layout_weights.push_back(getEdgeLayoutWeight(edge));
+        }
+    }
+}
 
 // why is this not the constructor? simple: I want to reuse m_data and save allocations
 void ConnectionMat::populate(const Digraph &dg, const size_t rank) {
-    assert(rank < dg.m_rank_counts.size() - 1 && dg.m_per_rank_orderings_index.size() == dg.m_rank_counts.size());
+    assert(rank < dg.m_rank_counts.size() - 1 && dg.m_node_positions.size() == dg.m_nodes.size());
     const size_t w = dg.m_rank_counts.at(rank + 1), h = dg.m_rank_counts.at(rank);
 
     // clear and resize (resize also resets data to false)
@@ -96,21 +138,15 @@ void ConnectionMat::populate(const Digraph &dg, const size_t rank) {
     m_h = h;
 
     // populate
-    for (const std::string_view &node_name: std::views::keys(dg.m_per_rank_orderings_index.at(rank))) {
-        if (const Node &node = dg.m_nodes.at(node_name); node.m_render_attrs.m_rank == rank) {
-            for (const Edge &edge: node.m_outgoing) {
-                if (dg.m_nodes.at(edge.m_dest).m_render_attrs.m_rank == rank + 1) {
-                    const size_t source_idx = dg.m_per_rank_orderings_index.at(rank).at(edge.m_source);
-                    const size_t dest_idx = dg.m_per_rank_orderings_index.at(rank + 1).at(edge.m_dest);
-                    assert(source_idx < h && dest_idx < w);
-                    const auto edge_ptr = reinterpret_cast<uintptr_t>(&edge);
-                    if (!g_edge_weight_attribute_cache.contains(edge_ptr)) {
-                        const bool constraint = getAttrOrDefault(edge.m_attrs, "constraint", "true") == "true";
-                        g_edge_weight_attribute_cache[edge_ptr] = getAttrTransformedCheckedOrDefault(
-                            edge.m_attrs, "weight", constraint ? 1 : 0, stringViewToSizeT);
-                    }
-                    m_data.at(source_idx * w + dest_idx) += g_edge_weight_attribute_cache.at(edge_ptr);
-                }
+    const auto &rank_ordering = dg.m_per_rank_orderings.at(rank);
+    for (size_t source_idx = 0; source_idx < rank_ordering.size(); source_idx++) {
+        const Node &node = dg.m_nodes.at(rank_ordering[source_idx]);
+        assert(node.m_render_attrs.m_rank == rank);
+        for (const Edge &edge: node.m_outgoing) {
+            if (const Node &dest = dg.m_nodes.at(edge.m_dest); dest.m_render_attrs.m_rank == rank + 1) {
+                const size_t dest_idx = dg.m_node_positions[dest.m_id];
+                assert(source_idx < h && dest_idx < w);
+                m_data.at(source_idx * w + dest_idx) += dg.m_edge_layout_weights[edge.m_id];
             }
         }
     }
@@ -140,7 +176,8 @@ size_t ConnectionMat::getSumDXAt(const size_t offset, ssize_t row_pixel_padding,
     return out;
 }
 
-static ssize_t getRowLayoutPaddingForRanks(const size_t node_count_current_rank, const size_t node_count_next_rank) {
+ssize_t layout::getRowLayoutPaddingForRanks(const size_t node_count_current_rank,
+                                            const size_t node_count_next_rank) {
     // padding accounts for the fact nodes will be centered. E.g. if there is 1 node in rank 0 and 3 nodes in rank 1,
     // then node 0 in rank 0 will actually be aligned with node 1 in rank 1, meaning dist_r0n0_r1n1 = 0 and
     // dist_r0n0_r1n{0|2} = 1. Graphically, padding is a heuristic for how far rank `rank + 1` will be right shifted
@@ -276,14 +313,45 @@ size_t IntersectionMat::getTotalIntersections() const {
     return std::accumulate(m_data.begin(), m_data.end(), 0ull);
 }
 
-ConnectionMat layout::g_connection_mats[2]{};
-IntersectionMat layout::g_intersection_mats[2]{};
-size_t layout::g_n_intersections_pr[2]{};
-size_t layout::g_sum_dx_pr[2]{};
+thread_local ConnectionMat layout::g_connection_mats[2]{};
+thread_local IntersectionMat layout::g_intersection_mats[2]{};
+thread_local size_t layout::g_n_intersections_pr[2]{};
+thread_local size_t layout::g_sum_dx_pr[2]{};
+thread_local SweepBarycenters layout::g_sweep_barycenters{};
+
+void SweepBarycenters::ensureLayout(const Digraph &dg) {
+    const size_t n_ranks = dg.m_per_rank_orderings.size();
+    bool is_up_to_date = m_rank_offsets.size() == n_ranks + 1;
+    for (size_t rank = 0; is_up_to_date && rank < n_ranks; rank++) {
+        is_up_to_date = m_rank_offsets[rank + 1] - m_rank_offsets[rank] == dg.m_per_rank_orderings[rank].size();
+    }
+    if (is_up_to_date) {
+        return;
+    }
+    m_rank_offsets.resize(n_ranks + 1);
+    m_rank_offsets[0] = 0;
+    for (size_t rank = 0; rank < n_ranks; rank++) {
+        m_rank_offsets[rank + 1] = m_rank_offsets[rank] + dg.m_per_rank_orderings[rank].size();
+    }
+    m_old.assign(m_rank_offsets.back(), 0.0f);
+    m_new.assign(m_rank_offsets.back(), 0.0f);
+}
+
+std::span<float> SweepBarycenters::getOld(const size_t rank) {
+    return {m_old.data() + m_rank_offsets.at(rank), m_rank_offsets.at(rank + 1) - m_rank_offsets.at(rank)};
+}
+
+std::span<float> SweepBarycenters::getNew(const size_t rank) {
+    return {m_new.data() + m_rank_offsets.at(rank), m_rank_offsets.at(rank + 1) - m_rank_offsets.at(rank)};
+}
+
+ThreadPool &layout::getLayoutThreadPool() {
+    static ThreadPool pool;
+    return pool;
+}
 
 void layout::clearGlobalState() {
     // TODO refactor this - there shouldn't be global state
-    g_edge_weight_attribute_cache.clear();
     std::memset(g_n_intersections_pr, 0, sizeof(g_n_intersections_pr));
     std::memset(g_sum_dx_pr, 0, sizeof(g_sum_dx_pr));
     for (size_t i = 0; i < 2; i++) {
@@ -400,25 +468,78 @@ void layout::revertToPreSwapState(const size_t pre_swap_n_intersections_pr[2], c
     }
 }
 
-void Digraph::swapNodesOnRank(const std::string_view a, const std::string_view b) {
-    const size_t rank = m_nodes.at(a).m_render_attrs.m_rank;
-    assert(rank == m_nodes.at(b).m_render_attrs.m_rank);
-
+void Digraph::swapNodesOnRank(const size_t rank, const size_t a_idx, const size_t b_idx) {
     auto &ordering = m_per_rank_orderings.at(rank);
-    auto &ordering_index = m_per_rank_orderings_index.at(rank);
+    const Node &a = m_nodes.at(ordering.at(a_idx)), &b = m_nodes.at(ordering.at(b_idx));
+    assert(a.m_render_attrs.m_rank == rank && b.m_render_attrs.m_rank == rank);
 
-    const size_t a_idx = ordering_index.at(a), b_idx = ordering_index.at(b);
-    ordering_index[a] = b_idx, ordering_index[b] = a_idx;
+    m_node_positions[a.m_id] = b_idx, m_node_positions[b.m_id] = a_idx;
+    std::swap(ordering[a_idx], ordering[b_idx]);
+}
 
-    assert(ordering.at(a_idx) == a && ordering.at(b_idx) == b);
-    ordering[a_idx] = b, ordering[b_idx] = a;
+// performs the barycenter update of a single rank against its (fixed) neighbour rank `rank - rank_step`
+static void barycenterSweepRank(Digraph &dg, const ssize_t rank, const bool is_downward_sweep,
+                                ConnectionMat &connection_mat, SweepBarycenters &sweep_barycenters,
+                                bool &improvement_found, float &total_change,
+                                const BarycenterSweepOperatorFunc &sweep_operator, const bool use_median,
+                                const float barycenter_dampening) {
+    const ssize_t rank_step = is_downward_sweep ? 1 : -1;
+    connection_mat.populate(dg, rank - static_cast<size_t>(is_downward_sweep));
+
+    size_t n_barycenters = connection_mat.m_h, inner_dim = connection_mat.m_w,
+            outer_stride = connection_mat.m_w, inner_stride = 1;
+    if (is_downward_sweep) {
+        std::swap(n_barycenters, inner_dim);
+        std::swap(outer_stride, inner_stride);
+    }
+
+    assert(n_barycenters == dg.m_per_rank_orderings.at(rank).size());
+    assert(inner_dim == dg.m_per_rank_orderings.at(rank - rank_step).size());
+
+    const std::span<float> new_barycenters = sweep_barycenters.getNew(rank);
+    const std::span<float> old_barycenters = sweep_barycenters.getOld(rank);
+    // scratch buffer per thread, since parallel sweeps call this concurrently for different ranks
+    thread_local std::vector<float> current_other_rank_barycenters;
+    current_other_rank_barycenters.resize(inner_dim);
+    for (size_t i = 0; i < inner_dim; i++) {
+        const auto &node_name = dg.m_per_rank_orderings.at(rank - rank_step).at(i);
+        const auto &node = dg.m_nodes.at(node_name);
+        current_other_rank_barycenters[i] = node.m_render_attrs.m_barycenter_x;
+        // const auto width_adjustment = consider_node_widths
+        //                                   ? static_cast<float>(node.m_render_attrs.m_width) / 2.0f
+        //                                   : 0.0f;
+        // current_other_rank_barycenters[i] = node.m_render_attrs.m_barycenter_x + width_adjustment;
+    }
+    const auto &rank_ordering = dg.m_per_rank_orderings.at(rank);
+    for (size_t i = 0; i < n_barycenters; i++) {
+        float p;
+        const auto &node_name = rank_ordering.at(i);
+        auto &node = dg.m_nodes.at(node_name);
+        if (use_median) {
+            p = medianBarycenterX(current_other_rank_barycenters.data(),
+                                  connection_mat.m_data.data() + i * outer_stride,
+                                  inner_stride, inner_dim, node.m_render_attrs.m_barycenter_x);
+        } else {
+            p = meanBarycenterX(current_other_rank_barycenters.data(),
+                                connection_mat.m_data.data() + i * outer_stride,
+                                inner_stride, inner_dim, node.m_render_attrs.m_barycenter_x);
+        }
+        const float new_barycenter =
+                std::lerp(node.m_render_attrs.m_barycenter_x, p, barycenter_dampening);
+        const float change = std::abs(new_barycenter - node.m_render_attrs.m_barycenter_x);
+        total_change += change;
+        old_barycenters[i] = node.m_render_attrs.m_barycenter_x;
+        node.m_render_attrs.m_barycenter_x = new_barycenter;
+        new_barycenters[i] = new_barycenter;
+    }
+
+    sweep_operator(dg, new_barycenters, old_barycenters, rank, improvement_found);
 }
 
-void layout::barycenterSweep(Digraph &dg, const bool is_downward_sweep, bool &improvement_found, float &total_change,
-                             const BarycenterSweepOperatorFunc &sweep_operator, const bool use_median,
-                             const float barycenter_dampening, const ssize_t start_rank, const ssize_t n_ranks) {
+// computes the [start, end) range (with step) of ranks visited by a sweep
+static void getSweepRankRange(const Digraph &dg, const bool is_downward_sweep, const ssize_t start_rank,
+                              const ssize_t n_ranks, ssize_t &start, ssize_t &end, ssize_t &rank_step) {
     // iterates ranks [n - 1, 0) if is_upward_pass else [0, n - 1)
-    ssize_t start, end, rank_step;
     if (is_downward_sweep) {
         start = 1 + (start_rank < 0 ? 0 : start_rank);
         end = n_ranks < 0 ? static_cast<ssize_t>(dg.m_per_rank_orderings.size()) : start + n_ranks;
@@ -428,56 +549,65 @@ void layout::barycenterSweep(Digraph &dg, const bool is_downward_sweep, bool &im
         end = n_ranks < 0 ? -1 : start - n_ranks;
         rank_step = -1;
     }
+}
+
+void layout::barycenterSweep(Digraph &dg, const bool is_downward_sweep, bool &improvement_found, float &total_change,
+                             const BarycenterSweepOperatorFunc &sweep_operator, const bool use_median,
+                             const float barycenter_dampening, const ssize_t start_rank, const ssize_t n_ranks) {
+    ssize_t start, end, rank_step;
+    getSweepRankRange(dg, is_downward_sweep, start_rank, n_ranks, start, end, rank_step);
+    g_sweep_barycenters.ensureLayout(dg);
 
     for (ssize_t rank = start; rank != end; rank += rank_step) {
         ConnectionMat &connection_mat = g_connection_mats[static_cast<size_t>(is_downward_sweep)];
-        connection_mat.populate(dg, rank - static_cast<size_t>(is_downward_sweep));
-
-        size_t n_barycenters = connection_mat.m_h, inner_dim = connection_mat.m_w,
-                outer_stride = connection_mat.m_w, inner_stride = 1;
-        if (is_downward_sweep) {
-            std::swap(n_barycenters, inner_dim);
-            std::swap(outer_stride, inner_stride);
-        }
+        barycenterSweepRank(dg, rank, is_downward_sweep, connection_mat, g_sweep_barycenters, improvement_found,
+                            total_change, sweep_operator, use_median, barycenter_dampening);
+    }
+}
 
-        assert(n_barycenters == dg.m_per_rank_orderings.at(rank).size());
-        assert(inner_dim == dg.m_per_rank_orderings.at(rank - rank_step).size());
-
-        std::vector<float> new_barycenters(n_barycenters);
-        std::vector<float> old_barycenters(n_barycenters);
-        std::vector<float> current_other_rank_barycenters(inner_dim);
-        for (size_t i = 0; i < inner_dim; i++) {
-            const auto &node_name = dg.m_per_rank_orderings.at(rank - rank_step).at(i);
-            const auto &node = dg.m_nodes.at(node_name);
-            current_other_rank_barycenters[i] = node.m_render_attrs.m_barycenter_x;
-            // const auto width_adjustment = consider_node_widths
-            //                                   ? static_cast<float>(node.m_render_attrs.m_width) / 2.0f
-            //                                   : 0.0f;
-            // current_other_rank_barycenters[i] = node.m_render_attrs.m_barycenter_x + width_adjustment;
-        }
-        const auto &rank_ordering = dg.m_per_rank_orderings.at(rank);
-        for (size_t i = 0; i < n_barycenters; i++) {
-            float p;
-            const auto &node_name = rank_ordering.at(i);
-            auto &node = dg.m_nodes.at(node_name);
-            if (use_median) {
-                p = medianBarycenterX(current_other_rank_barycenters.data(),
-                                      connection_mat.m_data.data() + i * outer_stride,
-                                      inner_stride, inner_dim, node.m_render_attrs.m_barycenter_x);
-            } else {
-                p = meanBarycenterX(current_other_rank_barycenters.data(),
-                                    connection_mat.m_data.data() + i * outer_stride,
-                                    inner_stride, inner_dim, node.m_render_attrs.m_barycenter_x);
+void layout::barycenterSweepParallel(Digraph &dg, const bool is_downward_sweep, bool &improvement_found,
+                                     float &total_change, const BarycenterSweepOperatorFunc &sweep_operator,
+                                     const bool use_median, const float barycenter_dampening, ThreadPool &pool,
+                                     const size_t band_size, const ssize_t start_rank, const ssize_t n_ranks) {
+    assert(band_size > 0);
+    ssize_t start, end, rank_step;
+    getSweepRankRange(dg, is_downward_sweep, start_rank, n_ranks, start, end, rank_step);
+    if (start == end) {
+        return;
+    }
+    g_sweep_barycenters.ensureLayout(dg);
+    // the barycenters are thread local, the workers must use the ones of this thread
+    SweepBarycenters &sweep_barycenters = g_sweep_barycenters;
+
+    const size_t n_swept_ranks = std::abs(end - start);
+    const size_t n_bands = (n_swept_ranks + band_size - 1) / band_size;
+    std::vector<char> per_rank_improvement_found(n_swept_ranks);
+    std::vector<float> per_rank_change(n_swept_ranks);
+    // Bands of parity 0 (even band index) only read the last rank of the preceding odd band, which is fixed during this
+    // phase, and vice versa. Within a band, ranks are swept sequentially just like in barycenterSweep.
+    for (size_t parity = 0; parity < 2; parity++) {
+        const size_t n_phase_bands = (n_bands + 1 - parity) / 2;
+        pool.parallelFor(n_phase_bands, [&](const size_t i) {
+            const size_t band = 2 * i + parity;
+            // per thread, so the bands of a phase do not share it and its allocation is reused across phases and sweeps
+            thread_local ConnectionMat connection_mat;
+            for (size_t sweep_idx = band * band_size; sweep_idx < std::min((band + 1) * band_size, n_swept_ranks);
+                 sweep_idx++) {
+                const ssize_t rank = start + static_cast<ssize_t>(sweep_idx) * rank_step;
+                bool rank_improvement_found = false;
+                float rank_change = 0.0f;
+                barycenterSweepRank(dg, rank, is_downward_sweep, connection_mat, sweep_barycenters,
+                                    rank_improvement_found, rank_change, sweep_operator, use_median,
+                                    barycenter_dampening);
+                per_rank_improvement_found[sweep_idx] = rank_improvement_found;
+                per_rank_change[sweep_idx] = rank_change;
             }
-            const float new_barycenter =
-                    std::lerp(node.m_render_attrs.m_barycenter_x, p, barycenter_dampening);
-            const float change = std::abs(new_barycenter - node.m_render_attrs.m_barycenter_x);
-            total_change += change;
-            old_barycenters[i] = node.m_render_attrs.m_barycenter_x;
-            node.m_render_attrs.m_barycenter_x = new_barycenter;
-            new_barycenters[i] = new_barycenter;
-        }
+        });
+    }
 
-        sweep_operator(dg, std::move(new_barycenters), std::move(old_barycenters), rank, improvement_found);
+    // reduce in sweep order so the result does not depend on thread scheduling
+    for (size_t sweep_idx = 0; sweep_idx < n_swept_ranks; sweep_idx++) {
+        improvement_found |= static_cast<bool>(per_rank_improvement_found[sweep_idx]);
+        total_change += per_rank_change[sweep_idx];
     }
 }
@@ -107,10 +107,8 @@ void Digraph::computeEdgeLayout() {
                 std::ranges::sort(edges, [&](const Edge &a, const Edge &b) {
                     const Node &other_node_a = getOtherNode(*this, a, node.m_name);
                     const Node &other_node_b = getOtherNode(*this, b, node.m_name);
-                    const size_t ordering_idx_a = m_per_rank_orderings_index.at(other_node_a.m_render_attrs.m_rank).at(
-                        other_node_a.m_name);
-                    const size_t ordering_idx_b = m_per_rank_orderings_index.at(other_node_b.m_render_attrs.m_rank).at(
-                        other_node_b.m_name);
+                    const size_t ordering_idx_a = m_node_positions.at(other_node_a.m_id);
+                    const size_t ordering_idx_b = m_node_positions.at(other_node_b.m_id);
                     if (ordering_idx_a < ordering_idx_b) {
                         return true;
                     } else if (ordering_idx_a == ordering_idx_b) {
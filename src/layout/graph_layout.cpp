@@ -14,18 +14,6 @@ using namespace punkt;
 constexpr auto default_rank_sep = static_cast<size_t>(static_cast<float>(DEFAULT_DPI) * 0.5f);
 constexpr auto default_node_sep = static_cast<size_t>(static_cast<float>(DEFAULT_DPI) * 0.25f);
 
-static void populateGraphLabelText(const Attrs &attrs, const TextAlignment label_ta,
-                                   render::glyph::GlyphLoader &glyph_loader, std::vector<GlyphQuad> &out_label_quads,
-                                   size_t &out_graph_label_width, size_t &out_graph_label_height,
-                                   const RankDirConfig rank_dir) {
-    if (const std::string_view graph_label = getAttrOrDefault(attrs, "label", ""); !graph_label.empty()) {
-        const size_t graph_label_font_size = getAttrTransformedCheckedOrDefault(
-            attrs, "fontsize", default_font_size, stringViewToSizeT);
-        populateGlyphQuadsWithText(graph_label, graph_label_font_size, label_ta, glyph_loader, out_label_quads,
-                                   out_graph_label_width, out_graph_label_height, rank_dir);
-    }
-}
-
 void Digraph::computeGraphLayout(render::glyph::GlyphLoader &glyph_loader) {
     m_render_attrs.m_graph_x = 0;
     m_render_attrs.m_graph_y = 0;
@@ -33,8 +21,6 @@ void Digraph::computeGraphLayout(render::glyph::GlyphLoader &glyph_loader) {
                                                                    stringViewToSizeT);
     m_render_attrs.m_node_sep = getAttrTransformedCheckedOrDefault(m_attrs, "nodesep", default_node_sep,
                                                                    stringViewToSizeT);
-    const TextAlignment label_ta =
-            getAttrTransformedOrDefault(m_attrs, "labeljust", default_label_just, textAlignmentFromStr);
     const std::string_view label_loc = getAttrOrDefault(m_attrs, "labelloc", "T");
 
     // graphs by default don't have padding and a margin
@@ -47,8 +33,8 @@ void Digraph::computeGraphLayout(render::glyph::GlyphLoader &glyph_loader) {
         graph_border_pen_width * static_cast<float>(dpi) / static_cast<float>(DEFAULT_DPI));
 
     size_t graph_label_width = 0, graph_label_height = 0, graph_body_start = 0, graph_label_y = 0;
-    populateGraphLabelText(m_attrs, label_ta, glyph_loader, m_render_attrs.m_label_quads, graph_label_width,
-                           graph_label_height, m_render_attrs.m_rank_dir);
+    populateGraphLabelText(m_attrs, glyph_loader, m_render_attrs.m_label_quads, graph_label_width, graph_label_height,
+                           m_render_attrs.m_rank_dir);
     if ((caseInsensitiveEquals(label_loc, "T") || caseInsensitiveEquals(label_loc, "L")) && graph_label_height > 0) {
         graph_body_start += graph_label_height + m_render_attrs.m_rank_sep;
     }
@@ -2,11 +2,19 @@
 
 #include <ranges>
 #include <cassert>
+#include <string>
+#include <unordered_map>
 
 using namespace punkt;
 
 constexpr std::string_view link_attr = "@link";
 constexpr std::string_view type_attr = "@type";
+constexpr std::string_view cluster_attr = "@cluster";
+
+// the node standing in for a cluster in its parent graph
+static std::string getClusterSuperNodeName(const std::string_view cluster_id) {
+    return "@" + std::string(cluster_id);
+}
 
 void Digraph::fuseClusterLinksIntoClusterSuperNodes() {
     std::vector<std::string_view> nodes_to_iter;
@@ -20,17 +28,18 @@ void Digraph::fuseClusterLinksIntoClusterSuperNodes() {
         nodes_to_iter.emplace_back(node.m_name);
     }
 
-    for (const auto &key: std::views::keys(m_clusters)) {
-        const std::string new_node_name = "@" + std::string(key);
-        m_nodes.emplace(new_node_name, Node{new_node_name, {}});
+    // link nodes refer to clusters by their declaration index (@link=cluster_N)
+    std::unordered_map<std::string, std::string_view> super_node_names_by_link;
+    for (const auto &[cluster_id, cluster_idx]: m_cluster_order) {
+        const std::string_view name = m_referenced_sources.emplace_front(getClusterSuperNodeName(cluster_id));
+        m_nodes.emplace(name, Node{name, {{type_attr, "cluster"}, {cluster_attr, cluster_id}}});
+        super_node_names_by_link.emplace("cluster_" + std::to_string(cluster_idx), name);
     }
 
     // insert cluster nodes
     for (const auto node_name: nodes_to_iter) {
         Node &node = m_nodes.at(node_name);
-        const std::string_view ref = node.m_attrs.at(link_attr);
-        const std::string new_node_name = "@" + std::string(ref);
-        assert(m_nodes.contains(new_node_name));
+        const std::string_view new_node_name = super_node_names_by_link.at(std::string(node.m_attrs.at(link_attr)));
         // TODO I possibly need to attach an attr here which indicates where it was originally pointing to
         for (const auto &edge: node.m_ingoing) {
             assert(edge.get().m_dest == node.m_name);
@@ -70,7 +79,7 @@ void Digraph::convertParentLinksToIOPorts(const std::string_view id_in_parent) {
     // to me from the parent graph
     assert(m_per_rank_orderings.empty());
     const Digraph &parent = *m_parent;
-    const Node &super_node = parent.m_nodes.at(id_in_parent);
+    const Node &super_node = parent.m_nodes.at(getClusterSuperNodeName(id_in_parent));
     for (const Node &node: std::views::values(m_nodes)) {
         if (!node.m_render_attrs.m_is_io_port) {
             continue;
@@ -0,0 +1,490 @@
+#include "punkt/dot.hpp"
+#include "punkt/utils/utils.hpp"
+#include "punkt/utils/int_types.hpp"
+#include "punkt/layout/common.hpp"
+#include "punkt/layout/coordinate_assignment.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace punkt;
+using namespace punkt::layout;
+
+// rounds of neighbour averaging that settle the added nodes (and their ghost chains) between their laid out neighbours
+constexpr size_t incremental_smoothing_iters = 16;
+// legalization weight of an added node relative to an existing one, so making room mostly moves the added nodes
+constexpr float incremental_added_node_weight = 1e-3f;
+
+bool LayoutDirtyRegion::isEmpty() const {
+    return m_added_nodes.empty() && m_added_edges.empty() && !m_requires_full_layout;
+}
+
+const char *UnsupportedRelayoutException::what() const noexcept {
+    return "Relayout of graphs with clusters is not supported, parse the graph again instead";
+}
+
+void Digraph::resetLayout() {
+    for (auto it = m_nodes.begin(); it != m_nodes.end();) {
+        if (it->second.m_render_attrs.m_is_ghost) {
+            it = m_nodes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // the edges into ghost nodes are the decomposed parts of the (now invisible) original edges
+    for (Node &node: std::views::values(m_nodes)) {
+        node.m_ingoing.clear();
+        std::erase_if(node.m_outgoing, [&](const Edge &edge) {
+            return !m_nodes.contains(edge.m_dest);
+        });
+        for (Edge &edge: node.m_outgoing) {
+            edge.m_render_attrs = EdgeRenderAttrs();
+        }
+        node.m_render_attrs = NodeRenderAttrs();
+    }
+    m_rank_counts.clear();
+    m_per_rank_orderings.clear();
+    m_node_positions.clear();
+    m_edge_layout_weights.clear();
+    m_n_ghost_nodes = 0;
+    const RankDirConfig rank_dir = m_render_attrs.m_rank_dir;
+    m_render_attrs = DigraphRenderAttrs();
+    m_render_attrs.m_rank_dir = rank_dir;
+}
+
+// calls `f` with every node connected to `node` by a visible edge (after ghost node insertion, these are exactly the
+// neighbours on the adjacent ranks)
+template<typename F>
+static void forEachLayoutNeighbour(const Digraph &dg, const Node &node, F &&f) {
+    for (const Edge &edge: node.m_outgoing) {
+        if (edge.m_render_attrs.m_is_visible && edge.m_dest != node.m_name) {
+            f(dg.m_nodes.at(edge.m_dest));
+        }
+    }
+    for (const Edge &edge: node.m_ingoing) {
+        if (edge.m_render_attrs.m_is_visible && edge.m_source != node.m_name) {
+            f(dg.m_nodes.at(edge.m_source));
+        }
+    }
+}
+
+// Ranks the added nodes while keeping the ranks of all existing nodes. In topological order of the added edges, a node
+// goes one rank below its lowest ranked predecessor, or one rank above its highest ranked successor if it has no ranked
+// predecessor (clamped at rank 0), or to rank 0 if it is not connected to any ranked node. Cycles among the added nodes
+// are broken in name order.
+static void rankAddedNodes(Digraph &dg, const std::vector<std::string_view> &added_nodes,
+                           const std::vector<std::pair<std::string_view, size_t> > &added_edges) {
+    const std::unordered_set<std::string_view> &is_added = dg.m_dirty_region.m_added_nodes;
+    std::unordered_map<std::string_view, std::vector<std::string_view> > preds, succs;
+    std::unordered_map<std::string_view, size_t> n_unranked_preds;
+    for (const auto &[source, edge_idx]: added_edges) {
+        const std::string_view dest = dg.m_nodes.at(source).m_outgoing.at(edge_idx).m_dest;
+        if (source == dest) {
+            continue;
+        }
+        preds[dest].emplace_back(source);
+        succs[source].emplace_back(dest);
+        if (is_added.contains(source) && is_added.contains(dest)) {
+            n_unranked_preds[dest]++;
+        }
+    }
+
+    std::unordered_set<std::string_view> ranked;
+    const auto isRanked = [&](const std::string_view name) {
+        return !is_added.contains(name) || ranked.contains(name);
+    };
+    const auto getRank = [&](const std::string_view name) {
+        return dg.m_nodes.at(name).m_render_attrs.m_rank;
+    };
+
+    std::vector<std::string_view> ready;
+    for (const std::string_view name: added_nodes) {
+        if (!n_unranked_preds.contains(name)) {
+            ready.emplace_back(name);
+        }
+    }
+    size_t next_ready = 0, next_cycle_breaker = 0;
+    while (ranked.size() < added_nodes.size()) {
+        std::string_view name;
+        if (next_ready < ready.size()) {
+            name = ready[next_ready++];
+            if (ranked.contains(name)) {
+                continue;
+            }
+        } else {
+            while (ranked.contains(added_nodes[next_cycle_breaker])) {
+                next_cycle_breaker++;
+            }
+            name = added_nodes[next_cycle_breaker];
+        }
+
+        ssize_t rank = -1;
+        for (const std::string_view pred: preds[name]) {
+            if (isRanked(pred)) {
+                rank = std::max(rank, static_cast<ssize_t>(getRank(pred)) + 1);
+            }
+        }
+        if (rank < 0) {
+            for (const std::string_view succ: succs[name]) {
+                if (isRanked(succ)) {
+                    const ssize_t above = std::max(static_cast<ssize_t>(getRank(succ)) - 1, static_cast<ssize_t>(0));
+                    rank = rank < 0 ? above : std::min(rank, above);
+                }
+            }
+        }
+        dg.m_nodes.at(name).m_render_attrs.m_rank = static_cast<size_t>(std::max(rank, static_cast<ssize_t>(0)));
+        ranked.insert(name);
+
+        for (const std::string_view succ: succs[name]) {
+            if (is_added.contains(succ) && --n_unranked_preds.at(succ) == 0) {
+                ready.emplace_back(succ);
+            }
+        }
+    }
+
+    for (const std::string_view name: added_nodes) {
+        const size_t rank = getRank(name);
+        if (rank >= dg.m_rank_counts.size()) {
+            dg.m_rank_counts.resize(rank + 1);
+        }
+        dg.m_rank_counts[rank]++;
+    }
+}
+
+// the same separations legalizeBarycentersIsotonic enforces, with the added nodes weighted down so the existing ones
+// keep their positions where possible
+static void legalizeRank(Digraph &dg, const size_t rank, std::vector<float> &centers,
+                         const std::vector<bool> &is_added) {
+    const auto &ordering = dg.m_per_rank_orderings.at(rank);
+    const auto node_sep = static_cast<float>(dg.m_render_attrs.m_node_sep);
+    std::vector<float> offsets(ordering.size()), values(ordering.size()), weights(ordering.size());
+    std::vector<size_t> ids(ordering.size());
+    for (size_t i = 0; i < ordering.size(); i++) {
+        const Node &node = dg.m_nodes.at(ordering[i]);
+        ids[i] = node.m_id;
+        if (i > 0) {
+            const Node &prev = dg.m_nodes.at(ordering[i - 1]);
+            offsets[i] = offsets[i - 1] + static_cast<float>(prev.m_render_attrs.m_width + node.m_render_attrs.m_width)
+                         / 2.0f + node_sep;
+        }
+        values[i] = centers[node.m_id] - offsets[i];
+        weights[i] = is_added[node.m_id] ? incremental_added_node_weight : 1.0f;
+    }
+    solveIsotonicRegression(values, weights);
+    for (size_t i = 0; i < ordering.size(); i++) {
+        centers[ids[i]] = values[i] + offsets[i];
+    }
+}
+
+static void centerGraphLabel(Digraph &dg) {
+    if (dg.m_render_attrs.m_label_quads.empty()) {
+        return;
+    }
+    const size_t label_old_x = dg.m_render_attrs.m_label_quads.front().m_left;
+    const size_t label_width = dg.m_render_attrs.m_label_quads.back().m_right - label_old_x;
+    const size_t label_new_x = dg.m_render_attrs.m_graph_x + (dg.m_render_attrs.m_graph_width - label_width) / 2;
+    const ssize_t x_adjustment = static_cast<ssize_t>(label_new_x) - static_cast<ssize_t>(label_old_x);
+    for (GlyphQuad &gq: dg.m_render_attrs.m_label_quads) {
+        gq.m_left += x_adjustment;
+        gq.m_right += x_adjustment;
+    }
+}
+
+// recomputes the rank heights and y positions (ranks below a rank that grew move down) and the node y positions
+static void recomputeVerticalLayout(Digraph &dg, const size_t n_old_ranks) {
+    std::vector<RankRenderAttrs> &rras = dg.m_render_attrs.m_rank_render_attrs;
+    const size_t old_bottom = rras.at(n_old_ranks - 1).m_rank_y + rras.at(n_old_ranks - 1).m_rank_height;
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        RankRenderAttrs &rra = rras.at(node.m_render_attrs.m_rank);
+        rra.m_rank_height = std::max(node.m_render_attrs.m_height, rra.m_rank_height);
+    }
+    size_t y = rras.front().m_rank_y;
+    for (RankRenderAttrs &rra: rras) {
+        rra.m_rank_y = y;
+        y += rra.m_rank_height + dg.m_render_attrs.m_rank_sep;
+    }
+    for (Node &node: std::views::values(dg.m_nodes)) {
+        const RankRenderAttrs &rra = rras.at(node.m_render_attrs.m_rank);
+        node.m_render_attrs.m_y = rra.m_rank_y + (rra.m_rank_height - node.m_render_attrs.m_height) / 2;
+    }
+
+    const size_t new_bottom = rras.back().m_rank_y + rras.back().m_rank_height;
+    assert(new_bottom >= old_bottom);
+    const size_t dy = new_bottom - old_bottom;
+    dg.m_render_attrs.m_graph_height += dy;
+    if (const std::string_view label_loc = getAttrOrDefault(dg.m_attrs, "labelloc", "T");
+        caseInsensitiveEquals(label_loc, "B") || caseInsensitiveEquals(label_loc, "R")) {
+        for (GlyphQuad &gq: dg.m_render_attrs.m_label_quads) {
+            gq.m_top += dy;
+            gq.m_bottom += dy;
+        }
+    }
+}
+
+static void relayoutIncrementally(Digraph &dg, render::glyph::GlyphLoader &glyph_loader) {
+    const LayoutDirtyRegion &dirty = dg.m_dirty_region;
+    // update() may have invalidated the ingoing edge references by appending edges
+    dg.deleteIngoingNodesVectors();
+
+    // edges added to a node that was redeclared later in the same update were dropped together with the old node
+    std::vector<std::pair<std::string_view, size_t> > added_edges;
+    for (const auto &[source, edge_idx]: dirty.m_added_edges) {
+        if (edge_idx < dg.m_nodes.at(source).m_outgoing.size()) {
+            added_edges.emplace_back(source, edge_idx);
+        }
+    }
+    std::ranges::sort(added_edges);
+    const auto [duplicates_begin, duplicates_end] = std::ranges::unique(added_edges);
+    added_edges.erase(duplicates_begin, duplicates_end);
+    std::vector<std::string_view> added_nodes(dirty.m_added_nodes.begin(), dirty.m_added_nodes.end());
+    std::ranges::sort(added_nodes);
+
+    const size_t n_old_nodes = dg.m_node_positions.size();
+    const size_t n_old_ghosts = dg.m_n_ghost_nodes;
+    const size_t n_old_ranks = dg.m_per_rank_orderings.size();
+    assert(n_old_nodes + added_nodes.size() == dg.m_nodes.size());
+    size_t old_x_min = std::numeric_limits<size_t>::max(), old_x_max = 0;
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        if (!dirty.m_added_nodes.contains(node.m_name)) {
+            old_x_min = std::min(old_x_min, node.m_render_attrs.m_x);
+            old_x_max = std::max(old_x_max, node.m_render_attrs.m_x + node.m_render_attrs.m_width);
+        }
+    }
+    const size_t right_padding = dg.m_render_attrs.m_graph_width - std::min(old_x_max, dg.m_render_attrs.m_graph_width);
+
+    rankAddedNodes(dg, added_nodes, added_edges);
+    insertGhostNodesForEdges(dg, added_edges);
+    const size_t n_ranks = dg.m_rank_counts.size();
+    dg.m_per_rank_orderings.resize(n_ranks);
+    dg.m_render_attrs.m_rank_render_attrs.resize(n_ranks);
+
+    // the added nodes and the ghost nodes of the added edges get the next ids, so every existing id stays valid
+    std::vector<Node *> placed_nodes;
+    for (const std::string_view name: added_nodes) {
+        placed_nodes.push_back(&dg.m_nodes.at(name));
+    }
+    for (size_t i = n_old_ghosts; i < dg.m_n_ghost_nodes; i++) {
+        placed_nodes.push_back(&dg.m_nodes.at(std::string("@") + std::to_string(i)));
+    }
+    size_t next_id = n_old_nodes;
+    for (Node *node: placed_nodes) {
+        node->m_id = next_id++;
+    }
+    assert(next_id == dg.m_nodes.size());
+    dg.m_node_positions.resize(next_id);
+    std::vector<bool> is_placed(next_id);
+    for (const Node *node: placed_nodes) {
+        is_placed[node->m_id] = true;
+    }
+
+    // the same goes for the edges: added edges are appended to their source, so everything from the first added edge
+    // of an existing node on is new (including the ghost edges appended while decomposing)
+    std::unordered_map<std::string_view, size_t> first_added_edge;
+    for (const auto &[source, edge_idx]: added_edges) {
+        if (dirty.m_added_nodes.contains(source)) {
+            continue;
+        }
+        const auto [it, inserted] = first_added_edge.try_emplace(source, edge_idx);
+        it->second = std::min(it->second, edge_idx);
+    }
+    std::vector<std::pair<Node *, size_t> > new_edge_ranges;
+    for (const auto &[source, edge_idx]: first_added_edge) {
+        new_edge_ranges.emplace_back(&dg.m_nodes.at(source), edge_idx);
+    }
+    std::ranges::sort(new_edge_ranges, [](const auto &a, const auto &b) {
+        return a.first->m_id < b.first->m_id;
+    });
+    for (Node *node: placed_nodes) {
+        new_edge_ranges.emplace_back(node, 0);
+    }
+    for (const auto &[node, first_edge]: new_edge_ranges) {
+        for (size_t i = first_edge; i < node->m_outgoing.size(); i++) {
+            Edge &edge = node->m_outgoing[i];
+            edge.m_id = dg.m_edge_layout_weights.size();
+            dg.m_edge_layout_weights.push_back(getEdgeLayoutWeight(edge));
+        }
+    }
+
+    dg.populateIngoingNodesVectors();
+    for (Node *node: placed_nodes) {
+        node->populateRenderInfo(glyph_loader, dg.m_render_attrs.m_rank_dir);
+    }
+
+    // node centers by id, the existing ones where they were laid out
+    std::vector<float> centers(next_id);
+    std::vector<float> rank_right_ends(n_ranks, static_cast<float>(old_x_min));
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        if (is_placed[node.m_id]) {
+            continue;
+        }
+        const auto left = static_cast<float>(node.m_render_attrs.m_x);
+        const auto width = static_cast<float>(node.m_render_attrs.m_width);
+        centers[node.m_id] = left + width / 2.0f;
+        float &right_end = rank_right_ends[node.m_render_attrs.m_rank];
+        right_end = std::max(right_end, left + width);
+    }
+
+    // place every added node at the mean of its already placed neighbours, spreading out from the laid out graph. A
+    // component without any laid out neighbour starts at the right end of its rank.
+    std::vector<bool> is_known(next_id, true);
+    for (const Node *node: placed_nodes) {
+        is_known[node->m_id] = false;
+    }
+    const auto node_sep = static_cast<float>(dg.m_render_attrs.m_node_sep);
+    for (size_t n_unknown = placed_nodes.size(); n_unknown > 0;) {
+        bool progress = false;
+        for (const Node *node: placed_nodes) {
+            if (is_known[node->m_id]) {
+                continue;
+            }
+            float sum = 0.0f;
+            size_t n_neighbours = 0;
+            forEachLayoutNeighbour(dg, *node, [&](const Node &neighbour) {
+                if (is_known[neighbour.m_id]) {
+                    sum += centers[neighbour.m_id];
+                    n_neighbours++;
+                }
+            });
+            if (n_neighbours > 0) {
+                centers[node->m_id] = sum / static_cast<float>(n_neighbours);
+                is_known[node->m_id] = true;
+                n_unknown--;
+                progress = true;
+            }
+        }
+        if (!progress) {
+            const Node &node = **std::ranges::find_if(placed_nodes, [&](const Node *n) {
+                return !is_known[n->m_id];
+            });
+            float &right_end = rank_right_ends[node.m_render_attrs.m_rank];
+            const auto width = static_cast<float>(node.m_render_attrs.m_width);
+            centers[node.m_id] = right_end + node_sep + width / 2.0f;
+            right_end += node_sep + width;
+            is_known[node.m_id] = true;
+            n_unknown--;
+        }
+    }
+    for (size_t iter = 0; iter < incremental_smoothing_iters; iter++) {
+        for (const Node *node: placed_nodes) {
+            float sum = 0.0f;
+            size_t n_neighbours = 0;
+            forEachLayoutNeighbour(dg, *node, [&](const Node &neighbour) {
+                sum += centers[neighbour.m_id];
+                n_neighbours++;
+            });
+            if (n_neighbours > 0) {
+                centers[node->m_id] = sum / static_cast<float>(n_neighbours);
+            }
+        }
+    }
+
+    // merge the added nodes into the (x sorted) orderings of their ranks and make room for them
+    std::vector<std::vector<const Node *> > placed_per_rank(n_ranks);
+    for (const Node *node: placed_nodes) {
+        placed_per_rank[node->m_render_attrs.m_rank].push_back(node);
+    }
+    std::vector<size_t> affected_ranks;
+    for (size_t rank = 0; rank < n_ranks; rank++) {
+        auto &placed = placed_per_rank[rank];
+        if (placed.empty()) {
+            continue;
+        }
+        affected_ranks.push_back(rank);
+        std::ranges::stable_sort(placed, [&](const Node *a, const Node *b) {
+            return centers[a->m_id] < centers[b->m_id];
+        });
+        auto &ordering = dg.m_per_rank_orderings[rank];
+        std::vector<std::string_view> merged;
+        merged.reserve(ordering.size() + placed.size());
+        size_t i = 0;
+        for (const Node *node: placed) {
+            while (i < ordering.size() && centers[dg.m_nodes.at(ordering[i]).m_id] <= centers[node->m_id]) {
+                merged.emplace_back(ordering[i++]);
+            }
+            merged.emplace_back(node->m_name);
+        }
+        merged.insert(merged.end(), ordering.begin() + static_cast<ssize_t>(i), ordering.end());
+        ordering = std::move(merged);
+        populateNodePositionsAtRank(dg, rank);
+        legalizeRank(dg, rank, centers, is_placed);
+    }
+
+    // apply the new positions of the affected ranks, shifting everything right if something moved past the left edge
+    float x_min = static_cast<float>(old_x_min);
+    for (const size_t rank: affected_ranks) {
+        const Node &leftmost = dg.m_nodes.at(dg.m_per_rank_orderings[rank].front());
+        x_min = std::min(x_min, centers[leftmost.m_id] - static_cast<float>(leftmost.m_render_attrs.m_width) / 2.0f);
+    }
+    const auto shift = static_cast<size_t>(std::ceil(static_cast<float>(old_x_min) - x_min));
+    if (shift > 0) {
+        for (Node &node: std::views::values(dg.m_nodes)) {
+            node.m_render_attrs.m_x += shift;
+        }
+    }
+    for (const size_t rank: affected_ranks) {
+        RankRenderAttrs &rra = dg.m_render_attrs.m_rank_render_attrs[rank];
+        rra.m_rank_width = 0;
+        for (const std::string_view name: dg.m_per_rank_orderings[rank]) {
+            Node &node = dg.m_nodes.at(name);
+            const float left = centers[node.m_id] - static_cast<float>(node.m_render_attrs.m_width) / 2.0f;
+            node.m_render_attrs.m_barycenter_x = left;
+            node.m_render_attrs.m_x = static_cast<size_t>(left + static_cast<float>(shift));
+            rra.m_rank_width += node.m_render_attrs.m_width + dg.m_render_attrs.m_node_sep;
+        }
+        rra.m_rank_width -= dg.m_render_attrs.m_node_sep;
+    }
+    size_t x_max = 0;
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        x_max = std::max(x_max, node.m_render_attrs.m_x + node.m_render_attrs.m_width);
+    }
+    dg.m_render_attrs.m_graph_width = std::max(dg.m_render_attrs.m_graph_width + shift, x_max + right_padding);
+    centerGraphLabel(dg);
+    recomputeVerticalLayout(dg, n_old_ranks);
+
+    // edge trajectories depend on the positions of all edges around a node, so they are laid out again (this is linear
+    // in the number of edges, unlike the passes above that are skipped)
+    for (Node &node: std::views::values(dg.m_nodes)) {
+        for (Edge &edge: node.m_outgoing) {
+            edge.m_render_attrs.m_trajectory.clear();
+            edge.m_render_attrs.m_label_quads.clear();
+            edge.m_render_attrs.m_head_label_quads.clear();
+            edge.m_render_attrs.m_tail_label_quads.clear();
+        }
+    }
+    dg.computeEdgeLayout();
+    dg.computeEdgeLabelLayouts(glyph_loader);
+}
+
+void Digraph::relayout(render::glyph::GlyphLoader &glyph_loader) {
+    if (m_per_rank_orderings.empty()) {
+        // never laid out (or there was nothing to lay out so far)
+        m_dirty_region = LayoutDirtyRegion();
+        preprocess(glyph_loader);
+        return;
+    }
+    if (m_dirty_region.isEmpty()) {
+        return;
+    }
+    if (!m_clusters.empty()) {
+        // cluster links are fused into the cluster super nodes during preprocessing, which cannot be undone
+        throw UnsupportedRelayoutException();
+    }
+
+    if (m_dirty_region.m_requires_full_layout) {
+        m_dirty_region = LayoutDirtyRegion();
+        resetLayout();
+        preprocess(glyph_loader);
+        return;
+    }
+    relayoutIncrementally(*this, glyph_loader);
+    m_dirty_region = LayoutDirtyRegion();
+}
@@ -124,6 +124,13 @@ void Node::populateRenderInfo(render::glyph::GlyphLoader &glyph_loader, const Ra
 
 void Digraph::computeNodeLayouts(render::glyph::GlyphLoader &glyph_loader) {
     for (Node &node: std::views::values(m_nodes)) {
-        node.populateRenderInfo(glyph_loader, m_render_attrs.m_rank_dir);
+        if (getAttrOrDefault(node.m_attrs, "@type", "") == "cluster") {
+            // clusters are laid out before their parent (see Digraph::preprocess), their super node takes their size
+            const Digraph &cluster_dg = m_clusters.at(node.m_attrs.at("@cluster"));
+            node.m_render_attrs.m_width = cluster_dg.m_render_attrs.m_graph_width;
+            node.m_render_attrs.m_height = cluster_dg.m_render_attrs.m_graph_height;
+        } else {
+            node.populateRenderInfo(glyph_loader, m_render_attrs.m_rank_dir);
+        }
     }
 }
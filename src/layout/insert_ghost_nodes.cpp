@@ -1,6 +1,7 @@
 #include "punkt/dot.hpp"
 #include "punkt/utils/int_types.hpp"
 #include "punkt/utils/utils.hpp"
+#include "punkt/layout/common.hpp"
 
 #include <ranges>
 #include <string>
@@ -9,8 +10,10 @@
 #include <utility>
 #include <algorithm>
 #include <optional>
+#include <span>
 
 using namespace punkt;
+using namespace punkt::layout;
 
 static std::string_view newGhostNode(Digraph &dg, const size_t rank, std::optional<std::string_view> color) {
     std::string name = std::string("@") + std::to_string(dg.m_n_ghost_nodes++);
@@ -184,10 +187,26 @@ static void decomposeEdgeIfRequired(Digraph &dg, const std::string_view source_n
     }
 }
 
+static bool hasTopIOPort(const Digraph &dg) {
+    return dg.m_io_port_ranks.contains(0);
+}
+
+static bool hasBottomIOPort(const Digraph &dg) {
+    return dg.m_io_port_ranks.size() == 2 || dg.m_io_port_ranks.size() == 1 && !dg.m_io_port_ranks.contains(0);
+}
+
+void layout::insertGhostNodesForEdges(Digraph &dg, const std::span<const std::pair<std::string_view, size_t> > edges) {
+    const bool has_top_io_port = hasTopIOPort(dg);
+    const bool has_bottom_io_port = hasBottomIOPort(dg);
+    for (const auto &[source_name, edge_idx]: edges) {
+        const std::string_view dest_name = dg.m_nodes.at(source_name).m_outgoing.at(edge_idx).m_dest;
+        decomposeEdgeIfRequired(dg, source_name, dest_name, edge_idx, has_top_io_port, has_bottom_io_port);
+    }
+}
+
 void Digraph::insertGhostNodes() {
-    bool has_top_io_port = m_io_port_ranks.contains(0);
-    bool has_bottom_io_port = m_io_port_ranks.size() == 2 || m_io_port_ranks.size() == 1 && !m_io_port_ranks.
-                              contains(0);
+    const bool has_top_io_port = hasTopIOPort(*this);
+    const bool has_bottom_io_port = hasBottomIOPort(*this);
 
     auto keys = std::views::keys(m_nodes);
     for (const std::vector real_node_names(keys.begin(), keys.end());
@@ -0,0 +1,274 @@
+#include "punkt/dot.hpp"
+#include "punkt/dot_constants.hpp"
+#include "punkt/utils/int_types.hpp"
+#include "punkt/layout/common.hpp"
+#include "punkt/layout/layered_graph.hpp"
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <ranges>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+
+using namespace punkt;
+using namespace punkt::layout;
+
+// builds the CSR arrays from a sorted list of (node, neighbour, weight) triples
+static void buildCSR(const size_t n_nodes, const std::vector<std::tuple<size_t, size_t, size_t> > &triples,
+                     std::vector<size_t> &offsets, std::vector<LayeredGraph::Neighbour> &neighbours) {
+    offsets.assign(n_nodes + 1, 0);
+    neighbours.clear();
+    neighbours.reserve(triples.size());
+    for (const auto &[node, neighbour, weight]: triples) {
+        offsets[node + 1]++;
+        neighbours.push_back(LayeredGraph::Neighbour{neighbour, weight});
+    }
+    for (size_t i = 0; i < n_nodes; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+}
+
+// sorts the triples and sums up the weights of parallel edges
+static void mergeParallelEdges(std::vector<std::tuple<size_t, size_t, size_t> > &triples) {
+    // sorting also makes the neighbour order independent of the hash map iteration order of the Digraph
+    std::ranges::sort(triples);
+    size_t n_unique = 0;
+    for (size_t i = 0; i < triples.size(); i++) {
+        if (n_unique > 0 && std::get<0>(triples[n_unique - 1]) == std::get<0>(triples[i]) &&
+            std::get<1>(triples[n_unique - 1]) == std::get<1>(triples[i])) {
+            std::get<2>(triples[n_unique - 1]) += std::get<2>(triples[i]);
+        } else {
+            triples[n_unique++] = triples[i];
+        }
+    }
+    triples.resize(n_unique);
+}
+
+void LayeredGraph::buildAdjacency(std::vector<std::tuple<size_t, size_t, size_t> > down_edges) {
+    mergeParallelEdges(down_edges);
+    std::vector<std::tuple<size_t, size_t, size_t> > up_edges;
+    up_edges.reserve(down_edges.size());
+    for (const auto &[upper, lower, weight]: down_edges) {
+        up_edges.emplace_back(lower, upper, weight);
+    }
+    std::ranges::sort(up_edges);
+    buildCSR(getNumNodes(), down_edges, m_down_offsets, m_down_neighbours);
+    buildCSR(getNumNodes(), up_edges, m_up_offsets, m_up_neighbours);
+}
+
+LayeredGraph LayeredGraph::fromDigraph(const Digraph &dg) {
+    LayeredGraph lg;
+    const size_t n_ranks = dg.m_per_rank_orderings.size();
+    lg.m_orderings.resize(n_ranks);
+    lg.m_is_fixed_rank.resize(n_ranks);
+
+    std::unordered_map<std::string_view, size_t> node_ids;
+    node_ids.reserve(dg.m_nodes.size());
+    for (size_t rank = 0; rank < n_ranks; rank++) {
+        lg.m_is_fixed_rank[rank] = dg.m_io_port_ranks.contains(rank);
+        for (const std::string_view &node_name: dg.m_per_rank_orderings[rank]) {
+            const size_t id = lg.m_names.size();
+            node_ids.emplace(node_name, id);
+            lg.m_names.push_back(node_name);
+            lg.m_ranks.push_back(rank);
+            lg.m_positions.push_back(lg.m_orderings[rank].size());
+            lg.m_orderings[rank].push_back(id);
+        }
+    }
+
+    std::vector<std::tuple<size_t, size_t, size_t> > down_edges;
+    for (size_t source_id = 0; source_id < lg.m_names.size(); source_id++) {
+        const Node &node = dg.m_nodes.at(lg.m_names[source_id]);
+        for (const Edge &edge: node.m_outgoing) {
+            const auto dest_it = node_ids.find(edge.m_dest);
+            if (dest_it == node_ids.end()) {
+                continue;
+            }
+            const size_t dest_id = dest_it->second;
+            const size_t source_rank = lg.m_ranks[source_id], dest_rank = lg.m_ranks[dest_id];
+            const size_t weight = dg.m_edge_layout_weights.at(edge.m_id);
+            // after ghost node insertion, every edge spans exactly one rank (in either direction)
+            if (dest_rank == source_rank + 1) {
+                down_edges.emplace_back(source_id, dest_id, weight);
+            } else if (source_rank == dest_rank + 1) {
+                down_edges.emplace_back(dest_id, source_id, weight);
+            }
+        }
+    }
+    lg.buildAdjacency(std::move(down_edges));
+    return lg;
+}
+
+void LayeredGraph::writeOrderingsTo(Digraph &dg) const {
+    assert(dg.m_per_rank_orderings.size() == m_orderings.size());
+    for (size_t rank = 0; rank < m_orderings.size(); rank++) {
+        auto &ordering = dg.m_per_rank_orderings[rank];
+        assert(ordering.size() == m_orderings[rank].size());
+        for (size_t i = 0; i < ordering.size(); i++) {
+            ordering[i] = m_names[m_orderings[rank][i]];
+        }
+        populateNodePositionsAtRank(dg, rank);
+    }
+}
+
+size_t LayeredGraph::getNumNodes() const {
+    return m_names.size();
+}
+
+std::span<const LayeredGraph::Neighbour> LayeredGraph::getNeighbours(const size_t node, const bool is_downward) const {
+    const auto &offsets = is_downward ? m_down_offsets : m_up_offsets;
+    const auto &neighbours = is_downward ? m_down_neighbours : m_up_neighbours;
+    return {neighbours.data() + offsets[node], offsets[node + 1] - offsets[node]};
+}
+
+void LayeredGraph::setOrdering(const size_t rank, const std::span<const size_t> ordering) {
+    auto &rank_ordering = m_orderings.at(rank);
+    assert(rank_ordering.size() == ordering.size());
+    for (size_t i = 0; i < ordering.size(); i++) {
+        rank_ordering[i] = ordering[i];
+        m_positions[ordering[i]] = i;
+    }
+}
+
+size_t LayeredGraph::countCrossings(const size_t rank) const {
+    assert(rank + 1 < m_orderings.size());
+    // (source position, dest position, weight), visited in source-major order
+    std::vector<std::tuple<size_t, size_t, size_t> > edges;
+    for (const size_t node: m_orderings[rank]) {
+        for (const Neighbour &neighbour: getNeighbours(node, true)) {
+            edges.emplace_back(m_positions[node], m_positions[neighbour.m_node], neighbour.m_weight);
+        }
+    }
+    std::ranges::sort(edges);
+
+    // Fenwick tree over dest positions. Edge (s, d) crosses every previously inserted edge (s', d') with s' < s and
+    // d' > d. Edges sharing a source are sorted by dest, so they never count as crossing each other.
+    const size_t n_dest = m_orderings[rank + 1].size();
+    std::vector<size_t> tree(n_dest + 1);
+    size_t total_inserted_weight = 0, crossings = 0;
+    for (const auto &[source_pos, dest_pos, weight]: edges) {
+        size_t weight_at_or_left_of_dest = 0;
+        for (size_t i = dest_pos + 1; i > 0; i -= i & -i) {
+            weight_at_or_left_of_dest += tree[i];
+        }
+        crossings += weight * (total_inserted_weight - weight_at_or_left_of_dest);
+        for (size_t i = dest_pos + 1; i <= n_dest; i += i & -i) {
+            tree[i] += weight;
+        }
+        total_inserted_weight += weight;
+    }
+    return crossings;
+}
+
+double LayeredGraph::getOrderingScore() const {
+    double score = 0.0;
+    for (size_t rank = 0; rank + 1 < m_orderings.size(); rank++) {
+        const ssize_t padding = getRowLayoutPaddingForRanks(m_orderings[rank].size(), m_orderings[rank + 1].size());
+        size_t sum_dx = 0;
+        for (const size_t node: m_orderings[rank]) {
+            const auto source_pos = static_cast<ssize_t>(m_positions[node]);
+            for (const Neighbour &neighbour: getNeighbours(node, true)) {
+                const auto dest_pos = static_cast<ssize_t>(m_positions[neighbour.m_node]);
+                sum_dx += std::abs(source_pos - dest_pos - padding) * neighbour.m_weight;
+            }
+        }
+        score += BUBBLE_ORDERING_DX_WEIGHT * static_cast<double>(sum_dx) +
+                BUBBLE_ORDERING_CROSSOVER_COUNT_WEIGHT * static_cast<double>(countCrossings(rank));
+    }
+    return score;
+}
+
+// weighted median of the positions in `neighbour_positions`, averaging the two middle elements if the total weight is
+// even (mirrors medianBarycenterX)
+static float weightedMedian(std::vector<std::pair<size_t, size_t> > &neighbour_positions) {
+    std::ranges::sort(neighbour_positions);
+    size_t total_weight = 0;
+    for (const auto &weight: neighbour_positions | std::views::values) {
+        total_weight += weight;
+    }
+    const size_t median_idx = (total_weight + 1) / 2;
+    size_t i = 0, n_encountered = 0;
+    for (; i < neighbour_positions.size(); i++) {
+        n_encountered += neighbour_positions[i].second;
+        if (n_encountered >= median_idx) {
+            break;
+        }
+    }
+    auto median = static_cast<float>(neighbour_positions[i].first);
+    if (total_weight % 2 == 0 && n_encountered == median_idx) {
+        // the median is between this element and the next one with non-zero weight
+        size_t j = i + 1;
+        while (j < neighbour_positions.size() && neighbour_positions[j].second == 0) {
+            j++;
+        }
+        if (j < neighbour_positions.size()) {
+            median = (median + static_cast<float>(neighbour_positions[j].first)) / 2.0f;
+        }
+    }
+    return median;
+}
+
+void layout::medianSweep(LayeredGraph &lg, const bool is_downward_sweep) {
+    const auto n_ranks = static_cast<ssize_t>(lg.m_orderings.size());
+    const ssize_t start = is_downward_sweep ? 1 : n_ranks - 2;
+    const ssize_t end = is_downward_sweep ? n_ranks : -1;
+    const ssize_t rank_step = is_downward_sweep ? 1 : -1;
+
+    std::vector<std::pair<size_t, size_t> > neighbour_positions;
+    std::vector<std::pair<float, size_t> > keys;
+    std::vector<size_t> new_ordering;
+    for (ssize_t rank = start; rank != end; rank += rank_step) {
+        if (lg.m_is_fixed_rank[rank]) {
+            continue;
+        }
+        const auto &ordering = lg.m_orderings[rank];
+        keys.clear();
+        for (const size_t node: ordering) {
+            neighbour_positions.clear();
+            size_t total_weight = 0;
+            // a downward sweep orders by the neighbours on the rank above
+            for (const LayeredGraph::Neighbour &neighbour: lg.getNeighbours(node, !is_downward_sweep)) {
+                neighbour_positions.emplace_back(lg.m_positions[neighbour.m_node], neighbour.m_weight);
+                total_weight += neighbour.m_weight;
+            }
+            const float key = total_weight == 0
+                                  ? static_cast<float>(lg.m_positions[node])
+                                  : weightedMedian(neighbour_positions);
+            keys.emplace_back(key, node);
+        }
+        // ties are broken by the current position, which keeps the sweep deterministic
+        std::ranges::stable_sort(keys, [](const auto &a, const auto &b) { return a.first < b.first; });
+        new_ordering.clear();
+        for (const size_t node: keys | std::views::values) {
+            new_ordering.push_back(node);
+        }
+        lg.setOrdering(rank, new_ordering);
+    }
+}
+
+double layout::refineByMedianSweeps(LayeredGraph &lg, const ssize_t max_sweeps) {
+    double best_score = lg.getOrderingScore();
+    std::vector<std::vector<size_t> > best_orderings = lg.m_orderings;
+    for (ssize_t sweep = 0; sweep < max_sweeps || max_sweeps < 0; sweep++) {
+        bool improvement_found = false;
+        for (const bool is_downward_sweep: {true, false}) {
+            medianSweep(lg, is_downward_sweep);
+            if (const double score = lg.getOrderingScore(); score < best_score) {
+                best_score = score;
+                best_orderings = lg.m_orderings;
+                improvement_found = true;
+            }
+        }
+        if (!improvement_found) {
+            break;
+        }
+    }
+    for (size_t rank = 0; rank < best_orderings.size(); rank++) {
+        lg.setOrdering(rank, best_orderings[rank]);
+    }
+    return best_score;
+}
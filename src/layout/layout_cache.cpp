@@ -0,0 +1,645 @@
+#include "punkt/dot.hpp"
+#include "punkt/dot_constants.hpp"
+#include "punkt/utils/int_types.hpp"
+#include "punkt/layout/layout_cache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <ranges>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace punkt;
+using namespace punkt::layout;
+
+namespace fs = std::filesystem;
+
+constexpr std::string_view cache_file_magic = "PUNKTLC\n";
+constexpr std::string_view cache_file_extension = ".punktlayout";
+// stores by this process between two scans of the cache directory, which catch entries other processes stored
+constexpr size_t layout_cache_rescan_interval = 64;
+
+namespace {
+class CacheWriter {
+    std::string m_data;
+
+public:
+    template<typename T> requires std::is_trivially_copyable_v<T>
+    void write(const T value) {
+        m_data.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    void write(const std::string_view sv) {
+        write<uint32_t>(static_cast<uint32_t>(sv.size()));
+        m_data.append(sv);
+    }
+
+    void write(const Attrs &attrs) {
+        write<uint64_t>(attrs.size());
+        for (const auto &[key, value]: attrs) {
+            write(key);
+            write(value);
+        }
+    }
+
+    void write(const std::vector<GlyphQuad> &quads) {
+        write<uint64_t>(quads.size());
+        for (const GlyphQuad &quad: quads) {
+            write<uint64_t>(quad.m_left);
+            write<uint64_t>(quad.m_top);
+            write<uint64_t>(quad.m_right);
+            write<uint64_t>(quad.m_bottom);
+            write<uint32_t>(quad.m_c.c);
+            write<uint64_t>(quad.m_c.font_size);
+        }
+    }
+
+    void write(const std::vector<size_t> &values) {
+        write<uint64_t>(values.size());
+        for (const size_t value: values) {
+            write<uint64_t>(value);
+        }
+    }
+
+    [[nodiscard]] const std::string &getData() const {
+        return m_data;
+    }
+};
+
+class CorruptLayoutCacheException final : std::exception {
+};
+
+// reads from the loaded cache file, string views point directly into it
+class CacheReader {
+    std::string_view m_data;
+    size_t m_pos{};
+
+public:
+    explicit CacheReader(const std::string_view data)
+        : m_data(data) {
+    }
+
+    template<typename T> requires std::is_trivially_copyable_v<T>
+    T read() {
+        if (m_data.size() - m_pos < sizeof(T)) {
+            throw CorruptLayoutCacheException();
+        }
+        T value;
+        std::memcpy(&value, m_data.data() + m_pos, sizeof(T));
+        m_pos += sizeof(T);
+        return value;
+    }
+
+    // reads a count of entries that each take at least `min_entry_size` bytes, so a corrupt count cannot make the
+    // caller allocate huge amounts of memory
+    size_t readCount(const size_t min_entry_size) {
+        const auto count = static_cast<size_t>(read<uint64_t>());
+        if (count > (m_data.size() - m_pos) / std::max(min_entry_size, size_t{1})) {
+            throw CorruptLayoutCacheException();
+        }
+        return count;
+    }
+
+    std::string_view readString() {
+        const auto size = static_cast<size_t>(read<uint32_t>());
+        if (m_data.size() - m_pos < size) {
+            throw CorruptLayoutCacheException();
+        }
+        const std::string_view sv = m_data.substr(m_pos, size);
+        m_pos += size;
+        return sv;
+    }
+
+    Attrs readAttrs() {
+        Attrs attrs;
+        const size_t n_attrs = readCount(2 * sizeof(uint32_t));
+        for (size_t i = 0; i < n_attrs; i++) {
+            const std::string_view key = readString();
+            attrs.insert_or_assign(key, readString());
+        }
+        return attrs;
+    }
+
+    std::vector<GlyphQuad> readQuads() {
+        std::vector<GlyphQuad> quads;
+        const size_t n_quads = readCount(5 * sizeof(uint64_t) + sizeof(uint32_t));
+        quads.reserve(n_quads);
+        for (size_t i = 0; i < n_quads; i++) {
+            const auto left = static_cast<size_t>(read<uint64_t>());
+            const auto top = static_cast<size_t>(read<uint64_t>());
+            const auto right = static_cast<size_t>(read<uint64_t>());
+            const auto bottom = static_cast<size_t>(read<uint64_t>());
+            const auto c = static_cast<char32_t>(read<uint32_t>());
+            const auto font_size = static_cast<size_t>(read<uint64_t>());
+            quads.emplace_back(left, top, right, bottom, render::glyph::GlyphCharInfo{c, font_size});
+        }
+        return quads;
+    }
+
+    std::vector<size_t> readSizes() {
+        std::vector<size_t> values(readCount(sizeof(uint64_t)));
+        for (size_t &value: values) {
+            value = static_cast<size_t>(read<uint64_t>());
+        }
+        return values;
+    }
+
+    [[nodiscard]] bool isAtEnd() const {
+        return m_pos == m_data.size();
+    }
+};
+
+// the preprocessed state of one graph, read completely before any of it is moved into the Digraph
+struct CachedGraph {
+    DigraphRenderAttrs m_render_attrs;
+    std::vector<size_t> m_rank_counts;
+    std::vector<std::vector<std::string_view> > m_per_rank_orderings;
+    std::vector<size_t> m_node_positions;
+    std::vector<size_t> m_edge_layout_weights;
+    size_t m_n_ghost_nodes{};
+    std::unordered_map<std::string_view, Node> m_nodes;
+    std::vector<std::pair<std::string_view, CachedGraph> > m_clusters;
+};
+
+// the size of the cache directory as of the last scan plus what this process stored since, so storing an entry does
+// not have to scan the directory
+struct LayoutCacheUsage {
+    std::mutex m_mutex;
+    std::string m_directory;
+    uintmax_t m_total_bytes{};
+    size_t m_n_stores_since_scan{};
+    bool m_is_known{};
+};
+
+LayoutCacheUsage g_layout_cache_usage;
+}
+
+// 64 bit FNV-1a
+static uint64_t hashBytes(const std::string_view data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char c: data) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// writes everything the layout of `dg` depends on to the canonical form
+static void writeCanonicalGraph(CacheWriter &writer, const Digraph &dg) {
+    writer.write(dg.m_name);
+    writer.write(dg.m_attrs);
+    writer.write(dg.m_default_node_attrs);
+    writer.write(dg.m_default_edge_attrs);
+    // in iteration order, which the layout depends on
+    writer.write<uint64_t>(dg.m_nodes.size());
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        writer.write(node.m_name);
+        writer.write(node.m_attrs);
+        writer.write<uint64_t>(node.m_outgoing.size());
+        for (const Edge &edge: node.m_outgoing) {
+            writer.write(edge.m_source);
+            writer.write(edge.m_dest);
+            writer.write(edge.m_attrs);
+        }
+    }
+    writer.write<uint64_t>(dg.m_rank_constraints.size());
+    for (const auto &[rank_type, names]: dg.m_rank_constraints) {
+        writer.write(rank_type);
+        writer.write<uint64_t>(names.size());
+        for (const std::string_view name: names) {
+            writer.write(name);
+        }
+    }
+    writer.write<uint64_t>(dg.m_cluster_order.size());
+    for (const auto &[cluster_id, order]: dg.m_cluster_order) {
+        writer.write(cluster_id);
+        writer.write<uint64_t>(order);
+    }
+    writer.write<uint64_t>(dg.m_io_port_ranks.size());
+    for (const size_t rank: dg.m_io_port_ranks) {
+        writer.write<uint64_t>(rank);
+    }
+    writer.write<uint64_t>(dg.m_clusters.size());
+    for (const auto &[cluster_id, cluster_dg]: dg.m_clusters) {
+        writer.write(cluster_id);
+        writeCanonicalGraph(writer, cluster_dg);
+    }
+}
+
+static void writeCanonicalLayoutSettings(CacheWriter &writer) {
+    writer.write(BARYCENTER_ORDERING_FADEOUT);
+    writer.write(BARYCENTER_ORDERING_DAMPENING);
+    writer.write(BARYCENTER_MIN_AVERAGE_CHANGE_REQUIRED);
+    writer.write(BARYCENTER_ORDERING_MAX_ITERS_PER_DIRECTION);
+    writer.write(BUBBLE_ORDERING_CROSSOVER_COUNT_WEIGHT);
+    writer.write(BUBBLE_ORDERING_DX_WEIGHT);
+    writer.write(BUBBLE_ORDERING_MAX_ITERS);
+    writer.write(PARALLEL_SWEEP_MIN_RANKS);
+    writer.write(PARALLEL_SWEEP_BAND_SIZE);
+    writer.write(MULTI_START_ORDERING_RUNS);
+    writer.write(MULTI_START_ORDERING_SEED);
+    writer.write(MULTI_START_ORDERING_MAX_SWEEPS_PER_RUN);
+    writer.write(MULTILEVEL_ORDERING_MIN_NODES);
+    writer.write(MULTILEVEL_ORDERING_COARSEST_NODES);
+    writer.write(MULTILEVEL_ORDERING_REFINEMENT_SWEEPS);
+    writer.write(ITERATION_BUDGET_FULL_SIZE);
+    writer.write(BARYCENTER_X_OPTIMIZATION_MIN_AVERAGE_CHANGE_REQUIRED);
+    writer.write(BARYCENTER_X_OPTIMIZATION_REGULARIZATION_RANK);
+    writer.write(BARYCENTER_X_OPTIMIZATION_REGULARIZATION_ONLY_ON_DOWNWARD);
+    writer.write(BARYCENTER_X_OPTIMIZATION_GHOST_NODE_RELATIVE_WEIGHT);
+    writer.write(BARYCENTER_X_OPTIMIZATION_CONVERGENCE_TOLERANCE);
+    writer.write(QUADRATIC_X_OPTIMIZATION_MAX_ITERS);
+    writer.write(QUADRATIC_X_OPTIMIZATION_GHOST_EDGE_WEIGHT_FACTOR);
+    writer.write(QUADRATIC_X_OPTIMIZATION_GHOST_CHAIN_WEIGHT_FACTOR);
+    writer.write<uint64_t>(BARYCENTER_X_OPTIMIZATION_PIPELINE.size());
+    for (const XOptPipelineStageSettings &pss: BARYCENTER_X_OPTIMIZATION_PIPELINE) {
+        writer.write(pss.m_repeats);
+        writer.write(pss.m_max_iters);
+        writer.write(pss.m_initial_dampening);
+        writer.write(pss.m_dampening_fadeout);
+        writer.write(pss.m_pull_towards_mean);
+        writer.write(pss.m_regularization);
+        writer.write(pss.m_sweep_mode);
+        const XOptPipelineStageSettings::LegalizerSettings &ls = pss.m_legalizer_settings;
+        writer.write(ls.m_legalization_timing);
+        writer.write(ls.m_legalizer_special_instruction.m_type);
+        writer.write(ls.m_legalizer_special_instruction.m_explode_inter_group_node_sep_factor);
+        writer.write(ls.m_try_cancel_mean_shift);
+        writer.write(ls.m_algorithm);
+        writer.write<uint64_t>(pss.m_sweep_settings.size());
+        for (const XOptPipelineStageSettings::SweepSettings &ss: pss.m_sweep_settings) {
+            writer.write(ss.m_is_downward_sweep);
+            writer.write(ss.m_is_group_sweep);
+            writer.write(ss.m_sweep_n_ranks_limit);
+        }
+    }
+}
+
+static fs::path getCacheFilePath(const uint64_t key) {
+    std::ostringstream name;
+    name << std::hex << key << cache_file_extension;
+    return fs::path(LAYOUT_CACHE_DIRECTORY) / name.str();
+}
+
+// `<path>.<random>.tmp`, the random number generator is seeded per thread so processes and threads do not collide
+static fs::path getTemporaryFilePath(const fs::path &path) {
+    thread_local std::mt19937_64 rng{std::random_device{}()};
+    std::ostringstream suffix;
+    suffix << '.' << std::hex << rng() << ".tmp";
+    fs::path tmp_path = path;
+    tmp_path += suffix.str();
+    return tmp_path;
+}
+
+static void writeGraph(CacheWriter &writer, const Digraph &dg) {
+    const DigraphRenderAttrs &ra = dg.m_render_attrs;
+    for (const size_t value: {
+             ra.m_rank_sep, ra.m_node_sep, ra.m_graph_width, ra.m_graph_height, ra.m_graph_x, ra.m_graph_y,
+             ra.m_border_thickness
+         }) {
+        writer.write<uint64_t>(value);
+    }
+    writer.write(ra.m_rank_dir.m_is_sideways);
+    writer.write(ra.m_rank_dir.m_is_reversed);
+    writer.write<uint64_t>(ra.m_rank_render_attrs.size());
+    for (const RankRenderAttrs &rra: ra.m_rank_render_attrs) {
+        writer.write<uint64_t>(rra.m_rank_x);
+        writer.write<uint64_t>(rra.m_rank_y);
+        writer.write<uint64_t>(rra.m_rank_width);
+        writer.write<uint64_t>(rra.m_rank_height);
+    }
+    writer.write(ra.m_label_quads);
+
+    writer.write(dg.m_rank_counts);
+    writer.write<uint64_t>(dg.m_per_rank_orderings.size());
+    for (const std::vector<std::string_view> &ordering: dg.m_per_rank_orderings) {
+        writer.write<uint64_t>(ordering.size());
+        for (const std::string_view name: ordering) {
+            writer.write(name);
+        }
+    }
+    writer.write(dg.m_node_positions);
+    writer.write(dg.m_edge_layout_weights);
+    writer.write<uint64_t>(dg.m_n_ghost_nodes);
+
+    writer.write<uint64_t>(dg.m_nodes.size());
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        writer.write(node.m_name);
+        writer.write<uint64_t>(node.m_id);
+        writer.write(node.m_attrs);
+        const NodeRenderAttrs &nra = node.m_render_attrs;
+        for (const size_t value: {nra.m_rank, nra.m_width, nra.m_height, nra.m_border_thickness, nra.m_x, nra.m_y}) {
+            writer.write<uint64_t>(value);
+        }
+        writer.write(nra.m_barycenter_x);
+        writer.write(nra.m_is_ghost);
+        writer.write(nra.m_is_io_port);
+        writer.write(nra.m_quads);
+
+        writer.write<uint64_t>(node.m_outgoing.size());
+        for (const Edge &edge: node.m_outgoing) {
+            writer.write(edge.m_source);
+            writer.write(edge.m_dest);
+            writer.write<uint64_t>(edge.m_id);
+            writer.write(edge.m_attrs);
+            const EdgeRenderAttrs &era = edge.m_render_attrs;
+            writer.write<uint64_t>(era.m_trajectory.size());
+            for (const Vector2<size_t> &point: era.m_trajectory) {
+                writer.write<uint64_t>(point.x);
+                writer.write<uint64_t>(point.y);
+            }
+            writer.write(era.m_label_quads);
+            writer.write(era.m_head_label_quads);
+            writer.write(era.m_tail_label_quads);
+            writer.write(era.m_is_visible);
+            writer.write(era.m_is_part_of_self_connection);
+            writer.write(era.m_is_spline);
+        }
+    }
+
+    writer.write<uint64_t>(dg.m_clusters.size());
+    for (const auto &[cluster_id, cluster_dg]: dg.m_clusters) {
+        writer.write(cluster_id);
+        writeGraph(writer, cluster_dg);
+    }
+}
+
+static CachedGraph readGraph(CacheReader &reader, const Digraph &dg) {
+    CachedGraph cg;
+    DigraphRenderAttrs &ra = cg.m_render_attrs;
+    for (size_t *value: {
+             &ra.m_rank_sep, &ra.m_node_sep, &ra.m_graph_width, &ra.m_graph_height, &ra.m_graph_x, &ra.m_graph_y,
+             &ra.m_border_thickness
+         }) {
+        *value = static_cast<size_t>(reader.read<uint64_t>());
+    }
+    ra.m_rank_dir.m_is_sideways = reader.read<bool>();
+    ra.m_rank_dir.m_is_reversed = reader.read<bool>();
+    ra.m_rank_render_attrs.resize(reader.readCount(4 * sizeof(uint64_t)));
+    for (RankRenderAttrs &rra: ra.m_rank_render_attrs) {
+        rra.m_rank_x = static_cast<size_t>(reader.read<uint64_t>());
+        rra.m_rank_y = static_cast<size_t>(reader.read<uint64_t>());
+        rra.m_rank_width = static_cast<size_t>(reader.read<uint64_t>());
+        rra.m_rank_height = static_cast<size_t>(reader.read<uint64_t>());
+    }
+    ra.m_label_quads = reader.readQuads();
+
+    cg.m_rank_counts = reader.readSizes();
+    cg.m_per_rank_orderings.resize(reader.readCount(sizeof(uint64_t)));
+    for (std::vector<std::string_view> &ordering: cg.m_per_rank_orderings) {
+        ordering.resize(reader.readCount(sizeof(uint32_t)));
+        for (std::string_view &name: ordering) {
+            name = reader.readString();
+        }
+    }
+    cg.m_node_positions = reader.readSizes();
+    cg.m_edge_layout_weights = reader.readSizes();
+    cg.m_n_ghost_nodes = static_cast<size_t>(reader.read<uint64_t>());
+
+    const size_t n_nodes = reader.readCount(sizeof(uint32_t));
+    for (size_t i = 0; i < n_nodes; i++) {
+        const std::string_view name = reader.readString();
+        const auto id = static_cast<size_t>(reader.read<uint64_t>());
+        Node node(name, reader.readAttrs());
+        node.m_id = id;
+        NodeRenderAttrs &nra = node.m_render_attrs;
+        for (size_t *value: {&nra.m_rank, &nra.m_width, &nra.m_height, &nra.m_border_thickness, &nra.m_x, &nra.m_y}) {
+            *value = static_cast<size_t>(reader.read<uint64_t>());
+        }
+        nra.m_barycenter_x = reader.read<float>();
+        nra.m_is_ghost = reader.read<bool>();
+        nra.m_is_io_port = reader.read<bool>();
+        nra.m_quads = reader.readQuads();
+
+        const size_t n_edges = reader.readCount(2 * sizeof(uint32_t));
+        node.m_outgoing.reserve(n_edges);
+        for (size_t j = 0; j < n_edges; j++) {
+            const std::string_view source = reader.readString();
+            const std::string_view dest = reader.readString();
+            const auto edge_id = static_cast<size_t>(reader.read<uint64_t>());
+            Edge &edge = node.m_outgoing.emplace_back(source, dest, reader.readAttrs());
+            edge.m_id = edge_id;
+            EdgeRenderAttrs &era = edge.m_render_attrs;
+            era.m_trajectory.resize(reader.readCount(2 * sizeof(uint64_t)));
+            for (Vector2<size_t> &point: era.m_trajectory) {
+                point.x = static_cast<size_t>(reader.read<uint64_t>());
+                point.y = static_cast<size_t>(reader.read<uint64_t>());
+            }
+            era.m_label_quads = reader.readQuads();
+            era.m_head_label_quads = reader.readQuads();
+            era.m_tail_label_quads = reader.readQuads();
+            era.m_is_visible = reader.read<bool>();
+            era.m_is_part_of_self_connection = reader.read<bool>();
+            era.m_is_spline = reader.read<bool>();
+        }
+        if (!cg.m_nodes.emplace(name, std::move(node)).second) {
+            throw CorruptLayoutCacheException();
+        }
+    }
+    for (const Node &node: std::views::values(cg.m_nodes)) {
+        for (const Edge &edge: node.m_outgoing) {
+            if (!cg.m_nodes.contains(edge.m_dest)) {
+                throw CorruptLayoutCacheException();
+            }
+        }
+    }
+
+    const size_t n_clusters = reader.readCount(sizeof(uint32_t));
+    if (n_clusters != dg.m_clusters.size()) {
+        throw CorruptLayoutCacheException();
+    }
+    for (size_t i = 0; i < n_clusters; i++) {
+        const std::string_view cluster_id = reader.readString();
+        const auto it = dg.m_clusters.find(cluster_id);
+        if (it == dg.m_clusters.end()) {
+            throw CorruptLayoutCacheException();
+        }
+        cg.m_clusters.emplace_back(it->first, readGraph(reader, it->second));
+    }
+    return cg;
+}
+
+static void restoreGraph(Digraph &dg, CachedGraph &cg) {
+    dg.m_render_attrs = std::move(cg.m_render_attrs);
+    dg.m_rank_counts = std::move(cg.m_rank_counts);
+    dg.m_per_rank_orderings = std::move(cg.m_per_rank_orderings);
+    dg.m_node_positions = std::move(cg.m_node_positions);
+    dg.m_edge_layout_weights = std::move(cg.m_edge_layout_weights);
+    dg.m_n_ghost_nodes = cg.m_n_ghost_nodes;
+    dg.m_nodes = std::move(cg.m_nodes);
+    dg.m_x_opt_trajectory.clear();
+    dg.populateIngoingNodesVectors();
+    for (auto &[cluster_id, cluster_cg]: cg.m_clusters) {
+        Digraph &cluster_dg = dg.m_clusters.at(cluster_id);
+        cluster_dg.m_parent = &dg;
+        restoreGraph(cluster_dg, cluster_cg);
+    }
+}
+
+bool layout::isLayoutCacheEnabled(const Digraph &dg) {
+    return !LAYOUT_CACHE_DIRECTORY.empty() && dg.m_parent == nullptr && !dg.m_layout_deadline.has_value();
+}
+
+LayoutCacheKey layout::getLayoutCacheKey(const Digraph &dg, const render::glyph::GlyphLoader &glyph_loader) {
+    CacheWriter writer;
+    writer.write(LAYOUT_CACHE_FORMAT_VERSION);
+    writer.write(glyph_loader.getFontFingerprint());
+    writeCanonicalLayoutSettings(writer);
+    writeCanonicalGraph(writer, dg);
+    LayoutCacheKey key;
+    key.m_canonical_form = writer.getData();
+    key.m_hash = hashBytes(key.m_canonical_form);
+    return key;
+}
+
+bool layout::loadCachedLayout(Digraph &dg, const LayoutCacheKey &key) {
+    const fs::path path = getCacheFilePath(key.m_hash);
+    std::string data;
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        std::ostringstream ss;
+        ss << file.rdbuf();
+        data = std::move(ss).str();
+    }
+
+    // the restored string views point into the file contents
+    const std::string &owned_data = dg.m_referenced_sources.emplace_front(std::move(data));
+    std::error_code ec;
+    try {
+        CacheReader reader(owned_data);
+        for (const char c: cache_file_magic) {
+            if (reader.read<char>() != c) {
+                throw CorruptLayoutCacheException();
+            }
+        }
+        if (reader.read<uint32_t>() != LAYOUT_CACHE_FORMAT_VERSION || reader.read<uint64_t>() != key.m_hash) {
+            throw CorruptLayoutCacheException();
+        }
+        if (reader.readString() != key.m_canonical_form) {
+            // a hash collision, the entry belongs to a different graph and is replaced once this one is stored
+            dg.m_referenced_sources.pop_front();
+            return false;
+        }
+        CachedGraph cg = readGraph(reader, dg);
+        if (!reader.isAtEnd()) {
+            throw CorruptLayoutCacheException();
+        }
+        restoreGraph(dg, cg);
+    } catch (const CorruptLayoutCacheException &) {
+        dg.m_referenced_sources.pop_front();
+        fs::remove(path, ec);
+        return false;
+    }
+    // entries are evicted least recently used first
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    return true;
+}
+
+void layout::storeCachedLayout(const Digraph &dg, const LayoutCacheKey &key) {
+    CacheWriter writer;
+    for (const char c: cache_file_magic) {
+        writer.write(c);
+    }
+    writer.write(LAYOUT_CACHE_FORMAT_VERSION);
+    writer.write(key.m_hash);
+    writer.write(key.m_canonical_form);
+    writeGraph(writer, dg);
+
+    std::error_code ec;
+    fs::create_directories(LAYOUT_CACHE_DIRECTORY, ec);
+    if (ec) {
+        return;
+    }
+    // write to a temporary file first so concurrent readers never see a partial entry, its name is unique so concurrent
+    // writers of the same entry do not write into the same file
+    const fs::path path = getCacheFilePath(key.m_hash);
+    const fs::path tmp_path = getTemporaryFilePath(path);
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return;
+        }
+        const std::string &data = writer.getData();
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file) {
+            file.close();
+            fs::remove(tmp_path, ec);
+            return;
+        }
+    }
+    fs::rename(tmp_path, path, ec);
+    if (ec) {
+        fs::remove(tmp_path, ec);
+        return;
+    }
+
+    bool should_evict;
+    {
+        const std::scoped_lock lock(g_layout_cache_usage.m_mutex);
+        LayoutCacheUsage &usage = g_layout_cache_usage;
+        if (usage.m_directory != LAYOUT_CACHE_DIRECTORY) {
+            usage.m_directory = LAYOUT_CACHE_DIRECTORY;
+            usage.m_is_known = false;
+        }
+        // replacing an entry overestimates the size, which at worst causes an early scan
+        usage.m_total_bytes += writer.getData().size();
+        should_evict = !usage.m_is_known || usage.m_total_bytes > LAYOUT_CACHE_MAX_BYTES
+                       || ++usage.m_n_stores_since_scan >= layout_cache_rescan_interval;
+    }
+    if (should_evict) {
+        evictLayoutCache(LAYOUT_CACHE_MAX_BYTES);
+    }
+}
+
+void layout::evictLayoutCache(const size_t max_bytes) {
+    struct CacheEntry {
+        fs::path m_path;
+        fs::file_time_type m_last_used;
+        uintmax_t m_size;
+    };
+    std::vector<CacheEntry> entries;
+    uintmax_t total_size = 0;
+    std::error_code ec;
+    for (const fs::directory_entry &entry: fs::directory_iterator(LAYOUT_CACHE_DIRECTORY, ec)) {
+        if (!entry.is_regular_file(ec) || entry.path().extension() != cache_file_extension) {
+            continue;
+        }
+        const uintmax_t size = entry.file_size(ec);
+        if (ec) {
+            continue;
+        }
+        entries.push_back({entry.path(), entry.last_write_time(ec), size});
+        total_size += size;
+    }
+    if (total_size > max_bytes) {
+        std::ranges::sort(entries, {}, &CacheEntry::m_last_used);
+    }
+    for (const CacheEntry &entry: entries) {
+        if (total_size <= max_bytes) {
+            break;
+        }
+        if (fs::remove(entry.m_path, ec)) {
+            total_size -= entry.m_size;
+        }
+    }
+
+    const std::scoped_lock lock(g_layout_cache_usage.m_mutex);
+    g_layout_cache_usage.m_directory = LAYOUT_CACHE_DIRECTORY;
+    g_layout_cache_usage.m_total_bytes = total_size;
+    g_layout_cache_usage.m_n_stores_since_scan = 0;
+    g_layout_cache_usage.m_is_known = true;
+}
@@ -0,0 +1,121 @@
+#include "punkt/dot.hpp"
+#include "punkt/utils/int_types.hpp"
+#include "punkt/utils/thread_pool.hpp"
+#include "punkt/layout/layered_graph.hpp"
+#include "punkt/layout/common.hpp"
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <limits>
+
+using namespace punkt;
+using namespace punkt::layout;
+
+using Orderings = std::vector<std::vector<size_t> >;
+
+// std::shuffle and the std distributions are implementation defined, so results would differ between standard
+// libraries. This Fisher-Yates shuffle only relies on the (fully specified) mt19937_64 output sequence.
+static void deterministicShuffle(std::vector<size_t> &v, std::mt19937_64 &rng) {
+    for (size_t i = v.size(); i > 1; i--) {
+        std::swap(v[i - 1], v[rng() % i]);
+    }
+}
+
+static std::mt19937_64 getRunRng(const uint64_t seed, const size_t run) {
+    // golden ratio increment decorrelates the streams of neighbouring runs
+    return std::mt19937_64{seed + 0x9e3779b97f4a7c15ull * static_cast<uint64_t>(run + 1)};
+}
+
+static void initializeRandomPermutation(LayeredGraph &lg, std::mt19937_64 &rng) {
+    for (size_t rank = 0; rank < lg.m_orderings.size(); rank++) {
+        if (lg.m_is_fixed_rank[rank]) {
+            continue;
+        }
+        std::vector<size_t> ordering = lg.m_orderings[rank];
+        deterministicShuffle(ordering, rng);
+        lg.setOrdering(rank, ordering);
+    }
+}
+
+// Places nodes in the order a depth first search (over the undirected graph, starting at randomly ordered roots)
+// visits them. Connected nodes end up close to each other, which is usually a much better starting point than a random
+// permutation.
+static void initializeDFSOrdering(LayeredGraph &lg, std::mt19937_64 &rng) {
+    std::vector<size_t> roots(lg.getNumNodes());
+    for (size_t i = 0; i < roots.size(); i++) {
+        roots[i] = i;
+    }
+    deterministicShuffle(roots, rng);
+
+    Orderings new_orderings(lg.m_orderings.size());
+    std::vector<bool> is_visited(lg.getNumNodes());
+    std::vector<size_t> stack;
+    for (const size_t root: roots) {
+        if (is_visited[root]) {
+            continue;
+        }
+        stack.push_back(root);
+        while (!stack.empty()) {
+            const size_t node = stack.back();
+            stack.pop_back();
+            if (is_visited[node]) {
+                continue;
+            }
+            is_visited[node] = true;
+            new_orderings[lg.m_ranks[node]].push_back(node);
+            for (const bool is_downward: {false, true}) {
+                for (const LayeredGraph::Neighbour &neighbour: lg.getNeighbours(node, is_downward)) {
+                    if (!is_visited[neighbour.m_node]) {
+                        stack.push_back(neighbour.m_node);
+                    }
+                }
+            }
+        }
+    }
+    for (size_t rank = 0; rank < lg.m_orderings.size(); rank++) {
+        if (!lg.m_is_fixed_rank[rank]) {
+            lg.setOrdering(rank, new_orderings[rank]);
+        }
+    }
+}
+
+std::vector<double> layout::runMultiStartOrdering(Digraph &dg, const size_t n_runs, const uint64_t seed,
+                                                  const ssize_t max_sweeps_per_run) {
+    if (n_runs == 0) {
+        return {};
+    }
+    const LayeredGraph base = LayeredGraph::fromDigraph(dg);
+
+    std::vector<double> scores(n_runs, std::numeric_limits<double>::infinity());
+    std::vector<Orderings> best_orderings(n_runs);
+    const auto run = [&](const size_t run_idx) {
+        LayeredGraph lg = base;
+        std::mt19937_64 rng = getRunRng(seed, run_idx);
+        // run 0 always starts from the current (alphabetical) ordering, so multi-start is never worse than not using it
+        if (run_idx % 2 == 1) {
+            initializeDFSOrdering(lg, rng);
+        } else if (run_idx != 0) {
+            initializeRandomPermutation(lg, rng);
+        }
+        scores[run_idx] = refineByMedianSweeps(lg, max_sweeps_per_run);
+        best_orderings[run_idx] = std::move(lg.m_orderings);
+    };
+
+    getLayoutThreadPool().parallelFor(n_runs, run);
+
+    // ties are resolved towards the lowest run index, so the result does not depend on thread scheduling
+    size_t best_run = 0;
+    for (size_t run_idx = 1; run_idx < n_runs; run_idx++) {
+        if (scores[run_idx] < scores[best_run]) {
+            best_run = run_idx;
+        }
+    }
+
+    LayeredGraph result = base;
+    for (size_t rank = 0; rank < result.m_orderings.size(); rank++) {
+        result.setOrdering(rank, best_orderings[best_run][rank]);
+    }
+    result.writeOrderingsTo(dg);
+    return scores;
+}
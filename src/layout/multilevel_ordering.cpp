@@ -0,0 +1,156 @@
+#include "punkt/dot.hpp"
+#include "punkt/utils/int_types.hpp"
+#include "punkt/layout/layered_graph.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <tuple>
+#include <utility>
+
+using namespace punkt;
+using namespace punkt::layout;
+
+constexpr size_t unmatched = std::numeric_limits<size_t>::max();
+// upper bound on the number of siblings inspected per neighbour, so that hubs do not make matching quadratic
+constexpr size_t max_siblings_scanned_per_neighbour = 64;
+// coarsening stops once a level removes less than this fraction of the nodes
+constexpr float min_coarsening_ratio = 0.1f;
+
+// Heavy-edge style matching within each rank: two nodes of the same rank are "strongly connected" if they share
+// neighbours on an adjacent rank. Every node is matched with the unmatched node that shares the most edge weight with
+// it. Nodes on fixed (IO port) ranks are never matched.
+static std::vector<size_t> computeMatching(const LayeredGraph &lg) {
+    std::vector<size_t> match(lg.getNumNodes(), unmatched);
+    std::vector<size_t> shared_weights(lg.getNumNodes());
+    std::vector<size_t> candidates;
+    for (size_t rank = 0; rank < lg.m_orderings.size(); rank++) {
+        if (lg.m_is_fixed_rank[rank]) {
+            continue;
+        }
+        for (const size_t node: lg.m_orderings[rank]) {
+            if (match[node] != unmatched) {
+                continue;
+            }
+            candidates.clear();
+            for (const bool is_downward: {false, true}) {
+                for (const LayeredGraph::Neighbour &neighbour: lg.getNeighbours(node, is_downward)) {
+                    size_t n_scanned = 0;
+                    for (const LayeredGraph::Neighbour &sibling: lg.getNeighbours(neighbour.m_node, !is_downward)) {
+                        if (n_scanned++ == max_siblings_scanned_per_neighbour) {
+                            break;
+                        }
+                        if (sibling.m_node == node || match[sibling.m_node] != unmatched) {
+                            continue;
+                        }
+                        if (shared_weights[sibling.m_node] == 0) {
+                            candidates.push_back(sibling.m_node);
+                        }
+                        // +1 so that zero weight edges still count as a (weak) connection
+                        shared_weights[sibling.m_node] += std::min(neighbour.m_weight, sibling.m_weight) + 1;
+                    }
+                }
+            }
+            size_t best = unmatched, best_shared_weight = 0;
+            for (const size_t candidate: candidates) {
+                // ties are broken by node id to stay deterministic
+                if (shared_weights[candidate] > best_shared_weight ||
+                    (shared_weights[candidate] == best_shared_weight && candidate < best)) {
+                    best = candidate;
+                    best_shared_weight = shared_weights[candidate];
+                }
+                shared_weights[candidate] = 0;
+            }
+            if (best != unmatched) {
+                match[node] = best;
+                match[best] = node;
+            }
+        }
+    }
+    return match;
+}
+
+// Builds the next coarser level. Coarse nodes inherit the current relative order of their fine nodes. Returns false
+// if coarsening does not shrink the graph enough to be worth another level.
+static bool coarsen(const LayeredGraph &fine, LayeredGraph &out_coarse, std::vector<size_t> &out_fine_to_coarse) {
+    const std::vector<size_t> match = computeMatching(fine);
+
+    out_fine_to_coarse.assign(fine.getNumNodes(), unmatched);
+    out_coarse = LayeredGraph{};
+    out_coarse.m_orderings.resize(fine.m_orderings.size());
+    out_coarse.m_is_fixed_rank = fine.m_is_fixed_rank;
+    for (size_t rank = 0; rank < fine.m_orderings.size(); rank++) {
+        for (const size_t node: fine.m_orderings[rank]) {
+            if (out_fine_to_coarse[node] != unmatched) {
+                continue;
+            }
+            const size_t coarse_id = out_coarse.m_names.size();
+            out_fine_to_coarse[node] = coarse_id;
+            if (match[node] != unmatched) {
+                out_fine_to_coarse[match[node]] = coarse_id;
+            }
+            out_coarse.m_names.push_back(fine.m_names[node]);
+            out_coarse.m_ranks.push_back(rank);
+            out_coarse.m_positions.push_back(out_coarse.m_orderings[rank].size());
+            out_coarse.m_orderings[rank].push_back(coarse_id);
+        }
+    }
+
+    const auto n_removed = static_cast<float>(fine.getNumNodes() - out_coarse.getNumNodes());
+    if (n_removed < min_coarsening_ratio * static_cast<float>(fine.getNumNodes())) {
+        return false;
+    }
+
+    std::vector<std::tuple<size_t, size_t, size_t> > down_edges;
+    down_edges.reserve(fine.m_down_neighbours.size());
+    for (size_t node = 0; node < fine.getNumNodes(); node++) {
+        for (const LayeredGraph::Neighbour &neighbour: fine.getNeighbours(node, true)) {
+            down_edges.emplace_back(out_fine_to_coarse[node], out_fine_to_coarse[neighbour.m_node], neighbour.m_weight);
+        }
+    }
+    out_coarse.buildAdjacency(std::move(down_edges));
+    return true;
+}
+
+// orders every rank of `fine` by the position of its coarse node, keeping the previous relative order of the fine
+// nodes which were merged into the same coarse node
+static void projectOrdering(const LayeredGraph &coarse, const std::vector<size_t> &fine_to_coarse,
+                            LayeredGraph &fine) {
+    std::vector<size_t> ordering;
+    for (size_t rank = 0; rank < fine.m_orderings.size(); rank++) {
+        if (fine.m_is_fixed_rank[rank]) {
+            continue;
+        }
+        ordering = fine.m_orderings[rank];
+        std::ranges::sort(ordering, [&](const size_t a, const size_t b) {
+            const size_t coarse_pos_a = coarse.m_positions[fine_to_coarse[a]];
+            const size_t coarse_pos_b = coarse.m_positions[fine_to_coarse[b]];
+            return coarse_pos_a < coarse_pos_b || (coarse_pos_a == coarse_pos_b &&
+                                                   fine.m_positions[a] < fine.m_positions[b]);
+        });
+        fine.setOrdering(rank, ordering);
+    }
+}
+
+void layout::runMultilevelOrdering(Digraph &dg, const size_t coarsest_n_nodes, const ssize_t refinement_sweeps) {
+    std::vector<LayeredGraph> levels;
+    std::vector<std::vector<size_t> > fine_to_coarse_maps;
+    levels.push_back(LayeredGraph::fromDigraph(dg));
+    while (levels.back().getNumNodes() > coarsest_n_nodes) {
+        LayeredGraph coarse;
+        std::vector<size_t> fine_to_coarse;
+        if (!coarsen(levels.back(), coarse, fine_to_coarse)) {
+            break;
+        }
+        levels.push_back(std::move(coarse));
+        fine_to_coarse_maps.push_back(std::move(fine_to_coarse));
+    }
+
+    // the coarsest level is small, so it is refined until the sweeps stop improving it
+    refineByMedianSweeps(levels.back(), -1);
+    for (size_t level = levels.size() - 1; level > 0; level--) {
+        projectOrdering(levels[level], fine_to_coarse_maps[level - 1], levels[level - 1]);
+        refineByMedianSweeps(levels[level - 1], refinement_sweeps);
+    }
+    levels.front().writeOrderingsTo(dg);
+}
@@ -1,6 +1,9 @@
 #include "punkt/dot.hpp"
 #include "punkt/dot_constants.hpp"
 #include "punkt/layout/common.hpp"
+#include "punkt/layout/coordinate_assignment.hpp"
+#include "punkt/layout/x_opt_profile.hpp"
+#include "punkt/layout/time_budget.hpp"
 
 #include <vector>
 #include <ranges>
@@ -8,15 +11,19 @@
 #include <cassert>
 #include <limits>
 #include <cmath>
-#include <map>
+#include <span>
+#include <tuple>
+#include <optional>
+#include <utility>
 
 using namespace punkt;
 using namespace punkt::layout;
 
-static bool g_is_group_barycenter_sweep = false;
-static bool g_is_downward_barycenter_sweep = false;
-static const XOptPipelineStageSettings *g_pss = nullptr;
-static std::map<size_t, std::vector<float> > g_old_per_rank_barycenters{};
+static thread_local bool g_is_group_barycenter_sweep = false;
+static thread_local bool g_is_downward_barycenter_sweep = false;
+static thread_local const XOptPipelineStageSettings *g_pss = nullptr;
+// whether the old barycenters of a rank in g_sweep_barycenters were written during the current x optimization run
+static thread_local std::vector<bool> g_has_old_barycenters;
 
 constexpr float dist_required_to_touch = 5.0f;
 
@@ -62,7 +69,7 @@ static float meanBarycenterOnRank(const Digraph &dg, const std::vector<std::stri
 }
 
 static bool isTouchingPrev(const Digraph &dg, const std::vector<std::string_view> &rank_ordering, const size_t i,
-                           const std::vector<float> &old_barycenters) {
+                           const std::span<const float> old_barycenters) {
     float prev_x_end = 0.0f;
     if (i > 0) {
         const Node &prev_node = dg.m_nodes.at(rank_ordering.at(i - 1));
@@ -74,26 +81,28 @@ static bool isTouchingPrev(const Digraph &dg, const std::vector<std::string_view
     return d - static_cast<float>(dg.m_render_attrs.m_node_sep) <= dist_required_to_touch;
 }
 
-// force the barycenter x back between it's left and right neighbours to maintain node order
-static void legalizeBarycenters(Digraph &dg, const size_t rank, const XOptPipelineStageSettings &pss) {
-    if (BARYCENTER_X_OPTIMIZATION_REORDER_BY_BARYCENTER_X_BEFORE_LEGALIZE) {
-        bool trash;
-        reorderRankByBarycenterX(dg, rank, trash);
-    }
+static float getNodeSepExplodeFactor(const XOptPipelineStageSettings &pss) {
+    return pss.m_legalizer_settings.m_legalizer_special_instruction.m_type ==
+           XOptPipelineStageSettings::LegalizerSettings::LegalizerSpecialInstruction::Type::explode_inter_group_node_sep
+               ? pss.m_legalizer_settings.m_legalizer_special_instruction.m_explode_inter_group_node_sep_factor
+               : 1.0f;
+}
 
+static void legalizeBarycentersByOutwardSweeps(Digraph &dg, const size_t rank, const XOptPipelineStageSettings &pss,
+                                               const float node_sep) {
     const auto &rank_ordering = dg.m_per_rank_orderings.at(rank);
-    const auto node_sep = static_cast<float>(dg.m_render_attrs.m_node_sep);
-    float mean_before_legalize = 0.0f;
-    if (pss.m_legalizer_settings.m_try_cancel_mean_shift) {
-        mean_before_legalize = meanBarycenterOnRank(dg, rank_ordering);
-    }
-
     printNodeBarycenters(dg, rank_ordering, true);
     forceApartMiddleNodes(dg, node_sep, rank_ordering);
 
-    const std::vector old_barycenters_cpy(std::move(g_old_per_rank_barycenters.at(rank)));
-    g_old_per_rank_barycenters[rank] = std::vector<float>(old_barycenters_cpy.size());
-    auto &old_barycenters_glob = g_old_per_rank_barycenters[rank];
+    // the sweeps below read the previous old barycenters while overwriting them, so they need a copy (reused)
+    static thread_local std::vector<float> old_barycenters_cpy;
+    const std::span<float> old_barycenters_glob = g_sweep_barycenters.getOld(rank);
+    old_barycenters_cpy.assign(old_barycenters_glob.begin(), old_barycenters_glob.end());
+    // the middle node is never moved, so its entry is written here
+    if (!rank_ordering.empty()) {
+        old_barycenters_glob[rank_ordering.size() / 2] =
+                dg.m_nodes.at(rank_ordering[rank_ordering.size() / 2]).m_render_attrs.m_barycenter_x;
+    }
 
     for (const bool is_left_sweep: {false, true}) {
         // start the separation process below from the center node for better stability
@@ -128,12 +137,7 @@ static void legalizeBarycenters(Digraph &dg, const size_t rank, const XOptPipeli
                 max_current_x_start = next_node.m_render_attrs.m_barycenter_x - (w + w_self) / 2.0f;
             }
 
-            const bool explode_node_sep = pss.m_legalizer_settings.m_legalizer_special_instruction.m_type ==
-                                          XOptPipelineStageSettings::LegalizerSettings::LegalizerSpecialInstruction::Type::explode_inter_group_node_sep;
-            const float node_sep_explode_factor = explode_node_sep
-                                                      ? pss.m_legalizer_settings.m_legalizer_special_instruction.
-                                                      m_explode_inter_group_node_sep_factor
-                                                      : 1.0f;
+            const float node_sep_explode_factor = getNodeSepExplodeFactor(pss);
             float exploded_node_sep = node_sep;
             if (node_sep_explode_factor != 1.0f && !isTouchingPrev(dg, rank_ordering, is_left_sweep ? i + 1 : i,
                                                                    old_barycenters_cpy)) {
@@ -147,11 +151,93 @@ static void legalizeBarycenters(Digraph &dg, const size_t rank, const XOptPipeli
             } else {
                 new_barycenter_x = std::max(node.m_render_attrs.m_barycenter_x, prev_x_end + exploded_node_sep);
             }
-            old_barycenters_glob.at(i) = node.m_render_attrs.m_barycenter_x;
+            old_barycenters_glob[i] = node.m_render_attrs.m_barycenter_x;
             node.m_render_attrs.m_barycenter_x = new_barycenter_x;
         }
     }
     printNodeBarycenters(dg, rank_ordering, false);
+}
+
+// Weighted pool adjacent violators with minimum separations. Finds the positions closest (in the weighted least squares
+// sense) to the current barycenters which keep the rank order and keep neighbours at least half their widths plus
+// node_sep apart. Substituting z_i = x_i - offset_i, where offset_i is the sum of the separations left of node i, turns
+// this into a plain isotonic regression on z, which PAV solves in a single O(n) pass. Scratch buffers are reused
+// across calls.
+static void legalizeBarycentersIsotonic(Digraph &dg, const size_t rank, const XOptPipelineStageSettings &pss,
+                                        const float node_sep) {
+    static thread_local std::vector<Node *> nodes;
+    static thread_local std::vector<float> offsets, values, weights;
+
+    const auto &rank_ordering = dg.m_per_rank_orderings.at(rank);
+    if (rank_ordering.empty()) {
+        return;
+    }
+    const std::span<float> old_barycenters = g_sweep_barycenters.getOld(rank);
+    const float node_sep_explode_factor = getNodeSepExplodeFactor(pss);
+
+    nodes.clear();
+    offsets.clear();
+    values.clear();
+    weights.clear();
+    for (size_t i = 0; i < rank_ordering.size(); i++) {
+        Node &node = dg.m_nodes.at(rank_ordering[i]);
+        nodes.push_back(&node);
+        if (i == 0) {
+            offsets.push_back(0.0f);
+            continue;
+        }
+        float sep = node_sep;
+        if (node_sep_explode_factor != 1.0f && !isTouchingPrev(dg, rank_ordering, i, old_barycenters)) {
+            sep *= node_sep_explode_factor;
+        }
+        const auto w_prev = static_cast<float>(nodes[i - 1]->m_render_attrs.m_width);
+        const auto w_self = static_cast<float>(node.m_render_attrs.m_width);
+        offsets.push_back(offsets.back() + (w_prev + w_self) / 2.0f + sep);
+    }
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        values.push_back(nodes[i]->m_render_attrs.m_barycenter_x - offsets[i]);
+        weights.push_back(nodes[i]->m_render_attrs.m_is_ghost
+                              ? BARYCENTER_X_OPTIMIZATION_GHOST_NODE_RELATIVE_WEIGHT
+                              : 1.0f);
+    }
+    solveIsotonicRegression(values, weights);
+
+    // keep the pre-legalization barycenters around like the sweep legalizer does
+    for (size_t i = 0; i < nodes.size(); i++) {
+        old_barycenters[i] = nodes[i]->m_render_attrs.m_barycenter_x;
+        nodes[i]->m_render_attrs.m_barycenter_x = values[i] + offsets[i];
+    }
+}
+
+// force the barycenter x back between it's left and right neighbours to maintain node order
+static void legalizeBarycenters(Digraph &dg, const size_t rank, const XOptPipelineStageSettings &pss) {
+    if (BARYCENTER_X_OPTIMIZATION_REORDER_BY_BARYCENTER_X_BEFORE_LEGALIZE) {
+        bool trash;
+        reorderRankByBarycenterX(dg, rank, trash);
+    }
+
+    const auto &rank_ordering = dg.m_per_rank_orderings.at(rank);
+    const auto node_sep = static_cast<float>(dg.m_render_attrs.m_node_sep);
+    float mean_before_legalize = 0.0f;
+    if (pss.m_legalizer_settings.m_try_cancel_mean_shift) {
+        mean_before_legalize = meanBarycenterOnRank(dg, rank_ordering);
+    }
+    // a rank no sweep has visited yet has not moved, so its current barycenters are also its old ones
+    if (!g_has_old_barycenters.at(rank)) {
+        const std::span<float> old_barycenters = g_sweep_barycenters.getOld(rank);
+        for (size_t i = 0; i < rank_ordering.size(); i++) {
+            old_barycenters[i] = dg.m_nodes.at(rank_ordering[i]).m_render_attrs.m_barycenter_x;
+        }
+        g_has_old_barycenters.at(rank) = true;
+    }
+
+    if (pss.m_legalizer_settings.m_algorithm ==
+        XOptPipelineStageSettings::LegalizerSettings::Algorithm::isotonic_regression) {
+        legalizeBarycentersIsotonic(dg, rank, pss, node_sep);
+    } else {
+        legalizeBarycentersByOutwardSweeps(dg, rank, pss, node_sep);
+    }
 
     if (pss.m_legalizer_settings.m_try_cancel_mean_shift) {
         const float mean_after_legalize = meanBarycenterOnRank(dg, rank_ordering);
@@ -165,7 +251,7 @@ static void legalizeBarycenters(Digraph &dg, const size_t rank, const XOptPipeli
 }
 
 static std::vector<size_t> findGroups(const Digraph &dg, const std::vector<std::string_view> &rank_ordering,
-                                      const std::vector<float> &barycenters) {
+                                      const std::span<const float> barycenters) {
     std::vector<size_t> group_sizes;
     group_sizes.reserve(barycenters.size());
     size_t group_size = 0;
@@ -182,8 +268,8 @@ static std::vector<size_t> findGroups(const Digraph &dg, const std::vector<std::
 }
 
 /// this function has to match the signature given by @code BarycenterSweepOperatorFunc @endcode
-static void barycenterXOptimizationOperator(Digraph &dg, std::vector<float> new_barycenters,
-                                            std::vector<float> old_barycenters, const size_t rank,
+static void barycenterXOptimizationOperator(Digraph &dg, const std::span<const float> new_barycenters,
+                                            const std::span<const float> old_barycenters, const size_t rank,
                                             bool &out_improvement_found) {
     assert(new_barycenters.size() == old_barycenters.size());
     float regularization_strength = 0.0f, pull_towards_mean_strength = 0.0f;
@@ -253,7 +339,8 @@ static void barycenterXOptimizationOperator(Digraph &dg, std::vector<float> new_
         }
     }
 
-    g_old_per_rank_barycenters.insert_or_assign(rank, std::move(old_barycenters));
+    // old_barycenters already lives in g_sweep_barycenters, where the legalizers pick it up
+    g_has_old_barycenters.at(rank) = true;
 
     if (g_pss && g_pss->m_legalizer_settings.m_legalization_timing ==
         XOptPipelineStageSettings::LegalizerSettings::LegalizationTiming::in_barycenter_operator) {
@@ -261,17 +348,43 @@ static void barycenterXOptimizationOperator(Digraph &dg, std::vector<float> new_
     }
 }
 
-static void recomputeGraphDimensions(Digraph &dg) {
-    size_t x_min = std::numeric_limits<size_t>::max(), x_max = 0;
-    for (size_t rank = 0; rank < dg.m_per_rank_orderings.size(); rank++) {
-        for (const auto &rank_ordering = dg.m_per_rank_orderings.at(rank);
-             const auto &name: rank_ordering) {
-            const Node &node = dg.m_nodes.at(name);
-            x_min = std::min(x_min, node.m_render_attrs.m_x);
-            x_max = std::max(x_max, node.m_render_attrs.m_x + node.m_render_attrs.m_width);
+namespace {
+// horizontal extent of the nodes of a rank, in (truncated) left edge coordinates
+struct RankExtent {
+    ssize_t m_min{std::numeric_limits<ssize_t>::max()}, m_max{std::numeric_limits<ssize_t>::min()};
+};
+}
+
+// converts m_barycenter_x from center to left edge position and returns the extent of every rank, gathered in the same
+// pass over the nodes
+static std::vector<RankExtent> convertBarycentersToLeftEdges(Digraph &dg) {
+    std::vector<RankExtent> rank_extents(dg.m_per_rank_orderings.size());
+    for (Node &node: std::views::values(dg.m_nodes)) {
+        node.m_render_attrs.m_barycenter_x -= static_cast<float>(node.m_render_attrs.m_width) / 2.0f;
+        const size_t rank = node.m_render_attrs.m_rank;
+        if (rank >= rank_extents.size()) {
+            rank_extents.resize(rank + 1);
         }
+        RankExtent &extent = rank_extents[rank];
+        const auto left = static_cast<ssize_t>(node.m_render_attrs.m_barycenter_x);
+        extent.m_min = std::min(extent.m_min, left);
+        extent.m_max = std::max(extent.m_max, left + static_cast<ssize_t>(node.m_render_attrs.m_width));
+    }
+    return rank_extents;
+}
+
+// Shifts the left edges so the minimum becomes 0 (plus padding), applies them as the node x positions and recomputes
+// the graph dimensions. The graph size is derived from the rank extents in O(ranks), but writing the positions is
+// still a pass over all nodes, just like gathering the extents.
+static void applyXPositionsAndRecomputeGraphDimensions(Digraph &dg, const std::span<const RankExtent> rank_extents) {
+    ssize_t x_min = std::numeric_limits<ssize_t>::max(), x_max = std::numeric_limits<ssize_t>::min();
+    for (const RankExtent &extent: rank_extents) {
+        x_min = std::min(x_min, extent.m_min);
+        x_max = std::max(x_max, extent.m_max);
+    }
+    if (x_min > x_max) {
+        return;
     }
-    assert(x_min == 0);
 
     // compute graph dimensions
     const size_t inner_width = std::ranges::max_element(
@@ -282,7 +395,7 @@ static void recomputeGraphDimensions(Digraph &dg) {
     const float padding_fract = static_cast<float>(dg.m_render_attrs.m_graph_width - inner_width) / 2.0f;
     const auto left_padding = static_cast<size_t>(std::floorf(padding_fract));
     const auto right_padding = static_cast<size_t>(std::ceilf(padding_fract));
-    dg.m_render_attrs.m_graph_width = x_max - x_min + left_padding + right_padding;
+    dg.m_render_attrs.m_graph_width = static_cast<size_t>(x_max - x_min) + left_padding + right_padding;
 
     // position graph label
     if (!dg.m_render_attrs.m_label_quads.empty()) {
@@ -296,13 +409,10 @@ static void recomputeGraphDimensions(Digraph &dg) {
         }
     }
 
-    // apply padding to each node again
-    for (size_t rank = 0; rank < dg.m_per_rank_orderings.size(); rank++) {
-        for (const auto &rank_ordering = dg.m_per_rank_orderings.at(rank);
-             const auto &name: rank_ordering) {
-            Node &node = dg.m_nodes.at(name);
-            node.m_render_attrs.m_x += left_padding;
-        }
+    // apply the final barycenter positions (with padding) as the new x positions
+    for (Node &node: std::views::values(dg.m_nodes)) {
+        node.m_render_attrs.m_x = static_cast<size_t>(static_cast<ssize_t>(node.m_render_attrs.m_barycenter_x) - x_min) +
+                                  left_padding;
     }
 }
 
@@ -310,7 +420,7 @@ static void recomputeGraphDimensions(Digraph &dg) {
 static void runLegalizationPass(Digraph &dg, const XOptPipelineStageSettings &pss,
                                 const bool ignore_missing_ranks = false) {
     for (size_t rank = 0; rank < dg.m_per_rank_orderings.size(); rank++) {
-        if (ignore_missing_ranks && !g_old_per_rank_barycenters.contains(rank)) {
+        if (ignore_missing_ranks && !g_has_old_barycenters.at(rank)) {
             continue;
         }
         legalizeBarycenters(dg, rank, pss);
@@ -331,9 +441,107 @@ static bool barycenterIteration(Digraph &dg, const bool is_downward_sweep, const
     return improvement_found || average_change >= BARYCENTER_X_OPTIMIZATION_MIN_AVERAGE_CHANGE_REQUIRED * dampening;
 }
 
-static void runBarycenterPipelineStage(Digraph &dg, const XOptPipelineStageSettings &pss) {
+// telemetry of the current x optimization run, see beginXOptTelemetry
+static thread_local float g_convergence_tolerance = 0.0f;
+static thread_local bool g_is_telemetry_enabled = false;
+static thread_local std::vector<Node *> g_nodes_by_id;
+// start of every rank in g_ordered_ids. The legalizer may reorder a rank, but its size stays the same.
+static thread_local std::vector<size_t> g_rank_offsets;
+// node ids in rank order, refilled from dg.m_node_positions for every measurement
+static thread_local std::vector<size_t> g_ordered_ids;
+// (source id, dest id, layout weight) of every edge with non-zero weight
+static thread_local std::vector<std::tuple<size_t, size_t, size_t> > g_layout_edges;
+static thread_local std::vector<float> g_prev_barycenters;
+// the iteration before the current one, the trajectory is not always recorded
+static thread_local std::optional<XOptIterationStats> g_prev_iteration_stats;
+// anytime layout mode: budget of the running x optimization and the lowest energy overlap-free barycenters so far
+static thread_local StageTimeBudget *g_time_budget = nullptr;
+static thread_local float g_best_energy = 0.0f;
+static thread_local std::vector<float> g_best_barycenters;
+
+// The iteration statistics cost a pass over all nodes and edges per iteration, so they are only measured if something
+// consumes them: the trajectory recording, early termination or the anytime layout mode.
+static void beginXOptTelemetry(Digraph &dg, const StageTimeBudget &budget) {
+    dg.m_x_opt_trajectory.clear();
+    g_prev_iteration_stats.reset();
+    g_nodes_by_id.assign(dg.m_nodes.size(), nullptr);
+    for (Node &node: std::views::values(dg.m_nodes)) {
+        g_nodes_by_id.at(node.m_id) = &node;
+    }
+    g_is_telemetry_enabled = BARYCENTER_X_OPTIMIZATION_RECORD_TRAJECTORY || g_convergence_tolerance > 0.0f ||
+                             budget.isEnabled();
+    if (!g_is_telemetry_enabled) {
+        return;
+    }
+    g_rank_offsets.assign(1, 0);
+    for (const auto &rank_ordering: dg.m_per_rank_orderings) {
+        g_rank_offsets.push_back(g_rank_offsets.back() + rank_ordering.size());
+    }
+    g_ordered_ids.resize(g_rank_offsets.back());
+    g_layout_edges.clear();
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        for (const Edge &edge: node.m_outgoing) {
+            const auto dest_it = dg.m_nodes.find(edge.m_dest);
+            if (dest_it == dg.m_nodes.end()) {
+                continue;
+            }
+            if (const size_t weight = dg.m_edge_layout_weights.at(edge.m_id); weight > 0) {
+                g_layout_edges.emplace_back(node.m_id, dest_it->second.m_id, weight);
+            }
+        }
+    }
+    g_prev_barycenters.resize(g_nodes_by_id.size());
+    for (size_t id = 0; id < g_nodes_by_id.size(); id++) {
+        g_prev_barycenters[id] = g_nodes_by_id[id]->m_render_attrs.m_barycenter_x;
+    }
+}
+
+// measures the iteration that just finished, appends it to the trajectory and returns whether the stage has converged
+static bool finishXOptIteration(Digraph &dg, const size_t stage, const size_t iteration) {
+    if (!g_is_telemetry_enabled) {
+        return false;
+    }
+    XOptIterationStats stats{stage, iteration};
+    for (size_t id = 0; id < g_nodes_by_id.size(); id++) {
+        const float x = g_nodes_by_id[id]->m_render_attrs.m_barycenter_x;
+        stats.m_displacement += std::abs(x - g_prev_barycenters[id]);
+        g_prev_barycenters[id] = x;
+    }
+    for (const auto &[source, dest, weight]: g_layout_edges) {
+        stats.m_energy += static_cast<float>(weight) * std::abs(g_prev_barycenters[source] - g_prev_barycenters[dest]);
+    }
+    for (size_t id = 0; id < g_nodes_by_id.size(); id++) {
+        g_ordered_ids[g_rank_offsets[g_nodes_by_id[id]->m_render_attrs.m_rank] + dg.m_node_positions[id]] = id;
+    }
+    for (size_t rank = 0; rank + 1 < g_rank_offsets.size(); rank++) {
+        for (size_t i = g_rank_offsets[rank] + 1; i < g_rank_offsets[rank + 1]; i++) {
+            const NodeRenderAttrs &left = g_nodes_by_id[g_ordered_ids[i - 1]]->m_render_attrs;
+            const NodeRenderAttrs &right = g_nodes_by_id[g_ordered_ids[i]]->m_render_attrs;
+            if (right.m_barycenter_x - left.m_barycenter_x < static_cast<float>(left.m_width + right.m_width) / 2.0f) {
+                stats.m_n_overlaps++;
+            }
+        }
+    }
+    if (g_time_budget && g_time_budget->isEnabled() && stats.m_n_overlaps == 0 && stats.m_energy < g_best_energy) {
+        g_best_energy = stats.m_energy;
+        g_best_barycenters = g_prev_barycenters;
+    }
+
+    if (BARYCENTER_X_OPTIMIZATION_RECORD_TRAJECTORY) {
+        dg.m_x_opt_trajectory.push_back(stats);
+    }
+    const std::optional<XOptIterationStats> prev = std::exchange(g_prev_iteration_stats, stats);
+    if (g_convergence_tolerance <= 0.0f || !prev || prev->m_stage != stage) {
+        return false;
+    }
+    return stats.m_n_overlaps <= prev->m_n_overlaps &&
+           std::abs(prev->m_energy - stats.m_energy) <= g_convergence_tolerance * std::max(prev->m_energy, 1.0f);
+}
+
+static void runBarycenterPipelineStage(Digraph &dg, const XOptPipelineStageSettings &pss, const size_t stage) {
     g_pss = &pss;
     float dampening = pss.m_initial_dampening;
+    size_t n_iterations = 0;
     if (pss.m_sweep_mode == SweepMode::sweep_direction_is_outer_loop) {
         for (const auto &sweep_settings: pss.m_sweep_settings) {
             g_is_downward_barycenter_sweep = sweep_settings.m_is_downward_sweep;
@@ -345,6 +553,12 @@ static void runBarycenterPipelineStage(Digraph &dg, const XOptPipelineStageSetti
                     return;
                 }
                 dampening *= pss.m_dampening_fadeout;
+                if (finishXOptIteration(dg, stage, n_iterations++)) {
+                    break;
+                }
+                if (g_time_budget->isExhausted()) {
+                    return;
+                }
             }
         }
     } else if (pss.m_sweep_mode == SweepMode::sweep_direction_is_innermost_loop) {
@@ -368,6 +582,9 @@ static void runBarycenterPipelineStage(Digraph &dg, const XOptPipelineStageSetti
                 }
             }
             dampening *= pss.m_dampening_fadeout;
+            if (finishXOptIteration(dg, stage, n_iterations++) || g_time_budget->isExhausted()) {
+                return;
+            }
         }
     } else {
         assert(pss.m_sweep_mode == SweepMode::normal);
@@ -380,20 +597,39 @@ static void runBarycenterPipelineStage(Digraph &dg, const XOptPipelineStageSetti
                 }
                 dampening *= pss.m_dampening_fadeout;
             }
+            if (finishXOptIteration(dg, stage, n_iterations++) || g_time_budget->isExhausted()) {
+                return;
+            }
         }
     }
 }
 
-static void runBarycenter(Digraph &dg) {
-    for (const XOptPipelineStageSettings &pss: BARYCENTER_X_OPTIMIZATION_PIPELINE) {
-        for (size_t i = 0; i < pss.m_repeats; i++) {
-            runBarycenterPipelineStage(dg, pss);
+// If the budget runs out, the remaining iterations and stages are skipped and the lowest energy overlap-free state
+// seen so far is kept (a pipeline cut short may be in the middle of e.g. an exploded stage).
+static void runBarycenter(Digraph &dg, const std::vector<XOptPipelineStageSettings> &pipeline,
+                          StageTimeBudget &budget) {
+    beginXOptTelemetry(dg, budget);
+    g_sweep_barycenters.ensureLayout(dg);
+    g_has_old_barycenters.assign(dg.m_per_rank_orderings.size(), false);
+    g_time_budget = &budget;
+    g_best_energy = std::numeric_limits<float>::infinity();
+    g_best_barycenters.clear();
+    for (size_t stage = 0; stage < pipeline.size() && !budget.m_was_cut_short; stage++) {
+        const XOptPipelineStageSettings &pss = pipeline[stage];
+        for (size_t i = 0; i < pss.m_repeats && !budget.m_was_cut_short; i++) {
+            runBarycenterPipelineStage(dg, pss, stage);
             if (pss.m_legalizer_settings.m_legalization_timing ==
                 XOptPipelineStageSettings::LegalizerSettings::LegalizationTiming::after_pipeline_stage) {
                 runLegalizationPass(dg, pss);
             }
         }
     }
+    if (budget.m_was_cut_short && !g_best_barycenters.empty()) {
+        for (size_t id = 0; id < g_nodes_by_id.size(); id++) {
+            g_nodes_by_id[id]->m_render_attrs.m_barycenter_x = g_best_barycenters[id];
+        }
+    }
+    g_time_budget = nullptr;
 }
 
 void Digraph::optimizeGraphLayout() {
@@ -406,42 +642,37 @@ void Digraph::optimizeGraphLayout() {
         return;
     }
     clearGlobalState();
+    StageTimeBudget budget = StageTimeBudget::begin(*this, TIME_BUDGET_X_OPTIMIZATION_SHARE);
+    const XOptProfile graph_profile = getGraphXOptProfile(*this);
+    g_convergence_tolerance = getAttrTransformedCheckedOrDefault(
+        m_attrs, "punktxopttolerance",
+        graph_profile.m_convergence_tolerance.value_or(BARYCENTER_X_OPTIMIZATION_CONVERGENCE_TOLERANCE),
+        stringViewToFloat);
 
     // populate barycenter x on each node
-    for (size_t rank = 0; rank < m_rank_counts.size(); rank++) {
-        for (size_t i = 0; i < m_rank_counts[rank]; i++) {
-            const auto &node_name = m_per_rank_orderings.at(rank).at(i);
-            auto &node = m_nodes.at(node_name);
-            node.m_render_attrs.m_barycenter_x = static_cast<float>(node.m_render_attrs.m_x) +
-                                                 static_cast<float>(node.m_render_attrs.m_width) / 2.0f;
-        }
-    }
-
-    runBarycenter(*this);
-
-    // convert m_barycenter_x from center to left edge position
     for (Node &node: std::views::values(m_nodes)) {
-        node.m_render_attrs.m_barycenter_x -= static_cast<float>(node.m_render_attrs.m_width) / 2.0f;
-    }
-
-    // find the minimum barycenter x and adjust so that minimum becomes 0
-    ssize_t x_min = std::numeric_limits<ssize_t>::max();
-    for (auto &rank_ordering: m_per_rank_orderings) {
-        for (const auto &node_name: rank_ordering) {
-            const auto &node = m_nodes.at(node_name);
-            x_min = std::min(x_min, static_cast<ssize_t>(node.m_render_attrs.m_barycenter_x));
-        }
+        node.m_render_attrs.m_barycenter_x = static_cast<float>(node.m_render_attrs.m_x) +
+                                             static_cast<float>(node.m_render_attrs.m_width) / 2.0f;
     }
 
-    // apply the final barycenter positions as the new x positions
-    for (size_t rank = 0; rank < m_rank_counts.size(); rank++) {
-        for (size_t i = 0; i < m_rank_counts[rank]; i++) {
-            const auto &node_name = m_per_rank_orderings.at(rank).at(i);
-            auto &node = m_nodes.at(node_name);
-            node.m_render_attrs.m_x = static_cast<size_t>(
-                static_cast<ssize_t>(node.m_render_attrs.m_barycenter_x) - x_min);
-        }
+    constexpr std::string_view punkt_x_opt_engine_attr_name = "punktxoptengine";
+    if (const std::string_view &x_opt_engine = getAttrOrDefault(m_attrs, punkt_x_opt_engine_attr_name, "barycenter");
+        caseInsensitiveEquals(x_opt_engine, "barycenter")) {
+        // g_pss points into the pipeline while it runs
+        const std::vector<XOptPipelineStageSettings> pipeline = getEffectiveXOptPipeline(*this, graph_profile);
+        runBarycenter(*this, pipeline, budget);
+        g_pss = nullptr;
+    } else if (caseInsensitiveEquals(x_opt_engine, "brandes-koepf")) {
+        assignXCoordinatesBrandesKoepf(*this);
+    } else if (caseInsensitiveEquals(x_opt_engine, "quadratic")) {
+        assignXCoordinatesQuadratic(*this, g_convergence_tolerance,
+                                    scaleIterationBudget(QUADRATIC_X_OPTIMIZATION_MAX_ITERS,
+                                                         getIterationBudgetGraphSize(*this)), budget);
+    } else {
+        throw IllegalAttributeException(std::string(punkt_x_opt_engine_attr_name), std::string(x_opt_engine));
     }
+    budget.finish(*this, "x_optimization");
 
-    recomputeGraphDimensions(*this);
+    const std::vector<RankExtent> rank_extents = convertBarycentersToLeftEdges(*this);
+    applyXPositionsAndRecomputeGraphDimensions(*this, rank_extents);
 }
@@ -1,51 +1,127 @@
 #include "punkt/dot.hpp"
 #include "punkt/dot_constants.hpp"
 #include "punkt/utils/int_types.hpp"
+#include "punkt/utils/thread_pool.hpp"
 #include "punkt/layout/common.hpp"
+#include "punkt/layout/layered_graph.hpp"
+#include "punkt/layout/x_opt_profile.hpp"
+#include "punkt/layout/time_budget.hpp"
 
 #include <vector>
 #include <algorithm>
 #include <string_view>
+#include <span>
+#include <limits>
 
 using namespace punkt;
 using namespace punkt::layout;
 
 /// this function has to match the signature given by @code BarycenterSweepOperatorFunc @endcode
-static void barycenterSweepReorderOperator(Digraph &dg, std::vector<float> new_barycenters,
-                                           std::vector<float> old_barycenters, const size_t rank,
+static void barycenterSweepReorderOperator(Digraph &dg, std::span<const float> new_barycenters,
+                                           std::span<const float> old_barycenters, const size_t rank,
                                            bool &out_improvement_found) {
     reorderRankByBarycenterX(dg, rank, out_improvement_found);
 }
 
-static bool barycenterIteration(Digraph &dg, const bool is_downward_sweep, const float dampening) {
+// if `pool` is not null, the sweep runs in parallel (banded odd/even) mode on it
+static bool barycenterIteration(Digraph &dg, const bool is_downward_sweep, const float dampening, ThreadPool *pool) {
     bool improvement_found = false;
     float total_change = 0.0f;
-    barycenterSweep(dg, is_downward_sweep, improvement_found, total_change, barycenterSweepReorderOperator,
-                    BARYCENTER_USE_MEDIAN, dampening);
+    if (pool) {
+        barycenterSweepParallel(dg, is_downward_sweep, improvement_found, total_change, barycenterSweepReorderOperator,
+                                BARYCENTER_USE_MEDIAN, dampening, *pool, PARALLEL_SWEEP_BAND_SIZE);
+    } else {
+        barycenterSweep(dg, is_downward_sweep, improvement_found, total_change, barycenterSweepReorderOperator,
+                        BARYCENTER_USE_MEDIAN, dampening);
+    }
     const float average_change = total_change / static_cast<float>(dg.m_nodes.size());
     return improvement_found || average_change >= BARYCENTER_MIN_AVERAGE_CHANGE_REQUIRED *
            BARYCENTER_ORDERING_DAMPENING;
 }
 
-static void runBarycenter(Digraph &dg) {
+static bool shouldUseParallelSweep(const Digraph &dg) {
+    constexpr std::string_view punkt_parallel_sweep_attr_name = "punktparallelsweep";
+    const std::string_view &parallel_sweep = getAttrOrDefault(dg.m_attrs, punkt_parallel_sweep_attr_name, "auto");
+    if (caseInsensitiveEquals(parallel_sweep, "auto")) {
+        return dg.m_per_rank_orderings.size() >= PARALLEL_SWEEP_MIN_RANKS;
+    }
+    if (caseInsensitiveEquals(parallel_sweep, "true")) {
+        return true;
+    }
+    if (caseInsensitiveEquals(parallel_sweep, "false")) {
+        return false;
+    }
+    throw IllegalAttributeException(std::string(punkt_parallel_sweep_attr_name), std::string(parallel_sweep));
+}
+
+// sum of the ordering scores of all reorderable ranks (smaller is better)
+static float getTotalOrderingScore(const Digraph &dg) {
+    float score = 0.0f;
+    for (size_t rank = 0; rank < dg.m_per_rank_orderings.size(); rank++) {
+        if (!dg.m_io_port_ranks.contains(rank)) {
+            score += getRankOrderingScore(dg, rank);
+        }
+    }
+    return score;
+}
+
+namespace {
+// the best ordering the barycenter sweeps have produced so far. Only tracked in the anytime layout mode, because
+// scoring every iteration is not free.
+struct BestOrdering {
+    float m_score{std::numeric_limits<float>::infinity()};
+    std::vector<std::vector<std::string_view> > m_orderings;
+
+    void update(const Digraph &dg) {
+        if (const float score = getTotalOrderingScore(dg); score < m_score) {
+            m_score = score;
+            m_orderings = dg.m_per_rank_orderings;
+        }
+    }
+
+    void restore(Digraph &dg) const {
+        dg.m_per_rank_orderings = m_orderings;
+        for (size_t rank = 0; rank < dg.m_per_rank_orderings.size(); rank++) {
+            populateNodePositionsAtRank(dg, rank);
+        }
+    }
+};
+}
+
+// stops early (after any iteration) once `budget` is exhausted, `best` is then updated after every iteration
+static void runBarycenterSweeps(Digraph &dg, StageTimeBudget &budget, BestOrdering *best) {
+    const ssize_t max_iters = scaleIterationBudget(BARYCENTER_ORDERING_MAX_ITERS_PER_DIRECTION,
+                                                   getIterationBudgetGraphSize(dg));
+    if (max_iters == 0) {
+        return;
+    }
+    ThreadPool *const pool = shouldUseParallelSweep(dg) ? &getLayoutThreadPool() : nullptr;
+
     float dampening = BARYCENTER_ORDERING_DAMPENING;
     if (BARYCENTER_SWEEP_DIRECTION_IS_OUTER_LOOP) {
         const float orig_dampening = dampening;
         for (const bool is_downward_sweep: {false, true}) {
             dampening = orig_dampening;
-            for (ssize_t barycenter_iter = 0; barycenter_iter < BARYCENTER_ORDERING_MAX_ITERS_PER_DIRECTION ||
-                                              BARYCENTER_ORDERING_MAX_ITERS_PER_DIRECTION < 0; barycenter_iter++) {
-                if (!barycenterIteration(dg, is_downward_sweep, dampening)) {
+            for (ssize_t barycenter_iter = 0; barycenter_iter < max_iters || max_iters < 0;
+                 barycenter_iter++) {
+                const bool keep_going = barycenterIteration(dg, is_downward_sweep, dampening, pool);
+                if (best) {
+                    best->update(dg);
+                }
+                if (!keep_going || budget.isExhausted()) {
                     return;
                 }
                 dampening *= BARYCENTER_ORDERING_FADEOUT;
             }
         }
     } else {
-        for (ssize_t barycenter_iter = 0; barycenter_iter < BARYCENTER_ORDERING_MAX_ITERS_PER_DIRECTION ||
-                                          BARYCENTER_ORDERING_MAX_ITERS_PER_DIRECTION < 0; barycenter_iter++) {
+        for (ssize_t barycenter_iter = 0; barycenter_iter < max_iters || max_iters < 0; barycenter_iter++) {
             for (const bool is_downward_sweep: {false, true}) {
-                if (!barycenterIteration(dg, is_downward_sweep, dampening)) {
+                const bool keep_going = barycenterIteration(dg, is_downward_sweep, dampening, pool);
+                if (best) {
+                    best->update(dg);
+                }
+                if (!keep_going || budget.isExhausted()) {
                     return;
                 }
             }
@@ -54,8 +130,22 @@ static void runBarycenter(Digraph &dg) {
     }
 }
 
+static void runBarycenter(Digraph &dg, StageTimeBudget &budget) {
+    if (!budget.isEnabled()) {
+        runBarycenterSweeps(dg, budget, nullptr);
+        return;
+    }
+    BestOrdering best;
+    best.update(dg);
+    runBarycenterSweeps(dg, budget, &best);
+    if (budget.m_was_cut_short) {
+        best.restore(dg);
+    }
+}
+
 void Digraph::computeHorizontalOrderings() {
     clearGlobalState();
+    StageTimeBudget budget = StageTimeBudget::begin(*this, TIME_BUDGET_ORDERING_SHARE);
 
     // init with empty ordering vector for every rank
     m_per_rank_orderings.resize(m_rank_counts.size());
@@ -65,8 +155,35 @@ void Digraph::computeHorizontalOrderings() {
     } else if (m_io_port_ranks.size() == 1 && !m_io_port_ranks.contains(0)) {
         std::swap(m_per_rank_orderings.at(0), m_per_rank_orderings.at(m_per_rank_orderings.size() - 1));
     }
-    m_per_rank_orderings_index.resize(m_rank_counts.size());
     populateInitialOrderings(*this);
+    populateEdgeLayoutWeights(*this);
+
+    // flat sweeps converge very slowly on huge graphs, so those are ordered by the multilevel engine first
+    constexpr std::string_view punkt_multilevel_attr_name = "punktmultilevel";
+    bool use_multilevel_ordering;
+    if (const std::string_view &multilevel = getAttrOrDefault(m_attrs, punkt_multilevel_attr_name, "auto");
+        caseInsensitiveEquals(multilevel, "auto")) {
+        use_multilevel_ordering = m_nodes.size() >= MULTILEVEL_ORDERING_MIN_NODES;
+    } else if (caseInsensitiveEquals(multilevel, "true")) {
+        use_multilevel_ordering = true;
+    } else if (caseInsensitiveEquals(multilevel, "false")) {
+        use_multilevel_ordering = false;
+    } else {
+        throw IllegalAttributeException(std::string(punkt_multilevel_attr_name), std::string(multilevel));
+    }
+    if (use_multilevel_ordering) {
+        runMultilevelOrdering(*this, MULTILEVEL_ORDERING_COARSEST_NODES, MULTILEVEL_ORDERING_REFINEMENT_SWEEPS);
+    }
+
+    // the alphabetical initial ordering often leads the sweeps below into a poor local optimum, so optionally replace it
+    // by the best of many independently seeded orderings
+    if (const size_t n_runs = getAttrTransformedCheckedOrDefault(m_attrs, "punktorderingruns",
+                                                                 MULTI_START_ORDERING_RUNS, stringViewToSizeT);
+        n_runs > 0) {
+        const uint64_t seed = getAttrTransformedCheckedOrDefault(m_attrs, "punktorderingseed",
+                                                                 MULTI_START_ORDERING_SEED, stringViewToSizeT);
+        runMultiStartOrdering(*this, n_runs, seed, MULTI_START_ORDERING_MAX_SWEEPS_PER_RUN);
+    }
 
     // populate barycenter x on each node
     for (size_t rank = 0; rank < m_rank_counts.size(); rank++) {
@@ -76,9 +193,11 @@ void Digraph::computeHorizontalOrderings() {
             node.m_render_attrs.m_barycenter_x = static_cast<float>(i);
         }
     }
-    runBarycenter(*this);
+    runBarycenter(*this, budget);
 
-    if (BUBBLE_ORDERING_MAX_ITERS == 0) {
+    const ssize_t bubble_max_iters = scaleIterationBudget(BUBBLE_ORDERING_MAX_ITERS, getIterationBudgetGraphSize(*this));
+    if (bubble_max_iters == 0 || budget.m_was_cut_short) {
+        budget.finish(*this, "ordering");
         return;
     }
     // reorder bubble-sort style until no adjacent node swap increases the score
@@ -90,8 +209,12 @@ void Digraph::computeHorizontalOrderings() {
         }
         rank_scores[rank] = getRankOrderingScore(*this, rank);
     }
-    for (ssize_t bubble_ordering_iter = 0; bubble_ordering_iter < BUBBLE_ORDERING_MAX_ITERS ||
-                                           BUBBLE_ORDERING_MAX_ITERS < 0; bubble_ordering_iter++) {
+    for (ssize_t bubble_ordering_iter = 0; bubble_ordering_iter < bubble_max_iters || bubble_max_iters < 0;
+         bubble_ordering_iter++) {
+        // swaps are only kept if they improve the score, so stopping after any iteration keeps the best ordering
+        if (bubble_ordering_iter > 0 && budget.isExhausted()) {
+            break;
+        }
         // iterate until no changes improve the score anymore (or until iteration limit is reached)
         bool improvement_found = false;
         // each iteration, we loop over every rank and every node in each rank in order and try to swap it with its
@@ -112,7 +235,7 @@ void Digraph::computeHorizontalOrderings() {
                 if (const float new_rank_score = updateRankOrderingScoreAfterSwap(node_idx, node_idx + 1);
                     new_rank_score < rank_scores[rank]) {
                     rank_scores[rank] = new_rank_score;
-                    swapNodesOnRank(m_per_rank_orderings[rank][node_idx], m_per_rank_orderings[rank][node_idx + 1]);
+                    swapNodesOnRank(rank, node_idx, node_idx + 1);
                     improvement_found = true;
                 } else {
                     // equivalent to (but more efficient than) updateRankOrderingScoreAfterSwap(node_idx, node_idx + 1)
@@ -124,4 +247,5 @@ void Digraph::computeHorizontalOrderings() {
             break;
         }
     }
+    budget.finish(*this, "ordering");
 }
@@ -1,4 +1,6 @@
 #include "punkt/dot.hpp"
+#include "punkt/dot_constants.hpp"
+#include "punkt/utils/utils.hpp"
 #include "punkt/layout/populate_glyph_quads_with_text.hpp"
 
 #include <ranges>
@@ -94,3 +96,16 @@ void punkt::populateGlyphQuadsWithText(const std::string_view &text, const size_
         std::swap(out_height, out_max_line_width);
     }
 }
+
+void punkt::populateGraphLabelText(const Attrs &attrs, render::glyph::GlyphLoader &glyph_loader,
+                                   std::vector<GlyphQuad> &out_label_quads, size_t &out_graph_label_width,
+                                   size_t &out_graph_label_height, const RankDirConfig rank_dir) {
+    if (const std::string_view graph_label = getAttrOrDefault(attrs, "label", ""); !graph_label.empty()) {
+        const TextAlignment label_ta =
+                getAttrTransformedOrDefault(attrs, "labeljust", default_label_just, textAlignmentFromStr);
+        const size_t graph_label_font_size = getAttrTransformedCheckedOrDefault(
+            attrs, "fontsize", default_font_size, stringViewToSizeT);
+        populateGlyphQuadsWithText(graph_label, graph_label_font_size, label_ta, glyph_loader, out_label_quads,
+                                   out_graph_label_width, out_graph_label_height, rank_dir);
+    }
+}
@@ -0,0 +1,236 @@
+#include "punkt/dot.hpp"
+#include "punkt/dot_constants.hpp"
+#include "punkt/utils/int_types.hpp"
+#include "punkt/layout/layered_graph.hpp"
+#include "punkt/layout/coordinate_assignment.hpp"
+
+#include <vector>
+#include <span>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+using namespace punkt;
+using namespace punkt::layout;
+
+void layout::solveIsotonicRegression(const std::span<float> values, const std::span<const float> weights) {
+    assert(values.size() == weights.size());
+    struct PAVBlock {
+        float m_weight, m_weighted_sum;
+        // one past the last index of the block
+        size_t m_end;
+    };
+    thread_local std::vector<PAVBlock> blocks;
+
+    blocks.clear();
+    for (size_t i = 0; i < values.size(); i++) {
+        blocks.push_back({weights[i], weights[i] * values[i], i + 1});
+        // merge while the last two blocks violate the order (compared as weighted means, cross-multiplied)
+        while (blocks.size() >= 2) {
+            const PAVBlock &a = blocks[blocks.size() - 2], &b = blocks.back();
+            if (a.m_weighted_sum * b.m_weight <= b.m_weighted_sum * a.m_weight) {
+                break;
+            }
+            const PAVBlock merged{a.m_weight + b.m_weight, a.m_weighted_sum + b.m_weighted_sum, b.m_end};
+            blocks.pop_back();
+            blocks.back() = merged;
+        }
+    }
+
+    size_t i = 0;
+    for (const PAVBlock &block: blocks) {
+        const float mean = block.m_weighted_sum / block.m_weight;
+        for (; i < block.m_end; i++) {
+            values[i] = mean;
+        }
+    }
+}
+
+namespace {
+struct QPEdge {
+    size_t m_u, m_v;
+    // weight in the objective (layout weight scaled by the ghost factors)
+    float m_weight;
+    size_t m_layout_weight;
+};
+
+// The problem  min sum_e w_e (x_u - x_v)^2  s.t.  x_{i+1} - x_i >= sep_i  for horizontally adjacent nodes, over node
+// centers indexed by LayeredGraph id. Ids are rank-major and in position order, so every rank is a contiguous slice.
+struct QuadraticProblem {
+    std::vector<QPEdge> m_edges;
+    // [m_rank_offsets[r], m_rank_offsets[r + 1]) are the ids of rank r
+    std::vector<size_t> m_rank_offsets;
+    // id -> sum of the separations left of the node on its rank
+    std::vector<float> m_sep_offsets;
+    // id -> diagonal of the hessian (1 for nodes without edges), used as the metric of the gradient projection
+    std::vector<float> m_metric;
+
+    [[nodiscard]] double getObjective(const std::vector<float> &x) const {
+        double f = 0.0;
+        for (const QPEdge &e: m_edges) {
+            const double dx = x[e.m_u] - x[e.m_v];
+            f += e.m_weight * dx * dx;
+        }
+        return f;
+    }
+
+    // sum of layout weight * |dx|, the energy the x optimization telemetry reports
+    [[nodiscard]] float getLinearEnergy(const std::vector<float> &x) const {
+        float energy = 0.0f;
+        for (const QPEdge &e: m_edges) {
+            energy += static_cast<float>(e.m_layout_weight) * std::abs(x[e.m_u] - x[e.m_v]);
+        }
+        return energy;
+    }
+
+    // Euclidean projection in the metric onto the separation constraints. The ranks are independent and substituting
+    // z_i = x_i - m_sep_offsets[i] turns each of them into an isotonic regression.
+    void project(std::vector<float> &x) const {
+        for (size_t i = 0; i < x.size(); i++) {
+            x[i] -= m_sep_offsets[i];
+        }
+        for (size_t rank = 0; rank + 1 < m_rank_offsets.size(); rank++) {
+            const size_t begin = m_rank_offsets[rank], size = m_rank_offsets[rank + 1] - begin;
+            solveIsotonicRegression(std::span(x).subspan(begin, size),
+                                    std::span<const float>(m_metric).subspan(begin, size));
+        }
+        for (size_t i = 0; i < x.size(); i++) {
+            x[i] += m_sep_offsets[i];
+        }
+    }
+
+    // One projected gradient step from `y` into `out_x`. In the diagonal metric the hessian has eigenvalues in [0, 2],
+    // so a step of 1/2 always decreases the objective. For a node, the step moves halfway towards the weighted mean of
+    // its neighbours, the projection then restores the separations.
+    void step(const std::vector<float> &y, std::vector<float> &gradient, std::vector<float> &out_x) const {
+        std::ranges::fill(gradient, 0.0f);
+        for (const QPEdge &e: m_edges) {
+            const float d = 2.0f * e.m_weight * (y[e.m_u] - y[e.m_v]);
+            gradient[e.m_u] += d;
+            gradient[e.m_v] -= d;
+        }
+        for (size_t i = 0; i < y.size(); i++) {
+            out_x[i] = y[i] - 0.5f * gradient[i] / m_metric[i];
+        }
+        project(out_x);
+    }
+};
+}
+
+static QuadraticProblem buildQuadraticProblem(const Digraph &dg, const LayeredGraph &lg,
+                                              const std::vector<NodeRenderAttrs *> &render_attrs) {
+    QuadraticProblem qp;
+    const size_t n_nodes = lg.getNumNodes();
+    qp.m_metric.assign(n_nodes, 0.0f);
+    for (size_t node = 0; node < n_nodes; node++) {
+        for (const LayeredGraph::Neighbour &neighbour: lg.getNeighbours(node, true)) {
+            if (neighbour.m_weight == 0) {
+                continue;
+            }
+            const int n_ghosts = static_cast<int>(render_attrs[node]->m_is_ghost) +
+                                 static_cast<int>(render_attrs[neighbour.m_node]->m_is_ghost);
+            const float factor = n_ghosts == 2
+                                     ? QUADRATIC_X_OPTIMIZATION_GHOST_CHAIN_WEIGHT_FACTOR
+                                     : n_ghosts == 1
+                                     ? QUADRATIC_X_OPTIMIZATION_GHOST_EDGE_WEIGHT_FACTOR
+                                     : 1.0f;
+            const float weight = static_cast<float>(neighbour.m_weight) * factor;
+            qp.m_edges.push_back({node, neighbour.m_node, weight, neighbour.m_weight});
+            qp.m_metric[node] += 2.0f * weight;
+            qp.m_metric[neighbour.m_node] += 2.0f * weight;
+        }
+    }
+    for (float &m: qp.m_metric) {
+        if (m <= 0.0f) {
+            m = 1.0f;
+        }
+    }
+
+    const auto node_sep = static_cast<float>(dg.m_render_attrs.m_node_sep);
+    qp.m_sep_offsets.resize(n_nodes);
+    qp.m_rank_offsets.push_back(0);
+    for (const std::vector<size_t> &ordering: lg.m_orderings) {
+        for (size_t i = 0; i < ordering.size(); i++) {
+            assert(ordering[i] == qp.m_rank_offsets.back() + i);
+            const size_t node = ordering[i];
+            if (i == 0) {
+                qp.m_sep_offsets[node] = 0.0f;
+                continue;
+            }
+            const auto w_prev = static_cast<float>(render_attrs[node - 1]->m_width);
+            const auto w_self = static_cast<float>(render_attrs[node]->m_width);
+            qp.m_sep_offsets[node] = qp.m_sep_offsets[node - 1] + (w_prev + w_self) / 2.0f + node_sep;
+        }
+        qp.m_rank_offsets.push_back(qp.m_rank_offsets.back() + ordering.size());
+    }
+    return qp;
+}
+
+void layout::assignXCoordinatesQuadratic(Digraph &dg, const float tolerance, const ssize_t max_iters,
+                                         StageTimeBudget &budget) {
+    dg.m_x_opt_trajectory.clear();
+    const LayeredGraph lg = LayeredGraph::fromDigraph(dg);
+    const size_t n_nodes = lg.getNumNodes();
+    if (n_nodes == 0) {
+        return;
+    }
+    std::vector<NodeRenderAttrs *> render_attrs(n_nodes);
+    for (size_t node = 0; node < n_nodes; node++) {
+        render_attrs[node] = &dg.m_nodes.at(lg.m_names[node]).m_render_attrs;
+    }
+    const QuadraticProblem qp = buildQuadraticProblem(dg, lg, render_attrs);
+
+    // warm start from the current positions
+    std::vector<float> x(n_nodes), x_prev, y(n_nodes), x_new(n_nodes), gradient(n_nodes);
+    for (size_t node = 0; node < n_nodes; node++) {
+        x[node] = render_attrs[node]->m_barycenter_x;
+    }
+    qp.project(x);
+    x_prev = x;
+    double f = qp.getObjective(x);
+
+    // accelerated (FISTA) gradient projection, restarted whenever the extrapolated step would increase the objective,
+    // which keeps the iterates monotone
+    float t = 1.0f;
+    for (size_t iteration = 0; max_iters < 0 || iteration < static_cast<size_t>(max_iters); iteration++) {
+        if (iteration > 0 && budget.isExhausted()) {
+            break;
+        }
+        const float t_next = (1.0f + std::sqrt(1.0f + 4.0f * t * t)) / 2.0f;
+        const float momentum = (t - 1.0f) / t_next;
+        for (size_t i = 0; i < n_nodes; i++) {
+            y[i] = x[i] + momentum * (x[i] - x_prev[i]);
+        }
+        qp.step(y, gradient, x_new);
+        double f_new = qp.getObjective(x_new);
+        t = t_next;
+        if (f_new > f) {
+            qp.step(x, gradient, x_new);
+            f_new = qp.getObjective(x_new);
+            t = 1.0f;
+        }
+
+        XOptIterationStats stats{0, iteration};
+        for (size_t i = 0; i < n_nodes; i++) {
+            stats.m_displacement += std::abs(x_new[i] - x[i]);
+        }
+        stats.m_energy = qp.getLinearEnergy(x_new);
+        // projected iterates never overlap, so m_n_overlaps stays 0
+        if (BARYCENTER_X_OPTIMIZATION_RECORD_TRAJECTORY) {
+            dg.m_x_opt_trajectory.push_back(stats);
+        }
+
+        std::swap(x_prev, x);
+        std::swap(x, x_new);
+        const double f_old = f;
+        f = f_new;
+        if (stats.m_displacement == 0.0f ||
+            (tolerance >= 0.0f && f_old - f <= static_cast<double>(tolerance) * std::max(f_old, 1.0))) {
+            break;
+        }
+    }
+
+    for (size_t node = 0; node < n_nodes; node++) {
+        render_attrs[node]->m_barycenter_x = x[node];
+    }
+}
@@ -0,0 +1,76 @@
+#include "punkt/dot.hpp"
+#include "punkt/dot_constants.hpp"
+#include "punkt/utils/utils.hpp"
+#include "punkt/layout/time_budget.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <string_view>
+
+using namespace punkt;
+using namespace punkt::layout;
+
+using Clock = std::chrono::steady_clock;
+using FloatMs = std::chrono::duration<float, std::milli>;
+
+float layout::parseDurationMs(const std::string_view sv, const std::string_view attr_name) {
+    std::string_view number = sv;
+    float unit_ms = 1.0f;
+    if (number.ends_with("ms")) {
+        number.remove_suffix(2);
+    } else if (number.ends_with("s")) {
+        number.remove_suffix(1);
+        unit_ms = 1000.0f;
+    }
+    const float duration = stringViewToFloat(number, attr_name) * unit_ms;
+    if (number.empty() || duration < 0.0f) {
+        throw IllegalAttributeException(std::string(attr_name), std::string(sv));
+    }
+    return duration;
+}
+
+void layout::beginTimeBudgetedLayout(Digraph &dg) {
+    dg.m_time_budget_report.clear();
+    if (constexpr std::string_view punkt_time_budget_attr_name = "punkttimebudget";
+        dg.m_attrs.contains(punkt_time_budget_attr_name)) {
+        const float budget_ms = parseDurationMs(dg.m_attrs.at(punkt_time_budget_attr_name),
+                                                punkt_time_budget_attr_name);
+        dg.m_layout_deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(FloatMs(budget_ms));
+    } else if (dg.m_parent) {
+        dg.m_layout_deadline = dg.m_parent->m_layout_deadline;
+    } else {
+        dg.m_layout_deadline.reset();
+    }
+}
+
+StageTimeBudget StageTimeBudget::begin(const Digraph &dg, const float share) {
+    StageTimeBudget budget;
+    budget.m_start = Clock::now();
+    if (dg.m_layout_deadline) {
+        const auto remaining = std::max(*dg.m_layout_deadline - budget.m_start, Clock::duration::zero());
+        budget.m_deadline = budget.m_start + std::chrono::duration_cast<Clock::duration>(
+                                FloatMs(remaining) * std::clamp(share, 0.0f, 1.0f));
+    }
+    return budget;
+}
+
+bool StageTimeBudget::isEnabled() const {
+    return m_deadline.has_value();
+}
+
+bool StageTimeBudget::isExhausted() {
+    if (m_deadline && Clock::now() >= *m_deadline) {
+        m_was_cut_short = true;
+    }
+    return m_was_cut_short;
+}
+
+void StageTimeBudget::finish(Digraph &dg, const std::string_view stage) const {
+    if (!m_deadline) {
+        return;
+    }
+    dg.m_time_budget_report.push_back({
+        stage, FloatMs(*m_deadline - m_start).count(), FloatMs(Clock::now() - m_start).count(), m_was_cut_short
+    });
+}
@@ -0,0 +1,299 @@
+#include "punkt/dot.hpp"
+#include "punkt/dot_constants.hpp"
+#include "punkt/utils/utils.hpp"
+#include "punkt/utils/int_types.hpp"
+#include "punkt/layout/x_opt_profile.hpp"
+
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace punkt;
+using namespace punkt::layout;
+
+using LegalizerSettings = XOptPipelineStageSettings::LegalizerSettings;
+
+static std::string_view trim(std::string_view sv) {
+    constexpr std::string_view whitespace = " \t\r\n";
+    const size_t start = sv.find_first_not_of(whitespace);
+    if (start == std::string_view::npos) {
+        return {};
+    }
+    return sv.substr(start, sv.find_last_not_of(whitespace) - start + 1);
+}
+
+static ssize_t stringViewToSSizeT(const std::string_view &sv, const std::string_view &key) {
+    ssize_t result = 0;
+    if (auto [ptr, ec] = std::from_chars(sv.data(), sv.data() + sv.size(), result);
+        ec != std::errc() || ptr != sv.data() + sv.size()) {
+        throw IllegalAttributeException(std::string(key), std::string(sv));
+    }
+    return result;
+}
+
+static bool stringViewToBool(const std::string_view &sv, const std::string_view &key) {
+    if (caseInsensitiveEquals(sv, "true")) {
+        return true;
+    }
+    if (caseInsensitiveEquals(sv, "false")) {
+        return false;
+    }
+    throw IllegalAttributeException(std::string(key), std::string(sv));
+}
+
+// settings of a `[stage]` before its keys are applied
+static XOptPipelineStageSettings getDefaultStage() {
+    return XOptPipelineStageSettings{
+        1, 1, 1.0f, 1.0f, 0.0f, 1.0f, SweepMode::normal,
+        LegalizerSettings{
+            LegalizerSettings::LegalizationTiming::after_iteration, LegalizerSettings::LegalizerSpecialInstruction{},
+            false
+        },
+        {
+            XOptPipelineStageSettings::SweepSettings{false, false},
+            XOptPipelineStageSettings::SweepSettings{true, false},
+        }
+    };
+}
+
+// parses a whitespace separated list like "up-group up down@1"
+static std::vector<XOptPipelineStageSettings::SweepSettings> parseSweeps(const std::string_view &value,
+                                                                          const std::string_view &key) {
+    std::vector<XOptPipelineStageSettings::SweepSettings> sweeps;
+    std::istringstream ss{std::string(value)};
+    std::string token_str;
+    while (ss >> token_str) {
+        std::string_view token = token_str;
+        ssize_t n_ranks_limit = -1;
+        if (const size_t at = token.find('@'); at != std::string_view::npos) {
+            n_ranks_limit = stringViewToSSizeT(token.substr(at + 1), key);
+            token = token.substr(0, at);
+        }
+        bool is_group_sweep = false;
+        if (constexpr std::string_view group_suffix = "-group"; token.ends_with(group_suffix)) {
+            is_group_sweep = true;
+            token.remove_suffix(group_suffix.size());
+        }
+        bool is_downward_sweep;
+        if (caseInsensitiveEquals(token, "up")) {
+            is_downward_sweep = false;
+        } else if (caseInsensitiveEquals(token, "down")) {
+            is_downward_sweep = true;
+        } else {
+            throw IllegalAttributeException(std::string(key), std::string(value));
+        }
+        sweeps.emplace_back(is_downward_sweep, is_group_sweep, n_ranks_limit);
+    }
+    if (sweeps.empty()) {
+        throw IllegalAttributeException(std::string(key), std::string(value));
+    }
+    return sweeps;
+}
+
+static void parseStageKey(XOptPipelineStageSettings &stage, const std::string_view &key,
+                          const std::string_view &value) {
+    if (key == "repeats") {
+        stage.m_repeats = stringViewToSizeT(value, key);
+    } else if (key == "max_iters") {
+        stage.m_max_iters = stringViewToSSizeT(value, key);
+    } else if (key == "initial_dampening") {
+        stage.m_initial_dampening = stringViewToFloat(value, key);
+    } else if (key == "dampening_fadeout") {
+        stage.m_dampening_fadeout = stringViewToFloat(value, key);
+    } else if (key == "pull_towards_mean") {
+        stage.m_pull_towards_mean = stringViewToFloat(value, key);
+    } else if (key == "regularization") {
+        stage.m_regularization = stringViewToFloat(value, key);
+    } else if (key == "sweep_mode") {
+        if (caseInsensitiveEquals(value, "normal")) {
+            stage.m_sweep_mode = SweepMode::normal;
+        } else if (caseInsensitiveEquals(value, "outer_loop")) {
+            stage.m_sweep_mode = SweepMode::sweep_direction_is_outer_loop;
+        } else if (caseInsensitiveEquals(value, "innermost_loop")) {
+            stage.m_sweep_mode = SweepMode::sweep_direction_is_innermost_loop;
+        } else {
+            throw IllegalAttributeException(std::string(key), std::string(value));
+        }
+    } else if (key == "legalization") {
+        using LegalizationTiming = LegalizerSettings::LegalizationTiming;
+        LegalizationTiming &timing = stage.m_legalizer_settings.m_legalization_timing;
+        if (caseInsensitiveEquals(value, "none")) {
+            timing = LegalizationTiming::none;
+        } else if (caseInsensitiveEquals(value, "after_stage")) {
+            timing = LegalizationTiming::after_pipeline_stage;
+        } else if (caseInsensitiveEquals(value, "after_iteration")) {
+            timing = LegalizationTiming::after_iteration;
+        } else if (caseInsensitiveEquals(value, "in_operator")) {
+            timing = LegalizationTiming::in_barycenter_operator;
+        } else {
+            throw IllegalAttributeException(std::string(key), std::string(value));
+        }
+    } else if (key == "legalizer") {
+        if (caseInsensitiveEquals(value, "isotonic")) {
+            stage.m_legalizer_settings.m_algorithm = LegalizerSettings::Algorithm::isotonic_regression;
+        } else if (caseInsensitiveEquals(value, "sweeps")) {
+            stage.m_legalizer_settings.m_algorithm = LegalizerSettings::Algorithm::outward_sweeps;
+        } else {
+            throw IllegalAttributeException(std::string(key), std::string(value));
+        }
+    } else if (key == "explode_node_sep") {
+        stage.m_legalizer_settings.m_legalizer_special_instruction =
+                LegalizerSettings::LegalizerSpecialInstruction::getExplodeInterGroupNodeSep(
+                    stringViewToFloat(value, key));
+    } else if (key == "cancel_mean_shift") {
+        stage.m_legalizer_settings.m_try_cancel_mean_shift = stringViewToBool(value, key);
+    } else if (key == "sweeps") {
+        stage.m_sweep_settings = parseSweeps(value, key);
+    } else {
+        throw IllegalAttributeException(std::string(key), std::string(value));
+    }
+}
+
+static void parseGlobalKey(XOptProfile &profile, const std::string_view &key, const std::string_view &value) {
+    if (key == "tolerance") {
+        profile.m_convergence_tolerance = stringViewToFloat(value, key);
+    } else if (key == "barycenter_ordering_max_iters") {
+        profile.m_barycenter_ordering_max_iters = stringViewToSSizeT(value, key);
+    } else if (key == "bubble_ordering_max_iters") {
+        profile.m_bubble_ordering_max_iters = stringViewToSSizeT(value, key);
+    } else if (key == "budget_full_size") {
+        profile.m_budget_full_size = stringViewToSizeT(value, key);
+    } else {
+        throw IllegalAttributeException(std::string(key), std::string(value));
+    }
+}
+
+// parses one (comment stripped, trimmed, non-empty) line of a profile
+static void parseProfileLine(XOptProfile &profile, const std::string_view line) {
+    if (line == "[stage]") {
+        if (!profile.m_pipeline) {
+            profile.m_pipeline.emplace();
+        }
+        profile.m_pipeline->push_back(getDefaultStage());
+        return;
+    }
+    const size_t eq = line.find('=');
+    if (eq == std::string_view::npos) {
+        throw IllegalAttributeException("profile", std::string(line));
+    }
+    const std::string_view key = trim(line.substr(0, eq)), value = trim(line.substr(eq + 1));
+    if (profile.m_pipeline) {
+        parseStageKey(profile.m_pipeline->back(), key, value);
+    } else {
+        parseGlobalKey(profile, key, value);
+    }
+}
+
+XOptProfile layout::parseXOptProfile(const std::string_view source) {
+    XOptProfile profile;
+    size_t line_start = 0, line_number = 1;
+    while (line_start <= source.size()) {
+        size_t line_end = source.find_first_of(";\n", line_start);
+        if (line_end == std::string_view::npos) {
+            line_end = source.size();
+        }
+        std::string_view line = source.substr(line_start, line_end - line_start);
+        line_start = line_end + 1;
+
+        if (const size_t comment_start = line.find('#'); comment_start != std::string_view::npos) {
+            line = line.substr(0, comment_start);
+        }
+        line = trim(line);
+        if (line.empty()) {
+            continue;
+        }
+        // only the line number is reported, the profile may be a file the error message must not leak
+        try {
+            parseProfileLine(profile, line);
+        } catch (...) {
+            throw IllegalAttributeException("profile", "line " + std::to_string(line_number));
+        }
+    }
+    return profile;
+}
+
+XOptProfile layout::loadXOptProfileFile(const std::string &path) {
+    // a FIFO would block the open and a device could be read forever, so only regular files of bounded size qualify
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(path, ec) ||
+        std::filesystem::file_size(path, ec) > MAX_X_OPT_PROFILE_FILE_BYTES || ec) {
+        throw IllegalAttributeException("profile", path);
+    }
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw IllegalAttributeException("profile", path);
+    }
+    // the file may have grown since it was checked
+    std::string source(MAX_X_OPT_PROFILE_FILE_BYTES + 1, '\0');
+    file.read(source.data(), static_cast<std::streamsize>(source.size()));
+    if (file.bad() || static_cast<size_t>(file.gcount()) > MAX_X_OPT_PROFILE_FILE_BYTES) {
+        throw IllegalAttributeException("profile", path);
+    }
+    source.resize(static_cast<size_t>(file.gcount()));
+    return parseXOptProfile(source);
+}
+
+void layout::applyXOptProfile(const XOptProfile &profile) {
+    if (profile.m_pipeline) {
+        BARYCENTER_X_OPTIMIZATION_PIPELINE = *profile.m_pipeline;
+    }
+    if (profile.m_barycenter_ordering_max_iters) {
+        BARYCENTER_ORDERING_MAX_ITERS_PER_DIRECTION = *profile.m_barycenter_ordering_max_iters;
+    }
+    if (profile.m_bubble_ordering_max_iters) {
+        BUBBLE_ORDERING_MAX_ITERS = *profile.m_bubble_ordering_max_iters;
+    }
+    if (profile.m_convergence_tolerance) {
+        BARYCENTER_X_OPTIMIZATION_CONVERGENCE_TOLERANCE = *profile.m_convergence_tolerance;
+    }
+    if (profile.m_budget_full_size) {
+        ITERATION_BUDGET_FULL_SIZE = *profile.m_budget_full_size;
+    }
+}
+
+ssize_t layout::scaleIterationBudget(const ssize_t max_iters, const size_t graph_size) {
+    if (max_iters <= 0 || ITERATION_BUDGET_FULL_SIZE == 0 || graph_size <= ITERATION_BUDGET_FULL_SIZE) {
+        return max_iters;
+    }
+    // rounded up, so every stage keeps at least one iteration
+    const size_t scaled = (static_cast<size_t>(max_iters) * ITERATION_BUDGET_FULL_SIZE + graph_size - 1) / graph_size;
+    return static_cast<ssize_t>(scaled);
+}
+
+size_t layout::getIterationBudgetGraphSize(const Digraph &dg) {
+    size_t n_edges = 0;
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        n_edges += node.m_outgoing.size();
+    }
+    return dg.m_nodes.size() + n_edges;
+}
+
+XOptProfile layout::getGraphXOptProfile(const Digraph &dg) {
+    constexpr std::string_view punkt_x_opt_pipeline_attr_name = "punktxoptpipeline";
+    if (!dg.m_attrs.contains(punkt_x_opt_pipeline_attr_name)) {
+        return {};
+    }
+    XOptProfile profile = parseXOptProfile(dg.m_attrs.at(punkt_x_opt_pipeline_attr_name));
+    // the global knobs are process wide, a graph cannot change them
+    if (profile.m_barycenter_ordering_max_iters || profile.m_bubble_ordering_max_iters || profile.m_budget_full_size) {
+        throw IllegalAttributeException(std::string(punkt_x_opt_pipeline_attr_name),
+                                        std::string(dg.m_attrs.at(punkt_x_opt_pipeline_attr_name)));
+    }
+    return profile;
+}
+
+std::vector<XOptPipelineStageSettings> layout::getEffectiveXOptPipeline(const Digraph &dg,
+                                                                        const XOptProfile &graph_profile) {
+    std::vector<XOptPipelineStageSettings> pipeline = graph_profile.m_pipeline
+                                                          ? *graph_profile.m_pipeline
+                                                          : BARYCENTER_X_OPTIMIZATION_PIPELINE;
+    const size_t graph_size = getIterationBudgetGraphSize(dg);
+    for (XOptPipelineStageSettings &pss: pipeline) {
+        pss.m_max_iters = scaleIterationBudget(pss.m_max_iters, graph_size);
+    }
+    return pipeline;
+}
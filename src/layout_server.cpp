@@ -0,0 +1,326 @@
+#include "punkt/layout_server.hpp"
+#include "punkt/dot.hpp"
+#include "punkt/layout_export.hpp"
+#include "punkt/snapshot.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PUNKT_HAS_UNIX_SOCKETS
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace punkt;
+
+using Clock = std::chrono::steady_clock;
+
+// frames larger than this are treated as a protocol error
+constexpr size_t max_layout_server_frame_size = 256 * 1024 * 1024;
+// how often run() checks whether it was stopped
+constexpr int layout_server_accept_poll_ms = 100;
+
+#ifdef MSG_NOSIGNAL
+constexpr int layout_server_send_flags = MSG_NOSIGNAL;
+#else
+constexpr int layout_server_send_flags = 0;
+#endif
+
+LayoutServerException::LayoutServerException(std::string msg)
+    : m_msg(std::move(msg)) {
+}
+
+const char *LayoutServerException::what() const noexcept {
+    return m_msg.c_str();
+}
+
+struct LayoutServer::Connection {
+    int m_fd;
+    // responses of concurrently finishing requests must not interleave
+    std::mutex m_write_mutex;
+    std::thread m_reader;
+    std::atomic<bool> m_is_done{};
+
+    explicit Connection(const int fd)
+        : m_fd(fd) {
+    }
+
+    Connection(const Connection &) = delete;
+
+    Connection &operator=(const Connection &) = delete;
+
+    ~Connection() {
+#ifdef PUNKT_HAS_UNIX_SOCKETS
+        close(m_fd);
+#endif
+    }
+
+    // reads exactly `size` bytes, false if the peer hung up
+    [[nodiscard]] bool readExactly(char *out, size_t size) const {
+#ifdef PUNKT_HAS_UNIX_SOCKETS
+        while (size > 0) {
+            const ssize_t n = recv(m_fd, out, size, 0);
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            out += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // discards `size` bytes, false if the peer hung up
+    [[nodiscard]] bool skipExactly(size_t size) const {
+        std::array<char, 64 * 1024> buffer{};
+        while (size > 0) {
+            const size_t n = std::min(size, buffer.size());
+            if (!readExactly(buffer.data(), n)) {
+                return false;
+            }
+            size -= n;
+        }
+        return true;
+    }
+
+    // a failed write means the client went away, which the reader notices on its own
+    void writeFrame(const uint32_t request_id, const LayoutServerStatus status, const std::string_view body) {
+        const auto payload_size = static_cast<uint32_t>(sizeof(uint32_t) + sizeof(uint8_t) + body.size());
+        std::string frame;
+        frame.reserve(sizeof(uint32_t) + payload_size);
+        for (const uint32_t value: {payload_size, request_id}) {
+            for (size_t i = 0; i < sizeof(uint32_t); i++) {
+                frame.push_back(static_cast<char>(value >> (8 * i) & 0xff));
+            }
+        }
+        frame.push_back(static_cast<char>(status));
+        frame.append(body);
+
+        std::lock_guard lock(m_write_mutex);
+#ifdef PUNKT_HAS_UNIX_SOCKETS
+        std::string_view remaining = frame;
+        while (!remaining.empty()) {
+            const ssize_t n = send(m_fd, remaining.data(), remaining.size(), layout_server_send_flags);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return;
+            }
+            remaining.remove_prefix(static_cast<size_t>(n));
+        }
+#endif
+    }
+};
+
+static uint32_t decodeUint32(const std::array<char, sizeof(uint32_t)> &bytes) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < sizeof(uint32_t); i++) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(bytes[i])) << (8 * i);
+    }
+    return value;
+}
+
+LayoutServer::LayoutServer(LayoutServerConfig config, render::glyph::GlyphLoader &glyph_loader)
+    : m_config(std::move(config)), m_glyph_loader(glyph_loader), m_pool(m_config.m_n_threads) {
+#ifdef PUNKT_HAS_UNIX_SOCKETS
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const std::string socket_path = m_config.m_socket_path.string();
+    if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+        throw LayoutServerException("Invalid socket path \"" + socket_path + "\"");
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    m_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_listen_fd < 0) {
+        throw LayoutServerException("Cannot create a socket");
+    }
+    // a socket file left behind by a previous server that was killed
+    unlink(socket_path.c_str());
+    if (bind(m_listen_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0
+        || listen(m_listen_fd, SOMAXCONN) != 0) {
+        close(m_listen_fd);
+        throw LayoutServerException("Cannot listen on \"" + socket_path + "\"");
+    }
+#else
+    throw LayoutServerException("Unix domain sockets are not supported on this platform");
+#endif
+}
+
+LayoutServer::~LayoutServer() {
+    stop();
+    joinFinishedConnections(true);
+#ifdef PUNKT_HAS_UNIX_SOCKETS
+    close(m_listen_fd);
+    unlink(m_config.m_socket_path.c_str());
+#endif
+}
+
+void LayoutServer::run() {
+#ifdef PUNKT_HAS_UNIX_SOCKETS
+    while (!m_is_stopping) {
+        pollfd listen_poll{m_listen_fd, POLLIN, 0};
+        if (poll(&listen_poll, 1, layout_server_accept_poll_ms) <= 0) {
+            continue;
+        }
+        const int fd = accept(m_listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        joinFinishedConnections(false);
+        auto connection = std::make_shared<Connection>(fd);
+        std::lock_guard lock(m_mutex);
+        m_connections.push_back(connection);
+        connection->m_reader = std::thread(&LayoutServer::serveConnection, this, connection);
+    }
+#endif
+}
+
+void LayoutServer::stop() {
+    {
+        // under the lock, so a reader cannot miss it between checking and starting to wait
+        std::lock_guard lock(m_mutex);
+        m_is_stopping = true;
+    }
+    m_request_finished.notify_all();
+}
+
+size_t LayoutServer::getNumServedRequests() const {
+    return m_n_served_requests;
+}
+
+void LayoutServer::joinFinishedConnections(const bool join_all) {
+    std::vector<std::shared_ptr<Connection> > finished;
+    {
+        std::lock_guard lock(m_mutex);
+        const auto [first, last] = std::ranges::partition(m_connections, [&](const auto &connection) {
+            return !join_all && !connection->m_is_done;
+        });
+        finished.assign(std::make_move_iterator(first), std::make_move_iterator(last));
+        m_connections.erase(first, last);
+    }
+    for (const std::shared_ptr<Connection> &connection: finished) {
+#ifdef PUNKT_HAS_UNIX_SOCKETS
+        // wakes up the reader if it is still waiting for a request
+        shutdown(connection->m_fd, SHUT_RD);
+#endif
+        connection->m_reader.join();
+    }
+}
+
+void LayoutServer::serveConnection(const std::shared_ptr<Connection> &connection) {
+    while (!m_is_stopping) {
+        std::array<char, sizeof(uint32_t)> size_bytes{}, id_bytes{};
+        uint8_t format{};
+        if (!connection->readExactly(size_bytes.data(), size_bytes.size())) {
+            break;
+        }
+        const uint32_t payload_size = decodeUint32(size_bytes);
+        if (payload_size < id_bytes.size() + sizeof(format) || payload_size > max_layout_server_frame_size
+            || !connection->readExactly(id_bytes.data(), id_bytes.size())
+            || !connection->readExactly(reinterpret_cast<char *>(&format), sizeof(format))) {
+            break;
+        }
+        const uint32_t request_id = decodeUint32(id_bytes);
+        const size_t source_size = payload_size - id_bytes.size() - sizeof(format);
+        if (m_config.m_max_request_bytes > 0 && source_size > m_config.m_max_request_bytes) {
+            if (!connection->skipExactly(source_size)) {
+                break;
+            }
+            connection->writeFrame(request_id, LayoutServerStatus::error, "Graph too large");
+            continue;
+        }
+        std::string source(source_size, '\0');
+        if (!connection->readExactly(source.data(), source.size())) {
+            break;
+        }
+        const Clock::time_point deadline = m_config.m_request_timeout.count() > 0
+                                               ? Clock::now() + m_config.m_request_timeout
+                                               : Clock::time_point::max();
+
+        // stop reading (and let the socket buffer fill up) while the workers are saturated
+        {
+            std::unique_lock lock(m_mutex);
+            m_request_finished.wait(lock, [this] {
+                return m_is_stopping || m_n_pending_requests < std::max<size_t>(m_config.m_max_pending_requests, 1);
+            });
+            if (m_is_stopping) {
+                break;
+            }
+            m_n_pending_requests++;
+        }
+        m_pool.submit([this, connection, request_id, format, source = std::move(source), deadline]() mutable {
+            processRequest(connection, request_id, format, std::move(source), deadline);
+            {
+                std::lock_guard lock(m_mutex);
+                m_n_pending_requests--;
+            }
+            m_request_finished.notify_all();
+        });
+    }
+    connection->m_is_done = true;
+}
+
+void LayoutServer::processRequest(const std::shared_ptr<Connection> &connection, const uint32_t request_id,
+                                  const uint8_t format, std::string source, const Clock::time_point deadline) {
+    if (format != static_cast<uint8_t>(LayoutServerFormat::snapshot)
+        && format != static_cast<uint8_t>(LayoutServerFormat::json)) {
+        connection->writeFrame(request_id, LayoutServerStatus::error, "Unknown format");
+        return;
+    }
+    if (Clock::now() >= deadline) {
+        connection->writeFrame(request_id, LayoutServerStatus::timeout, "Timed out in the queue");
+        return;
+    }
+
+    std::string body;
+    try {
+        Digraph dg{std::move(source)};
+        // the time left is the layout time budget, unless the graph sets its own
+        std::string time_budget;
+        if (constexpr std::string_view punkt_time_budget_attr_name = "punkttimebudget";
+            deadline != Clock::time_point::max() && !dg.m_attrs.contains(punkt_time_budget_attr_name)) {
+            const auto remaining = std::max(deadline - Clock::now(), Clock::duration::zero());
+            time_budget = std::to_string(std::chrono::duration<float, std::milli>(remaining).count()) + "ms";
+            dg.m_attrs.emplace(punkt_time_budget_attr_name, time_budget);
+        }
+        dg.preprocess(m_glyph_loader);
+        if (format == static_cast<uint8_t>(LayoutServerFormat::json)) {
+            std::ostringstream json;
+            render::writeLayoutJson(dg, json);
+            body = std::move(json).str();
+        } else {
+            body = render::serializeSnapshot(dg, m_glyph_loader);
+        }
+    } catch (const std::exception &e) {
+        connection->writeFrame(request_id, LayoutServerStatus::error, e.what());
+        return;
+    } catch (...) {
+        connection->writeFrame(request_id, LayoutServerStatus::error, "Invalid graph");
+        return;
+    }
+    if (Clock::now() >= deadline) {
+        connection->writeFrame(request_id, LayoutServerStatus::timeout, "Timed out during layout");
+        return;
+    }
+    connection->writeFrame(request_id, LayoutServerStatus::ok, body);
+    m_n_served_requests++;
+}
@@ -3,6 +3,7 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <string_view>
 
 class FileNotFoundException final : std::exception {
     const std::string m_path;
@@ -52,10 +53,54 @@ static void runTestMode() {
     punktRun(test_input.data(), font_path);
 }
 
+static int runGraphFile(const char *path, const bool watch) {
+    const auto font_path = "resources/fonts/tinyfont.psf";
+    if (std::string_view(path).ends_with(".punktsnap")) {
+        punktRunSnapshot(path, font_path);
+        return 0;
+    }
+    if (watch) {
+        try {
+            punktRunWatched(path, font_path);
+        } catch (const std::exception &e) {
+            std::cerr << "Error: " << e.what();
+        }
+        return 0;
+    }
+    std::string test_input;
+    try {
+        test_input = readInputFile(path);
+    } catch (const FileNotFoundException &e) {
+        std::cerr << "Error: " << e.what();
+        return 1;
+    }
+    try {
+        punktRun(test_input.data(), font_path);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what();
+    }
+    return 0;
+}
+
 static void printHelp() {
     std::cout << "punkt - A tiny clone of dot from graphviz" << std::endl << std::endl << "Usage:" << std::endl <<
             "punkt file/path.dot" << std::endl << std::endl << "Additional flags:" << std::endl <<
-            "\t--help\tShow this message" << std::endl << "\t-h\tShow this message";
+            "\t--help\tShow this message" << std::endl << "\t-h\tShow this message" << std::endl <<
+            "\t--profile profile/path graph/path.dot\tLoad layout tuning knobs from a profile file first" <<
+            std::endl <<
+            "\t--layout-cache cache/dir graph/path.dot\tReuse layouts of unchanged graphs from a cache directory" <<
+            std::endl << "\t--watch graph/path.dot\tFollow changes to the graph file without restarting" << std::endl <<
+            "\t--convert snapshot/path.punktsnap graph/path.dot\tLay out the graph and save it as a binary snapshot "
+            "instead of showing it" << std::endl <<
+            "\t--batch output/dir graph/paths.dot... or graph/dirs...\tLay out many graphs concurrently and save them "
+            "as snapshots in the output directory" << std::endl <<
+            "\t-Tplain, -Tjson, -Tsvg\tLay out the graph and write it in graphviz -Tplain format, as JSON or as an SVG "
+            "drawing instead of showing it" << std::endl << "\t-o output/path\tWhere -T writes to (default: stdout)" << std::endl <<
+            "\t--serve socket/path\tRun a layout server on a Unix domain socket until killed (protocol: see "
+            "punkt/layout_server.hpp)" << std::endl <<
+            "\t--threads N\tNumber of threads for --batch and --serve (default: one per hardware thread)" <<
+            std::endl << "\t--timeout MS\tPer request timeout of --serve (default: none)" << std::endl <<
+            "\tpunkt snapshot/path.punktsnap\tShow a snapshot";
 }
 
 int main(int argc, char **argv) {
@@ -67,23 +112,71 @@ int main(int argc, char **argv) {
         } else if (arg == "--help" || arg == "-h") {
             printHelp();
         } else {
-            const char *path = argv[1];
-            std::string test_input;
-            try {
-                test_input = readInputFile(path);
-            } catch (const FileNotFoundException &e) {
-                std::cerr << "Error: " << e.what();
+            return runGraphFile(argv[1], false);
+        }
+    } else {
+        // flags and options with a value, followed by the graph path(s)
+        bool watch = false;
+        const char *snapshot_path = nullptr;
+        const char *batch_output_dir = nullptr;
+        const char *server_socket_path = nullptr;
+        const char *export_format = nullptr, *export_path = nullptr;
+        size_t n_threads = 0, request_timeout_ms = 0;
+        int i = 1;
+        for (; i < argc && std::string_view(argv[i]).starts_with("-"); i++) {
+            if (const std::string_view arg = argv[i]; arg == "--watch") {
+                watch = true;
+            } else if (arg.starts_with("-T")) {
+                export_format = argv[i] + 2;
+            } else if (i + 1 >= argc) {
+                std::cerr << "Expected [--option value]... {graph_file_path}, see --help";
+                return 1;
+            } else if (arg == "--profile") {
+                if (punktLoadProfile(argv[++i]) != 0) {
+                    return 1;
+                }
+            } else if (arg == "--layout-cache") {
+                punktSetLayoutCacheDirectory(argv[++i]);
+            } else if (arg == "--convert") {
+                snapshot_path = argv[++i];
+            } else if (arg == "--batch") {
+                batch_output_dir = argv[++i];
+            } else if (arg == "-o") {
+                export_path = argv[++i];
+            } else if (arg == "--serve") {
+                server_socket_path = argv[++i];
+            } else if (arg == "--threads" || arg == "--timeout") {
+                size_t &value = arg == "--threads" ? n_threads : request_timeout_ms;
+                try {
+                    value = std::stoul(argv[++i]);
+                } catch (...) {
+                    std::cerr << "Invalid value for " << arg << ": " << argv[i];
+                    return 1;
+                }
+            } else {
+                std::cerr << "Unknown option: " << arg;
                 return 1;
-            }
-            try {
-                const auto font_path = "resources/fonts/tinyfont.psf";
-                punktRun(test_input.data(), font_path);
-            } catch (const std::exception &e) {
-                std::cerr << "Error: " << e.what();
             }
         }
-    } else {
-        std::cerr << "Takes at most 1 argument: {graph_file_path}";
+        const int n_graph_paths = argc - i;
+        if (server_socket_path && n_graph_paths == 0) {
+            return punktServe(server_socket_path, "resources/fonts/tinyfont.psf", n_threads, request_timeout_ms);
+        }
+        if (batch_output_dir && n_graph_paths >= 1) {
+            return punktRunBatch(argv + i, n_graph_paths, batch_output_dir, "resources/fonts/tinyfont.psf",
+                                 n_threads);
+        }
+        if (n_graph_paths != 1) {
+            std::cerr << "Expected [--option value]... {graph_file_path}, see --help";
+            return 1;
+        }
+        if (export_format) {
+            return punktExportLayout(argv[i], export_path, export_format, "resources/fonts/tinyfont.psf");
+        }
+        if (snapshot_path) {
+            return punktConvertToSnapshot(argv[i], snapshot_path, "resources/fonts/tinyfont.psf");
+        }
+        return runGraphFile(argv[i], watch);
     }
 }
 
@@ -100,10 +100,77 @@ static bool nextTokenIs(const std::span<tokenizer::Token> &tokens, const tokeniz
     return tok.m_type == type && (!value.has_value() || value.value() == tok.m_value);
 }
 
+// once a graph has been laid out, update() records what it changes in dg.m_dirty_region for Digraph::relayout
+static bool isTrackingChanges(const Digraph &dg) {
+    return !dg.m_per_rank_orderings.empty();
+}
+
+static void markRequiresFullLayout(Digraph &dg) {
+    if (isTrackingChanges(dg)) {
+        dg.m_dirty_region.m_requires_full_layout = true;
+    }
+}
+
+static void insertLinkNode(Digraph &dg, const std::string_view name, const std::string_view link) {
+    Attrs link_attrs{{"@link", link}, {"@type", "link"}};
+    dg.m_nodes.insert_or_assign(name, Node{name, std::move(link_attrs)});
+}
+
+// Cross-graph references are resolved lazily, so link nodes only exist for names that are actually referenced (instead
+// of every cluster holding a link to every node of its parent).
+
+// If `name` is owned by a cluster of dg (other than `exclude`), inserts a @link=cluster_N node for it into dg, and into
+// the clusters in between if it is owned by a nested cluster.
+static bool linkToCluster(Digraph &dg, const std::string_view name, const Digraph *exclude) {
+    const auto owner = dg.m_cluster_node_owners.find(name);
+    if (owner == dg.m_cluster_node_owners.end()) {
+        return false;
+    }
+    Digraph &cluster_dg = dg.m_clusters.at(owner->second);
+    if (&cluster_dg == exclude) {
+        return false;
+    }
+    if (!cluster_dg.m_nodes.contains(name)) {
+        linkToCluster(cluster_dg, name, nullptr);
+    }
+    const std::string &link = dg.m_referenced_sources.emplace_front(
+        "cluster_" + std::to_string(dg.m_cluster_order.at(owner->second)));
+    insertLinkNode(dg, name, link);
+    return true;
+}
+
+// If an enclosing graph knows `name`, inserts a @link=parent node for it into dg (and the graphs in between).
+static bool linkToParent(Digraph &dg, const std::string_view name) {
+    Digraph *parent = dg.m_parent;
+    if (!parent) {
+        return false;
+    }
+    if (!parent->m_nodes.contains(name) && !linkToCluster(*parent, name, &dg) && !linkToParent(*parent, name)) {
+        return false;
+    }
+    insertLinkNode(dg, name, "parent");
+    return true;
+}
+
 static void implicitCreateNodeIfNotExists(Digraph &dg, const std::string_view name, const Attrs &attrs) {
-    if (!dg.m_nodes.contains(name)) {
+    if (!dg.m_nodes.contains(name) && !linkToParent(dg, name) && !linkToCluster(dg, name, nullptr)) {
         dg.m_nodes.insert_or_assign(name, Node(name, attrs));
+        if (isTrackingChanges(dg)) {
+            dg.m_dirty_region.m_added_nodes.insert(name);
+        }
+    }
+}
+
+// declaring a node replaces it, which only the full layout can handle for nodes that are already laid out
+static void declareNode(Digraph &dg, const std::string_view name, Attrs attrs) {
+    if (isTrackingChanges(dg)) {
+        if (!dg.m_nodes.contains(name)) {
+            dg.m_dirty_region.m_added_nodes.insert(name);
+        } else if (!dg.m_dirty_region.m_added_nodes.contains(name)) {
+            dg.m_dirty_region.m_requires_full_layout = true;
+        }
     }
+    dg.m_nodes.insert_or_assign(name, Node(name, std::move(attrs)));
 }
 
 static Attrs consumeAttrs(std::span<tokenizer::Token> &tokens) {
@@ -174,6 +241,7 @@ static void consumeStatementAndUpdateDigraph(Digraph &dg, std::span<tokenizer::T
             mergeAttrsInto(dg.m_default_edge_attrs, new_attrs);
             dg.m_default_edge_attrs = std::move(new_attrs);
         } else if (kwd == KWD_GRAPH) {
+            markRequiresFullLayout(dg);
             Attrs new_attrs = consumeAttrs(tokens);
             mergeAttrsInto(dg.m_attrs, new_attrs);
             dg.m_attrs = std::move(new_attrs);
@@ -192,6 +260,7 @@ static void consumeStatementAndUpdateDigraph(Digraph &dg, std::span<tokenizer::T
         }
     } else if (a.m_type == tokenizer::Token::Type::lcurly) {
         // constraint, e.g. `{ rank=min; A B C; }`
+        markRequiresFullLayout(dg);
         expectAndConsume(tokens, tokenizer::Token::Type::string, "rank");
         expectAndConsume(tokens, tokenizer::Token::Type::equals);
         const tokenizer::Token ty = expectAndConsume(tokens, tokenizer::Token::Type::string);
@@ -269,10 +338,16 @@ static void consumeStatementAndUpdateDigraph(Digraph &dg, std::span<tokenizer::T
 
         // insert edges
         for (Edge &e: new_edges) {
-            dg.m_nodes.at(e.m_source).m_outgoing.emplace_back(std::move(e));
+            const std::string_view source = e.m_source;
+            std::vector<Edge> &outgoing = dg.m_nodes.at(source).m_outgoing;
+            outgoing.emplace_back(std::move(e));
+            if (isTrackingChanges(dg)) {
+                dg.m_dirty_region.m_added_edges.emplace_back(source, outgoing.size() - 1);
+            }
         }
     } else if (nextTokenIs(tokens, tokenizer::Token::Type::equals)) {
         // handle graph attribute
+        markRequiresFullLayout(dg);
         expectAndConsume(tokens, tokenizer::Token::Type::equals);
         auto v = expectAndConsume(tokens, tokenizer::Token::Type::string);
         dg.m_attrs.insert_or_assign(a.m_value, v.m_value);
@@ -284,7 +359,7 @@ static void consumeStatementAndUpdateDigraph(Digraph &dg, std::span<tokenizer::T
         // handle defaults set by `node [...];`
         mergeAttrsInto(dg.m_default_node_attrs, attrs);
 
-        dg.m_nodes.insert_or_assign(a.m_value, Node(a.m_value, attrs));
+        declareNode(dg, a.m_value, std::move(attrs));
     }
 
     // every statement should end with a semicolon (we don't crash if it doesn't though)
@@ -355,27 +430,20 @@ static bool containsClusterTrueAttr(const std::span<tokenizer::Token> tokens) {
     return false;
 }
 
-static void leakParentNodesInto(Digraph &cluster_dg, const Digraph &dg) {
-    for (const Node &node: std::views::values(dg.m_nodes)) {
-        if (cluster_dg.m_nodes.contains(node.m_name)) {
-            continue;
+// makes the nodes of a freshly parsed cluster resolvable from dg, see linkToCluster
+static void registerClusterNodes(Digraph &dg, const Digraph &cluster_dg) {
+    const auto registerNode = [&](const std::string_view name) {
+        if (!dg.m_nodes.contains(name)) {
+            dg.m_cluster_node_owners.try_emplace(name, cluster_dg.m_name);
         }
-        Attrs leaked_attrs{{"@link", "parent"}, {"@type", "link"}};
-        Node leaked_node{node.m_name, std::move(leaked_attrs)};
-        cluster_dg.m_nodes.insert_or_assign(node.m_name, std::move(leaked_node));
-    }
-}
-
-static void leakClusterNodesInto(Digraph &dg, const Digraph &cluster_dg) {
+    };
     for (const Node &cluster_node: std::views::values(cluster_dg.m_nodes)) {
-        if (dg.m_nodes.contains(cluster_node.m_name)) {
-            continue;
+        if (getAttrOrDefault(cluster_node.m_attrs, "@link", "") != "parent") {
+            registerNode(cluster_node.m_name);
         }
-        Attrs leaked_attrs{
-            {"@link", "cluster_" + std::to_string(dg.m_cluster_order.at(cluster_dg.m_name))}, {"@type", "link"}
-        };
-        Node leaked_node{cluster_node.m_name, std::move(leaked_attrs)};
-        dg.m_nodes.insert_or_assign(cluster_node.m_name, std::move(leaked_node));
+    }
+    for (const std::string_view name: std::views::keys(cluster_dg.m_cluster_node_owners)) {
+        registerNode(name);
     }
 }
 
@@ -392,8 +460,9 @@ static std::string_view consumeGraphSourceAndUpdateDigraph(Digraph &dg, std::spa
     }
     expectAndConsume(tokens, tokenizer::Token::Type::lcurly);
 
-    // check if it is a cluster
-    if (name.starts_with("cluster_") || containsClusterTrueAttr(tokens)) {
+    // check if it is a cluster (that is not the one currently being parsed, which re-parses its own header)
+    if ((name.starts_with("cluster_") || containsClusterTrueAttr(tokens)) && !(dg.m_parent && dg.m_name == name)) {
+        markRequiresFullLayout(dg);
         Digraph *cluster_dg;
         if (dg.m_clusters.contains(name)) {
             cluster_dg = &dg.m_clusters[name];
@@ -403,9 +472,12 @@ static std::string_view consumeGraphSourceAndUpdateDigraph(Digraph &dg, std::spa
             cluster_dg = &dg.m_clusters[name];
         }
         tokens = og_tokens;
-        leakParentNodesInto(*cluster_dg, dg);
+        // lets the cluster resolve references to nodes of its ancestors while it is parsed (the parent may have moved
+        // since a previous parse of the same cluster)
+        cluster_dg->m_parent = &dg;
+        cluster_dg->m_name = name;
         cluster_dg->constructFromTokens(tokens);
-        leakClusterNodesInto(dg, *cluster_dg);
+        registerClusterNodes(dg, *cluster_dg);
         return name;
     }
 
@@ -50,11 +50,14 @@ static bool isKwd(const std::string_view &s) {
     return keywords.contains(s);
 }
 
-std::vector<Token> punkt::tokenizer::tokenize(Digraph &dg, std::string_view s) {
+std::vector<Token> punkt::tokenizer::tokenize(Digraph &dg, std::string_view s, std::vector<size_t> *out_offsets) {
     std::vector<Token> out;
+    const size_t source_length = s.length();
 
     while (!s.empty()) {
         size_t advance_by = 0;
+        // identifiers are consumed from s directly, so the offset is taken up front
+        const size_t offset = source_length - s.length(), n_tokens_before = out.size();
 
         if (char c = s.front(); std::isalnum(c) || c == '_' || c == '.') {
             std::string_view ident = consumeIdent(s);
@@ -149,10 +152,16 @@ std::vector<Token> punkt::tokenizer::tokenize(Digraph &dg, std::string_view s) {
             throw UnexpectedCharException(c);
         }
 
+        if (out_offsets && out.size() > n_tokens_before) {
+            out_offsets->push_back(offset);
+        }
         s = s.substr(advance_by, s.length() - advance_by);
     }
 
     out.emplace_back("", Token::Type::eos);
+    if (out_offsets) {
+        out_offsets->push_back(source_length);
+    }
 
     return out;
 }
@@ -1,14 +1,34 @@
 #include "punkt/api/punkt.h"
+#include "punkt/batch_layout.hpp"
+#include "punkt/layout_server.hpp"
+#include "punkt/layout_export.hpp"
 #include "punkt/dot.hpp"
+#include "punkt/dot_constants.hpp"
 #include "punkt/glyph_loader/glyph_loader.hpp"
+#include "punkt/layout/x_opt_profile.hpp"
+#include "punkt/progressive_layout.hpp"
+#include "punkt/graph_reloader.hpp"
+#include "punkt/snapshot.hpp"
+#include "punkt/utils/file_watcher.hpp"
+#include "punkt/utils/utils.hpp"
 
 #include <glad/glad.h>
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
+#include <chrono>
 #include <cmath>
 #include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 constexpr double zoom_base = 1.1f;
 constexpr size_t startup_window_width = 640;
@@ -21,17 +41,17 @@ struct PunktUIState {
     double m_window_height{static_cast<double>(startup_window_height)};
     volatile bool m_reset_zoom{}, m_left_mouse_button_down{}, m_is_first_cursor_action{true};
 
-    void frameDone(const punkt::Digraph &dg);
+    void frameDone(const punkt::GraphRenderer &renderer);
 
     void notifyWindowSize(int window_width, int window_height);
 };
 
-void PunktUIState::frameDone(const punkt::Digraph &dg) {
-    dg.m_renderer.updateZoom(m_zoom_update, m_cursor_x, m_cursor_y, m_window_width, m_window_height);
+void PunktUIState::frameDone(const punkt::GraphRenderer &renderer) {
+    renderer.updateZoom(m_zoom_update, m_cursor_x, m_cursor_y, m_window_width, m_window_height);
     if (m_reset_zoom) {
-        dg.m_renderer.resetZoom();
+        renderer.resetZoom();
     }
-    dg.m_renderer.notifyCursorMovement(m_cursor_dx, m_cursor_dy);
+    renderer.notifyCursorMovement(m_cursor_dx, m_cursor_dy);
     m_reset_zoom = false;
     m_zoom_update = 1.0f;
     m_cursor_dx = 0;
@@ -136,22 +156,41 @@ static void terminateGL(GLFWwindow *window) {
     glfwTerminate();
 }
 
-// TODO maybe I should only re-render when user input has been received to reduce cpu/gpu time consumption?
-void punktRun(const char *graph_source_cstr, const char *font_path_relative_to_project_root_cstr) {
-    GLFWwindow *window = setupGL();
+int punktLoadProfile(const char *profile_path_cstr) {
+    try {
+        punkt::layout::applyXOptProfile(punkt::layout::loadXOptProfileFile(profile_path_cstr));
+    } catch (...) {
+        std::cerr << "Error: Cannot load profile \"" << profile_path_cstr << "\"" << std::endl;
+        return 1;
+    }
+    return 0;
+}
 
-    const std::string_view graph_source(graph_source_cstr);
-    const std::string_view font_path = font_path_relative_to_project_root_cstr
-                                           ? std::string_view(font_path_relative_to_project_root_cstr)
-                                           : std::string_view();
-    punkt::Digraph dg(graph_source);
-    punkt::render::glyph::GlyphLoader *glyph_loader = font_path_relative_to_project_root_cstr
-                                                          ? new punkt::render::glyph::GlyphLoader{
-                                                              std::string(font_path)
-                                                          }
-                                                          : new punkt::render::glyph::GlyphLoader{};
-    dg.preprocess(*glyph_loader, "");
-    dg.m_renderer.initialize(dg, *glyph_loader);
+void punktSetLayoutCacheDirectory(const char *cache_dir_cstr) {
+    punkt::LAYOUT_CACHE_DIRECTORY = cache_dir_cstr;
+}
+
+static punkt::render::glyph::GlyphLoader *createGlyphLoader(const char *font_path_relative_to_project_root_cstr) {
+    if (!font_path_relative_to_project_root_cstr) {
+        return new punkt::render::glyph::GlyphLoader{};
+    }
+    return new punkt::render::glyph::GlyphLoader{std::string(font_path_relative_to_project_root_cstr)};
+}
+
+// layout only needs the glyph metrics, so no window is opened for this one
+static std::unique_ptr<punkt::render::glyph::GlyphLoader> createHeadlessGlyphLoader(
+    const char *font_path_relative_to_project_root_cstr) {
+    if (!font_path_relative_to_project_root_cstr) {
+        return std::make_unique<punkt::render::glyph::GlyphLoader>();
+    }
+    return std::make_unique<punkt::render::glyph::GlyphLoader>(std::string(font_path_relative_to_project_root_cstr),
+                                                               true);
+}
+
+// TODO maybe I should only re-render when user input has been received to reduce cpu/gpu time consumption?
+// renders until the window is closed, calling before_frame() at the start of every frame
+template<typename BeforeFrame>
+static void runRenderLoop(GLFWwindow *window, const punkt::GraphRenderer &renderer, BeforeFrame before_frame) {
 #ifndef PUNKT_REMOVE_FPS_COUNTER
     fpsCounterInit();
 #endif
@@ -163,18 +202,247 @@ void punktRun(const char *graph_source_cstr, const char *font_path_relative_to_p
 
         int framebuffer_width, framebuffer_height;
         glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
-        dg.m_renderer.notifyFramebufferSize(framebuffer_width, framebuffer_height);
+        renderer.notifyFramebufferSize(framebuffer_width, framebuffer_height);
 
-        dg.m_renderer.renderFrame();
+        before_frame();
+        renderer.renderFrame();
         glfwSwapBuffers(window);
 
         glfwPollEvents();
 
-        ui_state.frameDone(dg);
+        ui_state.frameDone(renderer);
 #ifndef PUNKT_REMOVE_FPS_COUNTER
         fpsCounterNotifyFrameDone();
 #endif
     }
+}
+
+void punktRun(const char *graph_source_cstr, const char *font_path_relative_to_project_root_cstr) {
+    GLFWwindow *window = setupGL();
+
+    const std::string_view graph_source(graph_source_cstr);
+    punkt::render::glyph::GlyphLoader *glyph_loader = createGlyphLoader(font_path_relative_to_project_root_cstr);
+    // show a quick preview layout right away and swap in the refined layouts as the worker finishes them
+    punkt::render::ProgressiveLayout progressive_layout(std::string(graph_source), *glyph_loader);
+    punkt::GraphRenderer renderer;
+    renderer.initialize(progressive_layout.waitForLayout(), *glyph_loader);
+
+    runRenderLoop(window, renderer, [&] {
+        try {
+            if (std::optional<punkt::render::RenderInstanceData> refined = progressive_layout.takeLatest()) {
+                renderer.uploadInstanceData(std::move(*refined));
+            }
+        } catch (const std::exception &e) {
+            // a failed refinement pass keeps the last layout on screen
+            std::cerr << "Error: " << e.what() << std::endl;
+        } catch (...) {
+            std::cerr << "Error: Layout refinement failed, keeping the previous layout" << std::endl;
+        }
+    });
+    // the worker may still be using the glyph loader
+    progressive_layout.stop();
+    // must allocate with new so I can call the destructor manually before the opengl context is destroyed
+    delete glyph_loader;
+    terminateGL(window);
+}
+
+static std::optional<std::string> readGraphFile(const std::filesystem::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return std::nullopt;
+    }
+    return std::string(std::istreambuf_iterator(file), std::istreambuf_iterator<char>());
+}
+
+void punktRunWatched(const char *graph_path_cstr, const char *font_path_relative_to_project_root_cstr) {
+    const std::filesystem::path graph_path(graph_path_cstr);
+    // start watching before the first read so no write in between is missed
+    punkt::FileWatcher watcher(graph_path);
+    std::optional<std::string> graph_source = readGraphFile(graph_path);
+    if (!graph_source) {
+        std::cerr << "Error: Cannot read \"" << graph_path.string() << "\"" << std::endl;
+        return;
+    }
+
+    GLFWwindow *window = setupGL();
+    punkt::render::glyph::GlyphLoader *glyph_loader = createGlyphLoader(font_path_relative_to_project_root_cstr);
+    {
+        punkt::render::GraphReloader reloader(std::move(*graph_source), *glyph_loader);
+        punkt::GraphRenderer renderer;
+        renderer.initialize(reloader.getRenderInstanceData(), *glyph_loader);
+
+        // the window, shaders and camera stay, only the changed instance data is uploaded
+        runRenderLoop(window, renderer, [&] {
+            if (!watcher.pollChanged()) {
+                return;
+            }
+            // the file may be missing for a moment while an editor replaces it, the next write is reported again
+            std::optional<std::string> new_source = readGraphFile(graph_path);
+            if (!new_source) {
+                return;
+            }
+            try {
+                if (std::optional<punkt::render::RenderInstanceData> data = reloader.reload(std::move(*new_source))) {
+                    renderer.uploadInstanceData(std::move(*data));
+                }
+            } catch (const std::exception &e) {
+                // keep showing the last valid graph while the file is being edited
+                std::cerr << "Error: " << e.what() << std::endl;
+            } catch (...) {
+                std::cerr << "Error: Invalid graph, keeping the previous version" << std::endl;
+            }
+        });
+    }
+    // must allocate with new so I can call the destructor manually before the opengl context is destroyed
+    delete glyph_loader;
+    terminateGL(window);
+}
+
+int punktConvertToSnapshot(const char *graph_path_cstr, const char *snapshot_path_cstr,
+                           const char *font_path_relative_to_project_root_cstr) {
+    const std::optional<std::string> graph_source = readGraphFile(graph_path_cstr);
+    if (!graph_source) {
+        std::cerr << "Error: Cannot read \"" << graph_path_cstr << "\"" << std::endl;
+        return 1;
+    }
+    try {
+        const auto glyph_loader = createHeadlessGlyphLoader(font_path_relative_to_project_root_cstr);
+        punkt::Digraph dg{*graph_source};
+        dg.preprocess(*glyph_loader);
+        punkt::render::writeSnapshot(dg, *glyph_loader, snapshot_path_cstr);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "Error: Cannot convert \"" << graph_path_cstr << "\" to a snapshot" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int punktExportLayout(const char *graph_path_cstr, const char *output_path_cstr, const char *format_cstr,
+                      const char *font_path_relative_to_project_root_cstr) {
+    const std::string_view format = format_cstr;
+    if (!punkt::caseInsensitiveEquals(format, "plain") && !punkt::caseInsensitiveEquals(format, "json")
+        && !punkt::caseInsensitiveEquals(format, "svg")) {
+        std::cerr << "Error: Unknown output format \"" << format << "\", expected plain, json or svg" << std::endl;
+        return 1;
+    }
+    const std::optional<std::string> graph_source = readGraphFile(graph_path_cstr);
+    if (!graph_source) {
+        std::cerr << "Error: Cannot read \"" << graph_path_cstr << "\"" << std::endl;
+        return 1;
+    }
+    try {
+        const auto glyph_loader = createHeadlessGlyphLoader(font_path_relative_to_project_root_cstr);
+        punkt::Digraph dg{*graph_source};
+        dg.preprocess(*glyph_loader);
+
+        std::ofstream file;
+        if (output_path_cstr) {
+            file.open(output_path_cstr, std::ios::binary | std::ios::trunc);
+            if (!file) {
+                std::cerr << "Error: Cannot write \"" << output_path_cstr << "\"" << std::endl;
+                return 1;
+            }
+        }
+        std::ostream &out = output_path_cstr ? file : std::cout;
+        if (punkt::caseInsensitiveEquals(format, "plain")) {
+            punkt::render::writeLayoutPlain(dg, out);
+        } else if (punkt::caseInsensitiveEquals(format, "svg")) {
+            punkt::render::writeLayoutSvg(dg, out);
+        } else {
+            punkt::render::writeLayoutJson(dg, out);
+        }
+        out.flush();
+        if (!out) {
+            std::cerr << "Error: Cannot write the layout" << std::endl;
+            return 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "Error: Cannot lay out \"" << graph_path_cstr << "\"" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int punktRunBatch(const char *const *graph_paths_cstr, const size_t n_graph_paths, const char *output_dir_cstr,
+                  const char *font_path_relative_to_project_root_cstr, const size_t n_threads) {
+    std::vector<punkt::BatchLayoutResult> results;
+    try {
+        const auto glyph_loader = createHeadlessGlyphLoader(font_path_relative_to_project_root_cstr);
+        const std::vector<std::filesystem::path> graph_paths = punkt::collectBatchGraphPaths(
+            std::vector<std::filesystem::path>(graph_paths_cstr, graph_paths_cstr + n_graph_paths));
+        results = punkt::runBatchLayout(graph_paths, output_dir_cstr, *glyph_loader, n_threads);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "Error: Cannot set up the batch (is the font or the output directory invalid?)" << std::endl;
+        return 1;
+    }
+
+    size_t n_failed = 0;
+    for (const punkt::BatchLayoutResult &result: results) {
+        if (result.m_is_ok) {
+            std::cout << "ok   " << result.m_graph_path.string() << " -> " << result.m_output_path.string()
+                    << " (parse " << result.m_parse_ms << "ms, layout " << result.m_layout_ms << "ms, write "
+                    << result.m_write_ms << "ms)" << std::endl;
+        } else {
+            n_failed++;
+            std::cout << "FAIL " << result.m_graph_path.string() << ": " << result.m_error << std::endl;
+        }
+    }
+    std::cout << results.size() - n_failed << " of " << results.size() << " graphs laid out" << std::endl;
+    return n_failed == 0 ? 0 : 1;
+}
+
+int punktServe(const char *socket_path_cstr, const char *font_path_relative_to_project_root_cstr,
+               const size_t n_threads, const size_t request_timeout_ms) {
+    try {
+        const auto glyph_loader = createHeadlessGlyphLoader(font_path_relative_to_project_root_cstr);
+        punkt::LayoutServer server({
+                                       socket_path_cstr, n_threads, punkt::LayoutServerConfig{}.m_max_pending_requests,
+                                       std::chrono::milliseconds(request_timeout_ms)
+                                   }, *glyph_loader);
+        std::cout << "Serving layouts on \"" << socket_path_cstr << "\"" << std::endl;
+        server.run();
+    } catch (const punkt::LayoutServerException &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "Error: Cannot start the layout server on \"" << socket_path_cstr << "\"" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+void punktRunSnapshot(const char *snapshot_path_cstr, const char *font_path_relative_to_project_root_cstr) {
+    std::optional<punkt::render::Snapshot> snapshot;
+    try {
+        snapshot.emplace(snapshot_path_cstr);
+    } catch (...) {
+        std::cerr << "Error: Cannot load the snapshot \"" << snapshot_path_cstr << "\"" << std::endl;
+        return;
+    }
+
+    GLFWwindow *window = setupGL();
+    punkt::render::glyph::GlyphLoader *glyph_loader = createGlyphLoader(font_path_relative_to_project_root_cstr);
+    if (glyph_loader->getFontFingerprint() != snapshot->getFontFingerprint()) {
+        std::cerr << "Warning: The snapshot was laid out with a different font, labels may not fit" << std::endl;
+    }
+    {
+        punkt::GraphRenderer renderer;
+        renderer.initialize(punkt::render::RenderInstanceData(*snapshot), *glyph_loader);
+        runRenderLoop(window, renderer, [] {
+        });
+    }
     // must allocate with new so I can call the destructor manually before the opengl context is destroyed
     delete glyph_loader;
     terminateGL(window);
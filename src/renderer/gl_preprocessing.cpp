@@ -11,6 +11,8 @@
 #include <cassert>
 #include <cmath>
 #include <numbers>
+#include <cstring>
+#include <algorithm>
 
 using namespace punkt;
 using namespace punkt::render;
@@ -45,26 +47,6 @@ static GLuint getEdgeStyleId(const std::string_view style) {
     return edge_style_solid;
 }
 
-constexpr GLuint node_shape_none = 0;
-constexpr GLuint node_shape_box = 1;
-constexpr GLuint node_shape_ellipse = 2;
-constexpr GLuint node_shape_circle = node_shape_ellipse; // from shader POV there is no difference
-constexpr GLuint node_shape_pill = 3; // this one is punkt-specific
-
-// used in the fragment shader for identifying how to draw the border
-static GLuint getNodeShapeId(const Node &node) {
-    if (const std::string_view &shape = getAttrOrDefault(node.m_attrs, "shape", default_shape); shape == "none") {
-        return node_shape_none;
-    } else if (shape == "ellipse") {
-        return node_shape_ellipse;
-    } else if (shape == "circle") {
-        return node_shape_circle;
-    } else if (shape == "pill") {
-        return node_shape_pill;
-    }
-    return node_shape_box;
-}
-
 CharQuadPerInstanceData::CharQuadPerInstanceData(const GLuint x, const GLuint y, const GLuint color)
     : m_x(x), m_y(y), m_color(color) {
 }
@@ -135,11 +117,13 @@ EdgeArrowTriangle::EdgeArrowTriangle(const std::span<const Vector2<double>> poin
     }
 }
 
-static VAO moveShapeQuadsToBuffer(const std::span<const ShapeQuadInfo> quad_info) {
+static VAO moveShapeQuadsToBuffer(const std::span<const ShapeQuadInfo> quad_info,
+                                  InstanceBuffer &out_instances) {
     GLuint vao, vbo_fake_vertex, vbo_instance;
     GL_CHECK(glGenVertexArrays(1, &vao));
     GL_CHECK(glGenBuffers(1, &vbo_fake_vertex));
     GL_CHECK(glGenBuffers(1, &vbo_instance));
+    out_instances = InstanceBuffer{vbo_instance, quad_info.size() * sizeof(ShapeQuadInfo)};
     GL_CHECK(glBindVertexArray(vao));
 
     // fake vertex data (1 byte)
@@ -222,10 +206,12 @@ static VAO moveShapeQuadsToBuffer(const std::span<const ShapeQuadInfo> quad_info
     return vao;
 }
 
-static VAO moveEdgeLinesToBuffer(const std::span<const EdgeLinePoints> edge_lines) {
+static VAO moveEdgeLinesToBuffer(const std::span<const EdgeLinePoints> edge_lines,
+                                 InstanceBuffer &out_instances) {
     GLuint vao, vbo;
     GL_CHECK(glGenVertexArrays(1, &vao));
     GL_CHECK(glGenBuffers(1, &vbo));
+    out_instances = InstanceBuffer{vbo, edge_lines.size() * sizeof(EdgeLinePoints)};
     GL_CHECK(glBindVertexArray(vao));
     GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vbo));
 
@@ -266,10 +252,13 @@ static VAO moveEdgeLinesToBuffer(const std::span<const EdgeLinePoints> edge_line
     return vao;
 }
 
-static VAO moveEdgeSplinesToBuffer(const std::span<const EdgeLinePoints> edge_splines) {
+static VAO moveEdgeSplinesToBuffer(const std::span<const EdgeLinePoints> edge_splines,
+                                   InstanceBuffer &out_instances) {
     GLuint vao, vbo_points, vbo_t;
     GL_CHECK(glGenVertexArrays(1, &vao));
     GL_CHECK(glGenBuffers(1, &vbo_points));
+    // the spline points are per-vertex data, but they are what changes between layouts
+    out_instances = InstanceBuffer{vbo_points, edge_splines.size() * sizeof(EdgeLinePoints)};
     GL_CHECK(glGenBuffers(1, &vbo_t));
     GL_CHECK(glBindVertexArray(vao));
 
@@ -338,10 +327,12 @@ static VAO moveEdgeSplinesToBuffer(const std::span<const EdgeLinePoints> edge_sp
     return vao;
 }
 
-static VAO moveArrowTrianglesToBuffer(const std::span<const EdgeArrowTriangle> triangles) {
+static VAO moveArrowTrianglesToBuffer(const std::span<const EdgeArrowTriangle> triangles,
+                                      InstanceBuffer &out_instances) {
     GLuint vao, vbo;
     GL_CHECK(glGenVertexArrays(1, &vao));
     GL_CHECK(glGenBuffers(1, &vbo));
+    out_instances = InstanceBuffer{vbo, triangles.size() * sizeof(EdgeArrowTriangle)};
     GL_CHECK(glBindVertexArray(vao));
     GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vbo));
 
@@ -376,11 +367,13 @@ static VAO moveArrowTrianglesToBuffer(const std::span<const EdgeArrowTriangle> t
 
 static VAO
 moveGLQuadsWithCharQuadPerInstanceDataToBuffer(const std::span<const GLQuad> quads,
-                                               const std::span<const CharQuadPerInstanceData> per_instance_data) {
+                                               const std::span<const CharQuadPerInstanceData> per_instance_data,
+                                               InstanceBuffer &out_instances) {
     GLuint vao, vbo_quads, vbo_instances;
     GL_CHECK(glGenVertexArrays(1, &vao));
     GL_CHECK(glGenBuffers(1, &vbo_quads));
     GL_CHECK(glGenBuffers(1, &vbo_instances));
+    out_instances = InstanceBuffer{vbo_instances, per_instance_data.size() * sizeof(CharQuadPerInstanceData)};
     GL_CHECK(glBindVertexArray(vao));
 
     GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vbo_quads));
@@ -466,28 +459,11 @@ static void parsePulsingTimeOffset(const Attrs &attrs, GLfloat &out, GLfloat &ou
     }
 }
 
-GLRenderer::GLRenderer(const Digraph &dg, glyph::GlyphLoader &glyph_loader)
-    : m_dg(dg), m_glyph_loader(glyph_loader), m_zoom(1.0),
+RenderInstanceData::RenderInstanceData(const Digraph &dg)
+    : m_is_reversed(dg.m_render_attrs.m_rank_dir.m_is_reversed),
+      m_is_sideways(dg.m_render_attrs.m_rank_dir.m_is_sideways), m_graph_width(dg.m_render_attrs.m_graph_width),
+      m_graph_height(dg.m_render_attrs.m_graph_height),
       m_digraph_quad(0, 0, 0, 0, 0, 0, 0, 0, 0, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f) {
-    GLint viewport[4]{};
-    GL_CHECK(glGetIntegerv(GL_VIEWPORT, viewport));
-    const GLint vw = viewport[2] - viewport[0], vh = viewport[3] - viewport[1];
-    m_camera_x = static_cast<double>(static_cast<ssize_t>(dg.m_render_attrs.m_graph_width) - vw) / 2.0;
-    m_camera_y = static_cast<double>(static_cast<ssize_t>(dg.m_render_attrs.m_graph_height) - vh) / 2.0;
-
-    // so I don't have to pad my glyph textures
-    GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
-
-    // background is white
-    GL_CHECK(glClearColor(1.0f, 1.0f, 1.0f, 1.0f));
-
-    // enable MSAA for antialiasing
-    GL_CHECK(glEnable(GL_MULTISAMPLE));
-
-    // blending for transparency and because my text rendering depends on it
-    GL_CHECK(glEnable(GL_BLEND));
-    GL_CHECK(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
-
     // populate m_char_quads, an opengl-friendly quad collection for instanced rendering, and m_node_quads
     constexpr std::string_view font_color_attr = "fontcolor";
     constexpr std::string_view default_font_color = "black";
@@ -496,14 +472,7 @@ GLRenderer::GLRenderer(const Digraph &dg, glyph::GlyphLoader &glyph_loader)
     {
         const GLuint font_color = getPackedColorFromAttrs(dg.m_attrs, font_color_attr, default_font_color);
         const GLuint border_color = getPackedColorFromAttrs(dg.m_attrs, "color", "black");
-        GLuint fill_color;
-        if (dg.m_attrs.contains("fillcolor")) {
-            fill_color = getPackedColorFromAttrs(dg.m_attrs, "fillcolor", "white");
-        } else if (caseInsensitiveEquals(getAttrOrDefault(dg.m_attrs, "style", "normal"), "filled")) {
-            fill_color = border_color;
-        } else {
-            fill_color = getPackedColorFromName("white");
-        }
+        const GLuint fill_color = getPackedColorFromName(getFillColor(dg.m_attrs));
         const GLuint pulsing_color = getPackedColorFromAttrs(dg.m_attrs, "punktpulsingcolor", "transparent");
 
         const GLfloat rotation_speed = static_cast<GLfloat>(getAttrTransformedCheckedOrDefault(
@@ -529,17 +498,30 @@ GLRenderer::GLRenderer(const Digraph &dg, glyph::GlyphLoader &glyph_loader)
 
     // TODO populate cluster quads
 
+    // Nodes and edges are emitted in id order. Digraph::relayout gives added nodes and edges the next ids, so the
+    // instances of an incrementally updated graph stay where they were and GLRenderer::uploadInstanceData only has to
+    // upload the ones that changed.
+    std::vector<const Node *> nodes;
+    std::vector<const Edge *> edges;
+    nodes.reserve(dg.m_nodes.size());
     for (const Node &node: std::views::values(dg.m_nodes)) {
-        GLuint font_color = getPackedColorFromAttrs(node.m_attrs, font_color_attr, default_font_color);
-        const GLuint border_color = getPackedColorFromAttrs(node.m_attrs, "color", "black");
-        GLuint fill_color;
-        if (node.m_attrs.contains("fillcolor")) {
-            fill_color = getPackedColorFromAttrs(node.m_attrs, "fillcolor", "white");
-        } else if (caseInsensitiveEquals(getAttrOrDefault(node.m_attrs, "style", "normal"), "filled")) {
-            fill_color = border_color;
-        } else {
-            fill_color = getPackedColorFromName("white");
+        nodes.push_back(&node);
+        for (const Edge &edge: node.m_outgoing) {
+            edges.push_back(&edge);
         }
+    }
+    std::ranges::stable_sort(nodes, [](const Node *a, const Node *b) {
+        return a->m_id < b->m_id;
+    });
+    std::ranges::stable_sort(edges, [](const Edge *a, const Edge *b) {
+        return a->m_id < b->m_id;
+    });
+
+    for (const Node *node_ptr: nodes) {
+        const Node &node = *node_ptr;
+        const GLuint font_color = getPackedColorFromAttrs(node.m_attrs, font_color_attr, default_font_color);
+        const GLuint border_color = getPackedColorFromAttrs(node.m_attrs, "color", "black");
+        const GLuint fill_color = getPackedColorFromName(getFillColor(node.m_attrs));
         const GLuint pulsing_color = getPackedColorFromAttrs(node.m_attrs, "punktpulsingcolor", "transparent");
 
         const GLfloat rotation_speed = static_cast<GLfloat>(getAttrTransformedCheckedOrDefault(
@@ -559,80 +541,68 @@ GLRenderer::GLRenderer(const Digraph &dg, glyph::GlyphLoader &glyph_loader)
 
         populateRendererCharQuads(node.m_render_attrs.m_quads, node.m_render_attrs.m_x, node.m_render_attrs.m_y,
                                   font_color, m_char_quads);
+    }
 
-        // build edge lines (& arrows)
-        for (const Edge &edge: node.m_outgoing) {
-            if (edge.m_render_attrs.m_trajectory.empty()) {
-                // some edges may not have a trajectory because they were replaced by multiple ghost edges
-                assert(!edge.m_render_attrs.m_is_visible);
-                continue;
-            }
-            assert(edge.m_render_attrs.m_trajectory.size() == expected_edge_line_length);
-
-            const GLuint edge_color = getPackedColorFromAttrs(edge.m_attrs, "color", "black");
-            const GLuint edge_style = getEdgeStyleId(getAttrOrDefault(edge.m_attrs, "style", "solid"));
-
-            const float edge_pen_width = getAttrTransformedCheckedOrDefault(
-                edge.m_attrs, "penwidth", 1.0f, stringViewToFloat);
-            // TODO handle custom dpi
-            constexpr auto dpi = DEFAULT_DPI;
-            const auto edge_thickness = static_cast<GLuint>(
-                edge_pen_width * static_cast<float>(dpi) / static_cast<float>(DEFAULT_DPI));
-
-            bool render_as_spline = false;
-            // only render as spline if that is enabled obviously
-            if (edge.m_render_attrs.m_is_spline) {
-                const Node &src = dg.m_nodes.at(edge.m_source);
-                const Node &dest = dg.m_nodes.at(edge.m_dest);
-                const auto source_rank_height = dg.m_render_attrs.m_rank_render_attrs.at(src.m_render_attrs.m_rank).
-                        m_rank_height;
-                const auto dest_rank_height = dg.m_render_attrs.m_rank_render_attrs.at(dest.m_render_attrs.m_rank).
-                        m_rank_height;
-                // only render as spline if rendering as a spline makes a difference visually (splines are expensive)
-                if (src.m_render_attrs.m_height < source_rank_height ||
-                    dest.m_render_attrs.m_height < dest_rank_height || getNodeShapeId(src) != node_shape_box ||
-                    getNodeShapeId(dest) != node_shape_box) {
-                    render_as_spline = true;
-                }
-            }
-
-            if (render_as_spline) {
-                m_edge_spline_points.emplace_back(edge.m_render_attrs.m_trajectory, edge_color, edge_thickness,
-                                                  edge_style);
-            } else {
-                m_edge_line_points.emplace_back(edge.m_render_attrs.m_trajectory, edge_color, edge_thickness,
-                                                edge_style);
-            }
-
-            buildArrows(edge, edge_color);
-
-            font_color = getPackedColorFromAttrs(edge.m_attrs, font_color_attr, default_font_color);
-            for (const std::vector<GlyphQuad> *quads: {
-                     &edge.m_render_attrs.m_label_quads, &edge.m_render_attrs.m_head_label_quads,
-                     &edge.m_render_attrs.m_tail_label_quads
-                 }) {
-                populateRendererCharQuads(*quads, 0, 0, font_color, m_char_quads);
-            }
+    // build edge lines (& arrows)
+    for (const Edge *edge_ptr: edges) {
+        const Edge &edge = *edge_ptr;
+        if (edge.m_render_attrs.m_trajectory.empty()) {
+            // some edges may not have a trajectory because they were replaced by multiple ghost edges
+            assert(!edge.m_render_attrs.m_is_visible);
+            continue;
         }
-    }
+        assert(edge.m_render_attrs.m_trajectory.size() == expected_edge_line_length);
 
-    // populate node quad opengl buffers with node quads
-    m_digraph_quad_buffer = moveShapeQuadsToBuffer(std::array<ShapeQuadInfo, 1>({m_digraph_quad}));
-    m_cluster_quads_buffer = moveShapeQuadsToBuffer(m_cluster_quads);
-    m_node_quad_buffer = moveShapeQuadsToBuffer(m_node_quads);
-    m_edge_lines_buffer = moveEdgeLinesToBuffer(m_edge_line_points);
-    m_edge_splines_buffer = moveEdgeSplinesToBuffer(m_edge_spline_points);
-    m_arrow_triangles_buffer = moveArrowTrianglesToBuffer(m_edge_arrow_triangles);
+        const GLuint edge_color = getPackedColorFromAttrs(edge.m_attrs, "color", "black");
+        const GLuint edge_style = getEdgeStyleId(getAttrOrDefault(edge.m_attrs, "style", "solid"));
+        const auto edge_thickness = static_cast<GLuint>(getEdgeThickness(edge));
 
-    // populate glyph vertex and instance buffers
-    for (const auto &[key, qit]: m_char_quads) {
-        std::array qs{qit.m_quad};
-        m_char_buffers.insert_or_assign(key, moveGLQuadsWithCharQuadPerInstanceDataToBuffer(qs, qit.m_instances));
+        if (isEdgeDrawnAsSpline(dg, edge)) {
+            m_edge_spline_points.emplace_back(edge.m_render_attrs.m_trajectory, edge_color, edge_thickness,
+                                              edge_style);
+        } else {
+            m_edge_line_points.emplace_back(edge.m_render_attrs.m_trajectory, edge_color, edge_thickness,
+                                            edge_style);
+        }
+
+        buildArrows(dg, edge, edge_color);
+
+        const GLuint font_color = getPackedColorFromAttrs(edge.m_attrs, font_color_attr, default_font_color);
+        for (const std::vector<GlyphQuad> *quads: {
+                 &edge.m_render_attrs.m_label_quads, &edge.m_render_attrs.m_head_label_quads,
+                 &edge.m_render_attrs.m_tail_label_quads
+             }) {
+            populateRendererCharQuads(*quads, 0, 0, font_color, m_char_quads);
+        }
     }
+}
 
-    // unbind buffers so I don't shoot myself in the foot
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+GLRenderer::GLRenderer(const Digraph &dg, glyph::GlyphLoader &glyph_loader)
+    : GLRenderer(RenderInstanceData(dg), glyph_loader) {
+}
+
+GLRenderer::GLRenderer(RenderInstanceData data, glyph::GlyphLoader &glyph_loader)
+    : m_glyph_loader(glyph_loader), m_zoom(1.0), m_data(std::move(data)) {
+    GLint viewport[4]{};
+    GL_CHECK(glGetIntegerv(GL_VIEWPORT, viewport));
+    const GLint vw = viewport[2] - viewport[0], vh = viewport[3] - viewport[1];
+    m_camera_x = static_cast<double>(static_cast<ssize_t>(m_data.m_graph_width) - vw) / 2.0;
+    m_camera_y = static_cast<double>(static_cast<ssize_t>(m_data.m_graph_height) - vh) / 2.0;
+
+    // so I don't have to pad my glyph textures
+    GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+
+    // background is white
+    GL_CHECK(glClearColor(1.0f, 1.0f, 1.0f, 1.0f));
+
+    // enable MSAA for antialiasing
+    GL_CHECK(glEnable(GL_MULTISAMPLE));
+
+    // blending for transparency and because my text rendering depends on it
+    GL_CHECK(glEnable(GL_BLEND));
+    GL_CHECK(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+
+    createInstanceBuffers();
 
     // load shaders
     m_nodes_shader = punkt::createShaderProgram(nodes_vertex_shader_code, nodes_geometry_shader_code,
@@ -650,181 +620,93 @@ GLRenderer::GLRenderer(const Digraph &dg, glyph::GlyphLoader &glyph_loader)
     GL_CRITICAL_CHECK_ALL_ERRORS();
 }
 
-// determine whether two points for computing the angle of an arrow are too close together and should preferably not
-// be used. Policy: line must be longer than arrow.
-static bool pointsTooCloseToComputeArrowAngle(const Vector2<size_t> &a, const Vector2<size_t> &b,
-                                              const double arrow_size) {
-    const auto dx = static_cast<double>(a.x) - static_cast<double>(b.x);
-    const auto dy = static_cast<double>(a.y) - static_cast<double>(b.y);
-    return dx * dx + dy * dy <= arrow_size * arrow_size;
-}
-
-static double getArrowAngle(const std::span<const Vector2<size_t>> trajectory, const bool go_backward,
-                            const double arrow_size) {
-    const auto &a = go_backward ? trajectory.back() : trajectory.front();
-
-    // the next point in the line (either before or after depending on go_backward) may be the same point duplicated
-    // and therefore not usable for computing the angle of the line. Therefore, we have to search the first one that
-    // is not equal.
-    int start, stop, step;
-    if (go_backward) {
-        start = static_cast<int>(trajectory.size()) - 2;
-        stop = -1;
-        step = -1;
-    } else {
-        start = 1;
-        stop = static_cast<int>(trajectory.size());
-        step = 1;
+// Uploads the instances of `new_data` that differ from `old_data` (by value, at the same index). Equally sized data
+// only uploads the range between the first and the last difference, otherwise everything from the first difference on
+// is uploaded. A buffer that is too small is reallocated with 50% headroom, so a graph that keeps growing by a few
+// nodes does not reallocate on every update.
+template<typename T>
+static void updateInstanceBuffer(InstanceBuffer &buffer, const std::span<const T> old_data,
+                                 const std::span<const T> new_data) {
+    const size_t n_common = std::min(old_data.size(), new_data.size());
+    size_t begin = 0;
+    while (begin < n_common && std::memcmp(&old_data[begin], &new_data[begin], sizeof(T)) == 0) {
+        begin++;
     }
-    size_t i;
-    for (i = start; i != stop; i += step) {
-        if (const auto &b = trajectory[i]; !pointsTooCloseToComputeArrowAngle(a, b, arrow_size)) {
-            break;
+    size_t end = new_data.size();
+    if (old_data.size() == new_data.size()) {
+        while (end > begin && std::memcmp(&old_data[end - 1], &new_data[end - 1], sizeof(T)) == 0) {
+            end--;
         }
     }
-    if (i == stop) {
-        // check for exact equivalence: if exactly equal, cannot compute angle -> default to 0. Otherwise, meaning they
-        // are just very close together, use anyway as it's the least bad option.
-        i += step;
-        if (const auto &b = trajectory[i]; a == b) {
-            return 0.0;
-        }
+    if (begin == end) {
+        return;
     }
 
-    // found other reference point for line
-    const auto &b = trajectory[i];
-    // a and b are swapped in the Y term (first parameter) because y in my coordinate system is down instead of up
-    return std::atan2(static_cast<double>(b.y) - static_cast<double>(a.y),
-                      static_cast<double>(a.x) - static_cast<double>(b.x));
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, buffer.m_vbo));
+    if (const size_t required = new_data.size() * sizeof(T); required > buffer.m_capacity) {
+        buffer.m_capacity = required + required / 2;
+        GL_CHECK(glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(buffer.m_capacity), nullptr, GL_DYNAMIC_DRAW));
+        begin = 0;
+    }
+    GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(begin * sizeof(T)),
+        static_cast<GLsizeiptr>((end - begin) * sizeof(T)), new_data.data() + begin));
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
 }
 
-static Vector2<double> getLineEndPointForArrow(const std::span<const Vector2<size_t>> trajectory,
-                                               const bool get_min, double &orientation,
-                                               const double arrow_size) {
-    assert(trajectory.size() == 4);
-    if (trajectory.front().y < trajectory.back().y) {
-        if (get_min) {
-            const auto [x, y] = trajectory.front();
-            orientation = getArrowAngle(trajectory, false, arrow_size);
-            return Vector2(static_cast<double>(x), static_cast<double>(y));
-        } else {
-            const auto [x, y] = trajectory.back();
-            orientation = getArrowAngle(trajectory, true, arrow_size);
-            return Vector2(static_cast<double>(x), static_cast<double>(y));
-        }
-    } else {
-        if (get_min) {
-            const auto [x, y] = trajectory.back();
-            orientation = getArrowAngle(trajectory, true, arrow_size);
-            return Vector2(static_cast<double>(x), static_cast<double>(y));
+void GLRenderer::uploadInstanceData(RenderInstanceData data) {
+    updateInstanceBuffer<ShapeQuadInfo>(m_digraph_quad_instances, std::span(&m_data.m_digraph_quad, 1),
+                                        std::span(&data.m_digraph_quad, 1));
+    updateInstanceBuffer<ShapeQuadInfo>(m_cluster_quad_instances, m_data.m_cluster_quads, data.m_cluster_quads);
+    updateInstanceBuffer<ShapeQuadInfo>(m_node_quad_instances, m_data.m_node_quads, data.m_node_quads);
+    updateInstanceBuffer<EdgeLinePoints>(m_edge_line_instances, m_data.m_edge_line_points, data.m_edge_line_points);
+    updateInstanceBuffer<EdgeLinePoints>(m_edge_spline_instances, m_data.m_edge_spline_points,
+                                         data.m_edge_spline_points);
+    updateInstanceBuffer<EdgeArrowTriangle>(m_arrow_triangle_instances, m_data.m_edge_arrow_triangles,
+                                            data.m_edge_arrow_triangles);
+
+    for (const auto &[key, qit]: data.m_char_quads) {
+        if (const auto it = m_char_instances.find(key); it != m_char_instances.end()) {
+            const auto old_it = m_data.m_char_quads.find(key);
+            const std::span<const CharQuadPerInstanceData> old_instances =
+                    old_it != m_data.m_char_quads.end() ? old_it->second.m_instances
+                                                        : std::span<const CharQuadPerInstanceData>();
+            updateInstanceBuffer<CharQuadPerInstanceData>(it->second, old_instances, qit.m_instances);
         } else {
-            const auto [x, y] = trajectory.front();
-            orientation = getArrowAngle(trajectory, false, arrow_size);
-            return Vector2(static_cast<double>(x), static_cast<double>(y));
+            // a glyph that was not drawn before
+            std::array qs{qit.m_quad};
+            m_char_buffers.insert_or_assign(
+                key, moveGLQuadsWithCharQuadPerInstanceDataToBuffer(qs, qit.m_instances, m_char_instances[key]));
         }
     }
+    // glyphs that are not drawn anymore keep their (empty) buffers, which are not drawn since they are not in m_data
+    m_data = std::move(data);
 }
 
-static void buildArrowTriangles(GLRenderer &renderer, const Edge &edge, const GLuint edge_color,
-                                const std::string_view arrow_type, const float arrow_size, const bool is_upward) {
-    if (arrow_type == "none") {
-        return;
-    }
-
-    // TODO support more arrow types - for now, every type emits a normal arrow as "fallback"
-    Vector2<double> points[3]{};
-    // TODO handle custom dpi
-    constexpr auto dpi = DEFAULT_DPI;
-    const auto arrow_size_pix = arrow_size * arrow_scale * static_cast<float>(dpi) / static_cast<float>(DEFAULT_DPI);
-
-    double line_orientation, arrow_orientation;
-    if (is_upward) {
-        auto top = getLineEndPointForArrow(edge.m_render_attrs.m_trajectory, true, line_orientation, arrow_size);
-        // since arrows store their coordinates in double precision instead of size_t (i.e. they are not limited to the
-        // normal layout grid that other stuff is limited to position-wise), we have to adjust the x so the arrow is
-        // centered inside the grid cell it's at.
-        top.x += 0.5;
-        const auto left = Vector2(top.x - arrow_size_pix / 2, top.y + arrow_size_pix);
-        const auto right = Vector2(top.x + arrow_size_pix / 2, top.y + arrow_size_pix);
-        points[0] = top;
-        points[1] = left;
-        points[2] = right;
-        arrow_orientation = std::numbers::pi * 0.5;
-    } else {
-        auto bottom = getLineEndPointForArrow(edge.m_render_attrs.m_trajectory, false, line_orientation, arrow_size);
-        bottom.x += 0.5; // for explanation, see ~10 lines above
-        const auto left = Vector2(bottom.x - arrow_size_pix / 2, bottom.y - arrow_size_pix);
-        const auto right = Vector2(bottom.x + arrow_size_pix / 2, bottom.y - arrow_size_pix);
-        points[0] = bottom;
-        points[1] = left;
-        points[2] = right;
-        arrow_orientation = std::numbers::pi * 1.5;
-    }
+void GLRenderer::createInstanceBuffers() {
+    // populate node quad opengl buffers with node quads
+    m_digraph_quad_buffer = moveShapeQuadsToBuffer(std::array<ShapeQuadInfo, 1>({m_data.m_digraph_quad}),
+                                                   m_digraph_quad_instances);
+    m_cluster_quads_buffer = moveShapeQuadsToBuffer(m_data.m_cluster_quads, m_cluster_quad_instances);
+    m_node_quad_buffer = moveShapeQuadsToBuffer(m_data.m_node_quads, m_node_quad_instances);
+    m_edge_lines_buffer = moveEdgeLinesToBuffer(m_data.m_edge_line_points, m_edge_line_instances);
+    m_edge_splines_buffer = moveEdgeSplinesToBuffer(m_data.m_edge_spline_points, m_edge_spline_instances);
+    m_arrow_triangles_buffer = moveArrowTrianglesToBuffer(m_data.m_edge_arrow_triangles, m_arrow_triangle_instances);
 
-    // rotate the arrow to be aligned with the line
-    const double a = line_orientation - arrow_orientation;
-    const double sin = std::sin(a), cos = std::cos(a);
-    const auto [x_center_i, y_center_i] = points[0];
-    const auto x_center = static_cast<double>(x_center_i), y_center = static_cast<double>(y_center_i);
-    for (int i = 1; i < 3; i++) {
-        auto &p = points[i];
-        const auto [xi, yi] = p;
-        const auto x = static_cast<double>(xi) - x_center, y = static_cast<double>(yi) - y_center;
-        p.x = cos * x + sin * y + x_center;
-        p.y = -sin * x + cos * y + y_center;
+    // populate glyph vertex and instance buffers
+    for (const auto &[key, qit]: m_data.m_char_quads) {
+        std::array qs{qit.m_quad};
+        m_char_buffers.insert_or_assign(
+            key, moveGLQuadsWithCharQuadPerInstanceDataToBuffer(qs, qit.m_instances, m_char_instances[key]));
     }
 
-    renderer.m_edge_arrow_triangles.emplace_back(points, edge_color, 1);
+    // unbind buffers so I don't shoot myself in the foot
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void GLRenderer::buildArrows(const Edge &edge, const GLuint edge_color) {
-    const Node &src = m_dg.m_nodes.at(edge.m_source);
-    const Node &dest = m_dg.m_nodes.at(edge.m_dest);
-    const ssize_t rank_diff = static_cast<ssize_t>(dest.m_render_attrs.m_rank)
-                              - static_cast<ssize_t>(src.m_render_attrs.m_rank);
-    assert(rank_diff == -1 || rank_diff == 1);
-
-    // get relevant attrs
-    const std::string_view &arrow_head_type = getAttrOrDefault(edge.m_attrs, "arrowhead", "normal");
-    const std::string_view &arrow_tail_type = getAttrOrDefault(edge.m_attrs, "arrowtail", "normal");
-    const std::string_view &dir = getAttrOrDefault(edge.m_attrs, "dir", "forward");
-    const float arrow_size = getAttrTransformedCheckedOrDefault(edge.m_attrs, "arrowsize", 1.0f, stringViewToFloat);
-
-    const Node *upwards_node{}, *downwards_node{};
-    std::string_view upwards_arrow_type, downwards_arrow_type;
-    bool has_upwards_arrow{}, has_downwards_arrow{};
-    if (rank_diff == -1) {
-        upwards_node = &dest;
-        downwards_node = &src;
-        upwards_arrow_type = arrow_head_type;
-        downwards_arrow_type = arrow_tail_type;
-        if (dir == "forward") {
-            has_upwards_arrow = true;
-        } else if (dir == "backward") {
-            has_downwards_arrow = true;
-        }
-    } else {
-        upwards_node = &src;
-        downwards_node = &dest;
-        upwards_arrow_type = arrow_tail_type;
-        downwards_arrow_type = arrow_head_type;
-        if (dir == "forward") {
-            has_downwards_arrow = true;
-        } else if (dir == "backward") {
-            has_upwards_arrow = true;
-        }
-    }
-    if (dir == "both") {
-        has_downwards_arrow = true;
-        has_upwards_arrow = true;
-    }
-    has_upwards_arrow = has_upwards_arrow && !upwards_node->m_render_attrs.m_is_ghost;
-    has_downwards_arrow = has_downwards_arrow && !downwards_node->m_render_attrs.m_is_ghost;
-
-    if (has_upwards_arrow) {
-        buildArrowTriangles(*this, edge, edge_color, upwards_arrow_type, arrow_size, true);
-    }
-    if (has_downwards_arrow) {
-        buildArrowTriangles(*this, edge, edge_color, downwards_arrow_type, arrow_size, false);
+void RenderInstanceData::buildArrows(const Digraph &dg, const Edge &edge, const GLuint edge_color) {
+    const EdgeArrows arrows = getEdgeArrows(dg, edge);
+    for (size_t i = 0; i < arrows.m_n_triangles; i++) {
+        m_edge_arrow_triangles.emplace_back(arrows.m_triangles[i], edge_color, 1);
     }
 }
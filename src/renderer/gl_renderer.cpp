@@ -72,11 +72,9 @@ void GLRenderer::renderFrame() {
         static_cast<GLfloat>(m_camera_y)));
     GL_CHECK(glUniform1f(glGetUniformLocation(m_nodes_shader, "zoom"), m_zoom));
     GL_CHECK(
-        glUniform1i(glGetUniformLocation(m_nodes_shader, "is_reversed"), static_cast<GLint>(m_dg.m_render_attrs.
-            m_rank_dir.m_is_reversed)));
+        glUniform1i(glGetUniformLocation(m_nodes_shader, "is_reversed"), static_cast<GLint>(m_data.m_is_reversed)));
     GL_CHECK(
-        glUniform1i(glGetUniformLocation(m_nodes_shader, "is_sideways"), static_cast<GLint>(m_dg.m_render_attrs.
-            m_rank_dir.m_is_sideways)));
+        glUniform1i(glGetUniformLocation(m_nodes_shader, "is_sideways"), static_cast<GLint>(m_data.m_is_sideways)));
     GL_CHECK(glUniform1f(glGetUniformLocation(m_nodes_shader, "time"), static_cast<GLfloat>(time)));
 
     // draw graph
@@ -85,11 +83,11 @@ void GLRenderer::renderFrame() {
 
     // draw clusters
     GL_CHECK(glBindVertexArray(m_cluster_quads_buffer));
-    GL_CHECK(glDrawArraysInstanced(GL_POINTS, 0, 1, static_cast<GLsizei>(m_cluster_quads.size())));
+    GL_CHECK(glDrawArraysInstanced(GL_POINTS, 0, 1, static_cast<GLsizei>(m_data.m_cluster_quads.size())));
 
     // draw nodes
     GL_CHECK(glBindVertexArray(m_node_quad_buffer));
-    GL_CHECK(glDrawArraysInstanced(GL_POINTS, 0, 1, static_cast<GLsizei>(m_node_quads.size())));
+    GL_CHECK(glDrawArraysInstanced(GL_POINTS, 0, 1, static_cast<GLsizei>(m_data.m_node_quads.size())));
 
     resetGLState();
 
@@ -106,18 +104,18 @@ void GLRenderer::renderFrame() {
             static_cast<GLfloat>(m_camera_x), static_cast<GLfloat>(m_camera_y)));
         GL_CHECK(glUniform1f(glGetUniformLocation(m_edges_shader, "zoom"), m_zoom));
         GL_CHECK(glUniform1i(glGetUniformLocation(m_edges_shader, "is_reversed"),
-            static_cast<GLint>(m_dg.m_render_attrs.m_rank_dir.m_is_reversed)));
+            static_cast<GLint>(m_data.m_is_reversed)));
         GL_CHECK(glUniform1i(glGetUniformLocation(m_edges_shader, "is_sideways"),
-            static_cast<GLint>(m_dg.m_render_attrs.m_rank_dir.m_is_sideways)));
+            static_cast<GLint>(m_data.m_is_sideways)));
         GL_CHECK(glUniform1f(glGetUniformLocation(m_edges_shader, "time"), static_cast<GLfloat>(time)));
 
         if (is_splines_pass) {
             GL_CHECK(glBindVertexArray(m_edge_splines_buffer));
-            GL_CHECK(glDrawArraysInstanced(GL_POINTS, 0, static_cast<GLsizei>(m_edge_spline_points.size()),
+            GL_CHECK(glDrawArraysInstanced(GL_POINTS, 0, static_cast<GLsizei>(m_data.m_edge_spline_points.size()),
                 n_spline_divisions));
         } else {
             GL_CHECK(glBindVertexArray(m_edge_lines_buffer));
-            GL_CHECK(glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(m_edge_line_points.size())));
+            GL_CHECK(glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(m_data.m_edge_line_points.size())));
         }
 
         resetGLState();
@@ -131,15 +129,13 @@ void GLRenderer::renderFrame() {
         static_cast<GLfloat>(m_camera_y)));
     GL_CHECK(glUniform1f(glGetUniformLocation(m_arrows_shader, "zoom"), m_zoom));
     GL_CHECK(
-        glUniform1i(glGetUniformLocation(m_arrows_shader, "is_reversed"), static_cast<GLint>(m_dg.m_render_attrs.
-            m_rank_dir.m_is_reversed)));
+        glUniform1i(glGetUniformLocation(m_arrows_shader, "is_reversed"), static_cast<GLint>(m_data.m_is_reversed)));
     GL_CHECK(
-        glUniform1i(glGetUniformLocation(m_arrows_shader, "is_sideways"), static_cast<GLint>(m_dg.m_render_attrs.
-            m_rank_dir.m_is_sideways)));
+        glUniform1i(glGetUniformLocation(m_arrows_shader, "is_sideways"), static_cast<GLint>(m_data.m_is_sideways)));
     GL_CHECK(glUniform1f(glGetUniformLocation(m_arrows_shader, "time"), static_cast<GLfloat>(time)));
 
     GL_CHECK(glBindVertexArray(m_arrow_triangles_buffer));
-    GL_CHECK(glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(m_edge_arrow_triangles.size())));
+    GL_CHECK(glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(m_data.m_edge_arrow_triangles.size())));
 
     resetGLState();
 
@@ -149,7 +145,7 @@ void GLRenderer::renderFrame() {
     // loaders internal glyph cache, meaning we won't do any rendering next time we call it (i.e. in the text rendering
     // loop, the next step after this)
     m_glyph_loader.startLoading();
-    for (const auto &gci: std::views::keys(m_char_quads)) {
+    for (const auto &gci: std::views::keys(m_data.m_char_quads)) {
         const auto [c, font_size_zoomed] = transformGciForZoom(gci, m_zoom);
         if (font_size_zoomed == 0) {
             continue;
@@ -167,14 +163,12 @@ void GLRenderer::renderFrame() {
     GL_CHECK(glUniform1f(glGetUniformLocation(m_chars_shader, "zoom"), m_zoom));
     GL_CHECK(glUniform1i(glGetUniformLocation(m_chars_shader, "font_texture"), 0)); // Texture unit 0
     GL_CHECK(
-        glUniform1i(glGetUniformLocation(m_chars_shader, "is_reversed"), static_cast<GLint>(m_dg.m_render_attrs.
-            m_rank_dir.m_is_reversed)));
+        glUniform1i(glGetUniformLocation(m_chars_shader, "is_reversed"), static_cast<GLint>(m_data.m_is_reversed)));
     GL_CHECK(
-        glUniform1i(glGetUniformLocation(m_chars_shader, "is_sideways"), static_cast<GLint>(m_dg.m_render_attrs.
-            m_rank_dir.m_is_sideways)));
+        glUniform1i(glGetUniformLocation(m_chars_shader, "is_sideways"), static_cast<GLint>(m_data.m_is_sideways)));
     GL_CHECK(glUniform1f(glGetUniformLocation(m_chars_shader, "time"), static_cast<GLfloat>(time)));
 
-    for (const auto &gci: std::views::keys(m_char_quads)) {
+    for (const auto &gci: std::views::keys(m_data.m_char_quads)) {
         const auto [c, font_size_zoomed] = transformGciForZoom(gci, m_zoom);
         if (font_size_zoomed == 0) {
             continue;
@@ -187,7 +181,7 @@ void GLRenderer::renderFrame() {
         GL_CHECK(glBindTexture(GL_TEXTURE_2D, glyph_texture));
         GL_CHECK(glBindVertexArray(m_char_buffers.at(gci)));
         GL_CHECK(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
-            static_cast<GLsizei>(m_char_quads.at(gci).m_instances.size())));
+            static_cast<GLsizei>(m_data.m_char_quads.at(gci).m_instances.size())));
         glBindVertexArray(0);
     }
 
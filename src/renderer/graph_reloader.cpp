@@ -0,0 +1,112 @@
+#include "punkt/graph_reloader.hpp"
+#include "punkt/dot.hpp"
+#include "punkt/dot_tokenizer.hpp"
+#include "punkt/gl_renderer.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+
+using namespace punkt;
+using namespace punkt::render;
+using tokenizer::Token;
+
+// whether a statement may start right after `token`, i.e. appended statements cannot merge with the preceding one
+static bool endsStatement(const Token &token) {
+    switch (token.m_type) {
+        case Token::Type::semicolon:
+        case Token::Type::lcurly:
+        case Token::Type::rcurly:
+        case Token::Type::rsq:
+        case Token::Type::string:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// tokenizes `source` after moving it into `token_storage`, which the tokens then point into
+static std::vector<Token> tokenizeStored(Digraph &token_storage, std::string source,
+                                         std::vector<size_t> *out_offsets = nullptr) {
+    const std::string &stored = token_storage.m_referenced_sources.emplace_front(std::move(source));
+    return tokenizer::tokenize(token_storage, stored, out_offsets);
+}
+
+GraphReloader::GraphReloader(std::string source, glyph::GlyphLoader &glyph_loader)
+    : m_glyph_loader(glyph_loader), m_digraph(std::make_unique<Digraph>(source)) {
+    m_tokens = tokenizeStored(m_token_storage, std::move(source));
+    m_digraph->preprocess(m_glyph_loader);
+}
+
+RenderInstanceData GraphReloader::getRenderInstanceData() const {
+    return RenderInstanceData(*m_digraph);
+}
+
+std::optional<std::string> GraphReloader::getAppendedSource(const std::string_view source,
+                                                            const std::vector<Token> &tokens,
+                                                            const std::vector<size_t> &token_offsets) const {
+    // both streams end with `}` and eos, the old one must be a prefix of the new one up to its final `}`
+    if (m_tokens.size() < 3 || tokens.size() <= m_tokens.size()) {
+        return std::nullopt;
+    }
+    const size_t n_kept = m_tokens.size() - 2;
+    if (m_tokens[n_kept].m_type != Token::Type::rcurly || tokens[tokens.size() - 2].m_type != Token::Type::rcurly ||
+        !endsStatement(m_tokens[n_kept - 1])) {
+        return std::nullopt;
+    }
+    if (!std::equal(m_tokens.begin(), m_tokens.begin() + static_cast<ssize_t>(n_kept), tokens.begin())) {
+        return std::nullopt;
+    }
+    if (const Token::Type first = tokens[n_kept].m_type; first != Token::Type::string && first != Token::Type::kwd) {
+        return std::nullopt;
+    }
+    // the appended statements, including the final `}`
+    return "digraph {" + std::string(source.substr(token_offsets[n_kept]));
+}
+
+std::optional<RenderInstanceData> GraphReloader::reload(std::string source) {
+    Digraph token_storage;
+    std::vector<size_t> token_offsets;
+    std::vector<Token> tokens = tokenizeStored(token_storage, std::move(source), &token_offsets);
+    const std::string_view stored_source = token_storage.m_referenced_sources.front();
+    if (m_digraph && tokens == m_tokens) {
+        return std::nullopt;
+    }
+
+    std::optional<std::string> appended_source;
+    if (m_digraph) {
+        appended_source = getAppendedSource(stored_source, tokens, token_offsets);
+    }
+    bool is_updated = false;
+    if (appended_source) {
+        try {
+            m_digraph->update(*appended_source);
+            m_digraph->relayout(m_glyph_loader);
+            is_updated = true;
+            m_n_incremental_reloads++;
+        } catch (...) {
+            // the update may have been applied partially, start over from the full source below (which most likely
+            // reports the same error)
+            m_digraph.reset();
+        }
+    }
+    if (!is_updated) {
+        auto dg = std::make_unique<Digraph>(stored_source);
+        dg->preprocess(m_glyph_loader);
+        m_digraph = std::move(dg);
+        m_n_full_reloads++;
+    }
+
+    m_token_storage = std::move(token_storage);
+    m_tokens = std::move(tokens);
+    return RenderInstanceData(*m_digraph);
+}
+
+size_t GraphReloader::getNumIncrementalReloads() const {
+    return m_n_incremental_reloads;
+}
+
+size_t GraphReloader::getNumFullReloads() const {
+    return m_n_full_reloads;
+}
@@ -0,0 +1,381 @@
+#include "punkt/layout_export.hpp"
+#include "punkt/dot.hpp"
+#include "punkt/dot_constants.hpp"
+#include "punkt/render_geometry.hpp"
+#include "punkt/utils/buffered_writer.hpp"
+#include "punkt/utils/utils.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string_view>
+#include <vector>
+
+using namespace punkt;
+using namespace punkt::render;
+
+constexpr double points_per_inch = 72.0;
+constexpr int plain_export_decimals = 4;
+constexpr int json_export_decimals = 2;
+
+namespace {
+struct ExportPoint {
+    double x, y;
+};
+
+// converts layout coordinates into graphviz's (displayed, origin bottom left, y up)
+struct ExportFrame {
+    DisplayTransform m_display;
+    // output units per punkt unit
+    double m_scale;
+
+    [[nodiscard]] ExportPoint toExport(const double x, const double y) const {
+        const Vector2<double> p = m_display.apply(x, y);
+        return {p.x * m_scale, (m_display.getHeight() - p.y) * m_scale};
+    }
+
+    // the displayed size of a box of the given layout size
+    [[nodiscard]] ExportPoint getSize(const size_t width, const size_t height) const {
+        const auto w = static_cast<double>(width), h = static_cast<double>(height);
+        return m_display.m_rank_dir.m_is_sideways ? ExportPoint{h, w} : ExportPoint{w, h};
+    }
+};
+
+struct LabelBox {
+    size_t m_left{std::numeric_limits<size_t>::max()}, m_top{std::numeric_limits<size_t>::max()}, m_right{},
+            m_bottom{};
+
+    void add(const std::vector<GlyphQuad> &quads) {
+        for (const GlyphQuad &quad: quads) {
+            m_left = std::min(m_left, quad.m_left);
+            m_top = std::min(m_top, quad.m_top);
+            m_right = std::max(m_right, quad.m_right);
+            m_bottom = std::max(m_bottom, quad.m_bottom);
+        }
+    }
+
+    [[nodiscard]] bool isEmpty() const {
+        return m_left > m_right;
+    }
+};
+
+// an edge of the input graph, drawn as one or more segments (more if the layout split it at ghost nodes)
+struct ExportedEdge {
+    const Edge &m_edge;
+    std::span<const Edge *const> m_segments;
+
+    // The joined trajectory. Consecutive segments meet at the top and bottom of a ghost node, spline segments are
+    // connected there by a straight Bezier segment, so the trajectory keeps the 3n + 1 control points graphviz uses.
+    template<typename F>
+    void forEachPoint(F f) const {
+        const Vector2<size_t> *prev = nullptr;
+        for (const Edge *segment: m_segments) {
+            const std::vector<Vector2<size_t> > &trajectory = segment->m_render_attrs.m_trajectory;
+            for (size_t i = 0; i < trajectory.size(); i++) {
+                if (i != 0 || !prev) {
+                    f(trajectory[i]);
+                } else if (trajectory[i] != *prev) {
+                    if (isSpline()) {
+                        f(*prev);
+                        f(trajectory[i]);
+                    }
+                    f(trajectory[i]);
+                }
+            }
+            if (!trajectory.empty()) {
+                prev = &trajectory.back();
+            }
+        }
+    }
+
+    [[nodiscard]] size_t getNumPoints() const {
+        size_t n = 0;
+        forEachPoint([&n](const Vector2<size_t> &) { n++; });
+        return n;
+    }
+
+    [[nodiscard]] bool isSpline() const {
+        return m_segments.front()->m_render_attrs.m_is_spline;
+    }
+
+    [[nodiscard]] std::optional<std::string_view> getLabel() const {
+        if (!m_edge.m_attrs.contains("label")) {
+            return std::nullopt;
+        }
+        return m_edge.m_attrs.at("label");
+    }
+
+    // where the label ended up, see getGhostEdgeAttrs: on the middle segment, or as the tail label of the segment after
+    // the middle if the edge has an even number of segments
+    [[nodiscard]] LabelBox getLabelBox() const {
+        LabelBox box;
+        for (size_t i = 0; i < m_segments.size(); i++) {
+            box.add(m_segments[i]->m_render_attrs.m_label_quads);
+            if (i != 0) {
+                box.add(m_segments[i]->m_render_attrs.m_tail_label_quads);
+            }
+        }
+        return box;
+    }
+};
+}
+
+DisplayTransform::DisplayTransform(const Digraph &dg)
+    : m_rank_dir(dg.m_render_attrs.m_rank_dir), m_layout_width(static_cast<double>(dg.m_render_attrs.m_graph_width)),
+      m_layout_height(static_cast<double>(dg.m_render_attrs.m_graph_height)) {
+}
+
+Vector2<double> DisplayTransform::apply(const double x, const double y) const {
+    Vector2<double> p = m_rank_dir.m_is_sideways ? Vector2{y, x} : Vector2{x, y};
+    if (m_rank_dir.m_is_reversed) {
+        if (m_rank_dir.m_is_sideways) {
+            p.x = getWidth() - p.x;
+        } else {
+            p.y = getHeight() - p.y;
+        }
+    }
+    return p;
+}
+
+double DisplayTransform::getWidth() const {
+    return m_rank_dir.m_is_sideways ? m_layout_height : m_layout_width;
+}
+
+double DisplayTransform::getHeight() const {
+    return m_rank_dir.m_is_sideways ? m_layout_width : m_layout_height;
+}
+
+// the nodes of the input graph in id order, ghost nodes are part of the edges
+static std::vector<const Node *> getExportedNodes(const Digraph &dg) {
+    std::vector<const Node *> nodes;
+    nodes.reserve(dg.m_nodes.size());
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        if (!node.m_render_attrs.m_is_ghost) {
+            nodes.push_back(&node);
+        }
+    }
+    std::ranges::stable_sort(nodes, [](const Node *a, const Node *b) { return a->m_id < b->m_id; });
+    return nodes;
+}
+
+// Calls f(ExportedEdge) for every edge of the input graph leaving `node`. An edge split at ghost nodes stays as an
+// invisible edge without trajectory next to the chain of ghost edges that replaces it, so each such edge is matched
+// with an unused chain that leads to its destination.
+template<typename F>
+static void forEachExportedEdge(const Digraph &dg, const Node &node, F f) {
+    struct Chain {
+        std::string_view m_dest;
+        size_t m_begin, m_end;
+        bool m_is_used;
+    };
+    std::vector<const Edge *> chain_segments;
+    std::vector<Chain> chains;
+    for (const Edge &edge: node.m_outgoing) {
+        if (edge.m_render_attrs.m_trajectory.empty() || !dg.m_nodes.at(edge.m_dest).m_render_attrs.m_is_ghost) {
+            continue;
+        }
+        const size_t begin = chain_segments.size();
+        const Edge *segment = &edge;
+        chain_segments.push_back(segment);
+        while (dg.m_nodes.at(segment->m_dest).m_render_attrs.m_is_ghost) {
+            const Node &ghost = dg.m_nodes.at(segment->m_dest);
+            if (ghost.m_outgoing.empty()) {
+                break;
+            }
+            segment = &ghost.m_outgoing.front();
+            chain_segments.push_back(segment);
+        }
+        chains.push_back({segment->m_dest, begin, chain_segments.size(), false});
+    }
+
+    for (const Edge &edge: node.m_outgoing) {
+        if (!edge.m_render_attrs.m_trajectory.empty()) {
+            if (!dg.m_nodes.at(edge.m_dest).m_render_attrs.m_is_ghost) {
+                const Edge *const segment = &edge;
+                f(ExportedEdge{edge, std::span(&segment, 1)});
+            }
+            continue;
+        }
+        const auto chain = std::ranges::find_if(chains, [&](const Chain &c) {
+            return !c.m_is_used && c.m_dest == edge.m_dest;
+        });
+        if (chain != chains.end()) {
+            chain->m_is_used = true;
+            f(ExportedEdge{
+                edge, std::span(chain_segments).subspan(chain->m_begin, chain->m_end - chain->m_begin)
+            });
+        }
+    }
+}
+
+// whether graphviz would write the string without quotes (an identifier or a number)
+static bool isPlainId(const std::string_view s) {
+    if (s.empty()) {
+        return false;
+    }
+    const auto isIdChar = [](const char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || static_cast<unsigned char>(c) >= 0x80;
+    };
+    if (!std::isdigit(static_cast<unsigned char>(s.front())) && s.front() != '-' && s.front() != '.') {
+        return std::ranges::all_of(s, isIdChar);
+    }
+    const std::string_view digits = s.front() == '-' ? s.substr(1) : s;
+    const auto isNumeralChar = [](const char c) {
+        return std::isdigit(static_cast<unsigned char>(c)) || c == '.';
+    };
+    return !digits.empty() && digits != "." && std::ranges::count(digits, '.') <= 1
+           && std::ranges::all_of(digits, isNumeralChar);
+}
+
+static void writePlainString(BufferedWriter &out, const std::string_view s) {
+    if (isPlainId(s)) {
+        out << s;
+        return;
+    }
+    out << '"';
+    for (const char c: s) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (c == '\n') {
+            out << "\\n";
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+void render::writeLayoutPlain(const Digraph &dg, std::ostream &out) {
+    BufferedWriter w(out);
+    const ExportFrame frame{DisplayTransform(dg), 1.0 / points_per_inch};
+    const auto writeInches = [&](const double x) -> BufferedWriter &{
+        return w.writeDecimal(x * frame.m_scale, plain_export_decimals);
+    };
+    const auto writePoint = [&](const double x, const double y) {
+        const ExportPoint p = frame.toExport(x, y);
+        w << ' ';
+        w.writeDecimal(p.x, plain_export_decimals) << ' ';
+        w.writeDecimal(p.y, plain_export_decimals);
+    };
+
+    w << "graph 1 ";
+    writeInches(frame.m_display.getWidth()) << ' ';
+    writeInches(frame.m_display.getHeight()) << '\n';
+
+    const std::vector<const Node *> nodes = getExportedNodes(dg);
+    for (const Node *node: nodes) {
+        const NodeRenderAttrs &ra = node->m_render_attrs;
+        w << "node ";
+        writePlainString(w, node->m_name);
+        writePoint(static_cast<double>(ra.m_x) + static_cast<double>(ra.m_width) / 2.0,
+                   static_cast<double>(ra.m_y) + static_cast<double>(ra.m_height) / 2.0);
+        const ExportPoint size = frame.getSize(ra.m_width, ra.m_height);
+        w << ' ';
+        writeInches(size.x) << ' ';
+        writeInches(size.y) << ' ';
+        writePlainString(w, getAttrOrDefault(node->m_attrs, "label", node->m_name));
+        w << ' ';
+        writePlainString(w, getAttrOrDefault(node->m_attrs, "style", "solid"));
+        w << ' ';
+        writePlainString(w, getAttrOrDefault(node->m_attrs, "shape", default_shape));
+        w << ' ';
+        writePlainString(w, getAttrOrDefault(node->m_attrs, "color", "black"));
+        w << ' ';
+        writePlainString(w, getFillColor(node->m_attrs));
+        w << '\n';
+    }
+
+    for (const Node *node: nodes) {
+        forEachExportedEdge(dg, *node, [&](const ExportedEdge &edge) {
+            w << "edge ";
+            writePlainString(w, edge.m_edge.m_source);
+            w << ' ';
+            writePlainString(w, edge.m_edge.m_dest);
+            w << ' ' << edge.getNumPoints();
+            edge.forEachPoint([&](const Vector2<size_t> &p) {
+                writePoint(static_cast<double>(p.x), static_cast<double>(p.y));
+            });
+            if (const std::optional<std::string_view> label = edge.getLabel()) {
+                if (const LabelBox box = edge.getLabelBox(); !box.isEmpty()) {
+                    w << ' ';
+                    writePlainString(w, *label);
+                    writePoint(static_cast<double>(box.m_left + box.m_right) / 2.0,
+                               static_cast<double>(box.m_top + box.m_bottom) / 2.0);
+                }
+            }
+            w << ' ';
+            writePlainString(w, getAttrOrDefault(edge.m_edge.m_attrs, "style", "solid"));
+            w << ' ';
+            writePlainString(w, getAttrOrDefault(edge.m_edge.m_attrs, "color", "black"));
+            w << '\n';
+        });
+    }
+    w << "stop\n";
+}
+
+void render::writeLayoutJson(const Digraph &dg, std::ostream &out) {
+    BufferedWriter w(out);
+    const ExportFrame frame{DisplayTransform(dg), 1.0};
+    const auto writeXY = [&](const std::string_view x_key, const std::string_view y_key, const double x,
+                             const double y) {
+        const ExportPoint p = frame.toExport(x, y);
+        w << x_key;
+        w.writeDecimal(p.x, json_export_decimals) << y_key;
+        w.writeDecimal(p.y, json_export_decimals);
+    };
+
+    w << R"({"directed":true,"width":)";
+    w.writeDecimal(frame.m_display.getWidth(), json_export_decimals) << R"(,"height":)";
+    w.writeDecimal(frame.m_display.getHeight(), json_export_decimals) << R"(,"nodes":[)";
+    const std::vector<const Node *> nodes = getExportedNodes(dg);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const Node &node = *nodes[i];
+        const NodeRenderAttrs &ra = node.m_render_attrs;
+        w << (i ? R"(,{"name":)" : R"({"name":)");
+        w.writeJsonString(node.m_name) << R"(,"label":)";
+        w.writeJsonString(getAttrOrDefault(node.m_attrs, "label", node.m_name));
+        writeXY(R"(,"x":)", R"(,"y":)", static_cast<double>(ra.m_x) + static_cast<double>(ra.m_width) / 2.0,
+                static_cast<double>(ra.m_y) + static_cast<double>(ra.m_height) / 2.0);
+        const ExportPoint size = frame.getSize(ra.m_width, ra.m_height);
+        w << R"(,"width":)";
+        w.writeDecimal(size.x, json_export_decimals) << R"(,"height":)";
+        w.writeDecimal(size.y, json_export_decimals) << R"(,"shape":)";
+        w.writeJsonString(getAttrOrDefault(node.m_attrs, "shape", default_shape)) << R"(,"style":)";
+        w.writeJsonString(getAttrOrDefault(node.m_attrs, "style", "solid")) << R"(,"color":)";
+        w.writeJsonString(getAttrOrDefault(node.m_attrs, "color", "black")) << R"(,"fillcolor":)";
+        w.writeJsonString(getFillColor(node.m_attrs)) << '}';
+    }
+
+    w << R"(],"edges":[)";
+    bool is_first_edge = true;
+    for (const Node *node: nodes) {
+        forEachExportedEdge(dg, *node, [&](const ExportedEdge &edge) {
+            w << (is_first_edge ? R"({"tail":)" : R"(,{"tail":)");
+            is_first_edge = false;
+            w.writeJsonString(edge.m_edge.m_source) << R"(,"head":)";
+            w.writeJsonString(edge.m_edge.m_dest) << R"(,"points":[)";
+            bool is_first_point = true;
+            edge.forEachPoint([&](const Vector2<size_t> &p) {
+                writeXY(is_first_point ? "[" : ",[", ",", static_cast<double>(p.x), static_cast<double>(p.y));
+                w << ']';
+                is_first_point = false;
+            });
+            w << R"(],"spline":)" << (edge.isSpline() ? "true" : "false") << R"(,"style":)";
+            w.writeJsonString(getAttrOrDefault(edge.m_edge.m_attrs, "style", "solid")) << R"(,"color":)";
+            w.writeJsonString(getAttrOrDefault(edge.m_edge.m_attrs, "color", "black"));
+            if (const std::optional<std::string_view> label = edge.getLabel()) {
+                if (const LabelBox box = edge.getLabelBox(); !box.isEmpty()) {
+                    w << R"(,"label":)";
+                    w.writeJsonString(*label);
+                    writeXY(R"(,"label_x":)", R"(,"label_y":)", static_cast<double>(box.m_left + box.m_right) / 2.0,
+                            static_cast<double>(box.m_top + box.m_bottom) / 2.0);
+                }
+            }
+            w << '}';
+        });
+    }
+    w << "]}\n";
+}
@@ -0,0 +1,95 @@
+#include "punkt/progressive_layout.hpp"
+#include "punkt/dot.hpp"
+#include "punkt/dot_constants.hpp"
+#include "punkt/gl_renderer.hpp"
+
+#include <string>
+#include <utility>
+
+using namespace punkt;
+using namespace punkt::render;
+
+ProgressiveLayout::ProgressiveLayout(std::string source, glyph::GlyphLoader &glyph_loader)
+    : m_source(std::move(source)), m_glyph_loader(glyph_loader) {
+    m_worker = std::thread(&ProgressiveLayout::run, this);
+}
+
+ProgressiveLayout::~ProgressiveLayout() {
+    stop();
+}
+
+void ProgressiveLayout::stop() {
+    m_stop_requested = true;
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+void ProgressiveLayout::publish(RenderInstanceData data, const bool is_final) {
+    {
+        std::lock_guard lock(m_mutex);
+        m_pending = std::move(data);
+        m_n_published++;
+        m_is_done = is_final;
+    }
+    m_published.notify_all();
+}
+
+void ProgressiveLayout::run() {
+    try {
+        const size_t n_passes = PROGRESSIVE_LAYOUT_PASS_TIME_BUDGETS_MS.size() + 1;
+        for (size_t pass = 0; pass < n_passes && !m_stop_requested; pass++) {
+            // every pass starts from scratch, the layout stages keep global state and cannot be resumed
+            Digraph dg{m_source};
+            const bool is_final = pass + 1 == n_passes;
+            if (!is_final) {
+                const std::string &time_budget = dg.m_referenced_sources.emplace_front(
+                    std::to_string(PROGRESSIVE_LAYOUT_PASS_TIME_BUDGETS_MS[pass]) + "ms");
+                dg.m_attrs.insert_or_assign("punkttimebudget", time_budget);
+            }
+            dg.preprocess(m_glyph_loader);
+            publish(RenderInstanceData(dg), is_final);
+        }
+    } catch (...) {
+        {
+            std::lock_guard lock(m_mutex);
+            m_error = std::current_exception();
+            m_is_done = true;
+        }
+        m_published.notify_all();
+    }
+}
+
+RenderInstanceData ProgressiveLayout::waitForLayout() {
+    std::unique_lock lock(m_mutex);
+    m_published.wait(lock, [this] { return m_pending.has_value() || m_error; });
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+    RenderInstanceData data = std::move(*m_pending);
+    m_pending.reset();
+    return data;
+}
+
+std::optional<RenderInstanceData> ProgressiveLayout::takeLatest() {
+    const std::unique_lock lock(m_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return std::nullopt;
+    }
+    if (m_error) {
+        std::rethrow_exception(std::exchange(m_error, nullptr));
+    }
+    std::optional<RenderInstanceData> data = std::move(m_pending);
+    m_pending.reset();
+    return data;
+}
+
+size_t ProgressiveLayout::getNumPublished() {
+    std::lock_guard lock(m_mutex);
+    return m_n_published;
+}
+
+bool ProgressiveLayout::isDone() {
+    std::lock_guard lock(m_mutex);
+    return m_is_done;
+}
@@ -0,0 +1,236 @@
+#include "punkt/render_geometry.hpp"
+#include "punkt/dot.hpp"
+#include "punkt/dot_constants.hpp"
+#include "punkt/utils/utils.hpp"
+#include "punkt/utils/int_types.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <numbers>
+#include <span>
+
+using namespace punkt;
+using namespace punkt::render;
+
+uint32_t render::getNodeShapeId(const Node &node) {
+    if (const std::string_view &shape = getAttrOrDefault(node.m_attrs, "shape", default_shape); shape == "none") {
+        return node_shape_none;
+    } else if (shape == "ellipse") {
+        return node_shape_ellipse;
+    } else if (shape == "circle") {
+        return node_shape_circle;
+    } else if (shape == "pill") {
+        return node_shape_pill;
+    }
+    return node_shape_box;
+}
+
+std::string_view render::getFillColor(const Attrs &attrs) {
+    if (attrs.contains("fillcolor")) {
+        return attrs.at("fillcolor");
+    }
+    if (caseInsensitiveEquals(getAttrOrDefault(attrs, "style", "normal"), "filled")) {
+        return getAttrOrDefault(attrs, "color", "black");
+    }
+    return "white";
+}
+
+size_t render::getEdgeThickness(const Edge &edge) {
+    const float edge_pen_width = getAttrTransformedCheckedOrDefault(edge.m_attrs, "penwidth", 1.0f, stringViewToFloat);
+    // TODO handle custom dpi
+    constexpr auto dpi = DEFAULT_DPI;
+    return static_cast<size_t>(edge_pen_width * static_cast<float>(dpi) / static_cast<float>(DEFAULT_DPI));
+}
+
+bool render::isEdgeDrawnAsSpline(const Digraph &dg, const Edge &edge) {
+    // only render as spline if that is enabled obviously
+    if (!edge.m_render_attrs.m_is_spline) {
+        return false;
+    }
+    const Node &src = dg.m_nodes.at(edge.m_source);
+    const Node &dest = dg.m_nodes.at(edge.m_dest);
+    const auto source_rank_height = dg.m_render_attrs.m_rank_render_attrs.at(src.m_render_attrs.m_rank).m_rank_height;
+    const auto dest_rank_height = dg.m_render_attrs.m_rank_render_attrs.at(dest.m_render_attrs.m_rank).m_rank_height;
+    // only render as spline if rendering as a spline makes a difference visually (splines are expensive)
+    return src.m_render_attrs.m_height < source_rank_height || dest.m_render_attrs.m_height < dest_rank_height ||
+           getNodeShapeId(src) != node_shape_box || getNodeShapeId(dest) != node_shape_box;
+}
+
+// determine whether two points for computing the angle of an arrow are too close together and should preferably not
+// be used. Policy: line must be longer than arrow.
+static bool pointsTooCloseToComputeArrowAngle(const Vector2<size_t> &a, const Vector2<size_t> &b,
+                                              const double arrow_size) {
+    const auto dx = static_cast<double>(a.x) - static_cast<double>(b.x);
+    const auto dy = static_cast<double>(a.y) - static_cast<double>(b.y);
+    return dx * dx + dy * dy <= arrow_size * arrow_size;
+}
+
+static double getArrowAngle(const std::span<const Vector2<size_t>> trajectory, const bool go_backward,
+                            const double arrow_size) {
+    const auto &a = go_backward ? trajectory.back() : trajectory.front();
+
+    // the next point in the line (either before or after depending on go_backward) may be the same point duplicated
+    // and therefore not usable for computing the angle of the line. Therefore, we have to search the first one that
+    // is not equal.
+    int start, stop, step;
+    if (go_backward) {
+        start = static_cast<int>(trajectory.size()) - 2;
+        stop = -1;
+        step = -1;
+    } else {
+        start = 1;
+        stop = static_cast<int>(trajectory.size());
+        step = 1;
+    }
+    size_t i;
+    for (i = start; i != stop; i += step) {
+        if (const auto &b = trajectory[i]; !pointsTooCloseToComputeArrowAngle(a, b, arrow_size)) {
+            break;
+        }
+    }
+    if (i == stop) {
+        // check for exact equivalence: if exactly equal, cannot compute angle -> default to 0. Otherwise, meaning they
+        // are just very close together, use anyway as it's the least bad option.
+        i += step;
+        if (const auto &b = trajectory[i]; a == b) {
+            return 0.0;
+        }
+    }
+
+    // found other reference point for line
+    const auto &b = trajectory[i];
+    // a and b are swapped in the Y term (first parameter) because y in my coordinate system is down instead of up
+    return std::atan2(static_cast<double>(b.y) - static_cast<double>(a.y),
+                      static_cast<double>(a.x) - static_cast<double>(b.x));
+}
+
+static Vector2<double> getLineEndPointForArrow(const std::span<const Vector2<size_t>> trajectory,
+                                               const bool get_min, double &orientation,
+                                               const double arrow_size) {
+    assert(trajectory.size() == 4);
+    if (trajectory.front().y < trajectory.back().y) {
+        if (get_min) {
+            const auto [x, y] = trajectory.front();
+            orientation = getArrowAngle(trajectory, false, arrow_size);
+            return Vector2(static_cast<double>(x), static_cast<double>(y));
+        } else {
+            const auto [x, y] = trajectory.back();
+            orientation = getArrowAngle(trajectory, true, arrow_size);
+            return Vector2(static_cast<double>(x), static_cast<double>(y));
+        }
+    } else {
+        if (get_min) {
+            const auto [x, y] = trajectory.back();
+            orientation = getArrowAngle(trajectory, true, arrow_size);
+            return Vector2(static_cast<double>(x), static_cast<double>(y));
+        } else {
+            const auto [x, y] = trajectory.front();
+            orientation = getArrowAngle(trajectory, false, arrow_size);
+            return Vector2(static_cast<double>(x), static_cast<double>(y));
+        }
+    }
+}
+
+static void buildArrowTriangle(EdgeArrows &arrows, const Edge &edge, const std::string_view arrow_type,
+                               const float arrow_size, const bool is_upward) {
+    if (arrow_type == "none") {
+        return;
+    }
+
+    // TODO support more arrow types - for now, every type emits a normal arrow as "fallback"
+    std::array<Vector2<double>, 3> &points = arrows.m_triangles.at(arrows.m_n_triangles++);
+    // TODO handle custom dpi
+    constexpr auto dpi = DEFAULT_DPI;
+    const auto arrow_size_pix = arrow_size * arrow_scale * static_cast<float>(dpi) / static_cast<float>(DEFAULT_DPI);
+
+    double line_orientation, arrow_orientation;
+    if (is_upward) {
+        auto top = getLineEndPointForArrow(edge.m_render_attrs.m_trajectory, true, line_orientation, arrow_size);
+        // since arrows store their coordinates in double precision instead of size_t (i.e. they are not limited to the
+        // normal layout grid that other stuff is limited to position-wise), we have to adjust the x so the arrow is
+        // centered inside the grid cell it's at.
+        top.x += 0.5;
+        const auto left = Vector2(top.x - arrow_size_pix / 2, top.y + arrow_size_pix);
+        const auto right = Vector2(top.x + arrow_size_pix / 2, top.y + arrow_size_pix);
+        points[0] = top;
+        points[1] = left;
+        points[2] = right;
+        arrow_orientation = std::numbers::pi * 0.5;
+    } else {
+        auto bottom = getLineEndPointForArrow(edge.m_render_attrs.m_trajectory, false, line_orientation, arrow_size);
+        bottom.x += 0.5; // for explanation, see ~10 lines above
+        const auto left = Vector2(bottom.x - arrow_size_pix / 2, bottom.y - arrow_size_pix);
+        const auto right = Vector2(bottom.x + arrow_size_pix / 2, bottom.y - arrow_size_pix);
+        points[0] = bottom;
+        points[1] = left;
+        points[2] = right;
+        arrow_orientation = std::numbers::pi * 1.5;
+    }
+
+    // rotate the arrow to be aligned with the line
+    const double a = line_orientation - arrow_orientation;
+    const double sin = std::sin(a), cos = std::cos(a);
+    const auto [x_center_i, y_center_i] = points[0];
+    const auto x_center = static_cast<double>(x_center_i), y_center = static_cast<double>(y_center_i);
+    for (int i = 1; i < 3; i++) {
+        auto &p = points[i];
+        const auto [xi, yi] = p;
+        const auto x = static_cast<double>(xi) - x_center, y = static_cast<double>(yi) - y_center;
+        p.x = cos * x + sin * y + x_center;
+        p.y = -sin * x + cos * y + y_center;
+    }
+}
+
+EdgeArrows render::getEdgeArrows(const Digraph &dg, const Edge &edge) {
+    const Node &src = dg.m_nodes.at(edge.m_source);
+    const Node &dest = dg.m_nodes.at(edge.m_dest);
+    const ssize_t rank_diff = static_cast<ssize_t>(dest.m_render_attrs.m_rank)
+                              - static_cast<ssize_t>(src.m_render_attrs.m_rank);
+    assert(rank_diff == -1 || rank_diff == 1);
+
+    // get relevant attrs
+    const std::string_view &arrow_head_type = getAttrOrDefault(edge.m_attrs, "arrowhead", "normal");
+    const std::string_view &arrow_tail_type = getAttrOrDefault(edge.m_attrs, "arrowtail", "normal");
+    const std::string_view &dir = getAttrOrDefault(edge.m_attrs, "dir", "forward");
+    const float arrow_size = getAttrTransformedCheckedOrDefault(edge.m_attrs, "arrowsize", 1.0f, stringViewToFloat);
+
+    const Node *upwards_node{}, *downwards_node{};
+    std::string_view upwards_arrow_type, downwards_arrow_type;
+    bool has_upwards_arrow{}, has_downwards_arrow{};
+    if (rank_diff == -1) {
+        upwards_node = &dest;
+        downwards_node = &src;
+        upwards_arrow_type = arrow_head_type;
+        downwards_arrow_type = arrow_tail_type;
+        if (dir == "forward") {
+            has_upwards_arrow = true;
+        } else if (dir == "backward") {
+            has_downwards_arrow = true;
+        }
+    } else {
+        upwards_node = &src;
+        downwards_node = &dest;
+        upwards_arrow_type = arrow_tail_type;
+        downwards_arrow_type = arrow_head_type;
+        if (dir == "forward") {
+            has_downwards_arrow = true;
+        } else if (dir == "backward") {
+            has_upwards_arrow = true;
+        }
+    }
+    if (dir == "both") {
+        has_downwards_arrow = true;
+        has_upwards_arrow = true;
+    }
+    has_upwards_arrow = has_upwards_arrow && !upwards_node->m_render_attrs.m_is_ghost;
+    has_downwards_arrow = has_downwards_arrow && !downwards_node->m_render_attrs.m_is_ghost;
+
+    EdgeArrows arrows;
+    if (has_upwards_arrow) {
+        buildArrowTriangle(arrows, edge, upwards_arrow_type, arrow_size, true);
+    }
+    if (has_downwards_arrow) {
+        buildArrowTriangle(arrows, edge, downwards_arrow_type, arrow_size, false);
+    }
+    return arrows;
+}
@@ -0,0 +1,416 @@
+#include "punkt/snapshot.hpp"
+#include "punkt/dot.hpp"
+#include "punkt/dot_constants.hpp"
+#include "punkt/gl_renderer.hpp"
+#include "punkt/glyph_loader/glyph_loader.hpp"
+#include "punkt/utils/int_types.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <ranges>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PUNKT_SNAPSHOT_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace punkt;
+using namespace punkt::render;
+
+constexpr char snapshot_file_magic[8] = {'P', 'U', 'N', 'K', 'T', 'S', 'N', '\n'};
+constexpr uint32_t snapshot_byte_order_mark = 0x01020304;
+// every section starts at a multiple of this, so its records can be used in place
+constexpr size_t section_alignment = 8;
+
+enum SnapshotSection : size_t {
+    strings_section,
+    nodes_section,
+    edges_section,
+    trajectory_points_section,
+    glyph_quads_section,
+    digraph_quad_section,
+    cluster_quads_section,
+    node_quads_section,
+    edge_line_points_section,
+    edge_spline_points_section,
+    edge_arrow_triangles_section,
+    char_glyphs_section,
+    char_instances_section,
+    n_snapshot_sections,
+};
+
+struct SnapshotSectionInfo {
+    uint64_t m_offset, m_count, m_record_size;
+};
+
+namespace punkt::render {
+struct SnapshotFileHeader {
+    char m_magic[8];
+    uint32_t m_version;
+    uint32_t m_byte_order_mark;
+    uint64_t m_font_fingerprint;
+    uint64_t m_graph_width, m_graph_height;
+    uint32_t m_is_reversed, m_is_sideways;
+    SnapshotSectionInfo m_sections[n_snapshot_sections];
+};
+}
+
+// the expected record size of every section, a build whose structs differ rejects the file
+constexpr size_t section_record_sizes[n_snapshot_sections] = {
+    sizeof(char), sizeof(SnapshotNode), sizeof(SnapshotEdge), sizeof(Vector2<uint64_t>), sizeof(SnapshotGlyphQuad),
+    sizeof(ShapeQuadInfo), sizeof(ShapeQuadInfo), sizeof(ShapeQuadInfo), sizeof(EdgeLinePoints),
+    sizeof(EdgeLinePoints), sizeof(EdgeArrowTriangle), sizeof(SnapshotCharGlyph), sizeof(CharQuadPerInstanceData),
+};
+
+template<typename T>
+constexpr bool is_snapshot_record_v = std::is_trivially_copyable_v<T> && alignof(T) <= section_alignment;
+
+static_assert(is_snapshot_record_v<SnapshotFileHeader> && is_snapshot_record_v<SnapshotNode> &&
+    is_snapshot_record_v<SnapshotEdge> && is_snapshot_record_v<SnapshotCharGlyph> &&
+    is_snapshot_record_v<ShapeQuadInfo> && is_snapshot_record_v<EdgeLinePoints> &&
+    is_snapshot_record_v<EdgeArrowTriangle> && is_snapshot_record_v<CharQuadPerInstanceData>);
+
+SnapshotIOException::SnapshotIOException(std::string path)
+    : m_path(std::move(path)) {
+}
+
+const char *SnapshotIOException::what() const noexcept {
+    const std::string msg = std::string("Cannot access snapshot file \"") + m_path + "\"";
+    const auto m = new char[msg.length() + 1];
+    msg.copy(m, msg.length());
+    m[msg.length()] = '\0';
+    return m;
+}
+
+InvalidSnapshotException::InvalidSnapshotException(std::string reason)
+    : m_reason(std::move(reason)) {
+}
+
+const char *InvalidSnapshotException::what() const noexcept {
+    const std::string msg = std::string("Invalid snapshot: ") + m_reason;
+    const auto m = new char[msg.length() + 1];
+    msg.copy(m, msg.length());
+    m[msg.length()] = '\0';
+    return m;
+}
+
+namespace {
+class SnapshotWriter {
+    std::string m_strings;
+    std::unordered_map<std::string_view, SnapshotString> m_interned;
+    std::string m_data;
+    SnapshotFileHeader m_header{};
+
+public:
+    std::vector<SnapshotNode> m_nodes;
+    std::vector<SnapshotEdge> m_edges;
+    std::vector<Vector2<uint64_t> > m_trajectory_points;
+    std::vector<SnapshotGlyphQuad> m_glyph_quads;
+    std::vector<SnapshotCharGlyph> m_char_glyphs;
+    std::vector<CharQuadPerInstanceData> m_char_instances;
+
+    SnapshotString intern(const std::string_view s) {
+        const auto [it, inserted] = m_interned.try_emplace(s);
+        if (inserted) {
+            it->second = SnapshotString{m_strings.size(), s.size()};
+            m_strings.append(s);
+        }
+        return it->second;
+    }
+
+    SnapshotRange addGlyphQuads(const std::vector<GlyphQuad> &quads) {
+        const uint64_t begin = m_glyph_quads.size();
+        for (const GlyphQuad &quad: quads) {
+            m_glyph_quads.push_back({quad.m_left, quad.m_top, quad.m_right, quad.m_bottom, quad.m_c.c,
+                                     quad.m_c.font_size});
+        }
+        return {begin, m_glyph_quads.size()};
+    }
+
+    SnapshotRange addTrajectory(const std::vector<Vector2<size_t> > &trajectory) {
+        const uint64_t begin = m_trajectory_points.size();
+        for (const Vector2<size_t> &p: trajectory) {
+            m_trajectory_points.push_back({p.x, p.y});
+        }
+        return {begin, m_trajectory_points.size()};
+    }
+
+    template<typename T>
+    void appendSection(const SnapshotSection section, const std::span<const T> records) {
+        m_data.resize((m_data.size() + section_alignment - 1) / section_alignment * section_alignment, '\0');
+        m_header.m_sections[section] = {m_data.size(), records.size(), sizeof(T)};
+        m_data.append(reinterpret_cast<const char *>(records.data()), records.size_bytes());
+    }
+
+    std::string finish(const RenderInstanceData &data, const size_t font_fingerprint) {
+        std::memcpy(m_header.m_magic, snapshot_file_magic, sizeof(snapshot_file_magic));
+        m_header.m_version = SNAPSHOT_FORMAT_VERSION;
+        m_header.m_byte_order_mark = snapshot_byte_order_mark;
+        m_header.m_font_fingerprint = font_fingerprint;
+        m_header.m_graph_width = data.m_graph_width;
+        m_header.m_graph_height = data.m_graph_height;
+        m_header.m_is_reversed = data.m_is_reversed;
+        m_header.m_is_sideways = data.m_is_sideways;
+
+        for (const auto &[glyph, tracker]: data.m_char_quads) {
+            const uint64_t begin = m_char_instances.size();
+            m_char_instances.insert(m_char_instances.end(), tracker.m_instances.begin(), tracker.m_instances.end());
+            m_char_glyphs.push_back({glyph.c, glyph.font_size, tracker.m_quad, {begin, m_char_instances.size()}});
+        }
+
+        m_data.assign(sizeof(SnapshotFileHeader), '\0');
+        appendSection<char>(strings_section, m_strings);
+        appendSection<SnapshotNode>(nodes_section, m_nodes);
+        appendSection<SnapshotEdge>(edges_section, m_edges);
+        appendSection<Vector2<uint64_t> >(trajectory_points_section, m_trajectory_points);
+        appendSection<SnapshotGlyphQuad>(glyph_quads_section, m_glyph_quads);
+        appendSection<ShapeQuadInfo>(digraph_quad_section, std::span(&data.m_digraph_quad, 1));
+        appendSection<ShapeQuadInfo>(cluster_quads_section, data.m_cluster_quads);
+        appendSection<ShapeQuadInfo>(node_quads_section, data.m_node_quads);
+        appendSection<EdgeLinePoints>(edge_line_points_section, data.m_edge_line_points);
+        appendSection<EdgeLinePoints>(edge_spline_points_section, data.m_edge_spline_points);
+        appendSection<EdgeArrowTriangle>(edge_arrow_triangles_section, data.m_edge_arrow_triangles);
+        appendSection<SnapshotCharGlyph>(char_glyphs_section, m_char_glyphs);
+        appendSection<CharQuadPerInstanceData>(char_instances_section, m_char_instances);
+        std::memcpy(m_data.data(), &m_header, sizeof(m_header));
+        return std::move(m_data);
+    }
+};
+}
+
+std::string render::serializeSnapshot(const Digraph &dg, const glyph::GlyphLoader &glyph_loader) {
+    SnapshotWriter writer;
+    // id order, like the instance data
+    std::vector<const Node *> nodes;
+    nodes.reserve(dg.m_nodes.size());
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        nodes.push_back(&node);
+    }
+    std::ranges::stable_sort(nodes, [](const Node *a, const Node *b) { return a->m_id < b->m_id; });
+    for (const Node *node: nodes) {
+        const NodeRenderAttrs &ra = node->m_render_attrs;
+        writer.m_nodes.push_back({writer.intern(node->m_name), ra.m_x, ra.m_y, ra.m_width, ra.m_height, ra.m_is_ghost,
+                                  writer.addGlyphQuads(ra.m_quads)});
+        for (const Edge &edge: node->m_outgoing) {
+            writer.m_edges.push_back({writer.intern(edge.m_source), writer.intern(edge.m_dest),
+                                      writer.addTrajectory(edge.m_render_attrs.m_trajectory),
+                                      writer.addGlyphQuads(edge.m_render_attrs.m_label_quads)});
+        }
+    }
+    return writer.finish(RenderInstanceData(dg), glyph_loader.getFontFingerprint());
+}
+
+void render::writeSnapshot(const Digraph &dg, const glyph::GlyphLoader &glyph_loader,
+                           const std::filesystem::path &path) {
+    const std::string data = serializeSnapshot(dg, glyph_loader);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw SnapshotIOException(path.string());
+    }
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!file) {
+        throw SnapshotIOException(path.string());
+    }
+}
+
+struct Snapshot::MappedFile {
+#ifdef PUNKT_SNAPSHOT_USE_MMAP
+    void *m_address{MAP_FAILED};
+    size_t m_size{};
+#else
+    // uint64_t elements keep the sections aligned
+    std::unique_ptr<uint64_t[]> m_buffer;
+#endif
+    std::span<const std::byte> m_data;
+
+    explicit MappedFile(const std::filesystem::path &path) {
+#ifdef PUNKT_SNAPSHOT_USE_MMAP
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw SnapshotIOException(path.string());
+        }
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw SnapshotIOException(path.string());
+        }
+        m_size = static_cast<size_t>(st.st_size);
+        if (m_size < sizeof(SnapshotFileHeader)) {
+            close(fd);
+            throw InvalidSnapshotException("file too small");
+        }
+        m_address = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (m_address == MAP_FAILED) {
+            throw SnapshotIOException(path.string());
+        }
+        m_data = std::span(static_cast<const std::byte *>(m_address), m_size);
+#else
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in) {
+            throw SnapshotIOException(path.string());
+        }
+        const auto size = static_cast<size_t>(in.tellg());
+        in.seekg(0);
+        m_buffer = std::make_unique<uint64_t[]>((size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+        if (!in.read(reinterpret_cast<char *>(m_buffer.get()), static_cast<std::streamsize>(size))) {
+            throw SnapshotIOException(path.string());
+        }
+        m_data = std::span(reinterpret_cast<const std::byte *>(m_buffer.get()), size);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+#ifdef PUNKT_SNAPSHOT_USE_MMAP
+        if (m_address != MAP_FAILED) {
+            munmap(m_address, m_size);
+        }
+#endif
+    }
+};
+
+Snapshot::Snapshot(const std::filesystem::path &path)
+    : m_file(std::make_unique<MappedFile>(path)) {
+    validate();
+}
+
+Snapshot::~Snapshot() = default;
+
+Snapshot::Snapshot(Snapshot &&) noexcept = default;
+
+Snapshot &Snapshot::operator=(Snapshot &&) noexcept = default;
+
+SnapshotFileHeader Snapshot::getHeader() const {
+    SnapshotFileHeader header;
+    std::memcpy(&header, m_file->m_data.data(), sizeof(header));
+    return header;
+}
+
+template<typename T>
+std::span<const T> Snapshot::getSection(const size_t section) const {
+    const SnapshotSectionInfo info = getHeader().m_sections[section];
+    return {reinterpret_cast<const T *>(m_file->m_data.data() + info.m_offset), static_cast<size_t>(info.m_count)};
+}
+
+static bool isValidRange(const SnapshotRange range, const size_t n_records) {
+    return range.m_begin <= range.m_end && range.m_end <= n_records;
+}
+
+// checks everything the accessors rely on once, so they can index without checks
+void Snapshot::validate() const {
+    const size_t size = m_file->m_data.size();
+    if (size < sizeof(SnapshotFileHeader)) {
+        throw InvalidSnapshotException("file too small");
+    }
+    const SnapshotFileHeader header = getHeader();
+    if (std::memcmp(header.m_magic, snapshot_file_magic, sizeof(snapshot_file_magic)) != 0) {
+        throw InvalidSnapshotException("not a punkt snapshot");
+    }
+    if (header.m_version != SNAPSHOT_FORMAT_VERSION || header.m_byte_order_mark != snapshot_byte_order_mark) {
+        throw InvalidSnapshotException("written by an incompatible version or platform");
+    }
+    for (size_t i = 0; i < n_snapshot_sections; i++) {
+        const SnapshotSectionInfo &info = header.m_sections[i];
+        if (info.m_record_size != section_record_sizes[i]) {
+            throw InvalidSnapshotException("written by an incompatible version or platform");
+        }
+        if (info.m_offset % section_alignment != 0 || info.m_offset > size ||
+            info.m_count > (size - info.m_offset) / info.m_record_size) {
+            throw InvalidSnapshotException("section out of bounds");
+        }
+    }
+    if (header.m_sections[digraph_quad_section].m_count != 1) {
+        throw InvalidSnapshotException("missing graph quad");
+    }
+
+    const size_t n_strings = header.m_sections[strings_section].m_count;
+    const auto isValidString = [&](const SnapshotString s) {
+        return s.m_offset <= n_strings && s.m_size <= n_strings - s.m_offset;
+    };
+    const size_t n_glyph_quads = header.m_sections[glyph_quads_section].m_count;
+    for (const SnapshotNode &node: getNodes()) {
+        if (!isValidString(node.m_name) || !isValidRange(node.m_quads, n_glyph_quads)) {
+            throw InvalidSnapshotException("corrupt node");
+        }
+    }
+    for (const SnapshotEdge &edge: getEdges()) {
+        if (!isValidString(edge.m_source) || !isValidString(edge.m_dest) ||
+            !isValidRange(edge.m_trajectory, header.m_sections[trajectory_points_section].m_count) ||
+            !isValidRange(edge.m_label_quads, n_glyph_quads)) {
+            throw InvalidSnapshotException("corrupt edge");
+        }
+    }
+    for (const SnapshotCharGlyph &glyph: getSection<SnapshotCharGlyph>(char_glyphs_section)) {
+        if (!isValidRange(glyph.m_instances, header.m_sections[char_instances_section].m_count)) {
+            throw InvalidSnapshotException("corrupt glyph");
+        }
+    }
+}
+
+size_t Snapshot::getFontFingerprint() const {
+    return static_cast<size_t>(getHeader().m_font_fingerprint);
+}
+
+std::span<const SnapshotNode> Snapshot::getNodes() const {
+    return getSection<SnapshotNode>(nodes_section);
+}
+
+std::span<const SnapshotEdge> Snapshot::getEdges() const {
+    return getSection<SnapshotEdge>(edges_section);
+}
+
+std::string_view Snapshot::getString(const SnapshotString s) const {
+    const std::span<const char> chars = getSection<char>(strings_section);
+    return std::string_view(chars.data(), chars.size()).substr(s.m_offset, s.m_size);
+}
+
+std::span<const SnapshotGlyphQuad> Snapshot::getGlyphQuads(const SnapshotRange range) const {
+    return getSection<SnapshotGlyphQuad>(glyph_quads_section).subspan(range.m_begin, range.m_end - range.m_begin);
+}
+
+std::span<const Vector2<uint64_t> > Snapshot::getTrajectory(const SnapshotRange range) const {
+    return getSection<Vector2<uint64_t> >(trajectory_points_section).subspan(range.m_begin,
+                                                                             range.m_end - range.m_begin);
+}
+
+RenderInstanceData::RenderInstanceData(const Snapshot &snapshot)
+    : m_is_reversed(snapshot.getHeader().m_is_reversed), m_is_sideways(snapshot.getHeader().m_is_sideways),
+      m_graph_width(snapshot.getHeader().m_graph_width), m_graph_height(snapshot.getHeader().m_graph_height),
+      m_digraph_quad(snapshot.getSection<ShapeQuadInfo>(digraph_quad_section).front()) {
+    const auto copySection = [&]<typename T>(std::vector<T> &out, const SnapshotSection section) {
+        const std::span<const T> records = snapshot.getSection<T>(section);
+        out.assign(records.begin(), records.end());
+    };
+    copySection(m_cluster_quads, cluster_quads_section);
+    copySection(m_node_quads, node_quads_section);
+    copySection(m_edge_line_points, edge_line_points_section);
+    copySection(m_edge_spline_points, edge_spline_points_section);
+    copySection(m_edge_arrow_triangles, edge_arrow_triangles_section);
+
+    const std::span<const CharQuadPerInstanceData> instances = snapshot.getSection<CharQuadPerInstanceData>(
+        char_instances_section);
+    const std::span<const SnapshotCharGlyph> glyphs = snapshot.getSection<SnapshotCharGlyph>(char_glyphs_section);
+    m_char_quads.reserve(glyphs.size());
+    for (const SnapshotCharGlyph &glyph: glyphs) {
+        CharQuadInstanceTracker tracker(0, 0);
+        tracker.m_quad = glyph.m_quad;
+        tracker.m_instances.assign(instances.begin() + static_cast<ssize_t>(glyph.m_instances.m_begin),
+                                   instances.begin() + static_cast<ssize_t>(glyph.m_instances.m_end));
+        m_char_quads.insert_or_assign(
+            glyph::GlyphCharInfo{static_cast<char32_t>(glyph.m_c), static_cast<size_t>(glyph.m_font_size)},
+            std::move(tracker));
+    }
+}
@@ -2,6 +2,7 @@
 #include "punkt/gl_renderer.hpp"
 
 #include <cassert>
+#include <utility>
 
 using namespace punkt;
 
@@ -22,6 +23,16 @@ void GraphRenderer::initialize(const Digraph &dg, render::glyph::GlyphLoader &gl
     m_graph_renderer = new render::GLRenderer(dg, glyph_loader);
 }
 
+void GraphRenderer::initialize(render::RenderInstanceData instance_data, render::glyph::GlyphLoader &glyph_loader) {
+    m_graph_renderer = new render::GLRenderer(std::move(instance_data), glyph_loader);
+}
+
+void GraphRenderer::uploadInstanceData(render::RenderInstanceData instance_data) const {
+    assertNonNull(m_graph_renderer);
+    render::GLRenderer &glr = *static_cast<render::GLRenderer *>(m_graph_renderer);
+    glr.uploadInstanceData(std::move(instance_data));
+}
+
 void GraphRenderer::notifyFramebufferSize(const int width, const int height) const {
     assertNonNull(m_graph_renderer);
     render::GLRenderer &glr = *static_cast<render::GLRenderer *>(m_graph_renderer);
@@ -0,0 +1,328 @@
+#include "punkt/layout_export.hpp"
+#include "punkt/dot.hpp"
+#include "punkt/render_geometry.hpp"
+#include "punkt/utils/buffered_writer.hpp"
+#include "punkt/utils/utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <ranges>
+#include <string_view>
+#include <vector>
+
+using namespace punkt;
+using namespace punkt::render;
+
+constexpr int svg_export_decimals = 2;
+// dashed and bullet edges are split into this many segments along their length, every other one drawn (see edges.frag)
+constexpr size_t svg_n_segments_per_styled_edge = 20;
+// where the baseline sits in a glyph quad, as a fraction of the font size from the top
+constexpr double svg_baseline_factor = 0.8;
+constexpr std::string_view svg_font_family = "monospace";
+
+namespace {
+// an axis aligned box in display coordinates
+struct SvgBox {
+    double m_left, m_top, m_right, m_bottom;
+
+    [[nodiscard]] double getWidth() const {
+        return m_right - m_left;
+    }
+
+    [[nodiscard]] double getHeight() const {
+        return m_bottom - m_top;
+    }
+};
+
+class SvgWriter {
+    BufferedWriter m_w;
+    DisplayTransform m_display;
+
+public:
+    SvgWriter(std::ostream &out, const Digraph &dg)
+        : m_w(out), m_display(dg) {
+    }
+
+    BufferedWriter &getWriter() {
+        return m_w;
+    }
+
+    [[nodiscard]] const DisplayTransform &getDisplay() const {
+        return m_display;
+    }
+
+    BufferedWriter &writeNumber(const double x) {
+        return m_w.writeDecimal(x, svg_export_decimals);
+    }
+
+    void writePoint(const double x, const double y) {
+        const Vector2<double> p = m_display.apply(x, y);
+        writeNumber(p.x) << ',';
+        writeNumber(p.y);
+    }
+
+    [[nodiscard]] SvgBox toDisplay(const double left, const double top, const double right,
+                                   const double bottom) const {
+        const Vector2<double> a = m_display.apply(left, top), b = m_display.apply(right, bottom);
+        return {std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.x, b.x), std::max(a.y, b.y)};
+    }
+
+    // ` name="#rrggbb"`, plus ` name-opacity="a"` for translucent colors
+    void writeColor(const std::string_view name, const std::string_view color) {
+        uint8_t r, g, b, a;
+        parseColor(color, r, g, b, a);
+        constexpr std::string_view hex_digits = "0123456789abcdef";
+        m_w << ' ' << name << "=\"#";
+        for (const uint8_t channel: {r, g, b}) {
+            m_w << hex_digits[channel >> 4] << hex_digits[channel & 0xf];
+        }
+        m_w << '"';
+        if (a != 0xff) {
+            m_w << ' ' << name << "-opacity=\"";
+            m_w.writeDecimal(static_cast<double>(a) / 255.0, 3) << '"';
+        }
+    }
+
+    // a UTF-8 string, passed through byte by byte
+    void writeEscaped(const std::string_view s) {
+        for (const char c: s) {
+            if (static_cast<unsigned char>(c) >= 0x80) {
+                m_w << c;
+            } else {
+                writeEscapedChar(static_cast<unsigned char>(c));
+            }
+        }
+    }
+
+    // UTF-8 of a glyph's character. Labels are laid out byte by byte, so bytes >= 0x80 arrive sign extended and are
+    // written as U+FFFD (their continuation bytes may not have a glyph at all).
+    void writeEscapedChar(const char32_t c) {
+        switch (c) {
+            case '&':
+                m_w << "&amp;";
+                return;
+            case '<':
+                m_w << "&lt;";
+                return;
+            case '>':
+                m_w << "&gt;";
+                return;
+            case '"':
+                m_w << "&quot;";
+                return;
+            default:
+                break;
+        }
+        if (c < 0x20) {
+            // control characters are not allowed in XML
+            m_w << ' ';
+        } else if (c < 0x80) {
+            m_w << static_cast<char>(c);
+        } else if (c < 0x800) {
+            m_w << static_cast<char>(0xc0 | c >> 6) << static_cast<char>(0x80 | (c & 0x3f));
+        } else if (c < 0x10000) {
+            m_w << static_cast<char>(0xe0 | c >> 12) << static_cast<char>(0x80 | (c >> 6 & 0x3f))
+                    << static_cast<char>(0x80 | (c & 0x3f));
+        } else if (c < 0x110000) {
+            m_w << static_cast<char>(0xf0 | c >> 18) << static_cast<char>(0x80 | (c >> 12 & 0x3f))
+                    << static_cast<char>(0x80 | (c >> 6 & 0x3f)) << static_cast<char>(0x80 | (c & 0x3f));
+        } else {
+            m_w << "\xef\xbf\xbd";
+        }
+    }
+};
+}
+
+// A shape of the given (layout space) box with a border of `border_thickness` drawn inside it, like nodes.frag does.
+// SVG strokes are centered on the outline, so the outline is inset by half the border.
+static void writeSvgShape(SvgWriter &svg, const uint32_t shape_id, const SvgBox &box, const size_t border_thickness,
+                          const Attrs &attrs) {
+    BufferedWriter &w = svg.getWriter();
+    const double inset = static_cast<double>(border_thickness) / 2.0;
+    const double width = std::max(box.getWidth() - 2.0 * inset, 0.0);
+    const double height = std::max(box.getHeight() - 2.0 * inset, 0.0);
+    if (shape_id == node_shape_ellipse) {
+        w << "<ellipse cx=\"";
+        svg.writeNumber(box.m_left + box.getWidth() / 2.0) << "\" cy=\"";
+        svg.writeNumber(box.m_top + box.getHeight() / 2.0) << "\" rx=\"";
+        svg.writeNumber(width / 2.0) << "\" ry=\"";
+        svg.writeNumber(height / 2.0) << '"';
+    } else {
+        w << "<rect x=\"";
+        svg.writeNumber(box.m_left + inset) << "\" y=\"";
+        svg.writeNumber(box.m_top + inset) << "\" width=\"";
+        svg.writeNumber(width) << "\" height=\"";
+        svg.writeNumber(height) << '"';
+        if (shape_id == node_shape_pill) {
+            w << " rx=\"";
+            svg.writeNumber(std::min(width, height) / 2.0) << '"';
+        }
+    }
+    svg.writeColor("fill", getFillColor(attrs));
+    if (border_thickness > 0) {
+        svg.writeColor("stroke", getAttrOrDefault(attrs, "color", "black"));
+        w << " stroke-width=\"" << border_thickness << '"';
+    }
+    w << "/>\n";
+}
+
+// Glyph quads as <text> elements, one per run of quads that continue each other on the same line. The run is
+// stretched over its quads with textLength, so the text covers the space the layout reserved for it whatever font
+// the viewer picks.
+static void writeSvgText(SvgWriter &svg, const std::vector<GlyphQuad> &quads, const size_t x, const size_t y,
+                         const std::string_view color) {
+    BufferedWriter &w = svg.getWriter();
+    const auto getQuadBox = [&](const GlyphQuad &quad) {
+        return svg.toDisplay(static_cast<double>(x + quad.m_left), static_cast<double>(y + quad.m_top),
+                             static_cast<double>(x + quad.m_right), static_cast<double>(y + quad.m_bottom));
+    };
+    size_t begin = 0;
+    while (begin < quads.size()) {
+        const SvgBox first = getQuadBox(quads[begin]);
+        SvgBox run = first;
+        size_t end = begin + 1;
+        for (; end < quads.size(); end++) {
+            const SvgBox next = getQuadBox(quads[end]);
+            if (quads[end].m_c.font_size != quads[begin].m_c.font_size || next.m_top != first.m_top
+                || next.m_bottom != first.m_bottom || next.m_left < run.m_right) {
+                break;
+            }
+            run.m_right = next.m_right;
+        }
+
+        const auto font_size = static_cast<double>(quads[begin].m_c.font_size);
+        w << "<text x=\"";
+        svg.writeNumber(run.m_left) << "\" y=\"";
+        svg.writeNumber(run.m_top + svg_baseline_factor * run.getHeight()) << "\" font-family=\"" << svg_font_family
+                << "\" font-size=\"";
+        svg.writeNumber(font_size) << "\" textLength=\"";
+        svg.writeNumber(run.getWidth()) << "\" lengthAdjust=\"spacingAndGlyphs\" xml:space=\"preserve\"";
+        svg.writeColor("fill", color);
+        w << '>';
+        double prev_right = first.m_left;
+        for (size_t i = begin; i < end; i++) {
+            // whitespace has no quad, a gap in the run is where it was
+            const SvgBox box = getQuadBox(quads[i]);
+            if (box.m_left > prev_right) {
+                w << ' ';
+            }
+            svg.writeEscapedChar(quads[i].m_c.c);
+            prev_right = box.m_right;
+        }
+        w << "</text>\n";
+        begin = end;
+    }
+}
+
+static void writeSvgEdge(SvgWriter &svg, const Digraph &dg, const Edge &edge) {
+    BufferedWriter &w = svg.getWriter();
+    const std::vector<Vector2<size_t> > &trajectory = edge.m_render_attrs.m_trajectory;
+    const std::string_view color = getAttrOrDefault(edge.m_attrs, "color", "black");
+    const size_t thickness = getEdgeThickness(edge);
+
+    w << "<path d=\"M";
+    svg.writePoint(static_cast<double>(trajectory.front().x), static_cast<double>(trajectory.front().y));
+    const bool is_spline = isEdgeDrawnAsSpline(dg, edge);
+    for (size_t i = 1; i < trajectory.size(); i++) {
+        w << (is_spline ? (i % 3 == 1 ? " C" : " ") : " L");
+        svg.writePoint(static_cast<double>(trajectory[i].x), static_cast<double>(trajectory[i].y));
+    }
+    w << '"' << " fill=\"none\"";
+    svg.writeColor("stroke", color);
+    w << " stroke-width=\"" << thickness << '"';
+    // the same patterns edges.frag draws: dots spaced by the line thickness, or a fixed number of dashes or bullets
+    if (const std::string_view style = getAttrOrDefault(edge.m_attrs, "style", "solid"); style == "dotted") {
+        w << " stroke-linecap=\"round\" stroke-dasharray=\"0 " << 2 * thickness << '"';
+    } else if (style == "dashed") {
+        w << " pathLength=\"" << 2 * svg_n_segments_per_styled_edge << "\" stroke-dasharray=\"1\"";
+    } else if (style == "bullet") {
+        w << " pathLength=\"" << 2 * svg_n_segments_per_styled_edge
+                << "\" stroke-linecap=\"round\" stroke-dasharray=\"0 2\"";
+    }
+    w << "/>\n";
+
+    const EdgeArrows arrows = getEdgeArrows(dg, edge);
+    for (size_t i = 0; i < arrows.m_n_triangles; i++) {
+        w << "<polygon points=\"";
+        for (size_t j = 0; j < arrows.m_triangles[i].size(); j++) {
+            const auto [x, y] = arrows.m_triangles[i][j];
+            if (j != 0) {
+                w << ' ';
+            }
+            svg.writePoint(x, y);
+        }
+        w << '"';
+        svg.writeColor("fill", color);
+        w << "/>\n";
+    }
+
+    const std::string_view font_color = getAttrOrDefault(edge.m_attrs, "fontcolor", "black");
+    for (const std::vector<GlyphQuad> *quads: {
+             &edge.m_render_attrs.m_label_quads, &edge.m_render_attrs.m_head_label_quads,
+             &edge.m_render_attrs.m_tail_label_quads
+         }) {
+        writeSvgText(svg, *quads, 0, 0, font_color);
+    }
+}
+
+void render::writeLayoutSvg(const Digraph &dg, std::ostream &out) {
+    SvgWriter svg(out, dg);
+    BufferedWriter &w = svg.getWriter();
+    const DigraphRenderAttrs &gra = dg.m_render_attrs;
+    const DisplayTransform &display = svg.getDisplay();
+
+    w << R"(<?xml version="1.0" encoding="UTF-8"?>)" << '\n' << R"(<svg xmlns="http://www.w3.org/2000/svg" width=")";
+    svg.writeNumber(display.getWidth()) << "\" height=\"";
+    svg.writeNumber(display.getHeight()) << "\" viewBox=\"0 0 ";
+    svg.writeNumber(display.getWidth()) << ' ';
+    svg.writeNumber(display.getHeight()) << "\">\n";
+
+    // the graph box (fill and border), drawn below everything else like the renderer's digraph quad
+    writeSvgShape(svg, node_shape_box,
+                  svg.toDisplay(static_cast<double>(gra.m_graph_x), static_cast<double>(gra.m_graph_y),
+                                static_cast<double>(gra.m_graph_x + gra.m_graph_width),
+                                static_cast<double>(gra.m_graph_y + gra.m_graph_height)), gra.m_border_thickness,
+                  dg.m_attrs);
+    writeSvgText(svg, gra.m_label_quads, gra.m_graph_x, gra.m_graph_y,
+                 getAttrOrDefault(dg.m_attrs, "fontcolor", "black"));
+
+    // nodes and edges in id order, like RenderInstanceData, so the output is deterministic
+    std::vector<const Node *> nodes;
+    nodes.reserve(dg.m_nodes.size());
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        if (!node.m_render_attrs.m_is_ghost) {
+            nodes.push_back(&node);
+        }
+    }
+    std::ranges::stable_sort(nodes, [](const Node *a, const Node *b) { return a->m_id < b->m_id; });
+    for (const Node *node: nodes) {
+        const NodeRenderAttrs &ra = node->m_render_attrs;
+        w << "<g class=\"node\"><title>";
+        svg.writeEscaped(node->m_name);
+        w << "</title>\n";
+        if (const uint32_t shape_id = getNodeShapeId(*node); shape_id != node_shape_none) {
+            writeSvgShape(svg, shape_id,
+                          svg.toDisplay(static_cast<double>(ra.m_x), static_cast<double>(ra.m_y),
+                                        static_cast<double>(ra.m_x + ra.m_width),
+                                        static_cast<double>(ra.m_y + ra.m_height)), ra.m_border_thickness,
+                          node->m_attrs);
+        }
+        writeSvgText(svg, ra.m_quads, ra.m_x, ra.m_y, getAttrOrDefault(node->m_attrs, "fontcolor", "black"));
+        w << "</g>\n";
+    }
+
+    // edges split at ghost nodes have no trajectory, their ghost edges draw them piece by piece
+    std::vector<const Edge *> edges;
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        for (const Edge &edge: node.m_outgoing) {
+            if (!edge.m_render_attrs.m_trajectory.empty()) {
+                edges.push_back(&edge);
+            }
+        }
+    }
+    std::ranges::stable_sort(edges, [](const Edge *a, const Edge *b) { return a->m_id < b->m_id; });
+    for (const Edge *edge: edges) {
+        writeSvgEdge(svg, dg, *edge);
+    }
+    w << "</svg>\n";
+}
@@ -0,0 +1,138 @@
+#include "punkt/utils/thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+using namespace punkt;
+
+size_t ThreadPool::getDefaultNumThreads() {
+    // hardware_concurrency may return 0 if it cannot be determined
+    return std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1));
+}
+
+ThreadPool::ThreadPool(size_t n_threads) {
+    if (n_threads == 0) {
+        n_threads = getDefaultNumThreads();
+    }
+    m_workers.reserve(n_threads);
+    for (size_t i = 0; i < n_threads; i++) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_is_stopping = true;
+    }
+    m_task_available.notify_all();
+    for (std::thread &worker: m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(m_mutex);
+            m_task_available.wait(lock, [this] { return m_is_stopping || !m_tasks.empty(); });
+            if (m_tasks.empty()) {
+                // only reachable when stopping
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+            m_n_running++;
+        }
+
+        std::exception_ptr exception;
+        try {
+            task();
+        } catch (...) {
+            exception = std::current_exception();
+        }
+
+        {
+            std::lock_guard lock(m_mutex);
+            m_n_running--;
+            if (exception && !m_first_exception) {
+                m_first_exception = exception;
+            }
+            if (m_n_running == 0 && m_tasks.empty()) {
+                m_all_done.notify_all();
+            }
+        }
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard lock(m_mutex);
+        m_tasks.emplace(std::move(task));
+    }
+    m_task_available.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::exception_ptr exception;
+    {
+        std::unique_lock lock(m_mutex);
+        m_all_done.wait(lock, [this] { return m_n_running == 0 && m_tasks.empty(); });
+        std::swap(exception, m_first_exception);
+    }
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+void ThreadPool::parallelFor(const size_t n, const std::function<void(size_t)> &fn) {
+    if (n == 0) {
+        return;
+    }
+    // Indices are claimed from a shared counter by the helper tasks and by the calling thread itself. The caller only
+    // waits for the indices of this call, so concurrent callers do not wait for each other's tasks, and a call from
+    // inside a task of this pool cannot deadlock. Helpers that start after all indices are claimed return immediately.
+    struct State {
+        std::atomic<size_t> m_next{};
+        std::mutex m_mutex;
+        std::condition_variable m_all_done;
+        size_t m_n_done{};
+        std::exception_ptr m_first_exception;
+    };
+    const auto state = std::make_shared<State>();
+    const auto work = [state, n, &fn] {
+        for (size_t i = state->m_next++; i < n; i = state->m_next++) {
+            std::exception_ptr exception;
+            try {
+                fn(i);
+            } catch (...) {
+                exception = std::current_exception();
+            }
+            std::lock_guard lock(state->m_mutex);
+            if (exception && !state->m_first_exception) {
+                state->m_first_exception = exception;
+            }
+            if (++state->m_n_done == n) {
+                state->m_all_done.notify_all();
+            }
+        }
+    };
+    // the caller is one of the getNumThreads() threads working on this
+    for (size_t i = 1; i < std::min(n, m_workers.size()); i++) {
+        submit(work);
+    }
+    work();
+
+    std::unique_lock lock(state->m_mutex);
+    state->m_all_done.wait(lock, [&] { return state->m_n_done == n; });
+    if (state->m_first_exception) {
+        std::rethrow_exception(state->m_first_exception);
+    }
+}
+
+size_t ThreadPool::getNumThreads() const {
+    return m_workers.size();
+}
@@ -20,9 +20,10 @@ XOptPipelineStageSettings::LegalizerSettings::LegalizerSettings() = default;
 XOptPipelineStageSettings::LegalizerSettings::LegalizerSettings(const LegalizationTiming legalization_timing,
                                                                 const LegalizerSpecialInstruction
                                                                 legalizer_special_instruction,
-                                                                const bool try_cancel_mean_shift)
+                                                                const bool try_cancel_mean_shift,
+                                                                const Algorithm algorithm)
     : m_legalization_timing(legalization_timing), m_legalizer_special_instruction(legalizer_special_instruction),
-      m_try_cancel_mean_shift(try_cancel_mean_shift) {
+      m_try_cancel_mean_shift(try_cancel_mean_shift), m_algorithm(algorithm) {
 }
 
 XOptPipelineStageSettings::LegalizerSettings::LegalizerSpecialInstruction
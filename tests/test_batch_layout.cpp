@@ -0,0 +1,71 @@
+#include "punkt/dot.hpp"
+#include "punkt/gl_renderer.hpp"
+#include "punkt/snapshot.hpp"
+#include "punkt/batch_layout.hpp"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace punkt;
+
+TEST(batch_layout, MatchesSequentialLayouts) {
+    const std::vector<std::string> dot_sources = {
+        "digraph { A -> B; A -> C; B -> D; C -> D; A -> D [label=\"long edge\"]; }",
+        "digraph { X -> Y -> Z; X -> Z; W -> Y; V -> W; V -> Z; }",
+        "digraph { subgraph cluster_a { A1 -> A2; } subgraph cluster_b { B1 -> B2; } S -> A1; S -> B1; }",
+        "digraph { 1 -> 2; 1 -> 3; 1 -> 4; 2 -> 5; 3 -> 5; 4 -> 6; 5 -> 6; 2 -> 6 [label=\"x\"]; }",
+        "digraph { A -> ; }",
+    };
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "punkt_batch_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir / "in");
+    for (size_t i = 0; i < dot_sources.size(); i++) {
+        std::ofstream file(dir / "in" / ("graph" + std::to_string(i) + ".dot"));
+        file << dot_sources[i];
+    }
+    std::ofstream(dir / "in" / "notes.txt") << "not a graph";
+
+    // directories contribute their .dot files in name order
+    const std::vector<std::filesystem::path> graph_paths = collectBatchGraphPaths({dir / "in"});
+    ASSERT_EQ(graph_paths.size(), dot_sources.size());
+    for (size_t i = 0; i < dot_sources.size(); i++) {
+        ASSERT_EQ(graph_paths[i].filename(), "graph" + std::to_string(i) + ".dot");
+    }
+
+    render::glyph::GlyphLoader glyph_loader;
+    std::vector<std::filesystem::path> batch_paths = graph_paths;
+    batch_paths.push_back(dir / "in" / "missing.dot");
+    batch_paths.push_back(graph_paths.front());
+    const std::vector<BatchLayoutResult> results = runBatchLayout(batch_paths, dir / "out", glyph_loader, 2);
+    ASSERT_EQ(results.size(), batch_paths.size());
+    for (size_t i = 0; i < results.size(); i++) {
+        ASSERT_EQ(results[i].m_graph_path, batch_paths[i]);
+        // the invalid graph, the missing file and the duplicate output name fail without affecting the others
+        ASSERT_EQ(results[i].m_is_ok, i + 1 < dot_sources.size());
+        ASSERT_EQ(results[i].m_error.empty(), results[i].m_is_ok);
+    }
+
+    // concurrent layouts match sequential ones
+    for (size_t i = 0; i + 1 < dot_sources.size(); i++) {
+        Digraph dg{dot_sources[i]};
+        dg.preprocess(glyph_loader);
+        const render::Snapshot snapshot(results[i].m_output_path);
+        ASSERT_EQ(snapshot.getNodes().size(), dg.m_nodes.size());
+        for (const render::SnapshotNode &snapshot_node: snapshot.getNodes()) {
+            const Node &node = dg.m_nodes.at(snapshot.getString(snapshot_node.m_name));
+            ASSERT_EQ(snapshot_node.m_x, node.m_render_attrs.m_x);
+            ASSERT_EQ(snapshot_node.m_y, node.m_render_attrs.m_y);
+        }
+        const render::RenderInstanceData expected(dg), loaded(snapshot);
+        ASSERT_EQ(loaded.m_node_quads.size(), expected.m_node_quads.size());
+        ASSERT_EQ(std::memcmp(loaded.m_node_quads.data(), expected.m_node_quads.data(),
+                              expected.m_node_quads.size() * sizeof(expected.m_node_quads[0])), 0);
+        ASSERT_EQ(loaded.m_edge_spline_points.size(), expected.m_edge_spline_points.size());
+        ASSERT_EQ(std::memcmp(loaded.m_edge_spline_points.data(), expected.m_edge_spline_points.data(),
+                              expected.m_edge_spline_points.size() * sizeof(expected.m_edge_spline_points[0])), 0);
+    }
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,32 @@
+#include "punkt/utils/file_watcher.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+using namespace punkt;
+
+TEST(file_watcher, NoticesChanges) {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "punkt_file_watcher_test.dot";
+    const auto writeFile = [&](const std::string &content) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << content;
+    };
+    writeFile("digraph { A; }");
+    FileWatcher watcher(path);
+    ASSERT_FALSE(watcher.pollChanged());
+
+    // the modification time fallback only notices changes a few times per second and at its resolution
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    writeFile("digraph { A -> B; }");
+    bool changed = false;
+    for (int i = 0; i < 100 && !changed; i++) {
+        changed = watcher.pollChanged();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(changed);
+    ASSERT_FALSE(watcher.pollChanged());
+    std::filesystem::remove(path);
+}
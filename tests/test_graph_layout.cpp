@@ -1,10 +1,27 @@
 #include "punkt/dot.hpp"
 #include "punkt/dot_constants.hpp"
+#include "punkt/layout/coordinate_assignment.hpp"
+#include "punkt/gl_renderer.hpp"
+#include "punkt/progressive_layout.hpp"
+#include "punkt/layout/layout_cache.hpp"
+#include "punkt/layout/cluster_memo.hpp"
+#include "punkt/graph_reloader.hpp"
+#include "punkt/layout_export.hpp"
+#include "test_utils.hpp"
 #include <gtest/gtest.h>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <ranges>
+#include <chrono>
+#include <utility>
+#include <optional>
+#include <thread>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <limits>
 
 using namespace punkt;
 
@@ -753,3 +770,909 @@ HeadLabelQuad(245, 616, 252, 623)
 )";
     ASSERT_EQ(expected, s);
 }
+
+// nodes on the same rank keep their order and are at least nodesep apart
+static void assertNodesAreSeparated(const Digraph &dg) {
+    const auto node_sep = static_cast<ssize_t>(dg.m_render_attrs.m_node_sep);
+    for (const auto &rank_ordering: dg.m_per_rank_orderings) {
+        for (size_t i = 1; i < rank_ordering.size(); i++) {
+            const NodeRenderAttrs &left = dg.m_nodes.at(rank_ordering[i - 1]).m_render_attrs;
+            const NodeRenderAttrs &right = dg.m_nodes.at(rank_ordering[i]).m_render_attrs;
+            // one pixel of slack for rounding to integer positions
+            ASSERT_GE(static_cast<ssize_t>(right.m_x) + 1,
+                      static_cast<ssize_t>(left.m_x + left.m_width) + node_sep);
+        }
+    }
+}
+
+TEST(preprocessing, BrandesKoepfCoordinateAssignment) {
+    const std::string dot_source = R"(
+        digraph BrandesKoepfTest {
+            rankdir=TB;
+            ranksep=75;
+            nodesep=50;
+            punktxoptengine="brandes-koepf";
+
+            A [label="Node A"];
+            B [label="Node B with a long label"];
+            C [label="C"];
+            D [label="Node D"];
+            E [label="E"];
+            F [label="Wide node F"];
+
+            A -> B;
+            B -> C;
+            C -> D;
+            A -> D;
+            A -> E;
+            E -> F;
+            B -> F;
+            F -> D;
+        }
+    )";
+
+    Digraph dg{dot_source};
+    render::glyph::GlyphLoader glyph_loader;
+    dg.preprocess(glyph_loader);
+
+    assertNodesAreSeparated(dg);
+
+    // the only ghost chain (A -> D) is drawn as a straight vertical line
+    std::vector<ssize_t> ghost_centers;
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        if (node.m_render_attrs.m_is_ghost) {
+            ghost_centers.push_back(static_cast<ssize_t>(node.m_render_attrs.m_x + node.m_render_attrs.m_width / 2));
+        }
+    }
+    ASSERT_GE(ghost_centers.size(), 2);
+    for (const ssize_t center: ghost_centers) {
+        ASSERT_LE(std::abs(center - ghost_centers.front()), 1);
+    }
+}
+
+TEST(preprocessing, BrandesKoepfClassShifts) {
+    // the left column is split into two blocks that both start a class, and the nodes to their right have to be kept
+    // apart from both of them through the class shifts
+    const std::string dot_source = R"(
+        digraph BrandesKoepfClassShiftTest {
+            nodesep=30;
+            punktxoptengine="brandes-koepf";
+
+            n0 -> n4;
+            n1 -> n3;
+            n1 -> n7;
+            n2 -> n8;
+            n3 -> n8;
+            n4 -> n6;
+        }
+    )";
+
+    Digraph dg{dot_source};
+    render::glyph::GlyphLoader glyph_loader;
+    dg.preprocess(glyph_loader);
+
+    assertNodesAreSeparated(dg);
+}
+
+TEST(preprocessing, IsotonicLegalizer) {
+    const std::string dot_source = R"(
+        digraph IsotonicLegalizerTest {
+            nodesep=40;
+
+            Top [label="Top node"];
+            A [label="A rather wide node"];
+            B [label="B"];
+            C [label="Another wide node C"];
+            D [label="D"];
+
+            Top -> A;
+            Top -> B;
+            Top -> C;
+            Top -> D;
+        }
+    )";
+
+    // the isotonic legalizer is opt-in, the default pipeline uses the outward sweeps
+    std::vector isotonic_pipeline = BARYCENTER_X_OPTIMIZATION_PIPELINE;
+    for (XOptPipelineStageSettings &pss: isotonic_pipeline) {
+        ASSERT_EQ(pss.m_legalizer_settings.m_algorithm,
+                  XOptPipelineStageSettings::LegalizerSettings::Algorithm::outward_sweeps);
+        pss.m_legalizer_settings.m_algorithm =
+                XOptPipelineStageSettings::LegalizerSettings::Algorithm::isotonic_regression;
+    }
+    const test::SettingOverride pipeline(BARYCENTER_X_OPTIMIZATION_PIPELINE, isotonic_pipeline);
+    Digraph dg{dot_source};
+    render::glyph::GlyphLoader glyph_loader;
+    dg.preprocess(glyph_loader);
+
+    assertNodesAreSeparated(dg);
+}
+
+TEST(preprocessing, IsotonicRegressionIsLeastSquares) {
+    // three nodes that all want to sit at x = 100 with centers 30 apart: the legalizer solves for z = x - offset, which
+    // is decreasing here, so all of z collapses to its mean and the nodes end up centered around their common target
+    constexpr float target = 100.0f, sep = 30.0f;
+    std::vector values{target, target - sep, target - 2.0f * sep};
+    const std::vector weights(values.size(), 1.0f);
+    layout::solveIsotonicRegression(values, weights);
+    const std::vector expected_centers{target - sep, target, target + sep};
+    for (size_t i = 0; i < values.size(); i++) {
+        ASSERT_FLOAT_EQ(values[i] + static_cast<float>(i) * sep, expected_centers[i]);
+    }
+
+    // a weighted violating pair collapses to its weighted mean, the rest is already in order and stays put
+    std::vector weighted_values{-5.0f, 4.0f, 0.0f, 10.0f};
+    const std::vector weighted_weights{1.0f, 1.0f, 3.0f, 2.0f};
+    layout::solveIsotonicRegression(weighted_values, weighted_weights);
+    ASSERT_EQ(weighted_values, (std::vector{-5.0f, 1.0f, 1.0f, 10.0f}));
+}
+
+TEST(preprocessing, SweepBarycentersMatchPerRankVectors) {
+    // x positions produced before the sweep barycenters moved from per-rank vectors into the flat SweepBarycenters. The
+    // pipeline is pinned, so later changes of the default pipeline do not affect them.
+    const std::string dot_source = R"(
+        digraph SweepBarycentersTest {
+            nodesep=30;
+            punktxoptpipeline="tolerance = -1; [stage]; max_iters = 4; legalizer = sweeps; sweeps = up-group up down";
+
+            A -> B; A -> C; A -> D;
+            B -> E; C -> E; C -> F; D -> F; D -> G;
+            E -> H; F -> H; F -> I; G -> I;
+            A -> H; B -> I; C -> G;
+            X -> C; X -> G;
+        }
+    )";
+    const std::vector<std::pair<std::string_view, size_t> > expected_xs{
+        {"A", 88}, {"B", 145}, {"C", 31}, {"D", 88}, {"E", 31}, {"F", 88}, {"G", 175}, {"H", 59}, {"I", 116},
+        {"X", 145},
+    };
+
+    Digraph dg{dot_source};
+    render::glyph::GlyphLoader glyph_loader;
+    dg.preprocess(glyph_loader);
+    for (const auto &[name, x]: expected_xs) {
+        ASSERT_EQ(dg.m_nodes.at(name).m_render_attrs.m_x, x) << name;
+    }
+}
+
+TEST(preprocessing, GraphWidthFromRankExtents) {
+    // the widest rank is in the middle, and the long edge adds ghost nodes that take part in the extents as well
+    const std::string dot_source = R"(
+        digraph RankExtentsTest {
+            nodesep=25;
+
+            Top -> L; Top -> M; Top -> R;
+            L [label="A wide node on the left"];
+            R [label="Another wide node"];
+            L -> Bottom; R -> Bottom;
+            Top -> Bottom;
+        }
+    )";
+    Digraph dg{dot_source};
+    render::glyph::GlyphLoader glyph_loader;
+    dg.preprocess(glyph_loader);
+
+    // the nodes span the graph width minus the padding, which is split evenly (the right side gets the odd pixel)
+    size_t min_left = std::numeric_limits<size_t>::max(), max_right = 0;
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        min_left = std::min(min_left, node.m_render_attrs.m_x);
+        max_right = std::max(max_right, node.m_render_attrs.m_x + node.m_render_attrs.m_width);
+    }
+    const size_t right_padding = dg.m_render_attrs.m_graph_width - max_right;
+    ASSERT_TRUE(right_padding == min_left || right_padding == min_left + 1);
+}
+
+TEST(preprocessing, XOptTrajectoryAndEarlyTermination) {
+    const std::string dot_source = R"(
+        digraph XOptTrajectoryTest {
+            nodesep=40;
+            punktxopttolerance="%s";
+
+            A -> B;
+            A -> C;
+            B -> D;
+            C -> D;
+            C -> E;
+            A -> E;
+        }
+    )";
+    const auto preprocessWithTolerance = [&](const std::string &tolerance) {
+        std::string source = dot_source;
+        source.replace(source.find("%s"), 2, tolerance);
+        Digraph dg{source};
+        render::glyph::GlyphLoader glyph_loader;
+        dg.preprocess(glyph_loader);
+        return dg.m_x_opt_trajectory;
+    };
+
+    // the statistics are only recorded on request
+    ASSERT_TRUE(preprocessWithTolerance("0").empty());
+    const test::SettingOverride record_trajectory(BARYCENTER_X_OPTIMIZATION_RECORD_TRAJECTORY, true);
+    const std::vector<XOptIterationStats> full = preprocessWithTolerance("-1");
+    ASSERT_FALSE(full.empty());
+    for (const XOptIterationStats &stats: full) {
+        ASSERT_GE(stats.m_energy, 0.0f);
+        ASSERT_GE(stats.m_displacement, 0.0f);
+    }
+    // the default pipeline legalizes after every iteration
+    ASSERT_EQ(full.back().m_n_overlaps, 0);
+
+    // a huge tolerance accepts the second iteration of every stage as converged
+    const std::vector<XOptIterationStats> early = preprocessWithTolerance("1e9");
+    ASSERT_LE(early.size(), 2 * BARYCENTER_X_OPTIMIZATION_PIPELINE.size());
+    ASSERT_LE(early.size(), full.size());
+}
+
+// sum of layout weight * dx^2 over all edges, measured between the final node centers
+static double getSquaredEdgeLengthEnergy(const Digraph &dg) {
+    double energy = 0.0;
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        for (const Edge &edge: node.m_outgoing) {
+            const auto dest_it = dg.m_nodes.find(edge.m_dest);
+            if (dest_it == dg.m_nodes.end()) {
+                continue;
+            }
+            const NodeRenderAttrs &a = node.m_render_attrs, &b = dest_it->second.m_render_attrs;
+            const double dx = (static_cast<double>(a.m_x) + static_cast<double>(a.m_width) / 2.0) -
+                              (static_cast<double>(b.m_x) + static_cast<double>(b.m_width) / 2.0);
+            energy += static_cast<double>(dg.m_edge_layout_weights.at(edge.m_id)) * dx * dx;
+        }
+    }
+    return energy;
+}
+
+TEST(preprocessing, QuadraticCoordinateAssignment) {
+    // the same graph for both engines, barycenter is the default
+    const std::string barycenter_source = R"(
+        digraph QuadraticTest {
+            nodesep=40;
+
+            A [label="Node A"];
+            B [label="Node B with a long label"];
+            C [label="C"];
+            D [label="Node D"];
+            E [label="E"];
+            F [label="Wide node F"];
+
+            A -> B;
+            B -> C;
+            C -> D;
+            A -> D;
+            A -> E;
+            E -> F;
+            B -> F;
+            F -> D;
+            A -> C;
+        }
+    )";
+    const std::string quadratic_source = R"(
+        digraph QuadraticTest {
+            nodesep=40;
+            punktxoptengine="quadratic";
+
+            A [label="Node A"];
+            B [label="Node B with a long label"];
+            C [label="C"];
+            D [label="Node D"];
+            E [label="E"];
+            F [label="Wide node F"];
+
+            A -> B;
+            B -> C;
+            C -> D;
+            A -> D;
+            A -> E;
+            E -> F;
+            B -> F;
+            F -> D;
+            A -> C;
+        }
+    )";
+    // quality per millisecond of both engines, reported as test properties
+    const auto preprocessWithEngine = [&](const std::string &engine, const std::string &source) {
+        Digraph dg{source};
+        render::glyph::GlyphLoader glyph_loader;
+        const auto start = std::chrono::steady_clock::now();
+        dg.preprocess(glyph_loader);
+        const auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        const double energy = getSquaredEdgeLengthEnergy(dg);
+        ::testing::Test::RecordProperty(engine + "_ms", std::to_string(ms));
+        ::testing::Test::RecordProperty(engine + "_energy", std::to_string(energy));
+        return std::make_pair(std::move(dg), energy);
+    };
+
+    // without the ghost edge weighting the quadratic engine minimizes exactly the energy that is compared here
+    const test::SettingOverride ghost_edge_weight(QUADRATIC_X_OPTIMIZATION_GHOST_EDGE_WEIGHT_FACTOR, 1.0f);
+    const test::SettingOverride ghost_chain_weight(QUADRATIC_X_OPTIMIZATION_GHOST_CHAIN_WEIGHT_FACTOR, 1.0f);
+    const test::SettingOverride record_trajectory(BARYCENTER_X_OPTIMIZATION_RECORD_TRAJECTORY, true);
+    const auto [barycenter_dg, barycenter_energy] = preprocessWithEngine("barycenter", barycenter_source);
+    const auto [quadratic_dg, quadratic_energy] = preprocessWithEngine("quadratic", quadratic_source);
+    assertNodesAreSeparated(quadratic_dg);
+    ASSERT_FALSE(quadratic_dg.m_x_opt_trajectory.empty());
+    for (const XOptIterationStats &stats: quadratic_dg.m_x_opt_trajectory) {
+        ASSERT_EQ(stats.m_n_overlaps, 0);
+    }
+    ASSERT_LE(quadratic_energy, barycenter_energy);
+}
+
+TEST(preprocessing, AnytimeLayoutWithTimeBudget) {
+    const std::string dot_source = R"(
+        digraph TimeBudgetTest {
+            nodesep=40;
+            %s
+
+            A -> B;
+            A -> C;
+            B -> D;
+            C -> D;
+            C -> E;
+            A -> E;
+            E -> F;
+            B -> F;
+        }
+    )";
+    const auto preprocessWithAttr = [&](const std::string &attr) {
+        std::string source = dot_source;
+        source.replace(source.find("%s"), 2, attr);
+        Digraph dg{source};
+        render::glyph::GlyphLoader glyph_loader;
+        dg.preprocess(glyph_loader);
+        return dg;
+    };
+
+    // without a budget, nothing is reported
+    const Digraph unbounded = preprocessWithAttr("");
+    ASSERT_TRUE(unbounded.m_time_budget_report.empty());
+
+    // an ample budget is reported but does not change the layout
+    const Digraph ample = preprocessWithAttr(R"(punkttimebudget="60s";)");
+    ASSERT_EQ(ample.m_time_budget_report.size(), 2);
+    ASSERT_EQ(ample.m_time_budget_report[0].m_stage, "ordering");
+    ASSERT_EQ(ample.m_time_budget_report[1].m_stage, "x_optimization");
+    for (const LayoutStageTimeUsage &usage: ample.m_time_budget_report) {
+        ASSERT_GT(usage.m_budget_ms, 0.0f);
+        ASSERT_LE(usage.m_used_ms, usage.m_budget_ms);
+        ASSERT_FALSE(usage.m_was_cut_short);
+    }
+    for (const auto &[name, node]: unbounded.m_nodes) {
+        ASSERT_EQ(node.m_render_attrs.m_x, ample.m_nodes.at(name).m_render_attrs.m_x);
+    }
+
+    // an expired budget stops every stage after its first iteration (the x optimization pipeline has more to do than
+    // that, the ordering of this small graph may already have converged) but still yields a legal layout
+    const Digraph expired = preprocessWithAttr(R"(punkttimebudget="0ms";)");
+    ASSERT_EQ(expired.m_time_budget_report.size(), 2);
+    for (const LayoutStageTimeUsage &usage: expired.m_time_budget_report) {
+        ASSERT_EQ(usage.m_budget_ms, 0.0f);
+    }
+    ASSERT_TRUE(expired.m_time_budget_report[1].m_was_cut_short);
+    assertNodesAreSeparated(expired);
+
+    ASSERT_ANY_THROW(preprocessWithAttr(R"(punkttimebudget="soon";)"));
+}
+
+TEST(preprocessing, ProgressiveLayout) {
+    const std::string dot_source = R"(
+        digraph ProgressiveLayoutTest {
+            A -> B;
+            A -> C;
+            B -> D;
+            C -> D;
+            C -> E;
+            A -> E;
+            E -> F;
+            B -> F;
+        }
+    )";
+    render::glyph::GlyphLoader glyph_loader;
+    Digraph reference{dot_source};
+    reference.preprocess(glyph_loader);
+    const render::RenderInstanceData reference_data(reference);
+
+    render::ProgressiveLayout progressive_layout(dot_source, glyph_loader);
+    // every pass, including the 0ms preview, lays out the whole graph
+    const render::RenderInstanceData preview = progressive_layout.waitForLayout();
+    ASSERT_EQ(preview.m_node_quads.size(), reference_data.m_node_quads.size());
+    while (!progressive_layout.isDone()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(progressive_layout.getNumPublished(), PROGRESSIVE_LAYOUT_PASS_TIME_BUDGETS_MS.size() + 1);
+
+    // the final pass is the regular layout. The preview may already have been the final pass if the worker was quick.
+    std::optional<render::RenderInstanceData> last = progressive_layout.takeLatest();
+    if (!last) {
+        last.emplace(preview);
+    }
+    ASSERT_EQ(last->m_graph_width, reference_data.m_graph_width);
+    ASSERT_EQ(last->m_graph_height, reference_data.m_graph_height);
+    ASSERT_EQ(last->m_node_quads.size(), reference_data.m_node_quads.size());
+    ASSERT_EQ(last->m_edge_spline_points.size(), reference_data.m_edge_spline_points.size());
+    ASSERT_FALSE(progressive_layout.takeLatest().has_value());
+
+    // layout errors surface on the render thread
+    render::ProgressiveLayout broken(R"(digraph { A -> B; nodesep="wide"; })", glyph_loader);
+    ASSERT_ANY_THROW(broken.waitForLayout());
+    // polling every frame reports the error only once
+    ASSERT_ANY_THROW(broken.takeLatest());
+    ASSERT_FALSE(broken.takeLatest().has_value());
+}
+
+TEST(preprocessing, LayoutCache) {
+    const std::string dot_source = R"(
+        digraph LayoutCacheTest {
+            A -> B [label="ab"];
+            A -> C;
+            B -> D;
+            C -> D;
+            A -> D;
+            D -> D;
+        }
+    )";
+    // the same graph written differently
+    const std::string reformatted_source = R"(digraph LayoutCacheTest { A->B [label=ab]; A -> C; B -> D;
+        C -> D; A -> D; D -> D; })";
+    const std::filesystem::path cache_dir = std::filesystem::temp_directory_path() / "punkt_layout_cache_test";
+    std::filesystem::remove_all(cache_dir);
+    // a non-empty trajectory tells that the x optimization ran, i.e. that the cache missed
+    const test::SettingOverride record_trajectory(BARYCENTER_X_OPTIMIZATION_RECORD_TRAJECTORY, true);
+    const std::string og_cache_dir = LAYOUT_CACHE_DIRECTORY;
+    LAYOUT_CACHE_DIRECTORY = cache_dir.string();
+    render::glyph::GlyphLoader glyph_loader;
+    const auto countCacheFiles = [&] {
+        return std::ranges::distance(std::filesystem::directory_iterator(cache_dir));
+    };
+
+    Digraph computed{dot_source};
+    computed.preprocess(glyph_loader);
+    ASSERT_FALSE(computed.m_x_opt_trajectory.empty());
+    ASSERT_EQ(countCacheFiles(), 1);
+
+    // a hit skips preprocessing (no x optimization ran) but restores the same layout, ghost nodes included
+    Digraph cached{reformatted_source};
+    ASSERT_EQ(layout::getLayoutCacheKey(cached, glyph_loader), layout::getLayoutCacheKey(Digraph{dot_source},
+        glyph_loader));
+    cached.preprocess(glyph_loader);
+    ASSERT_TRUE(cached.m_x_opt_trajectory.empty());
+    ASSERT_EQ(cached.m_nodes.size(), computed.m_nodes.size());
+    ASSERT_EQ(cached.m_render_attrs.m_graph_width, computed.m_render_attrs.m_graph_width);
+    ASSERT_EQ(cached.m_render_attrs.m_graph_height, computed.m_render_attrs.m_graph_height);
+    for (const auto &[name, node]: computed.m_nodes) {
+        const Node &cached_node = cached.m_nodes.at(name);
+        ASSERT_EQ(cached_node.m_render_attrs.m_x, node.m_render_attrs.m_x);
+        ASSERT_EQ(cached_node.m_render_attrs.m_y, node.m_render_attrs.m_y);
+        ASSERT_EQ(cached_node.m_render_attrs.m_quads.size(), node.m_render_attrs.m_quads.size());
+        ASSERT_EQ(cached_node.m_ingoing.size(), node.m_ingoing.size());
+        ASSERT_EQ(cached_node.m_outgoing.size(), node.m_outgoing.size());
+        for (size_t i = 0; i < node.m_outgoing.size(); i++) {
+            ASSERT_EQ(cached_node.m_outgoing[i].m_render_attrs.m_trajectory,
+                      node.m_outgoing[i].m_render_attrs.m_trajectory);
+            ASSERT_EQ(cached_node.m_outgoing[i].m_render_attrs.m_label_quads.size(),
+                      node.m_outgoing[i].m_render_attrs.m_label_quads.size());
+        }
+    }
+
+    // layout settings are part of the key
+    const float og_tolerance = BARYCENTER_X_OPTIMIZATION_CONVERGENCE_TOLERANCE;
+    BARYCENTER_X_OPTIMIZATION_CONVERGENCE_TOLERANCE = -1.0f;
+    ASSERT_NE(layout::getLayoutCacheKey(Digraph{dot_source}, glyph_loader),
+              layout::getLayoutCacheKey(computed, glyph_loader));
+    BARYCENTER_X_OPTIMIZATION_CONVERGENCE_TOLERANCE = og_tolerance;
+
+    // a corrupt entry is a miss and gets replaced
+    const std::filesystem::path entry = std::filesystem::directory_iterator(cache_dir)->path();
+    std::filesystem::resize_file(entry, std::filesystem::file_size(entry) / 2);
+    Digraph recomputed{dot_source};
+    recomputed.preprocess(glyph_loader);
+    ASSERT_FALSE(recomputed.m_x_opt_trajectory.empty());
+    Digraph cached_again{dot_source};
+    cached_again.preprocess(glyph_loader);
+    ASSERT_TRUE(cached_again.m_x_opt_trajectory.empty());
+
+    // an entry stored under the same hash for a different graph (a hash collision) is a miss: fake one by copying the
+    // entry and overwriting the hash after the magic and the format version
+    const std::string colliding_source = R"(digraph Colliding { P -> Q; })";
+    const uint64_t colliding_hash = layout::getLayoutCacheKey(Digraph{colliding_source}, glyph_loader).m_hash;
+    std::ostringstream colliding_name;
+    colliding_name << std::hex << colliding_hash << ".punktlayout";
+    std::filesystem::copy_file(entry, cache_dir / colliding_name.str());
+    {
+        std::fstream file(cache_dir / colliding_name.str(), std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(8 + sizeof(uint32_t));
+        file.write(reinterpret_cast<const char *>(&colliding_hash), sizeof(colliding_hash));
+    }
+    Digraph colliding{colliding_source};
+    colliding.preprocess(glyph_loader);
+    ASSERT_FALSE(colliding.m_x_opt_trajectory.empty());
+    ASSERT_TRUE(colliding.m_nodes.contains("P"));
+    ASSERT_FALSE(colliding.m_nodes.contains("A"));
+    std::filesystem::remove(cache_dir / colliding_name.str());
+
+    // eviction keeps the cache below the size limit, dropping the least recently used entries
+    const size_t og_max_bytes = LAYOUT_CACHE_MAX_BYTES;
+    LAYOUT_CACHE_MAX_BYTES = std::filesystem::file_size(entry) + 1;
+    Digraph other{std::string(R"(digraph Other { X -> Y; })")};
+    other.preprocess(glyph_loader);
+    ASSERT_EQ(countCacheFiles(), 1);
+    ASSERT_FALSE(std::filesystem::exists(entry));
+    LAYOUT_CACHE_MAX_BYTES = og_max_bytes;
+
+    LAYOUT_CACHE_DIRECTORY = og_cache_dir;
+    std::filesystem::remove_all(cache_dir);
+}
+
+TEST(preprocessing, IncrementalRelayout) {
+    const std::string dot_source = R"(
+        digraph IncrementalRelayoutTest {
+            A -> B;
+            A -> C;
+            B -> D;
+            C -> D;
+        }
+    )";
+    render::glyph::GlyphLoader glyph_loader;
+    Digraph dg{dot_source};
+    dg.preprocess(glyph_loader);
+    const size_t n_old_nodes = dg.m_nodes.size();
+    std::unordered_map<std::string_view, NodeRenderAttrs> old_attrs;
+    for (const auto &[name, node]: dg.m_nodes) {
+        old_attrs.emplace(name, node.m_render_attrs);
+    }
+
+    // A -> E spans several ranks and needs ghost nodes
+    dg.update(std::string("digraph { D -> E; A -> F; A -> E; E [label=\"a much wider label\"]; }"));
+    ASSERT_FALSE(dg.m_dirty_region.isEmpty());
+    ASSERT_FALSE(dg.m_dirty_region.m_requires_full_layout);
+    ASSERT_EQ(dg.m_dirty_region.m_added_nodes.size(), 2);
+    ASSERT_EQ(dg.m_dirty_region.m_added_edges.size(), 3);
+    dg.relayout(glyph_loader);
+    ASSERT_TRUE(dg.m_dirty_region.isEmpty());
+
+    const auto &attrs = [&](const std::string_view name) -> const NodeRenderAttrs & {
+        return dg.m_nodes.at(name).m_render_attrs;
+    };
+    // existing nodes keep their ranks, the unaffected ranks keep their positions unless the graph had to grow left
+    for (const auto &[name, old]: old_attrs) {
+        ASSERT_EQ(attrs(name).m_rank, old.m_rank);
+    }
+    const ssize_t shift = static_cast<ssize_t>(attrs("D").m_x) - static_cast<ssize_t>(old_attrs.at("D").m_x);
+    ASSERT_GE(shift, 0);
+    ASSERT_EQ(attrs("D").m_y, old_attrs.at("D").m_y);
+    ASSERT_EQ(attrs("E").m_rank, attrs("D").m_rank + 1);
+    ASSERT_EQ(attrs("F").m_rank, attrs("A").m_rank + 1);
+    ASSERT_GT(attrs("E").m_y, attrs("D").m_y);
+
+    // ids stay dense, the added nodes are appended
+    std::vector<bool> seen_ids(dg.m_nodes.size());
+    for (const auto &[name, node]: dg.m_nodes) {
+        ASSERT_LT(node.m_id, seen_ids.size());
+        ASSERT_FALSE(seen_ids[node.m_id]);
+        seen_ids[node.m_id] = true;
+    }
+    ASSERT_GE(dg.m_nodes.at("E").m_id, n_old_nodes);
+    ASSERT_GE(dg.m_nodes.at("F").m_id, n_old_nodes);
+    ASSERT_GT(dg.m_n_ghost_nodes, 0);
+
+    // no overlaps within a rank, every visible edge is routed
+    for (const std::vector<std::string_view> &ordering: dg.m_per_rank_orderings) {
+        for (size_t i = 1; i < ordering.size(); i++) {
+            ASSERT_GE(attrs(ordering[i]).m_x, attrs(ordering[i - 1]).m_x + attrs(ordering[i - 1]).m_width);
+        }
+    }
+    for (const auto &[name, node]: dg.m_nodes) {
+        for (const Edge &edge: node.m_outgoing) {
+            ASSERT_EQ(edge.m_render_attrs.m_trajectory.empty(), !edge.m_render_attrs.m_is_visible);
+        }
+    }
+    ASSERT_GE(dg.m_render_attrs.m_graph_width, attrs("E").m_x + attrs("E").m_width);
+    ASSERT_GE(dg.m_render_attrs.m_graph_height, attrs("E").m_y + attrs("E").m_height);
+
+    // redeclaring a node falls back to a full layout, which matches laying out the combined source from scratch
+    const std::string extra_source = "digraph { B [label=\"B2\"]; }";
+    dg.update(extra_source);
+    ASSERT_TRUE(dg.m_dirty_region.m_requires_full_layout);
+    dg.relayout(glyph_loader);
+    Digraph reference{std::string(R"(
+        digraph IncrementalRelayoutTest {
+            A -> B;
+            A -> C;
+            B -> D;
+            C -> D;
+            D -> E;
+            A -> F;
+            A -> E;
+            E [label="a much wider label"];
+            B [label="B2"];
+        }
+    )")};
+    reference.preprocess(glyph_loader);
+    ASSERT_EQ(dg.m_nodes.size(), reference.m_nodes.size());
+    for (const auto &[name, node]: reference.m_nodes) {
+        ASSERT_EQ(attrs(name).m_x, node.m_render_attrs.m_x);
+        ASSERT_EQ(attrs(name).m_y, node.m_render_attrs.m_y);
+    }
+}
+
+TEST(preprocessing, WatchModeReload) {
+    const std::string dot_source = R"(
+        digraph WatchTest {
+            A -> B;
+            A -> C;
+            B -> D;
+        }
+    )";
+    render::glyph::GlyphLoader glyph_loader;
+    render::GraphReloader reloader(dot_source, glyph_loader);
+    const auto countNodeQuads = [&](const std::string &source) {
+        Digraph dg{source};
+        dg.preprocess(glyph_loader);
+        return render::RenderInstanceData(dg).m_node_quads.size();
+    };
+
+    // formatting and comments do not change the token stream
+    ASSERT_FALSE(reloader.reload("digraph WatchTest { A->B; A->C;\n# unused\nB->D; }").has_value());
+    ASSERT_EQ(reloader.getNumIncrementalReloads() + reloader.getNumFullReloads(), 0);
+
+    // appended statements are applied to the laid out graph
+    const std::string appended_source = "digraph WatchTest { A->B; A->C; B->D; D -> E; C -> E; }";
+    std::optional<render::RenderInstanceData> data = reloader.reload(appended_source);
+    ASSERT_TRUE(data.has_value());
+    ASSERT_EQ(reloader.getNumIncrementalReloads(), 1);
+    ASSERT_EQ(reloader.getNumFullReloads(), 0);
+    ASSERT_EQ(data->m_node_quads.size(), countNodeQuads(appended_source));
+
+    // invalid sources throw and keep the previous version current
+    ASSERT_ANY_THROW(reloader.reload("digraph WatchTest { A->B; A->C; B->D; D -> E; C -> E; F -> }"));
+    const std::string appended_again = "digraph WatchTest { A->B; A->C; B->D; D -> E; C -> E; E -> F; }";
+    data = reloader.reload(appended_again);
+    ASSERT_TRUE(data.has_value());
+    ASSERT_EQ(data->m_node_quads.size(), countNodeQuads(appended_again));
+
+    // any other change is laid out from scratch
+    const std::string modified_source = "digraph WatchTest { A->B; B->D; D -> E; }";
+    const size_t n_full_reloads = reloader.getNumFullReloads();
+    data = reloader.reload(modified_source);
+    ASSERT_TRUE(data.has_value());
+    ASSERT_EQ(reloader.getNumFullReloads(), n_full_reloads + 1);
+    ASSERT_EQ(data->m_node_quads.size(), countNodeQuads(modified_source));
+}
+
+TEST(preprocessing, ClusterLayoutMemo) {
+    // the same structure with different names and statement order. f and g are interchangeable.
+    const std::string first_source = R"(digraph { a1 -> b1; a1 -> c1; b1 -> d1; c1 -> d1 [label="cd"]; a1 -> d1;
+        c1 -> e1; d1 -> f1; d1 -> g1; })";
+    const std::string second_source = R"(digraph { d2 -> g2; c2 -> e2; d2 -> f2; a2 -> d2; c2 -> d2 [label="cd"];
+        b2 -> d2; a2 -> c2; a2 -> b2; })";
+    render::glyph::GlyphLoader glyph_loader;
+    layout::ClusterLayoutMemo memo;
+    const test::SettingOverride record_trajectory(BARYCENTER_X_OPTIMIZATION_RECORD_TRAJECTORY, true);
+
+    Digraph first{first_source};
+    ASSERT_FALSE(memo.preprocess(first, glyph_loader, ""));
+    ASSERT_FALSE(first.m_x_opt_trajectory.empty());
+    Digraph second{second_source};
+    ASSERT_TRUE(memo.preprocess(second, glyph_loader, ""));
+    ASSERT_TRUE(second.m_x_opt_trajectory.empty());
+    ASSERT_EQ(second.m_nodes.size(), first.m_nodes.size());
+    ASSERT_EQ(second.m_render_attrs.m_graph_width, first.m_render_attrs.m_graph_width);
+    ASSERT_EQ(second.m_render_attrs.m_graph_height, first.m_render_attrs.m_graph_height);
+    for (const std::string name: {"a", "b", "c", "d", "e"}) {
+        const Node &node = first.m_nodes.at(name + "1");
+        const Node &copied_node = second.m_nodes.at(name + "2");
+        ASSERT_EQ(copied_node.m_render_attrs.m_x, node.m_render_attrs.m_x);
+        ASSERT_EQ(copied_node.m_render_attrs.m_y, node.m_render_attrs.m_y);
+        ASSERT_EQ(copied_node.m_render_attrs.m_quads.size(), node.m_render_attrs.m_quads.size());
+        ASSERT_EQ(copied_node.m_ingoing.size(), node.m_ingoing.size());
+        ASSERT_EQ(copied_node.m_outgoing.size(), node.m_outgoing.size());
+    }
+    ASSERT_EQ(second.m_nodes.at("f2").m_render_attrs.m_y, first.m_nodes.at("f1").m_render_attrs.m_y);
+    const render::RenderInstanceData first_data(first), second_data(second);
+    ASSERT_EQ(second_data.m_node_quads.size(), first_data.m_node_quads.size());
+    ASSERT_EQ(second_data.m_edge_line_points.size(), first_data.m_edge_line_points.size());
+    ASSERT_EQ(second_data.m_edge_spline_points.size(), first_data.m_edge_spline_points.size());
+
+    // a different structure or a node of a different size needs its own layout
+    Digraph other_structure{std::string(R"(digraph { a3 -> b3; a3 -> c3; b3 -> d3; c3 -> d3 [label="cd"]; a3 -> d3;
+        c3 -> e3; d3 -> f3; e3 -> g3; })")};
+    ASSERT_FALSE(memo.preprocess(other_structure, glyph_loader, ""));
+    Digraph other_size{std::string(R"(digraph { a4 -> b4; a4 -> c4; b4 -> d4; c4 -> d4 [label="cd"]; a4 -> d4;
+        c4 -> e4; d4 -> f4; d4 -> g4; b4 [label="a much longer label"]; })")};
+    ASSERT_FALSE(memo.preprocess(other_size, glyph_loader, ""));
+
+    // rank constraints refer to nodes by name, such graphs are not memoized
+    const Digraph constrained{std::string(R"(digraph { A -> B; { rank=same; A; B; } })")};
+    ASSERT_FALSE(layout::computeClusterCanonicalForm(constrained, glyph_loader).has_value());
+}
+
+TEST(preprocessing, ClusterLayoutMemoKeepsClusterLabels) {
+    // sibling clusters that only differ in render-only attrs share a layout but keep their own label and color
+    const std::string dot_source = R"(
+        digraph {
+            subgraph cluster_a {
+                label="service 12";
+                color=red;
+                A1 -> A2;
+                A1 -> A3;
+                A2 -> A4;
+                A3 -> A4;
+                A1 -> A4;
+            }
+            subgraph cluster_b {
+                label="service 21";
+                color=blue;
+                B1 -> B2;
+                B1 -> B3;
+                B2 -> B4;
+                B3 -> B4;
+                B1 -> B4;
+            }
+            C -> A1;
+            C -> B1;
+        }
+    )";
+    render::glyph::GlyphLoader glyph_loader;
+    const test::SettingOverride record_trajectory(BARYCENTER_X_OPTIMIZATION_RECORD_TRAJECTORY, true);
+    Digraph dg{dot_source};
+    dg.preprocess(glyph_loader);
+
+    const Digraph &a = dg.m_clusters.at("cluster_a"), &b = dg.m_clusters.at("cluster_b");
+    // exactly one of the clusters was laid out, the other one reused its layout
+    ASSERT_NE(a.m_x_opt_trajectory.empty(), b.m_x_opt_trajectory.empty());
+    ASSERT_EQ(getAttrOrDefault(b.m_attrs, "color", ""), "blue");
+    const auto getLabelText = [](const Digraph &cluster_dg) {
+        std::string text;
+        for (const GlyphQuad &gq: cluster_dg.m_render_attrs.m_label_quads) {
+            text.push_back(static_cast<char>(gq.m_c.c));
+        }
+        return text;
+    };
+    ASSERT_EQ(getLabelText(a), "service 12");
+    ASSERT_EQ(getLabelText(b), "service 21");
+    // the labels sit at the same place within their clusters
+    const GlyphQuad &label_a = a.m_render_attrs.m_label_quads.front(), &label_b = b.m_render_attrs.m_label_quads.front();
+    ASSERT_EQ(label_a.m_left - a.m_render_attrs.m_graph_x, label_b.m_left - b.m_render_attrs.m_graph_x);
+    ASSERT_EQ(label_a.m_top - a.m_render_attrs.m_graph_y, label_b.m_top - b.m_render_attrs.m_graph_y);
+}
+
+TEST(preprocessing, BottomUpClusterLayout) {
+    const std::string dot_source = R"(
+        digraph {
+            subgraph cluster_x {
+                X1 -> X2;
+                X2 -> X3;
+            }
+            subgraph cluster_y {
+                Y1 -> Y2;
+                subgraph cluster_z {
+                    Z1 -> Z2;
+                }
+                Y2 -> Z1;
+            }
+            A -> X1;
+            A -> Y1;
+            X1 -> B;
+        }
+    )";
+    render::glyph::GlyphLoader glyph_loader;
+    Digraph dg{dot_source};
+    dg.preprocess(glyph_loader);
+
+    // the super nodes are sized by their (already laid out) clusters before coordinate assignment of the parent
+    const auto expectSizedSuperNode = [](const Digraph &parent, const std::string &cluster_id) {
+        const Digraph &cluster_dg = parent.m_clusters.at(cluster_id);
+        const Node &super_node = parent.m_nodes.at("@" + cluster_id);
+        ASSERT_GT(cluster_dg.m_render_attrs.m_graph_width, 0);
+        ASSERT_EQ(super_node.m_render_attrs.m_width, cluster_dg.m_render_attrs.m_graph_width);
+        ASSERT_EQ(super_node.m_render_attrs.m_height, cluster_dg.m_render_attrs.m_graph_height);
+    };
+    expectSizedSuperNode(dg, "cluster_x");
+    expectSizedSuperNode(dg, "cluster_y");
+    expectSizedSuperNode(dg.m_clusters.at("cluster_y"), "cluster_z");
+    ASSERT_GE(dg.m_nodes.at("@cluster_y").m_render_attrs.m_height,
+              dg.m_clusters.at("cluster_y").m_nodes.at("@cluster_z").m_render_attrs.m_height);
+
+    // links into clusters are edges of the super nodes
+    ASSERT_FALSE(dg.m_nodes.contains("X1"));
+    ASSERT_EQ(dg.m_nodes.at("@cluster_x").m_render_attrs.m_rank, dg.m_nodes.at("A").m_render_attrs.m_rank + 1);
+    ASSERT_EQ(dg.m_nodes.at("B").m_render_attrs.m_rank, dg.m_nodes.at("@cluster_x").m_render_attrs.m_rank + 1);
+
+    // the super nodes take part in the single coordinate assignment like any node, so nothing overlaps them
+    for (const Node &a: std::views::values(dg.m_nodes)) {
+        for (const Node &b: std::views::values(dg.m_nodes)) {
+            if (&a == &b) {
+                continue;
+            }
+            const NodeRenderAttrs &ra = a.m_render_attrs, &rb = b.m_render_attrs;
+            ASSERT_TRUE(ra.m_x + ra.m_width <= rb.m_x || rb.m_x + rb.m_width <= ra.m_x ||
+                ra.m_y + ra.m_height <= rb.m_y || rb.m_y + rb.m_height <= ra.m_y);
+        }
+    }
+    const render::RenderInstanceData data(dg);
+    ASSERT_FALSE(data.m_node_quads.empty());
+}
+
+TEST(preprocessing, LayoutExport) {
+    const std::string dot_source = R"(
+        digraph {
+            A -> B [label="ab"];
+            B -> C;
+            A -> C [label="long edge", color=red];
+            "node with spaces" -> A;
+        }
+    )";
+    render::glyph::GlyphLoader glyph_loader;
+    Digraph dg{dot_source};
+    dg.preprocess(glyph_loader);
+    ASSERT_TRUE(dg.m_nodes.at("A").m_render_attrs.m_rank + 2 == dg.m_nodes.at("C").m_render_attrs.m_rank);
+
+    std::ostringstream plain_out;
+    render::writeLayoutPlain(dg, plain_out);
+    std::istringstream plain(plain_out.str());
+    std::vector<std::string> node_lines, edge_lines;
+    std::string line, last_line;
+    std::getline(plain, line);
+    ASSERT_TRUE(line.starts_with("graph 1 "));
+    while (std::getline(plain, line)) {
+        if (line.starts_with("node ")) {
+            node_lines.push_back(line);
+        } else if (line.starts_with("edge ")) {
+            edge_lines.push_back(line);
+        }
+        last_line = line;
+    }
+    ASSERT_EQ(last_line, "stop");
+    // ghost nodes are not exported and the split edge is joined back into one
+    ASSERT_EQ(node_lines.size(), 4);
+    ASSERT_EQ(edge_lines.size(), 4);
+    ASSERT_TRUE(std::ranges::any_of(node_lines, [](const std::string &l) {
+        return l.starts_with(R"(node "node with spaces" )");
+    }));
+    const auto long_edge = std::ranges::find_if(edge_lines, [](const std::string &l) {
+        return l.starts_with("edge A C ");
+    });
+    ASSERT_NE(long_edge, edge_lines.end());
+    ASSERT_NE(long_edge->find(R"("long edge")"), std::string::npos);
+    ASSERT_TRUE(long_edge->ends_with(" solid red"));
+
+    // the node center of B, with y pointing up
+    const NodeRenderAttrs &ra = dg.m_nodes.at("B").m_render_attrs;
+    const double center_x = (static_cast<double>(ra.m_x) + static_cast<double>(ra.m_width) / 2.0) / 72.0;
+    const double center_y = (static_cast<double>(dg.m_render_attrs.m_graph_height) - static_cast<double>(ra.m_y) -
+                             static_cast<double>(ra.m_height) / 2.0) / 72.0;
+    const auto b_line = std::ranges::find_if(node_lines, [](const std::string &l) { return l.starts_with("node B "); });
+    ASSERT_NE(b_line, node_lines.end());
+    std::istringstream b_fields(b_line->substr(std::string_view("node B ").size()));
+    double x, y;
+    b_fields >> x >> y;
+    ASSERT_NEAR(x, center_x, 1e-4);
+    ASSERT_NEAR(y, center_y, 1e-4);
+
+    std::ostringstream json_out;
+    render::writeLayoutJson(dg, json_out);
+    const std::string json = json_out.str();
+    ASSERT_TRUE(json.starts_with(R"({"directed":true,"width":)"));
+    ASSERT_TRUE(json.ends_with("]}\n"));
+    ASSERT_NE(json.find(R"({"tail":"A","head":"C","points":[[)"), std::string::npos);
+    ASSERT_NE(json.find(R"("label":"long edge","label_x":)"), std::string::npos);
+    ASSERT_EQ(json.find(R"("name":"@)"), std::string::npos);
+
+    // sideways graphs are exported transposed, the way the renderer displays them
+    Digraph sideways{std::string("digraph { rankdir=LR; A -> B -> C; }")};
+    sideways.preprocess(glyph_loader);
+    std::ostringstream sideways_plain;
+    render::writeLayoutPlain(sideways, sideways_plain);
+    std::istringstream sideways_header(sideways_plain.str());
+    std::string graph_keyword;
+    double scale, width, height;
+    sideways_header >> graph_keyword >> scale >> width >> height;
+    ASSERT_NEAR(width, static_cast<double>(sideways.m_render_attrs.m_graph_height) / 72.0, 1e-4);
+    ASSERT_NEAR(height, static_cast<double>(sideways.m_render_attrs.m_graph_width) / 72.0, 1e-4);
+    std::ostringstream sideways_json;
+    render::writeLayoutJson(sideways, sideways_json);
+    // ranks go left to right
+    const std::string sideways_json_str = sideways_json.str();
+    const auto getJsonNodeX = [&](const std::string_view name) {
+        const size_t pos = sideways_json_str.find(R"("x":)", sideways_json_str.find(R"("name":")" + std::string(name)));
+        return std::stod(sideways_json_str.substr(pos + 4));
+    };
+    ASSERT_LT(getJsonNodeX("A"), getJsonNodeX("C"));
+}
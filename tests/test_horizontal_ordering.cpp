@@ -1,11 +1,15 @@
 #include "punkt/dot.hpp"
 #include "punkt/dot_constants.hpp"
 #include "punkt/utils/int_types.hpp"
+#include "punkt/layout/layered_graph.hpp"
+#include "test_utils.hpp"
 #include <gtest/gtest.h>
 #include <string>
 #include <vector>
 #include <string_view>
 #include <iostream>
+#include <algorithm>
+#include <ranges>
 
 using namespace punkt;
 
@@ -177,3 +181,195 @@ TEST(preprocessing, WeightWorks) {
         }
     }
 }
+
+TEST(preprocessing, MultiStartOrderingIsDeterministic) {
+    const std::string graph_body = R"(
+            A -> D; B -> D; C -> E; A -> F;
+            D -> G; E -> G; D -> H; B -> I;
+            F -> I; G -> J; H -> J; F -> G;
+            C -> H; E -> I; A -> J;
+        }
+    )";
+    const std::string multi_start_source =
+            "digraph MultiStart { punktxopt=false; punktorderingruns=16; punktorderingseed=42;" + graph_body;
+    // x optimization may reorder nodes within a rank, so it is disabled for a fair score comparison
+    const std::string default_source = "digraph Default { punktxopt=false;" + graph_body;
+
+    // the sweeps after multi-start ordering run as well, like they do in a real layout
+    const test::SettingOverride barycenter_iters(BARYCENTER_ORDERING_MAX_ITERS_PER_DIRECTION, static_cast<ssize_t>(5));
+    const test::SettingOverride bubble_iters(BUBBLE_ORDERING_MAX_ITERS, static_cast<ssize_t>(5));
+
+    render::glyph::GlyphLoader glyph_loader;
+    Digraph dg_a{multi_start_source}, dg_b{multi_start_source}, dg_default{default_source};
+    dg_a.preprocess(glyph_loader);
+    dg_b.preprocess(glyph_loader);
+    dg_default.preprocess(glyph_loader);
+
+    // same seed must produce the same orderings regardless of thread scheduling
+    ASSERT_EQ(dg_a.m_per_rank_orderings.size(), dg_b.m_per_rank_orderings.size());
+    for (size_t rank = 0; rank < dg_a.m_per_rank_orderings.size(); rank++) {
+        EXPECT_EQ(dg_a.m_per_rank_orderings[rank], dg_b.m_per_rank_orderings[rank]) << "Mismatch at rank " << rank;
+    }
+
+    // the engine keeps the best of its runs, and run 0 refines the current ordering, so it never makes it worse
+    const double swept_score = layout::LayeredGraph::fromDigraph(dg_default).getOrderingScore();
+    const std::vector<double> run_scores = layout::runMultiStartOrdering(dg_default, 16, 42, 24);
+    ASSERT_EQ(run_scores.size(), 16);
+    const double multi_start_score = layout::LayeredGraph::fromDigraph(dg_default).getOrderingScore();
+    EXPECT_DOUBLE_EQ(multi_start_score, std::ranges::min(run_scores));
+    EXPECT_LE(multi_start_score, swept_score);
+    EXPECT_LE(run_scores.front(), swept_score);
+}
+
+TEST(preprocessing, MultilevelOrderingKeepsRanksAndImprovesScore) {
+    // layered graph with 8 ranks of 40 nodes each and pseudo-random (but fixed) edges between neighbouring ranks
+    constexpr size_t n_ranks = 8, n_nodes_per_rank = 40;
+    std::string graph_body;
+    for (size_t rank = 0; rank + 1 < n_ranks; rank++) {
+        for (size_t i = 0; i < n_nodes_per_rank; i++) {
+            for (const size_t offset: {7, 13}) {
+                const size_t j = (i * offset + rank) % n_nodes_per_rank;
+                graph_body += "n" + std::to_string(rank) + "_" + std::to_string(i) + " -> n" +
+                        std::to_string(rank + 1) + "_" + std::to_string(j) + ";\n";
+            }
+        }
+    }
+    graph_body += "}";
+    const std::string multilevel_source = "digraph Multilevel { punktxopt=false; punktmultilevel=true;" + graph_body;
+    const std::string default_source = "digraph Default { punktxopt=false; punktmultilevel=false;" + graph_body;
+
+    // force several coarsening levels on this small graph
+    const test::SettingOverride coarsest_nodes(MULTILEVEL_ORDERING_COARSEST_NODES, static_cast<size_t>(16));
+
+    render::glyph::GlyphLoader glyph_loader;
+    Digraph dg_multilevel{multilevel_source}, dg_default{default_source};
+    dg_multilevel.preprocess(glyph_loader);
+    dg_default.preprocess(glyph_loader);
+
+    ASSERT_EQ(dg_multilevel.m_per_rank_orderings.size(), dg_default.m_per_rank_orderings.size());
+    for (size_t rank = 0; rank < dg_multilevel.m_per_rank_orderings.size(); rank++) {
+        auto multilevel_ordering = dg_multilevel.m_per_rank_orderings[rank];
+        auto default_ordering = dg_default.m_per_rank_orderings[rank];
+        std::ranges::sort(multilevel_ordering);
+        std::ranges::sort(default_ordering);
+        EXPECT_EQ(multilevel_ordering, default_ordering) << "Rank " << rank << " contains different nodes";
+    }
+
+    const double multilevel_score = layout::LayeredGraph::fromDigraph(dg_multilevel).getOrderingScore();
+    const double default_score = layout::LayeredGraph::fromDigraph(dg_default).getOrderingScore();
+    EXPECT_LT(multilevel_score, default_score);
+}
+
+TEST(preprocessing, ParallelSweepMatchesSequentialQuality) {
+    // 12 ranks of 30 nodes each with pseudo-random (but fixed) edges between neighbouring ranks
+    constexpr size_t n_ranks = 12, n_nodes_per_rank = 30;
+    std::string graph_body;
+    for (size_t rank = 0; rank + 1 < n_ranks; rank++) {
+        for (size_t i = 0; i < n_nodes_per_rank; i++) {
+            for (const size_t offset: {5, 11}) {
+                const size_t j = (i * offset + 3 * rank) % n_nodes_per_rank;
+                graph_body += "n" + std::to_string(rank) + "_" + std::to_string(i) + " -> n" +
+                        std::to_string(rank + 1) + "_" + std::to_string(j) + ";\n";
+            }
+        }
+    }
+    graph_body += "}";
+    const std::string parallel_source = "digraph Parallel { punktxopt=false; punktparallelsweep=true;" + graph_body;
+    const std::string sequential_source = "digraph Sequential { punktxopt=false; punktparallelsweep=false;" +
+                                          graph_body;
+    const std::string unordered_source = "digraph Unordered { punktxopt=false;" + graph_body;
+
+    render::glyph::GlyphLoader glyph_loader;
+    Digraph dg_unordered{unordered_source};
+    dg_unordered.preprocess(glyph_loader);
+
+    // small bands so this small graph actually gets split into several bands
+    const test::SettingOverride barycenter_iters(BARYCENTER_ORDERING_MAX_ITERS_PER_DIRECTION, static_cast<ssize_t>(5));
+    const test::SettingOverride band_size(PARALLEL_SWEEP_BAND_SIZE, static_cast<size_t>(3));
+    Digraph dg_parallel_a{parallel_source}, dg_parallel_b{parallel_source}, dg_sequential{sequential_source};
+    dg_parallel_a.preprocess(glyph_loader);
+    dg_parallel_b.preprocess(glyph_loader);
+    dg_sequential.preprocess(glyph_loader);
+
+    // the parallel mode must not depend on thread scheduling
+    ASSERT_EQ(dg_parallel_a.m_per_rank_orderings.size(), dg_parallel_b.m_per_rank_orderings.size());
+    for (size_t rank = 0; rank < dg_parallel_a.m_per_rank_orderings.size(); rank++) {
+        EXPECT_EQ(dg_parallel_a.m_per_rank_orderings[rank], dg_parallel_b.m_per_rank_orderings[rank])
+            << "Mismatch at rank " << rank;
+    }
+
+    const double parallel_score = layout::LayeredGraph::fromDigraph(dg_parallel_a).getOrderingScore();
+    const double sequential_score = layout::LayeredGraph::fromDigraph(dg_sequential).getOrderingScore();
+    const double unordered_score = layout::LayeredGraph::fromDigraph(dg_unordered).getOrderingScore();
+    ::testing::Test::RecordProperty("unordered_score", std::to_string(unordered_score));
+    ::testing::Test::RecordProperty("sequential_score", std::to_string(sequential_score));
+    ::testing::Test::RecordProperty("parallel_score", std::to_string(parallel_score));
+    EXPECT_LT(parallel_score, unordered_score);
+    EXPECT_LE(parallel_score, 1.25 * sequential_score);
+}
+
+TEST(preprocessing, NodePositionsMatchOrderings) {
+    const std::string dot_source = R"(
+        digraph Positions {
+            punktxopt=false;
+            A -> D; B -> D; C -> E; A -> F;
+            D -> G; E -> G; D -> H; B -> I;
+            F -> I; G -> J; H -> J; F -> G;
+        }
+    )";
+
+    // enable both reordering passes so positions are updated by reorders and by swaps
+    const test::SettingOverride barycenter_iters(BARYCENTER_ORDERING_MAX_ITERS_PER_DIRECTION, static_cast<ssize_t>(5));
+    const test::SettingOverride bubble_iters(BUBBLE_ORDERING_MAX_ITERS, static_cast<ssize_t>(100));
+
+    Digraph dg{dot_source};
+    render::glyph::GlyphLoader glyph_loader;
+    dg.preprocess(glyph_loader);
+
+    ASSERT_EQ(dg.m_node_positions.size(), dg.m_nodes.size());
+    std::vector<bool> is_id_used(dg.m_nodes.size());
+    for (const auto &ordering: dg.m_per_rank_orderings) {
+        for (size_t x = 0; x < ordering.size(); x++) {
+            const Node &node = dg.m_nodes.at(ordering[x]);
+            ASSERT_LT(node.m_id, dg.m_nodes.size());
+            EXPECT_FALSE(is_id_used[node.m_id]) << "Duplicate id " << node.m_id;
+            is_id_used[node.m_id] = true;
+            EXPECT_EQ(dg.m_node_positions[node.m_id], x) << "Wrong position of node " << node.m_name;
+        }
+    }
+}
+
+TEST(preprocessing, EdgeLayoutWeightsAreDense) {
+    const std::string dot_source = R"(
+        digraph Weights {
+            punktxopt=false;
+            A -> B [weight=5];
+            A -> C [constraint=false];
+            B -> D;
+            A -> D;
+        }
+    )";
+    Digraph dg{dot_source};
+    render::glyph::GlyphLoader glyph_loader;
+    dg.preprocess(glyph_loader);
+
+    size_t n_edges = 0;
+    std::vector<bool> is_id_used(dg.m_edge_layout_weights.size());
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        for (const Edge &edge: node.m_outgoing) {
+            n_edges++;
+            ASSERT_LT(edge.m_id, dg.m_edge_layout_weights.size());
+            EXPECT_FALSE(is_id_used[edge.m_id]) << "Duplicate edge id " << edge.m_id;
+            is_id_used[edge.m_id] = true;
+            size_t expected_weight = 1;
+            if (edge.m_source == "A" && edge.m_dest == "B") {
+                expected_weight = 5;
+            } else if (edge.m_source == "A" && edge.m_dest == "C") {
+                expected_weight = 0;
+            }
+            EXPECT_EQ(dg.m_edge_layout_weights[edge.m_id], expected_weight)
+                << "Wrong weight for " << edge.m_source << " -> " << edge.m_dest;
+        }
+    }
+    EXPECT_EQ(n_edges, dg.m_edge_layout_weights.size());
+}
@@ -0,0 +1,137 @@
+#include "punkt/dot.hpp"
+#include "punkt/snapshot.hpp"
+#include "punkt/layout_export.hpp"
+#include "punkt/layout_server.hpp"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace punkt;
+
+#if defined(__unix__) || defined(__APPLE__)
+namespace {
+// runs the server on its own thread and stops and joins it when the test ends, also when an assertion fails early
+class ServerThread {
+    LayoutServer &m_server;
+    std::thread m_thread;
+
+public:
+    explicit ServerThread(LayoutServer &server)
+        : m_server(server), m_thread(&LayoutServer::run, &server) {
+    }
+
+    ~ServerThread() {
+        stop();
+    }
+
+    ServerThread(const ServerThread &) = delete;
+
+    ServerThread &operator=(const ServerThread &) = delete;
+
+    void stop() {
+        m_server.stop();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+};
+}
+
+static void sendLayoutRequest(const int fd, const uint32_t request_id, const LayoutServerFormat format,
+                              const std::string_view source) {
+    std::string frame;
+    for (const uint32_t value: {static_cast<uint32_t>(sizeof(uint32_t) + 1 + source.size()), request_id}) {
+        for (size_t i = 0; i < sizeof(uint32_t); i++) {
+            frame.push_back(static_cast<char>(value >> (8 * i) & 0xff));
+        }
+    }
+    frame.push_back(static_cast<char>(format));
+    frame.append(source);
+    ASSERT_EQ(write(fd, frame.data(), frame.size()), static_cast<ssize_t>(frame.size()));
+}
+
+static void readExactly(const int fd, char *out, size_t size) {
+    while (size > 0) {
+        const ssize_t n = read(fd, out, size);
+        ASSERT_GT(n, 0);
+        out += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+static uint32_t readUint32(const int fd) {
+    unsigned char bytes[sizeof(uint32_t)]{};
+    readExactly(fd, reinterpret_cast<char *>(bytes), sizeof(bytes));
+    return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+}
+
+TEST(layout_server, PipelinedRequests) {
+    LayoutServerConfig config;
+    config.m_socket_path = std::filesystem::temp_directory_path() / "punkt_layout_server_test.sock";
+    config.m_n_threads = 2;
+    config.m_max_request_bytes = 1024;
+    render::glyph::GlyphLoader glyph_loader;
+    LayoutServer server(config, glyph_loader);
+    ServerThread server_thread(server);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(fd, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, config.m_socket_path.c_str(), sizeof(address.sun_path) - 1);
+    ASSERT_EQ(connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)), 0);
+
+    // pipelined, the responses come back in any order. The oversized request is skipped without breaking the framing
+    // of the requests after it.
+    const std::string dot_source = "digraph { A -> B [label=\"ab\"]; A -> C; B -> D; C -> D; }";
+    const std::string oversized_source = "digraph { " + std::string(config.m_max_request_bytes, ' ') + "A; }";
+    sendLayoutRequest(fd, 1, LayoutServerFormat::snapshot, dot_source);
+    sendLayoutRequest(fd, 2, LayoutServerFormat::json, dot_source);
+    sendLayoutRequest(fd, 3, LayoutServerFormat::json, "digraph { A -> ; }");
+    sendLayoutRequest(fd, 4, static_cast<LayoutServerFormat>(7), dot_source);
+    sendLayoutRequest(fd, 5, LayoutServerFormat::json, oversized_source);
+    sendLayoutRequest(fd, 6, LayoutServerFormat::json, dot_source);
+    std::unordered_map<uint32_t, std::pair<LayoutServerStatus, std::string> > responses;
+    for (size_t i = 0; i < 6; i++) {
+        const uint32_t payload_size = readUint32(fd);
+        ASSERT_GE(payload_size, sizeof(uint32_t) + 1);
+        const uint32_t request_id = readUint32(fd);
+        char status{};
+        readExactly(fd, &status, 1);
+        std::string body(payload_size - sizeof(uint32_t) - 1, '\0');
+        readExactly(fd, body.data(), body.size());
+        responses.emplace(request_id, std::pair(static_cast<LayoutServerStatus>(status), std::move(body)));
+    }
+    close(fd);
+    server_thread.stop();
+    ASSERT_EQ(responses.size(), 6);
+    ASSERT_EQ(server.getNumServedRequests(), 3);
+
+    // the layouts match a local one
+    Digraph dg{dot_source};
+    dg.preprocess(glyph_loader);
+    ASSERT_EQ(responses.at(1).first, LayoutServerStatus::ok);
+    ASSERT_EQ(responses.at(1).second, render::serializeSnapshot(dg, glyph_loader));
+    ASSERT_EQ(responses.at(2).first, LayoutServerStatus::ok);
+    std::ostringstream json;
+    render::writeLayoutJson(dg, json);
+    ASSERT_EQ(responses.at(2).second, json.str());
+    ASSERT_EQ(responses.at(3).first, LayoutServerStatus::error);
+    ASSERT_EQ(responses.at(4).first, LayoutServerStatus::error);
+    ASSERT_EQ(responses.at(5).first, LayoutServerStatus::error);
+    ASSERT_EQ(responses.at(5).second, "Graph too large");
+    ASSERT_EQ(responses.at(6).first, LayoutServerStatus::ok);
+    ASSERT_EQ(responses.at(6).second, json.str());
+}
+#endif
@@ -544,3 +544,54 @@ TEST(parser, ComplexCyclicTest) {
         EXPECT_EQ(incT.m_attrs.at(key), val);
     }
 }
+
+TEST(parser, LazyClusterLinks) {
+    const std::string dot_source = R"(
+        digraph LazyLinkTest {
+            A;
+            B;
+            C;
+            subgraph cluster_x {
+                X1 -> X2;
+                X1 -> A;
+            }
+            subgraph cluster_y {
+                Y1;
+                subgraph cluster_z {
+                    Z1 -> X2;
+                }
+            }
+            A -> Y1;
+            B -> Z1;
+        }
+    )";
+    const Digraph dg{dot_source};
+    const auto getLink = [](const Digraph &graph, const std::string_view name) {
+        const Node &node = graph.m_nodes.at(name);
+        return node.m_attrs.contains("@link") ? std::string(node.m_attrs.at("@link")) : std::string();
+    };
+
+    // link nodes only exist for names that are referenced across a cluster border
+    const Digraph &x = dg.m_clusters.at("cluster_x");
+    ASSERT_EQ(x.m_nodes.size(), 3);
+    ASSERT_EQ(getLink(x, "X1"), "");
+    ASSERT_EQ(getLink(x, "A"), "parent");
+
+    const Digraph &y = dg.m_clusters.at("cluster_y");
+    const Digraph &z = y.m_clusters.at("cluster_z");
+    ASSERT_EQ(z.m_nodes.size(), 2);
+    ASSERT_EQ(getLink(z, "Z1"), "");
+    ASSERT_EQ(getLink(z, "X2"), "parent");
+    ASSERT_EQ(y.m_nodes.size(), 3);
+    ASSERT_EQ(getLink(y, "Y1"), "");
+    ASSERT_EQ(getLink(y, "X2"), "parent");
+    ASSERT_EQ(getLink(y, "Z1"), "cluster_0");
+
+    ASSERT_EQ(dg.m_nodes.size(), 6);
+    ASSERT_EQ(getLink(dg, "C"), "");
+    ASSERT_EQ(getLink(dg, "X2"), "cluster_0");
+    ASSERT_EQ(getLink(dg, "Y1"), "cluster_1");
+    ASSERT_EQ(getLink(dg, "Z1"), "cluster_1");
+    ASSERT_FALSE(dg.m_nodes.contains("X1"));
+    ASSERT_EQ(dg.m_nodes.at("B").m_outgoing.at(0).m_dest, "Z1");
+}
@@ -0,0 +1,89 @@
+#include "punkt/dot.hpp"
+#include "punkt/gl_renderer.hpp"
+#include "punkt/snapshot.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace punkt;
+
+TEST(snapshot, RoundTrip) {
+    const std::string dot_source = R"(
+        digraph {
+            A -> B [label="ab"];
+            A -> C;
+            B -> D;
+            C -> D;
+            A -> D [label="long edge"];
+        }
+    )";
+    render::glyph::GlyphLoader glyph_loader;
+    Digraph dg{dot_source};
+    dg.preprocess(glyph_loader);
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "punkt_snapshot_test.punktsnap";
+    render::writeSnapshot(dg, glyph_loader, path);
+
+    const render::Snapshot snapshot(path);
+    ASSERT_EQ(snapshot.getFontFingerprint(), glyph_loader.getFontFingerprint());
+    ASSERT_EQ(snapshot.getNodes().size(), dg.m_nodes.size());
+    size_t n_edges = 0;
+    for (const render::SnapshotNode &snapshot_node: snapshot.getNodes()) {
+        const Node &node = dg.m_nodes.at(snapshot.getString(snapshot_node.m_name));
+        ASSERT_EQ(snapshot_node.m_x, node.m_render_attrs.m_x);
+        ASSERT_EQ(snapshot_node.m_y, node.m_render_attrs.m_y);
+        ASSERT_EQ(snapshot_node.m_width, node.m_render_attrs.m_width);
+        ASSERT_EQ(snapshot_node.m_height, node.m_render_attrs.m_height);
+        ASSERT_EQ(snapshot.getGlyphQuads(snapshot_node.m_quads).size(), node.m_render_attrs.m_quads.size());
+        n_edges += node.m_outgoing.size();
+    }
+    ASSERT_EQ(snapshot.getEdges().size(), n_edges);
+    for (const render::SnapshotEdge &snapshot_edge: snapshot.getEdges()) {
+        const Node &source = dg.m_nodes.at(snapshot.getString(snapshot_edge.m_source));
+        const auto edge = std::ranges::find_if(source.m_outgoing, [&](const Edge &e) {
+            return e.m_dest == snapshot.getString(snapshot_edge.m_dest);
+        });
+        ASSERT_NE(edge, source.m_outgoing.end());
+        const auto trajectory = snapshot.getTrajectory(snapshot_edge.m_trajectory);
+        ASSERT_EQ(trajectory.size(), edge->m_render_attrs.m_trajectory.size());
+        for (size_t i = 0; i < trajectory.size(); i++) {
+            ASSERT_EQ(trajectory[i].x, edge->m_render_attrs.m_trajectory[i].x);
+            ASSERT_EQ(trajectory[i].y, edge->m_render_attrs.m_trajectory[i].y);
+        }
+        ASSERT_EQ(snapshot.getGlyphQuads(snapshot_edge.m_label_quads).size(),
+                  edge->m_render_attrs.m_label_quads.size());
+    }
+
+    // the instance data is restored byte for byte
+    const render::RenderInstanceData expected(dg), loaded(snapshot);
+    const auto expectSameBytes = [](const auto &a, const auto &b) {
+        ASSERT_EQ(a.size(), b.size());
+        ASSERT_EQ(std::memcmp(a.data(), b.data(), a.size() * sizeof(a[0])), 0);
+    };
+    ASSERT_EQ(loaded.m_graph_width, expected.m_graph_width);
+    ASSERT_EQ(loaded.m_graph_height, expected.m_graph_height);
+    ASSERT_EQ(std::memcmp(&loaded.m_digraph_quad, &expected.m_digraph_quad, sizeof(expected.m_digraph_quad)), 0);
+    expectSameBytes(loaded.m_node_quads, expected.m_node_quads);
+    expectSameBytes(loaded.m_edge_line_points, expected.m_edge_line_points);
+    expectSameBytes(loaded.m_edge_spline_points, expected.m_edge_spline_points);
+    expectSameBytes(loaded.m_edge_arrow_triangles, expected.m_edge_arrow_triangles);
+    ASSERT_FALSE(expected.m_char_quads.empty());
+    ASSERT_EQ(loaded.m_char_quads.size(), expected.m_char_quads.size());
+    for (const auto &[glyph, tracker]: expected.m_char_quads) {
+        const render::CharQuadInstanceTracker &loaded_tracker = loaded.m_char_quads.at(glyph);
+        ASSERT_EQ(std::memcmp(&loaded_tracker.m_quad, &tracker.m_quad, sizeof(tracker.m_quad)), 0);
+        expectSameBytes(loaded_tracker.m_instances, tracker.m_instances);
+    }
+
+    // truncated files and other files are rejected
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) / 2);
+    ASSERT_THROW(render::Snapshot{path}, render::InvalidSnapshotException);
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << dot_source;
+    }
+    ASSERT_THROW(render::Snapshot{path}, render::InvalidSnapshotException);
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,66 @@
+#include "punkt/dot.hpp"
+#include "punkt/layout_export.hpp"
+#include <gtest/gtest.h>
+#include <ranges>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+using namespace punkt;
+
+static size_t countOccurrences(const std::string_view s, const std::string_view what) {
+    size_t n = 0;
+    for (size_t pos = s.find(what); pos != std::string_view::npos; pos = s.find(what, pos + what.size())) {
+        n++;
+    }
+    return n;
+}
+
+TEST(svg_export, WritesSvg) {
+    const std::string dot_source = R"(
+        digraph {
+            A -> B [label="a<b"];
+            B -> C [style=dashed];
+            A -> C [label="long edge", color=red];
+            D [shape=none];
+            C -> D;
+        }
+    )";
+    render::glyph::GlyphLoader glyph_loader;
+    Digraph dg{dot_source};
+    dg.preprocess(glyph_loader);
+
+    size_t n_visible_segments = 0;
+    for (const Node &node: std::views::values(dg.m_nodes)) {
+        for (const Edge &edge: node.m_outgoing) {
+            n_visible_segments += !edge.m_render_attrs.m_trajectory.empty();
+        }
+    }
+    // the long edge is drawn as one path per ghost edge
+    ASSERT_GT(n_visible_segments, 4);
+
+    std::ostringstream out;
+    render::writeLayoutSvg(dg, out);
+    const std::string svg = out.str();
+    ASSERT_TRUE(svg.starts_with("<?xml"));
+    ASSERT_NE(svg.find("<svg "), std::string::npos);
+    ASSERT_TRUE(svg.ends_with("</svg>\n"));
+    // the graph box and every node but D (ghost nodes are not drawn)
+    ASSERT_EQ(countOccurrences(svg, "<rect ") + countOccurrences(svg, "<ellipse "), 4);
+    ASSERT_EQ(countOccurrences(svg, "<g class=\"node\">"), 4);
+    ASSERT_EQ(countOccurrences(svg, "<path "), n_visible_segments);
+    ASSERT_EQ(countOccurrences(svg, "<polygon "), 4);
+    ASSERT_EQ(countOccurrences(svg, "stroke-dasharray"), 1);
+    ASSERT_EQ(countOccurrences(svg, "stroke=\"#ff0000\""), n_visible_segments - 3);
+    ASSERT_NE(svg.find("&lt;"), std::string::npos);
+    ASSERT_EQ(svg.find("a<b"), std::string::npos);
+
+    // sideways graphs are transposed like the renderer does it
+    Digraph sideways{std::string("digraph { rankdir=LR; A -> B -> C; }")};
+    sideways.preprocess(glyph_loader);
+    std::ostringstream sideways_out;
+    render::writeLayoutSvg(sideways, sideways_out);
+    const std::string expected_size = "width=\"" + std::to_string(sideways.m_render_attrs.m_graph_height)
+                                      + "\" height=\"" + std::to_string(sideways.m_render_attrs.m_graph_width) + '"';
+    ASSERT_NE(sideways_out.str().find(expected_size), std::string::npos);
+}
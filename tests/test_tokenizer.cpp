@@ -48,3 +48,13 @@ TEST(tokenizer, StringTest) {
         Token("", Token::Type::eos),
     }));
 }
+
+TEST(tokenizer, TokenOffsets) {
+    constexpr std::string_view test_input = "digraph {\n  # comment\n  \"a b\" -> c; }";
+    Digraph dg;
+    std::vector<size_t> offsets;
+    const std::vector<Token> tokens = tokenize(dg, test_input, &offsets);
+
+    ASSERT_EQ(offsets.size(), tokens.size());
+    ASSERT_EQ(offsets, std::vector<size_t>({0, 8, 24, 30, 33, 34, 36, test_input.size()}));
+}
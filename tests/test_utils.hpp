@@ -0,0 +1,25 @@
+#pragma once
+
+namespace punkt::test {
+// Overrides a global layout setting until the end of the scope, so a failed assertion cannot leak the override into
+// later tests.
+template<typename T>
+class SettingOverride {
+    T &m_setting;
+    const T m_normal_value;
+
+public:
+    SettingOverride(T &setting, const T value)
+        : m_setting(setting), m_normal_value(setting) {
+        m_setting = value;
+    }
+
+    ~SettingOverride() {
+        m_setting = m_normal_value;
+    }
+
+    SettingOverride(const SettingOverride &) = delete;
+
+    SettingOverride &operator=(const SettingOverride &) = delete;
+};
+}
@@ -0,0 +1,138 @@
+#include "punkt/dot.hpp"
+#include "punkt/dot_constants.hpp"
+#include "punkt/layout/x_opt_profile.hpp"
+#include "test_utils.hpp"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace punkt;
+using namespace punkt::layout;
+
+TEST(profile, ParseProfile) {
+    const std::string profile_source = R"(
+        # global knobs
+        tolerance = 0.01
+        bubble_ordering_max_iters = 100
+        budget_full_size = 500
+
+        [stage]
+        repeats = 2
+        max_iters = -1
+        sweep_mode = innermost_loop
+        legalization = after_stage
+        legalizer = sweeps
+        explode_node_sep = 2.5
+        sweeps = up-group down@1
+
+        [stage]
+        max_iters = 7  # trailing comment
+    )";
+    const XOptProfile profile = parseXOptProfile(profile_source);
+
+    ASSERT_EQ(profile.m_convergence_tolerance, 0.01f);
+    ASSERT_EQ(profile.m_bubble_ordering_max_iters, 100);
+    ASSERT_EQ(profile.m_budget_full_size, 500);
+    ASSERT_FALSE(profile.m_barycenter_ordering_max_iters.has_value());
+
+    ASSERT_TRUE(profile.m_pipeline.has_value());
+    ASSERT_EQ(profile.m_pipeline->size(), 2);
+    const XOptPipelineStageSettings &first = profile.m_pipeline->at(0);
+    ASSERT_EQ(first.m_repeats, 2);
+    ASSERT_EQ(first.m_max_iters, -1);
+    ASSERT_EQ(first.m_sweep_mode, SweepMode::sweep_direction_is_innermost_loop);
+    ASSERT_EQ(first.m_legalizer_settings.m_legalization_timing,
+              XOptPipelineStageSettings::LegalizerSettings::LegalizationTiming::after_pipeline_stage);
+    ASSERT_EQ(first.m_legalizer_settings.m_algorithm,
+              XOptPipelineStageSettings::LegalizerSettings::Algorithm::outward_sweeps);
+    ASSERT_EQ(first.m_legalizer_settings.m_legalizer_special_instruction.m_explode_inter_group_node_sep_factor, 2.5f);
+    ASSERT_EQ(first.m_sweep_settings.size(), 2);
+    ASSERT_FALSE(first.m_sweep_settings[0].m_is_downward_sweep);
+    ASSERT_TRUE(first.m_sweep_settings[0].m_is_group_sweep);
+    ASSERT_TRUE(first.m_sweep_settings[1].m_is_downward_sweep);
+    ASSERT_EQ(first.m_sweep_settings[1].m_sweep_n_ranks_limit, 1);
+    ASSERT_EQ(profile.m_pipeline->at(1).m_max_iters, 7);
+}
+
+TEST(profile, RejectsUnknownKeysAndValues) {
+    ASSERT_ANY_THROW(parseXOptProfile("no_such_knob = 1"));
+    ASSERT_ANY_THROW(parseXOptProfile("[stage]; sweep_mode = sideways"));
+    ASSERT_ANY_THROW(parseXOptProfile("[stage]; sweeps = left"));
+    ASSERT_ANY_THROW(parseXOptProfile("tolerance"));
+}
+
+TEST(profile, IterationBudgetScalesWithGraphSize) {
+    const size_t og_full_size = ITERATION_BUDGET_FULL_SIZE;
+    ITERATION_BUDGET_FULL_SIZE = 1000;
+    ASSERT_EQ(scaleIterationBudget(10, 500), 10);
+    ASSERT_EQ(scaleIterationBudget(10, 1000), 10);
+    ASSERT_EQ(scaleIterationBudget(10, 4000), 3);
+    ASSERT_EQ(scaleIterationBudget(10, 1000000), 1);
+    ASSERT_EQ(scaleIterationBudget(-1, 1000000), -1);
+    ASSERT_EQ(scaleIterationBudget(0, 1000000), 0);
+    ITERATION_BUDGET_FULL_SIZE = 0;
+    ASSERT_EQ(scaleIterationBudget(10, 1000000), 10);
+    ITERATION_BUDGET_FULL_SIZE = og_full_size;
+}
+
+TEST(profile, InlineGraphPipeline) {
+    const std::string dot_source = R"(
+        digraph InlinePipelineTest {
+            punktxoptpipeline="tolerance = -1; [stage]; max_iters = 2; sweeps = up down";
+
+            A -> B;
+            A -> C;
+            B -> D;
+            C -> D;
+        }
+    )";
+    const test::SettingOverride record_trajectory(BARYCENTER_X_OPTIMIZATION_RECORD_TRAJECTORY, true);
+    Digraph dg{dot_source};
+    render::glyph::GlyphLoader glyph_loader;
+    dg.preprocess(glyph_loader);
+
+    // one measurement per iteration of the single inline stage, early termination disabled by the profile
+    ASSERT_EQ(dg.m_x_opt_trajectory.size(), 2);
+    for (const XOptIterationStats &stats: dg.m_x_opt_trajectory) {
+        ASSERT_EQ(stats.m_stage, 0);
+    }
+}
+
+TEST(profile, GraphProfileCannotSetGlobalKnobs) {
+    const std::string dot_source = R"(
+        digraph GlobalKnobTest {
+            punktxoptpipeline="budget_full_size = 1; [stage]; max_iters = 2";
+
+            A -> B;
+        }
+    )";
+    const Digraph dg{dot_source};
+    ASSERT_ANY_THROW(getGraphXOptProfile(dg));
+
+    // a profile file cannot be named from within a graph
+    const Digraph file_dg{std::string(R"(digraph { punktxoptprofile="/dev/zero"; A -> B; })")};
+    ASSERT_FALSE(getGraphXOptProfile(file_dg).m_pipeline.has_value());
+}
+
+TEST(profile, LoadProfileFile) {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "punkt_profile_test.punktprofile";
+    {
+        std::ofstream file(path);
+        file << "tolerance = 0.5\n[stage]\nmax_iters = 4\n";
+    }
+    const XOptProfile profile = loadXOptProfileFile(path.string());
+    ASSERT_EQ(profile.m_convergence_tolerance, 0.5f);
+    ASSERT_EQ(profile.m_pipeline->at(0).m_max_iters, 4);
+
+    // only regular files of bounded size are read
+    ASSERT_ANY_THROW(loadXOptProfileFile(std::filesystem::temp_directory_path().string()));
+    ASSERT_ANY_THROW(loadXOptProfileFile((std::filesystem::temp_directory_path() / "punkt_no_such_profile").string()));
+    {
+        std::ofstream file(path);
+        file << std::string(MAX_X_OPT_PROFILE_FILE_BYTES, '#') << "\n";
+    }
+    ASSERT_ANY_THROW(loadXOptProfileFile(path.string()));
+    std::filesystem::remove(path);
+}